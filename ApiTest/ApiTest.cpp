@@ -14,8 +14,10 @@
 #include <crtdbg.h>
 
 #include <cstdio>
+#include <cwchar>
 #include <exception>
 #include <iterator>
+#include <vector>
 
 #include "DirectXMath.h"
 
@@ -178,6 +180,20 @@ extern _Success_(return) bool Test19(_In_ ID3D12Device *device);
 extern _Success_(return) bool Test20(_In_ ID3D12Device *device);
 extern _Success_(return) bool Test21(_In_ ID3D12Device *device);
 extern _Success_(return) bool Test22(_In_ ID3D12Device *device);
+extern _Success_(return) bool Test23(_In_ ID3D12Device *device);
+extern _Success_(return) bool Test24(_In_ ID3D12Device *device);
+extern _Success_(return) bool Test25(_In_ ID3D12Device *device);
+extern _Success_(return) bool Test26(_In_ ID3D12Device *device);
+extern _Success_(return) bool Test27(_In_ ID3D12Device *device);
+extern _Success_(return) bool Test28(_In_ ID3D12Device *device);
+extern _Success_(return) bool Test29(_In_ ID3D12Device *device);
+extern _Success_(return) bool Test30(_In_ ID3D12Device *device);
+extern _Success_(return) bool Test31(_In_ ID3D12Device *device);
+extern _Success_(return) bool Test32(_In_ ID3D12Device *device);
+extern _Success_(return) bool Test33(_In_ ID3D12Device *device);
+extern _Success_(return) bool Test34(_In_ ID3D12Device *device);
+extern _Success_(return) bool Test35(_In_ ID3D12Device *device);
+extern _Success_(return) bool Test36(_In_ ID3D12Device *device);
 
 #ifdef TEST_AUDIO
 extern _Success_(return) bool TestA01(_In_ ID3D12Device *device);
@@ -192,6 +208,9 @@ const TestInfo g_Tests[] =
     { "CommonStates", Test02 },
     { "DescriptorHeap", Test18 },
     { "DescriptorPile", Test19 },
+    { "DescriptorCache", Test33 },
+    { "PipelineStateCache", Test34 },
+    { "PipelineLibrary", Test35 },
     { "DirectXHelpers", Test03 },
     { "ResourceUploadBatch", Test21 },
     { "GeometricPrimitive", Test04 },
@@ -204,6 +223,8 @@ const TestInfo g_Tests[] =
     { "PBREffect", Test12 },
     { "NPREffect", Test22 },
     { "Model", Test13 },
+    { "MeshOptimize", Test24 },
+    { "RecordingCommandList", Test26 },
     { "GamePad", Test14 },
     { "Keyboard", Test15 },
     { "Mouse", Test16 },
@@ -218,9 +239,23 @@ const TestInfo g_Tests[] =
 #endif
 };
 
+// Tests that also time large workloads. CTest runs these on their own, with a longer timeout.
+const TestInfo g_Benchmarks[] =
+{
+    { "DescriptorAllocator", Test32 },
+    { "WaveFrontReader", Test23 },
+    { "MeshOptimize (large meshes)", Test36 },
+    { "FrustumCull", Test25 },
+    { "DrawList", Test27 },
+    { "InstanceTransforms", Test28 },
+    { "GraphicsMemoryStress", Test29 },
+    { "SubresourceStaging", Test30 },
+    { "FileReadQueue", Test31 },
+};
+
 //-------------------------------------------------------------------------------------
 _Success_(return)
-bool RunTests(_In_ ID3D12Device *device)
+bool RunTests(_In_ ID3D12Device *device, bool tests, bool benchmarks)
 {
     if (!device)
         return false;
@@ -228,15 +263,21 @@ bool RunTests(_In_ ID3D12Device *device)
     size_t nPass = 1; // Test00 in wmain
     size_t nFail = 0;
 
-    for(size_t i=0; i < std::size(g_Tests); ++i)
+    std::vector<TestInfo> run;
+    if (tests)
+        run.insert(run.end(), std::begin(g_Tests), std::end(g_Tests));
+    if (benchmarks)
+        run.insert(run.end(), std::begin(g_Benchmarks), std::end(g_Benchmarks));
+
+    for(size_t i=0; i < run.size(); ++i)
     {
-        printf("%s: ", g_Tests[i].name );
+        printf("%s: ", run[i].name );
 
         bool passed = false;
 
         try
         {
-            passed = g_Tests[i].func(device);
+            passed = run[i].func(device);
         }
         catch(const std::exception& e)
         {
@@ -266,8 +307,19 @@ bool RunTests(_In_ ID3D12Device *device)
 
 
 //-------------------------------------------------------------------------------------
-int __cdecl wmain()
+int __cdecl wmain(int argc, wchar_t* argv[])
 {
+    // -bench runs only the benchmarks, and -nobench everything else
+    bool tests = true;
+    bool benchmarks = true;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!_wcsicmp(argv[i], L"-bench"))
+            tests = false;
+        else if (!_wcsicmp(argv[i], L"-nobench"))
+            benchmarks = false;
+    }
+
     printf("**************************************************************\n");
     printf("*** DirectX tool Kit for DX 12 API Test\n" );
     printf("**************************************************************\n");
@@ -322,7 +374,7 @@ int __cdecl wmain()
         return -1;
     }
 
-    if ( !RunTests(device.Get()) )
+    if ( !RunTests(device.Get(), tests, benchmarks) )
         return -1;
 
     return 0;
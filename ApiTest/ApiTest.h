@@ -0,0 +1,19 @@
+//--------------------------------------------------------------------------------------
+// File: ApiTest.h
+//
+// Helpers shared by the API tests and benchmarks
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkID=615561
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <chrono>
+
+inline double ElapsedMilliseconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
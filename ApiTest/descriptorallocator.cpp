@@ -0,0 +1,365 @@
+//--------------------------------------------------------------------------------------
+// File: descriptorallocator.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkID=615561
+//-------------------------------------------------------------------------------------
+
+#ifdef __MINGW32__
+#include <unknwn.h>
+#endif
+
+#include "DescriptorHeap.h"
+#include "PlatformHelpers.h"
+
+namespace DX
+{
+    using DirectX::ThrowIfFailed;
+}
+
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <wrl/client.h>
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    constexpr size_t c_reserve = 16;
+    constexpr size_t c_capacity = 8192;
+    constexpr size_t c_operationsPerThread = 100000;
+    constexpr size_t c_maxHeldPerThread = 64;
+    constexpr int c_unowned = -1;
+
+    // Mostly single descriptors, as for one texture, with some ranges, as for a model's textures.
+    size_t MakeCount(std::mt19937& rng)
+    {
+        return (rng() % 8) ? 1 : 2 + rng() % 15;
+    }
+
+    struct Held
+    {
+        DX::DescriptorAllocator::IndexType index;
+        size_t count;
+    };
+}
+
+_Success_(return)
+bool Test32(_In_ ID3D12Device* device)
+{
+    if (!device)
+        return false;
+
+    bool success = true;
+
+    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+    queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+
+    ComPtr<ID3D12CommandQueue> commandQueue;
+    HRESULT hr = device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(commandQueue.GetAddressOf()));
+    if (FAILED(hr))
+    {
+        printf("ERROR: Failed to create command queue (%08X)\n", static_cast<unsigned int>(hr));
+        return false;
+    }
+
+    std::unique_ptr<DescriptorPile> pile;
+    std::unique_ptr<DX::DescriptorAllocator> allocator;
+    try
+    {
+        pile = std::make_unique<DescriptorPile>(device,
+            D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE,
+            c_reserve + c_capacity * 2, c_reserve);
+
+        allocator = std::make_unique<DX::DescriptorAllocator>(device, *pile, c_capacity);
+    }
+    catch (const std::exception& e)
+    {
+        printf("ERROR: Failed creating descriptor allocator (except: %s)\n", e.what());
+        return false;
+    }
+
+    // Freed descriptors merge back into one block
+    try
+    {
+        std::vector<DX::DescriptorAllocator::IndexType> singles(c_capacity);
+        for (auto& it : singles)
+        {
+            it = allocator->Allocate();
+            if (it < c_reserve || it >= c_reserve + c_capacity)
+            {
+                printf("ERROR: Allocated index %zu outside the allocator's range\n", it);
+                success = false;
+                break;
+            }
+        }
+
+        DX::DescriptorAllocator::IndexType index;
+        if (allocator->TryAllocate(1, index))
+        {
+            printf("ERROR: Expected a full allocator to fail\n");
+            success = false;
+        }
+
+        std::mt19937 rng(1234);
+        std::shuffle(singles.begin(), singles.end(), rng);
+        for (auto it : singles)
+        {
+            allocator->FreeImmediate(it);
+        }
+
+        auto stats = allocator->GetStatistics();
+        if (stats.allocated != 0 || stats.freeBlocks != 1 || stats.largestFreeBlock != c_capacity)
+        {
+            printf("ERROR: Expected all free in one block (%zu allocated, %zu blocks, %zu largest)\n",
+                stats.allocated, stats.freeBlocks, stats.largestFreeBlock);
+            success = false;
+        }
+
+        const auto all = allocator->Allocate(c_capacity);
+        if (allocator->GetCpuHandle(all).ptr != pile->GetCpuHandle(all).ptr
+            || allocator->GetGpuHandle(all).ptr != pile->GetGpuHandle(all).ptr)
+        {
+            printf("ERROR: Handles do not match the pile's\n");
+            success = false;
+        }
+
+        // Deferred frees come back once the GPU passes the Commit
+        allocator->Free(all);
+
+        if (allocator->GetStatistics().pendingFree != c_capacity || allocator->TryAllocate(1, index))
+        {
+            printf("ERROR: Expected deferred frees to be held until Commit\n");
+            success = false;
+        }
+
+        allocator->Commit(commandQueue.Get());
+
+        allocator->FreeImmediate(allocator->Allocate(c_capacity));
+
+        stats = allocator->GetStatistics();
+        if (stats.pendingFree != 0 || stats.allocated != 0)
+        {
+            printf("ERROR: Expected deferred frees to be reclaimed (%zu pending, %zu allocated)\n", stats.pendingFree, stats.allocated);
+            success = false;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        printf("ERROR: Failed allocating descriptors (except: %s)\n", e.what());
+        return false;
+    }
+
+    // invalid args
+    {
+        const auto index = allocator->Allocate(4);
+
+        try
+        {
+            allocator->FreeImmediate(index + 1);
+
+            printf("ERROR: Failed to catch freeing inside an allocation\n");
+            success = false;
+        }
+        catch (const std::exception&)
+        {
+        }
+
+        allocator->Free(index);
+
+        try
+        {
+            allocator->Free(index);
+
+            printf("ERROR: Failed to catch a double free\n");
+            success = false;
+        }
+        catch (const std::exception&)
+        {
+        }
+
+        try
+        {
+            allocator->FreeImmediate(0);
+
+            printf("ERROR: Failed to catch freeing a reserved descriptor\n");
+            success = false;
+        }
+        catch (const std::exception&)
+        {
+        }
+
+        try
+        {
+            std::ignore = allocator->Allocate(0);
+
+            printf("ERROR: Failed to catch zero allocation\n");
+            success = false;
+        }
+        catch (const std::exception&)
+        {
+        }
+
+        allocator->Commit(commandQueue.Get());
+    }
+
+    // Concurrent allocation and freeing while the main thread commits each 'frame'
+    const unsigned int threadCount = std::max(4u, std::thread::hardware_concurrency());
+
+    std::vector<std::atomic<int>> owners(c_capacity);
+    for (auto& it : owners)
+        it = c_unowned;
+
+    std::atomic<bool> overlap(false);
+    std::atomic<bool> failed(false);
+    std::atomic<unsigned int> running(threadCount);
+
+    auto worker = [&](unsigned int thread)
+        {
+            std::mt19937 rng(static_cast<uint32_t>(0x5EED + thread));
+            std::vector<Held> held;
+            held.reserve(c_maxHeldPerThread);
+
+            auto claim = [&](const Held& h, int from, int to)
+                {
+                    for (size_t j = 0; j < h.count; ++j)
+                    {
+                        int expected = from;
+                        if (!owners[h.index - c_reserve + j].compare_exchange_strong(expected, to))
+                            overlap = true;
+                    }
+                };
+
+            try
+            {
+                for (size_t j = 0; j < c_operationsPerThread; ++j)
+                {
+                    if (held.size() == c_maxHeldPerThread || (!held.empty() && (rng() % 2)))
+                    {
+                        const size_t k = rng() % held.size();
+                        const Held h = held[k];
+                        held[k] = held.back();
+                        held.pop_back();
+
+                        claim(h, static_cast<int>(thread), c_unowned);
+
+                        if (rng() % 2)
+                            allocator->Free(h.index);
+                        else
+                            allocator->FreeImmediate(h.index);
+                    }
+                    else
+                    {
+                        Held h = { 0, MakeCount(rng) };
+                        if (allocator->TryAllocate(h.count, h.index))
+                        {
+                            claim(h, c_unowned, static_cast<int>(thread));
+                            held.push_back(h);
+                        }
+                    }
+                }
+
+                for (const auto& h : held)
+                {
+                    claim(h, static_cast<int>(thread), c_unowned);
+                    allocator->FreeImmediate(h.index);
+                }
+            }
+            catch (const std::exception&)
+            {
+                failed = true;
+            }
+
+            --running;
+        };
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    for (unsigned int j = 0; j < threadCount; ++j)
+        threads.emplace_back(worker, j);
+
+    size_t frames = 0;
+    float maxFragmentation = 0.f;
+    size_t minLargestFreeBlock = c_capacity;
+    try
+    {
+        while (running)
+        {
+            allocator->Commit(commandQueue.Get());
+            ++frames;
+
+            const auto stats = allocator->GetStatistics();
+            maxFragmentation = std::max(maxFragmentation, stats.fragmentation);
+            minLargestFreeBlock = std::min(minLargestFreeBlock, stats.largestFreeBlock);
+
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    catch (const std::exception& e)
+    {
+        printf("ERROR: Failed to commit (except: %s)\n", e.what());
+        success = false;
+    }
+
+    for (auto& it : threads)
+        it.join();
+
+    const double totalTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Let the last frames' deferred frees retire
+    try
+    {
+        allocator->Commit(commandQueue.Get());
+        allocator->FreeImmediate(allocator->Allocate(c_capacity));
+    }
+    catch (const std::exception& e)
+    {
+        printf("ERROR: Failed to reclaim all descriptors (except: %s)\n", e.what());
+        success = false;
+    }
+
+    if (failed)
+    {
+        printf("ERROR: Descriptor allocation threw across %u threads\n", threadCount);
+        success = false;
+    }
+
+    if (overlap)
+    {
+        printf("ERROR: Descriptors were handed out twice across %u threads\n", threadCount);
+        success = false;
+    }
+
+    const auto stats = allocator->GetStatistics();
+    if (stats.allocated != 0 || stats.freeBlocks != 1)
+    {
+        printf("ERROR: Expected all free in one block after the stress test (%zu allocated, %zu blocks)\n", stats.allocated, stats.freeBlocks);
+        success = false;
+    }
+
+    printf("\n\t%u threads: %.0f operations/s, %llu allocations (%llu failed), %zu peak of %zu, %llu stalls over %zu frames\n",
+        threadCount,
+        (totalTime > 0.0) ? double(threadCount * c_operationsPerThread) / totalTime : 0.0,
+        stats.allocations, stats.failedAllocations, stats.peakAllocated, stats.capacity, stats.stalls, frames);
+    printf("\t\tfragmentation at most %.3f, smallest largest free block %zu\n", double(maxFragmentation), minLargestFreeBlock);
+
+    return success;
+}
@@ -0,0 +1,279 @@
+//--------------------------------------------------------------------------------------
+// File: descriptorcache.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkID=615561
+//-------------------------------------------------------------------------------------
+
+#ifdef __MINGW32__
+#include <unknwn.h>
+#endif
+
+#include "DescriptorHeap.h"
+#include "PlatformHelpers.h"
+
+#include "d3dx12.h"
+
+namespace DX
+{
+    using DirectX::ThrowIfFailed;
+}
+
+#include "DescriptorCache.h"
+
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <wrl/client.h>
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    constexpr size_t c_textures = 32;
+    constexpr size_t c_materials = 1024;
+    constexpr size_t c_texturesPerMaterial = 4;
+}
+
+_Success_(return)
+bool Test33(_In_ ID3D12Device* device)
+{
+    if (!device)
+        return false;
+
+    bool success = true;
+
+    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+    queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+
+    ComPtr<ID3D12CommandQueue> commandQueue;
+    HRESULT hr = device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(commandQueue.GetAddressOf()));
+    if (FAILED(hr))
+    {
+        printf("ERROR: Failed to create command queue (%08X)\n", static_cast<unsigned int>(hr));
+        return false;
+    }
+
+    const CD3DX12_HEAP_PROPERTIES defaultHeap(D3D12_HEAP_TYPE_DEFAULT);
+
+    std::vector<ComPtr<ID3D12Resource>> textures(c_textures);
+    for (auto& it : textures)
+    {
+        auto desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, 64, 64, 1, 0);
+        hr = device->CreateCommittedResource(&defaultHeap, D3D12_HEAP_FLAG_NONE, &desc,
+            D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(it.GetAddressOf()));
+        if (FAILED(hr))
+        {
+            printf("ERROR: Failed to create texture (%08X)\n", static_cast<unsigned int>(hr));
+            return false;
+        }
+    }
+
+    ComPtr<ID3D12Resource> constantBuffer;
+    {
+        auto desc = CD3DX12_RESOURCE_DESC::Buffer(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+        hr = device->CreateCommittedResource(&defaultHeap, D3D12_HEAP_FLAG_NONE, &desc,
+            D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(constantBuffer.GetAddressOf()));
+        if (FAILED(hr))
+        {
+            printf("ERROR: Failed to create constant buffer (%08X)\n", static_cast<unsigned int>(hr));
+            return false;
+        }
+    }
+
+    std::unique_ptr<DescriptorPile> resourcePile;
+    std::unique_ptr<DescriptorPile> samplerPile;
+    std::unique_ptr<DX::DescriptorAllocator> resourceAllocator;
+    std::unique_ptr<DX::DescriptorAllocator> samplerAllocator;
+    std::unique_ptr<DX::DescriptorCache> resources;
+    std::unique_ptr<DX::DescriptorCache> samplers;
+    try
+    {
+        resourcePile = std::make_unique<DescriptorPile>(device,
+            D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE, 1024);
+        samplerPile = std::make_unique<DescriptorPile>(device,
+            D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE, 64);
+
+        resourceAllocator = std::make_unique<DX::DescriptorAllocator>(device, *resourcePile, 1024);
+        samplerAllocator = std::make_unique<DX::DescriptorAllocator>(device, *samplerPile, 64);
+
+        resources = std::make_unique<DX::DescriptorCache>(device, *resourceAllocator);
+        samplers = std::make_unique<DX::DescriptorCache>(device, *samplerAllocator);
+    }
+    catch (const std::exception& e)
+    {
+        printf("ERROR: Failed creating descriptor cache (except: %s)\n", e.what());
+        return false;
+    }
+
+    try
+    {
+        // Identical views share a descriptor, while different view descriptions of a resource do not
+        auto texture = textures[0].Get();
+
+        const auto first = resources->CreateShaderResourceView(texture);
+        const auto second = resources->CreateShaderResourceView(texture);
+
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srvDesc.Texture2D.MipLevels = UINT(-1);
+
+        const auto full = resources->CreateShaderResourceView(texture, &srvDesc);
+
+        srvDesc.Texture2D.MostDetailedMip = 2;
+        const auto mips = resources->CreateShaderResourceView(texture, &srvDesc);
+
+        const auto other = resources->CreateShaderResourceView(textures[1].Get());
+
+        if (first != second || first == full || full == mips || first == other)
+        {
+            printf("ERROR: Expected identical views only to share a descriptor (%zu %zu %zu %zu %zu)\n", first, second, full, mips, other);
+            success = false;
+        }
+
+        if (resources->GetCpuHandle(first).ptr != resourcePile->GetCpuHandle(first).ptr
+            || resources->GetGpuHandle(first).ptr != resourcePile->GetGpuHandle(first).ptr)
+        {
+            printf("ERROR: Handles do not match the pile's\n");
+            success = false;
+        }
+
+        D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
+        cbvDesc.BufferLocation = constantBuffer->GetGPUVirtualAddress();
+        cbvDesc.SizeInBytes = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+
+        const auto cbv = resources->CreateConstantBufferView(cbvDesc);
+        cbvDesc.BufferLocation += D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+        const auto cbvNext = resources->CreateConstantBufferView(cbvDesc);
+        cbvDesc.BufferLocation -= D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+
+        if (cbv == cbvNext || resources->CreateConstantBufferView(cbvDesc) != cbv)
+        {
+            printf("ERROR: Expected constant buffer views to share by location and size\n");
+            success = false;
+        }
+
+        const D3D12_SAMPLER_DESC samplerDesc = {
+            D3D12_FILTER_ANISOTROPIC,
+            D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+            0.f, D3D12_MAX_MAXANISOTROPY, D3D12_COMPARISON_FUNC_NEVER,
+            { 0.f, 0.f, 0.f, 0.f }, 0.f, D3D12_FLOAT32_MAX };
+
+        const auto sampler = samplers->CreateSampler(samplerDesc);
+        if (samplers->CreateSampler(samplerDesc) != sampler)
+        {
+            printf("ERROR: Expected identical samplers to share a descriptor\n");
+            success = false;
+        }
+
+        auto stats = resources->GetStatistics();
+        if (stats.views != 6 || stats.references != 8 || stats.hits != 2 || stats.misses != 6)
+        {
+            printf("ERROR: Expected 6 views, 8 references, 2 hits, 6 misses (%zu, %zu, %llu, %llu)\n",
+                stats.views, stats.references, stats.hits, stats.misses);
+            success = false;
+        }
+
+        // The descriptor goes back to the allocator with the last reference
+        resources->Release(first);
+        if (resources->GetStatistics().views != 6)
+        {
+            printf("ERROR: Expected the view to live while referenced\n");
+            success = false;
+        }
+
+        resources->Release(second);
+        if (resources->GetStatistics().views != 5 || resourceAllocator->GetStatistics().pendingFree != 1)
+        {
+            printf("ERROR: Expected the view to be freed with its last reference\n");
+            success = false;
+        }
+
+        bool thrown = false;
+        try
+        {
+            resources->Release(first);
+        }
+        catch (const std::out_of_range&)
+        {
+            thrown = true;
+        }
+
+        if (!thrown)
+        {
+            printf("ERROR: Expected releasing a freed view to throw\n");
+            success = false;
+        }
+
+        for (auto it : { full, mips, other, cbv, cbvNext, cbv })
+        {
+            resources->Release(it);
+        }
+
+        samplers->Release(sampler);
+        samplers->Release(sampler);
+
+        resourceAllocator->Commit(commandQueue.Get());
+        samplerAllocator->Commit(commandQueue.Get());
+
+        if (resources->GetStatistics().views != 0 || resources->GetStatistics().references != 0 || samplers->GetStatistics().views != 0)
+        {
+            printf("ERROR: Expected every view to be released\n");
+            success = false;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        printf("ERROR: Failed creating cached views (except: %s)\n", e.what());
+        return false;
+    }
+
+    // A scene whose materials share a small set of textures
+    try
+    {
+        const auto before = resources->GetStatistics();
+
+        std::mt19937 rng(2024);
+        std::vector<DX::DescriptorCache::IndexType> references;
+        references.reserve(c_materials * c_texturesPerMaterial);
+        for (size_t j = 0; j < c_materials * c_texturesPerMaterial; ++j)
+        {
+            references.push_back(resources->CreateShaderResourceView(textures[rng() % c_textures].Get()));
+        }
+
+        const auto stats = resources->GetStatistics();
+        const auto hits = stats.hits - before.hits;
+        const auto misses = stats.misses - before.misses;
+
+        if (stats.views > c_textures || misses != stats.views)
+        {
+            printf("ERROR: Expected at most one descriptor per texture (%zu views, %llu written)\n", stats.views, misses);
+            success = false;
+        }
+
+        printf("\n\t%zu material textures over %zu textures: %llu hits, %llu descriptors written rather than %zu\n",
+            references.size(), c_textures, hits, misses, references.size());
+
+        for (auto it : references)
+        {
+            resources->Release(it);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        printf("ERROR: Failed caching scene views (except: %s)\n", e.what());
+        return false;
+    }
+
+    return success;
+}
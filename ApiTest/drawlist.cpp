@@ -0,0 +1,303 @@
+//--------------------------------------------------------------------------------------
+// File: drawlist.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkID=615561
+//-------------------------------------------------------------------------------------
+
+#ifdef __MINGW32__
+#include <unknwn.h>
+#endif
+
+#include "Model.h"
+
+#include "CommonStates.h"
+#include "DescriptorHeap.h"
+#include "EffectPipelineStateDescription.h"
+#include "RenderTargetState.h"
+
+#include "DrawList.h"
+#include "RecordingCommandList.h"
+
+#include "ApiTest.h"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <wrl/client.h>
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    constexpr size_t c_keyCount = 100000;
+    constexpr size_t c_iterations = 8;
+
+    // Arguments of each DrawIndexedInstanced in a recorded stream, sorted so streams can be compared
+    std::vector<std::array<uint32_t, 5>> GetDraws(const std::vector<uint8_t>& stream)
+    {
+        std::vector<std::array<uint32_t, 5>> draws;
+        DX::RecordingCommandList::ForEachCommand(stream,
+            [&](DX::RecordedCommand command, const uint8_t* payload, size_t size)
+            {
+                if (command == DX::RecordedCommand::DrawIndexedInstanced && size == sizeof(std::array<uint32_t, 5>))
+                {
+                    std::array<uint32_t, 5> args;
+                    memcpy(args.data(), payload, size);
+                    draws.push_back(args);
+                }
+            });
+
+        std::sort(draws.begin(), draws.end());
+        return draws;
+    }
+
+    size_t CountParts(const Model& model)
+    {
+        size_t count = 0;
+        for (const auto& mesh : model.meshes)
+        {
+            count += mesh->opaqueMeshParts.size() + mesh->alphaMeshParts.size();
+        }
+        return count;
+    }
+}
+
+_Success_(return)
+bool Test27(_In_ ID3D12Device* device)
+{
+    if (!device)
+        return false;
+
+    bool success = true;
+
+    // Radix sort
+    {
+        std::mt19937_64 rng(0x5EED);
+
+        std::vector<DX::DrawKey> keys(c_keyCount);
+        for (size_t j = 0; j < c_keyCount; ++j)
+        {
+            // Few distinct high bits and many duplicates, as in a frame of draws
+            const uint64_t state = rng() % 64;
+            keys[j].key = (state << 48) | (rng() & 0xFFFF);
+            keys[j].index = static_cast<uint32_t>(j);
+        }
+
+        std::vector<DX::DrawKey> expected(keys);
+        double stdTime = DBL_MAX;
+        for (size_t iter = 0; iter < c_iterations; ++iter)
+        {
+            expected = keys;
+            auto start = std::chrono::steady_clock::now();
+            std::stable_sort(expected.begin(), expected.end(), [](const DX::DrawKey& a, const DX::DrawKey& b) noexcept
+                {
+                    return a.key < b.key;
+                });
+            stdTime = std::min(stdTime, ElapsedMilliseconds(start));
+        }
+
+        std::vector<DX::DrawKey> sorted;
+        std::vector<DX::DrawKey> scratch;
+        double radixTime = DBL_MAX;
+        for (size_t iter = 0; iter < c_iterations; ++iter)
+        {
+            sorted = keys;
+            auto start = std::chrono::steady_clock::now();
+            DX::RadixSortKeys(sorted, scratch);
+            radixTime = std::min(radixTime, ElapsedMilliseconds(start));
+        }
+
+        bool match = (sorted.size() == expected.size());
+        for (size_t j = 0; match && j < sorted.size(); ++j)
+        {
+            match = (sorted[j].key == expected[j].key && sorted[j].index == expected[j].index);
+        }
+
+        if (!match)
+        {
+            printf("ERROR: Radix sort does not match std::stable_sort\n");
+            success = false;
+        }
+
+        std::vector<DX::DrawKey> empty;
+        DX::RadixSortKeys(empty, scratch);
+        std::vector<DX::DrawKey> single = { { 42, 7 } };
+        DX::RadixSortKeys(single, scratch);
+        if (!empty.empty() || single.size() != 1 || single[0].key != 42 || single[0].index != 7)
+        {
+            printf("ERROR: Unexpected radix sort of empty or single keys\n");
+            success = false;
+        }
+
+        printf("\n\t%zu keys: std::stable_sort %.3f ms, radix sort %.3f ms\n", c_keyCount, stdTime, radixTime);
+    }
+
+    // Model::Draw vs. draw list
+    {
+        std::unique_ptr<CommonStates> states;
+        std::unique_ptr<DescriptorPile> resourceDescriptors;
+        std::unique_ptr<EffectFactory> fxFactory;
+        std::unique_ptr<Model> gamelevel;
+        std::unique_ptr<Model> cup;
+        Model::EffectCollection fxGamelevel;
+        Model::EffectCollection fxCup;
+        try
+        {
+            states = std::make_unique<CommonStates>(device);
+            resourceDescriptors = std::make_unique<DescriptorPile>(device, 128);
+            fxFactory = std::make_unique<EffectFactory>(resourceDescriptors->Heap(), states->Heap());
+
+            const RenderTargetState rtState(DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_FORMAT_D32_FLOAT);
+
+            const EffectPipelineStateDescription pd(
+                nullptr,
+                CommonStates::Opaque,
+                CommonStates::DepthDefault,
+                CommonStates::CullClockwise,
+                rtState);
+
+            gamelevel = Model::CreateFromCMO(device, L"ModelTest\\gamelevel.cmo");
+            cup = Model::CreateFromSDKMESH(device, L"ModelTest\\cup.sdkmesh");
+
+            fxGamelevel = gamelevel->CreateEffects(*fxFactory, pd, pd);
+            fxCup = cup->CreateEffects(*fxFactory, pd, pd);
+        }
+        catch (const std::exception& e)
+        {
+            printf("ERROR: Failed creating models for draw list (except: %s)\n", e.what());
+            return false;
+        }
+
+        ComPtr<DX::RecordingCommandList> recorder;
+        HRESULT hr = DX::RecordingCommandList::Create(device, D3D12_COMMAND_LIST_TYPE_DIRECT, recorder.GetAddressOf());
+        if (FAILED(hr))
+        {
+            printf("ERROR: Failed creating recording command list (%08X)\n", static_cast<unsigned int>(hr));
+            return false;
+        }
+
+        const XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.f, 5.f, -20.f, 0.f), g_XMZero, g_XMIdentityR1);
+        const XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.f / 9.f, 0.1f, 1000.f);
+
+        const XMMATRIX worlds[] =
+        {
+            XMMatrixScaling(0.1f, 0.1f, 0.1f),
+            XMMatrixTranslation(-2.f, 0.f, 0.f),
+            XMMatrixTranslation(2.f, 0.f, 0.f),
+            XMMatrixTranslation(4.f, 1.f, 0.f),
+        };
+
+        // As ModelTest draws them, one model at a time
+        recorder->Close();
+        recorder->Reset(nullptr, nullptr);
+        Model::UpdateEffectMatrices(fxGamelevel, worlds[0], view, projection);
+        gamelevel->Draw(recorder.Get(), fxGamelevel.cbegin());
+        for (size_t j = 1; j < std::size(worlds); ++j)
+        {
+            Model::UpdateEffectMatrices(fxCup, worlds[j], view, projection);
+            cup->Draw(recorder.Get(), fxCup.cbegin());
+        }
+        recorder->Close();
+
+        const DX::RecordingStats unsorted = recorder->GetStats();
+        const auto unsortedDraws = GetDraws(recorder->GetStream());
+
+        DX::DrawList drawList;
+        drawList.Begin(view, projection);
+        hr = drawList.AddModel(*gamelevel, fxGamelevel, worlds[0]);
+        for (size_t j = 1; SUCCEEDED(hr) && j < std::size(worlds); ++j)
+        {
+            hr = drawList.AddModel(*cup, fxCup, worlds[j]);
+        }
+
+        if (FAILED(hr))
+        {
+            printf("ERROR: Failed adding models to draw list (%08X)\n", static_cast<unsigned int>(hr));
+            return false;
+        }
+
+        recorder->Reset(nullptr, nullptr);
+        DX::DrawListStats stats = {};
+        try
+        {
+            stats = drawList.Submit(recorder.Get());
+        }
+        catch (const std::exception& e)
+        {
+            printf("ERROR: Failed submitting draw list (except: %s)\n", e.what());
+            return false;
+        }
+        recorder->Close();
+
+        const DX::RecordingStats& sorted = recorder->GetStats();
+        const size_t partCount = CountParts(*gamelevel) + CountParts(*cup) * (std::size(worlds) - 1);
+
+        if (stats.draws != partCount || sorted.draws != stats.draws || unsorted.draws != partCount)
+        {
+            printf("ERROR: Unexpected draw count for draw list (%u, %u recorded, %zu parts)\n", stats.draws, sorted.draws, partCount);
+            success = false;
+        }
+        else if (GetDraws(recorder->GetStream()) != unsortedDraws)
+        {
+            printf("ERROR: Draw list does not issue the same draws as Model::Draw\n");
+            success = false;
+        }
+        else if (stats.bindsSaved == 0
+            || sorted.pipelineChanges > unsorted.pipelineChanges
+            || sorted.counts[static_cast<size_t>(DX::RecordedCommand::IASetVertexBuffers)] >= unsorted.counts[static_cast<size_t>(DX::RecordedCommand::IASetVertexBuffers)])
+        {
+            printf("ERROR: Draw list did not reduce state changes (%u binds saved, %u vs %u PSO changes)\n",
+                stats.bindsSaved, sorted.pipelineChanges, unsorted.pipelineChanges);
+            success = false;
+        }
+
+        printf("\t%zu parts: Model::Draw %u PSO changes, %u redundant sets; draw list %u PSO changes, %u redundant sets\n",
+            partCount, unsorted.pipelineChanges, unsorted.redundantSets, sorted.pipelineChanges, sorted.redundantSets);
+        printf("\t%u effect applies, %u VB, %u IB, %u topology sets, %u binds saved\n",
+            stats.effectApplies, stats.vertexBufferSets, stats.indexBufferSets, stats.topologySets, stats.bindsSaved);
+
+        // Models outside the frustum are culled
+        drawList.Begin(view, projection);
+        if (FAILED(drawList.AddModel(*cup, fxCup, worlds[1]))
+            || FAILED(drawList.AddModel(*cup, fxCup, XMMatrixTranslation(0.f, 0.f, -100.f))))
+        {
+            printf("ERROR: Failed adding models for culling\n");
+            success = false;
+        }
+        else
+        {
+            recorder->Reset(nullptr, nullptr);
+            stats = drawList.Submit(recorder.Get());
+            recorder->Close();
+
+            if (drawList.size() != cup->meshes.size() * 2 || stats.draws != CountParts(*cup))
+            {
+                printf("ERROR: Unexpected draws for culled model (%u)\n", stats.draws);
+                success = false;
+            }
+        }
+
+        // Invalid arguments
+        drawList.Begin(view, projection);
+        Model::EffectCollection tooFew;
+        if (drawList.AddModel(*cup, tooFew, worlds[1]) != E_INVALIDARG || drawList.size() != 0)
+        {
+            printf("ERROR: Expected failure for missing effects\n");
+            success = false;
+        }
+    }
+
+    return success;
+}
@@ -0,0 +1,293 @@
+//--------------------------------------------------------------------------------------
+// File: filereadqueue.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkID=615561
+//-------------------------------------------------------------------------------------
+
+#ifdef __MINGW32__
+#include <unknwn.h>
+#endif
+
+#include "FileReadQueue.h"
+
+#include "ApiTest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <wrl/client.h>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    constexpr size_t c_fileSize = 64 * 1024 * 1024;
+    constexpr size_t c_blockSize = 64 * 1024;
+    constexpr size_t c_randomReadSize = 4096;
+    constexpr size_t c_randomReads = 4096;
+
+    double MegabytesPerSecond(size_t bytes, double ms)
+    {
+        return (ms > 0.0) ? double(bytes) / (ms * 1000.0) : 0.0;
+    }
+
+    // Reads the whole file in c_blockSize requests issued in a shuffled order.
+    double ReadBlocks(DX::FileReadQueue& queue, DX::FileReadQueue::FileId file, uint8_t* dest, std::mt19937& rng)
+    {
+        std::vector<size_t> blocks(c_fileSize / c_blockSize);
+        std::iota(blocks.begin(), blocks.end(), size_t(0));
+        std::shuffle(blocks.begin(), blocks.end(), rng);
+
+        auto start = std::chrono::steady_clock::now();
+        for (auto it : blocks)
+        {
+            queue.Enqueue({ file, it * c_blockSize, c_blockSize, dest + it * c_blockSize, 0, nullptr });
+        }
+        queue.Wait(queue.Submit());
+        return ElapsedMilliseconds(start);
+    }
+
+    // Reads c_randomReadSize blocks from random offsets, none adjacent, so nothing is merged.
+    double ReadRandom(DX::FileReadQueue& queue, DX::FileReadQueue::FileId file, uint8_t* dest, std::mt19937& rng)
+    {
+        std::uniform_int_distribution<size_t> dist(0, c_fileSize / (2 * c_randomReadSize) - 1);
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t j = 0; j < c_randomReads; ++j)
+        {
+            queue.Enqueue({ file, dist(rng) * 2 * c_randomReadSize, c_randomReadSize, dest + j * c_randomReadSize, 0, nullptr });
+        }
+        queue.Wait(queue.Submit());
+        return ElapsedMilliseconds(start);
+    }
+}
+
+_Success_(return)
+bool Test31(_In_ ID3D12Device* device)
+{
+    if (!device)
+        return false;
+
+    bool success = true;
+
+    wchar_t tempPath[MAX_PATH] = {};
+    if (!GetTempPathW(MAX_PATH, tempPath))
+    {
+        printf("ERROR: Failed to get the temp path\n");
+        return false;
+    }
+
+    std::wstring fileName(tempPath);
+    fileName += L"apitest_filereadqueue.bin";
+
+    std::mt19937 rng(4321);
+
+    std::vector<uint8_t> expected(c_fileSize);
+    for (auto& it : expected)
+    {
+        it = static_cast<uint8_t>(rng());
+    }
+
+    {
+        std::ofstream outFile(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        outFile.write(reinterpret_cast<const char*>(expected.data()), static_cast<std::streamsize>(expected.size()));
+        if (!outFile)
+        {
+            printf("ERROR: Failed to write %ls\n", fileName.c_str());
+            return false;
+        }
+    }
+
+    printf("\n");
+
+    try
+    {
+        std::vector<uint8_t> dest(c_fileSize);
+
+        // Shuffled blocks with contiguous destinations are merged into large direct reads
+        {
+            DX::FileReadQueue queue;
+            auto file = queue.Open(fileName.c_str());
+
+            if (queue.GetFileSize(file) != c_fileSize)
+            {
+                printf("ERROR: Expected file size %zu, got %llu\n", c_fileSize, queue.GetFileSize(file));
+                success = false;
+            }
+
+            ComPtr<ID3D12Fence> fence;
+            if (FAILED(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(fence.GetAddressOf()))))
+            {
+                throw std::runtime_error("CreateFence");
+            }
+
+            std::atomic<size_t> callbacks(0);
+            std::atomic<size_t> failures(0);
+
+            std::vector<size_t> blocks(c_fileSize / c_blockSize);
+            std::iota(blocks.begin(), blocks.end(), size_t(0));
+            std::shuffle(blocks.begin(), blocks.end(), rng);
+
+            for (auto it : blocks)
+            {
+                // Alternate priorities in runs, so some merging stops at a priority change
+                const int priority = static_cast<int>((it / 64) % 2);
+                queue.Enqueue({ file, it * c_blockSize, c_blockSize, dest.data() + it * c_blockSize, priority,
+                    [&](HRESULT hr)
+                    {
+                        ++callbacks;
+                        if (FAILED(hr))
+                            ++failures;
+                    } });
+            }
+            queue.EnqueueSignal(fence.Get(), 1);
+
+            const UINT64 batch = queue.Submit();
+            queue.Wait(batch);
+
+            if (!queue.IsComplete(batch) || fence->GetCompletedValue() != 1)
+            {
+                printf("ERROR: Batch or D3D12 fence not complete after Wait\n");
+                success = false;
+            }
+
+            if (callbacks != blocks.size() || failures != 0)
+            {
+                printf("ERROR: Expected %zu successful callbacks, got %zu (%zu failed)\n", blocks.size(), callbacks.load(), failures.load());
+                success = false;
+            }
+
+            if (memcmp(dest.data(), expected.data(), c_fileSize) != 0)
+            {
+                printf("ERROR: Data read with merged requests does not match\n");
+                success = false;
+            }
+
+            const auto stats = queue.GetStatistics();
+            if (stats.requests != blocks.size() || stats.reads >= stats.requests || stats.bytesRead != c_fileSize)
+            {
+                printf("ERROR: Expected merged reads (%llu requests, %llu reads, %llu bytes)\n", stats.requests, stats.reads, stats.bytesRead);
+                success = false;
+            }
+        }
+
+        // Scattered destinations are read through the scratch buffer, and an empty batch still completes
+        {
+            DX::FileReadQueue queue;
+            auto file = queue.Open(fileName.c_str());
+
+            std::vector<std::vector<uint8_t>> parts(64, std::vector<uint8_t>(1000));
+            for (size_t j = 0; j < parts.size(); ++j)
+            {
+                queue.Enqueue({ file, 7 + j * 1000, 1000, parts[j].data(), 0, nullptr });
+            }
+            queue.Submit();
+
+            queue.Wait(queue.Submit());
+
+            for (size_t j = 0; j < parts.size(); ++j)
+            {
+                if (memcmp(parts[j].data(), expected.data() + 7 + j * 1000, 1000) != 0)
+                {
+                    printf("ERROR: Data read into scattered destinations does not match at %zu\n", j);
+                    success = false;
+                    break;
+                }
+            }
+
+            const auto stats = queue.GetStatistics();
+            if (stats.reads != 1 || stats.batches != 2)
+            {
+                printf("ERROR: Expected 1 read over 2 batches (%llu reads, %llu batches)\n", stats.reads, stats.batches);
+                success = false;
+            }
+
+            bool thrown = false;
+            try
+            {
+                uint8_t tail[2] = {};
+                queue.Enqueue({ file, c_fileSize - 1, 2, tail, 0, nullptr });
+            }
+            catch (const std::out_of_range&)
+            {
+                thrown = true;
+            }
+
+            if (!thrown)
+            {
+                printf("ERROR: Expected a request past the end of the file to throw\n");
+                success = false;
+            }
+
+            queue.Close(file);
+
+            thrown = false;
+            try
+            {
+                uint8_t head[2] = {};
+                queue.Enqueue({ file, 0, 2, head, 0, nullptr });
+            }
+            catch (const std::invalid_argument&)
+            {
+                thrown = true;
+            }
+
+            if (!thrown)
+            {
+                printf("ERROR: Expected a request on a closed file to throw\n");
+                success = false;
+            }
+        }
+
+        // Bandwidth and IOPS, from the file cache since the file was just written
+        {
+            DX::FileReadQueue merged;
+            DX::FileReadQueue unmerged(DX::FileReadQueue::c_defaultThreads, c_blockSize);
+            DX::FileReadQueue singleThread(1);
+
+            const auto mergedFile = merged.Open(fileName.c_str());
+            const auto unmergedFile = unmerged.Open(fileName.c_str());
+            const auto singleFile = singleThread.Open(fileName.c_str());
+
+            const double mergedTime = ReadBlocks(merged, mergedFile, dest.data(), rng);
+            const double unmergedTime = ReadBlocks(unmerged, unmergedFile, dest.data(), rng);
+
+            const auto mergedStats = merged.GetStatistics();
+            const auto unmergedStats = unmerged.GetStatistics();
+
+            printf("\t%zu KB blocks of %zu MB: merged %llu reads %.3f ms (%.1f MB/s), unmerged %llu reads %.3f ms (%.1f MB/s)\n",
+                c_blockSize / 1024, c_fileSize / (1024 * 1024),
+                mergedStats.reads, mergedTime, MegabytesPerSecond(c_fileSize, mergedTime),
+                unmergedStats.reads, unmergedTime, MegabytesPerSecond(c_fileSize, unmergedTime));
+
+            const double parallelTime = ReadRandom(merged, mergedFile, dest.data(), rng);
+            const double serialTime = ReadRandom(singleThread, singleFile, dest.data(), rng);
+
+            printf("\t%zu random %zu byte reads: %u threads %.3f ms (%.0f IOPS), 1 thread %.3f ms (%.0f IOPS)\n",
+                c_randomReads, c_randomReadSize,
+                DX::FileReadQueue::c_defaultThreads, parallelTime, (parallelTime > 0.0) ? double(c_randomReads) * 1000.0 / parallelTime : 0.0,
+                serialTime, (serialTime > 0.0) ? double(c_randomReads) * 1000.0 / serialTime : 0.0);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        printf("ERROR: Failed reading %ls (except: %s)\n", fileName.c_str(), e.what());
+        success = false;
+    }
+
+    std::ignore = DeleteFileW(fileName.c_str());
+
+    return success;
+}
@@ -0,0 +1,274 @@
+//--------------------------------------------------------------------------------------
+// File: frustumcull.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkID=615561
+//-------------------------------------------------------------------------------------
+
+#ifdef __MINGW32__
+#include <unknwn.h>
+#endif
+
+#include "Model.h"
+
+#include "FrustumCull.h"
+
+#include "ApiTest.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr size_t c_boundsCount = 100000;
+    constexpr size_t c_iterations = 8;
+
+    double Throughput(size_t count, double ms)
+    {
+        return (ms > 0.0) ? double(count) / (ms * 1000.0) : 0.0;
+    }
+
+    // Indices of the spheres that intersect the frustum, using BoundingFrustum as the reference. The
+    // spheres are shrunk slightly so rounding of planes on the boundary is not reported as a miss.
+    std::vector<uint32_t> CullReference(const BoundingFrustum& frustum, const std::vector<BoundingSphere>& spheres)
+    {
+        std::vector<uint32_t> result;
+        for (size_t j = 0; j < spheres.size(); ++j)
+        {
+            const BoundingSphere sphere(spheres[j].Center, std::max(spheres[j].Radius - 1e-3f, 0.f));
+            if (frustum.Intersects(sphere))
+                result.push_back(static_cast<uint32_t>(j));
+        }
+        return result;
+    }
+
+    // The culler must keep every sphere the reference keeps, and report each one once, in order.
+    bool ValidateVisible(const std::vector<uint32_t>& visible, const std::vector<uint32_t>& expected, size_t count, const char* name)
+    {
+        for (size_t j = 0; j < visible.size(); ++j)
+        {
+            if (visible[j] >= count || (j > 0 && visible[j] <= visible[j - 1]))
+            {
+                printf("ERROR: Visible list for %s is out of order or range at %zu (%u)\n", name, j, visible[j]);
+                return false;
+            }
+        }
+
+        if (!std::includes(visible.cbegin(), visible.cend(), expected.cbegin(), expected.cend()))
+        {
+            printf("ERROR: %s culled bounds that intersect the frustum (%zu visible, %zu expected)\n", name, visible.size(), expected.size());
+            return false;
+        }
+
+        return true;
+    }
+}
+
+_Success_(return)
+bool Test25(_In_ ID3D12Device* device)
+{
+    if (!device)
+        return false;
+
+    bool success = true;
+
+    const XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.f, 0.f, -50.f, 0.f), g_XMZero, g_XMIdentityR1);
+    const XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.f / 9.f, 0.1f, 500.f);
+    const XMMATRIX viewProjection = XMMatrixMultiply(view, projection);
+
+    BoundingFrustum frustum(projection);
+    frustum.Transform(frustum, XMMatrixInverse(nullptr, view));
+
+    // Culling many bounds
+    {
+        std::mt19937 rng(0x5EED);
+        std::uniform_real_distribution<float> position(-500.f, 500.f);
+        std::uniform_real_distribution<float> radius(0.5f, 5.f);
+
+        std::vector<BoundingSphere> spheres(c_boundsCount);
+        for (auto& it : spheres)
+        {
+            it.Center = XMFLOAT3(position(rng), position(rng), position(rng));
+            it.Radius = radius(rng);
+        }
+
+        DX::FrustumCuller culler;
+        culler.Reserve(spheres.size());
+        for (const auto& it : spheres)
+        {
+            culler.Add(it);
+        }
+
+        if (culler.size() != c_boundsCount)
+        {
+            printf("ERROR: Unexpected culler size %zu\n", culler.size());
+            success = false;
+        }
+
+        std::vector<uint32_t> expected;
+        double referenceTime = DBL_MAX;
+        for (size_t iter = 0; iter < c_iterations; ++iter)
+        {
+            auto start = std::chrono::steady_clock::now();
+            expected = CullReference(frustum, spheres);
+            referenceTime = std::min(referenceTime, ElapsedMilliseconds(start));
+        }
+
+        std::vector<uint32_t> visible;
+        double singleTime = DBL_MAX;
+        for (size_t iter = 0; iter < c_iterations; ++iter)
+        {
+            auto start = std::chrono::steady_clock::now();
+            culler.Cull(viewProjection, visible, 1);
+            singleTime = std::min(singleTime, ElapsedMilliseconds(start));
+        }
+
+        const unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+
+        std::vector<uint32_t> visibleParallel;
+        double parallelTime = DBL_MAX;
+        for (size_t iter = 0; iter < c_iterations; ++iter)
+        {
+            auto start = std::chrono::steady_clock::now();
+            culler.Cull(viewProjection, visibleParallel, 0);
+            parallelTime = std::min(parallelTime, ElapsedMilliseconds(start));
+        }
+
+        if (!ValidateVisible(visible, expected, c_boundsCount, "single-threaded culling"))
+        {
+            success = false;
+        }
+        else if (visibleParallel != visible)
+        {
+            printf("ERROR: Multithreaded culling does not match (%zu vs %zu visible)\n", visibleParallel.size(), visible.size());
+            success = false;
+        }
+        else if (expected.empty() || visible.size() >= c_boundsCount / 2)
+        {
+            printf("ERROR: Unexpected number of visible bounds (%zu, %zu expected)\n", visible.size(), expected.size());
+            success = false;
+        }
+
+        // An explicit thread count splits the same work differently
+        if (culler.Cull(viewProjection, visibleParallel, 3) != visible.size() || visibleParallel != visible)
+        {
+            printf("ERROR: Culling with 3 threads does not match\n");
+            success = false;
+        }
+
+        printf("\n\t%zu bounds: %zu visible (%zu by BoundingFrustum)\n", c_boundsCount, visible.size(), expected.size());
+        printf("\tBoundingFrustum %.3f ms (%.1f M/s), SoA %.3f ms (%.1f M/s), %u threads %.3f ms (%.1f M/s)\n",
+            referenceTime, Throughput(c_boundsCount, referenceTime),
+            singleTime, Throughput(c_boundsCount, singleTime),
+            threads, parallelTime, Throughput(c_boundsCount, parallelTime));
+    }
+
+    // Model meshes and instances
+    {
+        static const BoundingSphere s_meshBounds[] =
+        {
+            BoundingSphere(XMFLOAT3(0.f, 0.f, 0.f), 1.f),
+            BoundingSphere(XMFLOAT3(0.f, 0.f, -100.f), 1.f),
+            BoundingSphere(XMFLOAT3(1000.f, 0.f, 0.f), 1.f),
+            BoundingSphere(XMFLOAT3(-5.f, 2.f, 10.f), 2.f),
+        };
+
+        Model model;
+        for (const auto& it : s_meshBounds)
+        {
+            auto mesh = std::make_shared<ModelMesh>();
+            mesh->boundingSphere = it;
+            model.meshes.emplace_back(std::move(mesh));
+        }
+
+        const XMMATRIX world = XMMatrixTranslation(1.f, 0.f, 0.f);
+
+        DX::FrustumCuller culler;
+        const size_t firstMesh = culler.AddModel(model, world);
+
+        // Instances in a row across the view, as for ModelTest's DrawInstanced path
+        constexpr size_t c_instanceCount = 33;
+        constexpr XMFLOAT3X4 s_identity = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f };
+        XMFLOAT3X4 transforms[c_instanceCount];
+        for (size_t j = 0; j < c_instanceCount; ++j)
+        {
+            transforms[j] = s_identity;
+            transforms[j]._14 = (float(j) - 16.f) * 8.f;
+        }
+
+        const BoundingSphere local(XMFLOAT3(0.f, 0.5f, 0.f), 1.f);
+        const size_t firstInstance = culler.AddInstances(local, transforms, c_instanceCount, world);
+
+        std::vector<BoundingSphere> spheres;
+        for (const auto& it : s_meshBounds)
+        {
+            BoundingSphere sphere;
+            it.Transform(sphere, world);
+            spheres.push_back(sphere);
+        }
+
+        for (const auto& it : transforms)
+        {
+            BoundingSphere sphere;
+            local.Transform(sphere, XMMatrixMultiply(XMLoadFloat3x4(&it), world));
+            spheres.push_back(sphere);
+        }
+
+        std::vector<uint32_t> visible;
+        const auto expected = CullReference(frustum, spheres);
+        culler.Cull(viewProjection, visible);
+
+        if (firstMesh != 0 || firstInstance != std::size(s_meshBounds) || culler.size() != spheres.size())
+        {
+            printf("ERROR: Unexpected culler indices (%zu, %zu, %zu)\n", firstMesh, firstInstance, culler.size());
+            success = false;
+        }
+        else if (!ValidateVisible(visible, expected, spheres.size(), "model culling"))
+        {
+            success = false;
+        }
+        else if (visible.size() < 2 || visible[0] != 0 || visible[1] != 3 || visible.back() >= spheres.size() - 1)
+        {
+            printf("ERROR: Unexpected visible meshes and instances (%zu visible)\n", visible.size());
+            success = false;
+        }
+    }
+
+    // Empty and partial groups
+    {
+        DX::FrustumCuller culler;
+        std::vector<uint32_t> visible = { 1, 2, 3 };
+        if (culler.Cull(viewProjection, visible) != 0 || !visible.empty())
+        {
+            printf("ERROR: Expected no visible bounds for an empty culler\n");
+            success = false;
+        }
+
+        culler.Add(BoundingSphere(XMFLOAT3(0.f, 0.f, 0.f), 1.f));
+        if (culler.Cull(viewProjection, visible) != 1 || visible[0] != 0)
+        {
+            printf("ERROR: Padding in a partial group reported as visible (%zu)\n", visible.size());
+            success = false;
+        }
+
+        culler.Clear();
+        if (culler.size() != 0 || culler.Cull(viewProjection, visible) != 0)
+        {
+            printf("ERROR: Expected no visible bounds after Clear\n");
+            success = false;
+        }
+    }
+
+    return success;
+}
@@ -0,0 +1,289 @@
+//--------------------------------------------------------------------------------------
+// File: graphicsmemorystress.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkID=615561
+//-------------------------------------------------------------------------------------
+
+#ifdef __MINGW32__
+#include <unknwn.h>
+#endif
+
+#include "GraphicsMemory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <wrl/client.h>
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    constexpr size_t c_frames = 60;
+    constexpr size_t c_allocationsPerThread = 1000;
+    constexpr size_t c_garbageCollectInterval = 16;
+
+    // Per-frame requests as a scene's jobs make them: mostly small constant buffers, some
+    // dynamic vertex and index data, and the occasional large upload.
+    struct Request
+    {
+        size_t size;
+        size_t alignment;
+    };
+
+    Request MakeRequest(std::mt19937& rng)
+    {
+        const uint32_t kind = rng() % 100;
+        if (kind < 75)
+        {
+            return { 64 + (rng() % 8) * 64, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT };
+        }
+        else if (kind < 99)
+        {
+            return { 1024 + (rng() % 32) * 1024, 16 };
+        }
+        else
+        {
+            return { 64 * 1024 + (rng() % 8) * 64 * 1024, 512 };
+        }
+    }
+
+    struct ThreadResult
+    {
+        std::vector<float> latencies; // nanoseconds per Allocate
+        std::vector<GraphicsResource> allocations;
+        std::vector<size_t> sizes;
+        size_t bytes;
+        bool failed;
+    };
+
+    uint32_t MakeTag(unsigned int thread, size_t index) noexcept
+    {
+        return (uint32_t(thread) << 20) | static_cast<uint32_t>(index);
+    }
+
+    double Percentile(const std::vector<float>& sorted, double p)
+    {
+        if (sorted.empty())
+            return 0.0;
+
+        const auto index = static_cast<size_t>(p * double(sorted.size() - 1));
+        return double(sorted[index]);
+    }
+}
+
+_Success_(return)
+bool Test29(_In_ ID3D12Device* device)
+{
+    if (!device)
+        return false;
+
+    bool success = true;
+
+    auto& graphicsMemory = GraphicsMemory::Get(device);
+
+    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+    queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+
+    ComPtr<ID3D12CommandQueue> commandQueue;
+    HRESULT hr = device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(commandQueue.GetAddressOf()));
+    if (FAILED(hr))
+    {
+        printf("ERROR: Failed to create command queue (%08X)\n", static_cast<unsigned int>(hr));
+        return false;
+    }
+
+    std::vector<unsigned int> threadCounts = { 1, 2, 4, std::max(1u, std::thread::hardware_concurrency()) };
+    std::sort(threadCounts.begin(), threadCounts.end());
+    threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()), threadCounts.end());
+
+    printf("\n");
+
+    for (const unsigned int threadCount : threadCounts)
+    {
+        std::vector<ThreadResult> results(threadCount);
+        for (auto& it : results)
+        {
+            it.latencies.reserve(c_frames * c_allocationsPerThread);
+            it.allocations.reserve(c_allocationsPerThread);
+            it.sizes.reserve(c_allocationsPerThread);
+            it.bytes = 0;
+            it.failed = false;
+        }
+
+        try
+        {
+            graphicsMemory.Commit(commandQueue.Get());
+            graphicsMemory.GarbageCollect();
+            graphicsMemory.ResetStatistics();
+        }
+        catch (const std::exception& e)
+        {
+            printf("ERROR: Failed to reset graphics memory (except: %s)\n", e.what());
+            return false;
+        }
+
+        double totalTime = 0.0;
+        size_t maxPages = 0;
+
+        for (size_t frame = 0; frame < c_frames && success; ++frame)
+        {
+            auto worker = [&](unsigned int index)
+                {
+                    auto& result = results[index];
+
+                    std::mt19937 rng(static_cast<uint32_t>(0x5EED + frame * 131 + index));
+
+                    try
+                    {
+                        for (size_t j = 0; j < c_allocationsPerThread; ++j)
+                        {
+                            const Request request = MakeRequest(rng);
+
+                            auto start = std::chrono::steady_clock::now();
+                            GraphicsResource res = graphicsMemory.Allocate(request.size, request.alignment);
+                            result.latencies.push_back(std::chrono::duration<float, std::nano>(std::chrono::steady_clock::now() - start).count());
+
+                            if (!res
+                                || res.Size() < request.size
+                                || res.Memory() == nullptr
+                                || (res.GpuAddress() % request.alignment) != 0)
+                            {
+                                result.failed = true;
+                                return;
+                            }
+
+                            // Tag both ends, so memory handed out twice at once shows up after the frame
+                            const uint32_t tag = MakeTag(index, j);
+                            auto ptr = static_cast<uint8_t*>(res.Memory());
+                            memcpy(ptr, &tag, sizeof(tag));
+                            memcpy(ptr + request.size - sizeof(tag), &tag, sizeof(tag));
+
+                            result.bytes += request.size;
+                            result.allocations.emplace_back(std::move(res));
+                            result.sizes.push_back(request.size);
+                        }
+                    }
+                    catch (const std::exception&)
+                    {
+                        result.failed = true;
+                    }
+                };
+
+            auto start = std::chrono::steady_clock::now();
+
+            std::vector<std::thread> threads;
+            threads.reserve(threadCount - 1);
+            for (unsigned int j = 1; j < threadCount; ++j)
+                threads.emplace_back(worker, j);
+
+            worker(0);
+
+            for (auto& it : threads)
+                it.join();
+
+            totalTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            maxPages = std::max(maxPages, graphicsMemory.GetStatistics().totalPages);
+
+            bool overlap = false;
+            for (unsigned int j = 0; j < threadCount; ++j)
+            {
+                auto& result = results[j];
+                for (size_t k = 0; k < result.allocations.size() && !overlap; ++k)
+                {
+                    const uint32_t expected = MakeTag(j, k);
+                    auto ptr = static_cast<const uint8_t*>(result.allocations[k].Memory());
+                    uint32_t first, last;
+                    memcpy(&first, ptr, sizeof(first));
+                    memcpy(&last, ptr + result.sizes[k] - sizeof(last), sizeof(last));
+                    overlap = (first != expected || last != expected);
+                }
+
+                result.allocations.clear();
+                result.sizes.clear();
+            }
+
+            try
+            {
+                // The frame's allocations are released, so their pages retire here
+                graphicsMemory.Commit(commandQueue.Get());
+
+                if ((frame % c_garbageCollectInterval) == (c_garbageCollectInterval - 1))
+                {
+                    graphicsMemory.GarbageCollect();
+                }
+            }
+            catch (const std::exception& e)
+            {
+                printf("ERROR: Failed to commit graphics memory (except: %s)\n", e.what());
+                success = false;
+            }
+
+            for (unsigned int j = 0; j < threadCount; ++j)
+            {
+                if (results[j].failed)
+                {
+                    printf("ERROR: Allocation failed or was misaligned on thread %u of %u (frame %zu)\n", j, threadCount, frame);
+                    success = false;
+                    break;
+                }
+            }
+
+            if (overlap)
+            {
+                printf("ERROR: Allocations overlapped across %u threads (frame %zu)\n", threadCount, frame);
+                success = false;
+            }
+        }
+
+        if (!success)
+            break;
+
+        std::vector<float> latencies;
+        size_t bytes = 0;
+        for (auto& it : results)
+        {
+            latencies.insert(latencies.end(), it.latencies.cbegin(), it.latencies.cend());
+            bytes += it.bytes;
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        const auto stats = graphicsMemory.GetStatistics();
+        const double count = double(latencies.size());
+
+        printf("\t%u threads: %.0f allocations/s, %.1f MB/frame, latency p50 %.0f ns, p99 %.0f ns, p99.9 %.0f ns, max %.0f ns\n",
+            threadCount,
+            (totalTime > 0.0) ? count / totalTime : 0.0,
+            double(bytes) / double(c_frames) / (1024.0 * 1024.0),
+            Percentile(latencies, 0.5), Percentile(latencies, 0.99), Percentile(latencies, 0.999),
+            latencies.empty() ? 0.0 : double(latencies.back()));
+        printf("\t\t%zu pages in use at most, %zu peak, %zu now, %.1f MB peak\n",
+            maxPages, stats.peakTotalPages, stats.totalPages, double(stats.peakTotalMemory) / (1024.0 * 1024.0));
+    }
+
+    try
+    {
+        graphicsMemory.Commit(commandQueue.Get());
+        graphicsMemory.GarbageCollect();
+        graphicsMemory.ResetStatistics();
+    }
+    catch (const std::exception& e)
+    {
+        printf("ERROR: Failed to reset graphics memory (except: %s)\n", e.what());
+        success = false;
+    }
+
+    return success;
+}
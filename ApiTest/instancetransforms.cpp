@@ -0,0 +1,249 @@
+//--------------------------------------------------------------------------------------
+// File: instancetransforms.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkID=615561
+//-------------------------------------------------------------------------------------
+
+#ifdef __MINGW32__
+#include <unknwn.h>
+#endif
+
+#include "GraphicsMemory.h"
+
+#include "InstanceTransforms.h"
+
+#include "ApiTest.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr size_t c_instanceCount = 200000;
+    constexpr size_t c_iterations = 8;
+
+    double PerMillisecond(size_t count, double ms)
+    {
+        return (ms > 0.0) ? double(count) / ms : 0.0;
+    }
+
+    bool Compare(const XMFLOAT3X4* actual, const XMFLOAT3X4* expected, size_t count, const char* name)
+    {
+        for (size_t j = 0; j < count; ++j)
+        {
+            const float* a = &actual[j]._11;
+            const float* b = &expected[j]._11;
+            for (size_t k = 0; k < 12; ++k)
+            {
+                if (std::fabs(a[k] - b[k]) > 1e-4f * std::max(1.f, std::fabs(b[k])))
+                {
+                    printf("ERROR: %s instance %zu element %zu is %f (expected %f)\n", name, j, k, double(a[k]), double(b[k]));
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+_Success_(return)
+bool Test28(_In_ ID3D12Device* device)
+{
+    if (!device)
+        return false;
+
+    bool success = true;
+
+    auto& graphicsMemory = GraphicsMemory::Get(device);
+
+    std::mt19937 rng(0x5EED);
+    std::uniform_real_distribution<float> position(-100.f, 100.f);
+    std::uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+    std::uniform_real_distribution<float> scale(0.5f, 2.f);
+
+    std::vector<XMFLOAT3> positions(c_instanceCount);
+    std::vector<XMFLOAT4> rotations(c_instanceCount);
+    std::vector<XMFLOAT3> scales(c_instanceCount);
+    for (size_t j = 0; j < c_instanceCount; ++j)
+    {
+        positions[j] = XMFLOAT3(position(rng), position(rng), position(rng));
+        XMStoreFloat4(&rotations[j], XMQuaternionRotationRollPitchYaw(angle(rng), angle(rng), angle(rng)));
+        scales[j] = XMFLOAT3(scale(rng), scale(rng), scale(rng));
+    }
+
+    const XMMATRIX world = XMMatrixRotationY(0.5f) * XMMatrixTranslation(1.f, 2.f, 3.f);
+
+    // Packing positions, rotations, and scales
+    {
+        // One instance at a time into a CPU array, then copied to upload memory, as ModelTest did
+        std::unique_ptr<XMFLOAT3X4[]> expected(new XMFLOAT3X4[c_instanceCount]);
+        GraphicsResource reference;
+        GraphicsResource packed;
+        GraphicsResource packedParallel;
+        try
+        {
+            reference = graphicsMemory.Allocate(c_instanceCount * sizeof(XMFLOAT3X4));
+            packed = graphicsMemory.Allocate(c_instanceCount * sizeof(XMFLOAT3X4));
+            packedParallel = graphicsMemory.Allocate(c_instanceCount * sizeof(XMFLOAT3X4));
+        }
+        catch (const std::exception& e)
+        {
+            printf("ERROR: Failed allocating instance memory (except: %s)\n", e.what());
+            return false;
+        }
+
+        double referenceTime = DBL_MAX;
+        for (size_t iter = 0; iter < c_iterations; ++iter)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t j = 0; j < c_instanceCount; ++j)
+            {
+                const XMMATRIX m = XMMatrixScaling(scales[j].x, scales[j].y, scales[j].z)
+                    * XMMatrixRotationQuaternion(XMLoadFloat4(&rotations[j]))
+                    * XMMatrixTranslation(positions[j].x, positions[j].y, positions[j].z)
+                    * world;
+                XMStoreFloat3x4(&expected[j], m);
+            }
+            memcpy(reference.Memory(), expected.get(), c_instanceCount * sizeof(XMFLOAT3X4));
+            referenceTime = std::min(referenceTime, ElapsedMilliseconds(start));
+        }
+
+        auto dest = static_cast<XMFLOAT3X4*>(packed.Memory());
+        double singleTime = DBL_MAX;
+        for (size_t iter = 0; iter < c_iterations; ++iter)
+        {
+            auto start = std::chrono::steady_clock::now();
+            DX::PackInstanceTransforms(dest,
+                positions.data(), sizeof(XMFLOAT3), rotations.data(), sizeof(XMFLOAT4), scales.data(), sizeof(XMFLOAT3),
+                c_instanceCount, world, 1);
+            singleTime = std::min(singleTime, ElapsedMilliseconds(start));
+        }
+
+        auto destParallel = static_cast<XMFLOAT3X4*>(packedParallel.Memory());
+        double parallelTime = DBL_MAX;
+        for (size_t iter = 0; iter < c_iterations; ++iter)
+        {
+            auto start = std::chrono::steady_clock::now();
+            DX::PackInstanceTransforms(destParallel,
+                positions.data(), sizeof(XMFLOAT3), rotations.data(), sizeof(XMFLOAT4), scales.data(), sizeof(XMFLOAT3),
+                c_instanceCount, world, 0);
+            parallelTime = std::min(parallelTime, ElapsedMilliseconds(start));
+        }
+
+        if (!Compare(dest, expected.get(), c_instanceCount, "packed")
+            || !Compare(destParallel, expected.get(), c_instanceCount, "packed in parallel"))
+        {
+            success = false;
+        }
+
+        const unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+
+        printf("\n\t%zu instances: per instance %.3f ms (%.0f/ms), packed %.3f ms (%.0f/ms), %u threads %.3f ms (%.0f/ms)\n",
+            c_instanceCount,
+            referenceTime, PerMillisecond(c_instanceCount, referenceTime),
+            singleTime, PerMillisecond(c_instanceCount, singleTime),
+            threads, parallelTime, PerMillisecond(c_instanceCount, parallelTime));
+    }
+
+    // Packing matrices
+    {
+        std::vector<XMMATRIX> matrices(c_instanceCount);
+        std::unique_ptr<XMFLOAT3X4[]> expected(new XMFLOAT3X4[c_instanceCount]);
+        for (size_t j = 0; j < c_instanceCount; ++j)
+        {
+            matrices[j] = XMMatrixRotationQuaternion(XMLoadFloat4(&rotations[j]))
+                * XMMatrixTranslation(positions[j].x, positions[j].y, positions[j].z);
+            XMStoreFloat3x4(&expected[j], matrices[j] * world);
+        }
+
+        GraphicsResource packed;
+        try
+        {
+            packed = DX::AllocateInstanceTransforms(graphicsMemory, matrices.data(), c_instanceCount, world, 3);
+        }
+        catch (const std::exception& e)
+        {
+            printf("ERROR: Failed allocating instance memory (except: %s)\n", e.what());
+            return false;
+        }
+
+        if (packed.Size() < c_instanceCount * sizeof(XMFLOAT3X4)
+            || !Compare(static_cast<const XMFLOAT3X4*>(packed.Memory()), expected.get(), c_instanceCount, "packed matrices"))
+        {
+            success = false;
+        }
+    }
+
+    // Shared elements, identity world, and no instances
+    {
+        const XMFLOAT4 rotation(0.f, 0.f, 0.f, 1.f);
+        const XMFLOAT3 uniformScale(2.f, 2.f, 2.f);
+
+        XMFLOAT3X4 result[4] = {};
+        DX::PackInstanceTransforms(result, positions.data(), sizeof(XMFLOAT3), &rotation, 0, &uniformScale, 0, std::size(result), XMMatrixIdentity());
+
+        for (size_t j = 0; j < std::size(result); ++j)
+        {
+            if (result[j]._11 != 2.f || result[j]._22 != 2.f || result[j]._33 != 2.f
+                || result[j]._12 != 0.f || result[j]._21 != 0.f
+                || result[j]._14 != positions[j].x || result[j]._24 != positions[j].y || result[j]._34 != positions[j].z)
+            {
+                printf("ERROR: Unexpected transform for shared rotation and scale (%zu)\n", j);
+                success = false;
+                break;
+            }
+        }
+
+        DX::PackInstanceTransforms(result, positions.data(), sizeof(XMFLOAT3), nullptr, 0, nullptr, 0, 1, XMMatrixIdentity());
+        if (result[0]._11 != 1.f || result[0]._22 != 1.f || result[0]._33 != 1.f || result[0]._14 != positions[0].x)
+        {
+            printf("ERROR: Unexpected transform for missing rotation and scale\n");
+            success = false;
+        }
+
+        // A shared matrix, as for instances placed in a rotating frame
+        XMFLOAT3X4 expected[std::size(result)];
+        for (size_t j = 0; j < std::size(result); ++j)
+        {
+            XMStoreFloat3x4(&expected[j], world * XMMatrixTranslation(positions[j].x, positions[j].y, positions[j].z));
+        }
+
+        DX::PackInstanceTransforms(result, positions.data(), sizeof(XMFLOAT3), world, std::size(result), XMMatrixIdentity());
+        if (!Compare(result, expected, std::size(result), "shared matrix"))
+        {
+            success = false;
+        }
+
+        try
+        {
+            GraphicsResource empty = DX::AllocateInstanceTransforms(graphicsMemory, positions.data(), sizeof(XMFLOAT3), nullptr, 0, nullptr, 0, 0, XMMatrixIdentity());
+            if (!empty)
+            {
+                printf("ERROR: Expected an allocation for no instances\n");
+                success = false;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            printf("ERROR: Failed allocating for no instances (except: %s)\n", e.what());
+            success = false;
+        }
+    }
+
+    return success;
+}
@@ -0,0 +1,1061 @@
+//--------------------------------------------------------------------------------------
+// File: meshoptimize.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkID=615561
+//-------------------------------------------------------------------------------------
+
+#ifdef __MINGW32__
+#include <unknwn.h>
+#endif
+
+#include "Model.h"
+
+#include "WaveFrontReader.h"
+#include "MeshOptimize.h"
+#include "MeshSimplify.h"
+
+#include "ApiTest.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    using Triangle = std::array<uint32_t, 3>;
+
+    // Indices for a regular grid of quads split into bands of rows, as for a mesh with several
+    // materials, and 'offsets' receives the index range of each band. If requested, the triangles in
+    // each band are shuffled to mimic the poor ordering of scanned and CAD meshes.
+    std::vector<uint32_t> CreateGrid(uint32_t gridSize, const std::vector<uint32_t>& bandRows, bool shuffle, std::vector<uint32_t>& offsets)
+    {
+        const uint32_t stride = gridSize + 1;
+
+        std::vector<Triangle> faces;
+        faces.reserve(size_t(gridSize) * gridSize * 2);
+        for (uint32_t y = 0; y < gridSize; ++y)
+        {
+            for (uint32_t x = 0; x < gridSize; ++x)
+            {
+                const uint32_t a = y * stride + x;
+                faces.push_back({ a, a + 1, a + stride + 1 });
+                faces.push_back({ a, a + stride + 1, a + stride });
+            }
+        }
+
+        offsets.clear();
+        for (const auto row : bandRows)
+        {
+            offsets.push_back(std::min(row, gridSize) * gridSize * 6);
+        }
+
+        uint32_t seed = 0x2545F491;
+        for (size_t band = 0; shuffle && band + 1 < offsets.size(); ++band)
+        {
+            auto first = faces.begin() + offsets[band] / 3;
+            const size_t count = (offsets[band + 1] - offsets[band]) / 3;
+            for (size_t j = count; j > 1; --j)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                std::swap(first[ptrdiff_t(j - 1)], first[ptrdiff_t(seed % j)]);
+            }
+        }
+
+        std::vector<uint32_t> indices;
+        indices.reserve(faces.size() * 3);
+        for (const auto& it : faces)
+        {
+            indices.insert(indices.end(), it.cbegin(), it.cend());
+        }
+        return indices;
+    }
+
+    std::vector<Triangle> GetSortedTriangles(const uint32_t* indices, size_t nFaces, const uint32_t* vertexRemap)
+    {
+        std::vector<Triangle> faces(nFaces);
+        for (size_t j = 0; j < nFaces; ++j)
+        {
+            for (size_t k = 0; k < 3; ++k)
+            {
+                const uint32_t v = indices[j * 3 + k];
+                faces[j][k] = vertexRemap ? vertexRemap[v] : v;
+            }
+        }
+        std::sort(faces.begin(), faces.end());
+        return faces;
+    }
+
+    struct OptimizeResult
+    {
+        float acmrBefore;
+        float atvrBefore;
+        float acmrAfter;
+        float atvrAfter;
+        double time;
+    };
+
+    // Optimizes each range of 'indices' for the vertex cache, then the whole mesh for vertex fetch,
+    // and validates that the result is the same set of triangles with vertices in first-use order.
+    bool OptimizeAndValidate(
+        const std::vector<uint32_t>& indices, const std::vector<uint32_t>& offsets, size_t nVerts,
+        const char* name, OptimizeResult& result)
+    {
+        const size_t nFaces = indices.size() / 3;
+
+        HRESULT hr = DX::ComputeVertexCacheMissRate(indices.data(), nFaces, nVerts, DX::VCACHE_FIFO_DEFAULT, result.acmrBefore, result.atvrBefore);
+        if (FAILED(hr))
+        {
+            printf("ERROR: ComputeVertexCacheMissRate failed for %s (%08X)\n", name, static_cast<unsigned int>(hr));
+            return false;
+        }
+
+        std::vector<uint32_t> optimized(indices.size());
+        std::vector<uint32_t> vertexRemap;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t j = 0; j + 1 < offsets.size(); ++j)
+        {
+            const size_t count = offsets[j + 1] - offsets[j];
+            if (!count)
+                continue;
+
+            hr = DX::OptimizeFacesLRU(indices.data() + offsets[j], count / 3, nVerts, optimized.data() + offsets[j]);
+            if (FAILED(hr))
+            {
+                printf("ERROR: OptimizeFacesLRU failed for %s range %zu (%08X)\n", name, j, static_cast<unsigned int>(hr));
+                return false;
+            }
+        }
+
+        hr = DX::OptimizeVertices(optimized.data(), nFaces, nVerts, vertexRemap);
+        result.time = ElapsedMilliseconds(start);
+        if (FAILED(hr))
+        {
+            printf("ERROR: OptimizeVertices failed for %s (%08X)\n", name, static_cast<unsigned int>(hr));
+            return false;
+        }
+
+        hr = DX::ComputeVertexCacheMissRate(optimized.data(), nFaces, vertexRemap.size(), DX::VCACHE_FIFO_DEFAULT, result.acmrAfter, result.atvrAfter);
+        if (FAILED(hr))
+        {
+            printf("ERROR: ComputeVertexCacheMissRate failed for optimized %s (%08X)\n", name, static_cast<unsigned int>(hr));
+            return false;
+        }
+
+        bool success = true;
+
+        // Each range must hold the same triangles, with the same winding
+        for (size_t j = 0; j + 1 < offsets.size(); ++j)
+        {
+            const size_t count = offsets[j + 1] - offsets[j];
+            auto before = GetSortedTriangles(indices.data() + offsets[j], count / 3, nullptr);
+            auto after = GetSortedTriangles(optimized.data() + offsets[j], count / 3, vertexRemap.data());
+            if (before != after)
+            {
+                printf("ERROR: Optimized triangles do not match for %s range %zu\n", name, j);
+                success = false;
+            }
+        }
+
+        // Vertices must be numbered in the order they are first used
+        uint32_t next = 0;
+        for (const auto it : optimized)
+        {
+            if (it > next)
+            {
+                printf("ERROR: Vertices are not in fetch order for %s\n", name);
+                success = false;
+                break;
+            }
+            else if (it == next)
+            {
+                ++next;
+            }
+        }
+
+        if (next != vertexRemap.size())
+        {
+            printf("ERROR: Unexpected vertex count for %s (%u, %zu)\n", name, next, vertexRemap.size());
+            success = false;
+        }
+
+        return success;
+    }
+
+    // Validates that the subsets cover the triangles in order, and that each one can be drawn with
+    // 16-bit indices from its base vertex.
+    bool ValidateSubsets(const std::vector<uint32_t>& indices, const std::vector<DX::IndexSubset>& subsets, const char* name)
+    {
+        uint32_t next = 0;
+        for (const auto& it : subsets)
+        {
+            if (it.startIndex != next || !it.indexCount || (it.indexCount % 3) != 0 || it.vertexCount > UINT16_MAX)
+            {
+                printf("ERROR: Invalid subset for %s (%u, %u, %u, %u)\n", name, it.startIndex, it.indexCount, it.baseVertex, it.vertexCount);
+                return false;
+            }
+
+            for (uint32_t j = it.startIndex; j < it.startIndex + it.indexCount; ++j)
+            {
+                if (indices[j] < it.baseVertex || indices[j] - it.baseVertex >= it.vertexCount)
+                {
+                    printf("ERROR: Index %u out of subset range for %s\n", j, name);
+                    return false;
+                }
+            }
+
+            next += it.indexCount;
+        }
+
+        if (next != indices.size())
+        {
+            printf("ERROR: Subsets do not cover all indices for %s (%u, %zu)\n", name, next, indices.size());
+            return false;
+        }
+
+        return true;
+    }
+
+    struct MeshletStats
+    {
+        size_t meshlets;
+        size_t vertices;
+        size_t primitives;
+        size_t coneCullable;
+        double time;
+    };
+
+    // Builds meshlets and culling data for a triangle list, validates them, and accumulates statistics.
+    bool BuildMeshlets(
+        const uint32_t* indices, size_t nFaces, const std::vector<XMFLOAT3>& positions,
+        size_t maxVerts, size_t maxPrims, const char* name, MeshletStats& stats)
+    {
+        std::vector<DX::Meshlet> meshlets;
+        std::vector<uint32_t> uniqueVertexIndices;
+        std::vector<DX::MeshletTriangle> primitiveIndices;
+        std::vector<DX::MeshletCullData> cullData;
+
+        auto start = std::chrono::steady_clock::now();
+        HRESULT hr = DX::ComputeMeshlets(indices, nFaces, positions.size(), meshlets, uniqueVertexIndices, primitiveIndices, maxVerts, maxPrims);
+        if (SUCCEEDED(hr))
+        {
+            hr = DX::ComputeCullData(positions.data(), positions.size(), meshlets, uniqueVertexIndices, primitiveIndices, cullData);
+        }
+        stats.time += ElapsedMilliseconds(start);
+
+        if (FAILED(hr))
+        {
+            printf("ERROR: Failed building meshlets for %s (%08X)\n", name, static_cast<unsigned int>(hr));
+            return false;
+        }
+
+        if (cullData.size() != meshlets.size())
+        {
+            printf("ERROR: Missing culling data for %s (%zu, %zu)\n", name, cullData.size(), meshlets.size());
+            return false;
+        }
+
+        // Meshlets must reproduce the non-degenerate triangles in order
+        size_t face = 0;
+        for (size_t m = 0; m < meshlets.size(); ++m)
+        {
+            const auto& meshlet = meshlets[m];
+            if (!meshlet.vertexCount || meshlet.vertexCount > maxVerts || !meshlet.primitiveCount || meshlet.primitiveCount > maxPrims)
+            {
+                printf("ERROR: Meshlet %zu exceeds limits for %s (%u, %u)\n", m, name, meshlet.vertexCount, meshlet.primitiveCount);
+                return false;
+            }
+
+            const uint32_t* vertexIndices = uniqueVertexIndices.data() + meshlet.vertexOffset;
+            for (uint32_t j = 0; j < meshlet.primitiveCount; ++j)
+            {
+                while (face < nFaces
+                    && (indices[face * 3] == indices[face * 3 + 1]
+                        || indices[face * 3 + 1] == indices[face * 3 + 2]
+                        || indices[face * 3] == indices[face * 3 + 2]))
+                {
+                    ++face;
+                }
+
+                const auto& prim = primitiveIndices[size_t(meshlet.primitiveOffset) + j];
+                if (face >= nFaces
+                    || vertexIndices[prim.i0] != indices[face * 3]
+                    || vertexIndices[prim.i1] != indices[face * 3 + 1]
+                    || vertexIndices[prim.i2] != indices[face * 3 + 2])
+                {
+                    printf("ERROR: Meshlet %zu does not match triangle %zu for %s\n", m, face, name);
+                    return false;
+                }
+                ++face;
+            }
+
+            // The bounding sphere holds every vertex, and the cone never culls a front-facing triangle
+            const auto& cull = cullData[m];
+            const XMVECTOR center = XMLoadFloat3(&cull.boundingSphere.Center);
+            const float radius = cull.boundingSphere.Radius;
+            const float epsilon = 1e-4f * (radius + 1.f);
+            for (uint32_t j = 0; j < meshlet.vertexCount; ++j)
+            {
+                const XMVECTOR p = XMLoadFloat3(&positions[vertexIndices[j]]);
+                if (XMVectorGetX(XMVector3Length(XMVectorSubtract(p, center))) > radius + epsilon)
+                {
+                    printf("ERROR: Meshlet %zu bounding sphere does not contain its vertices for %s\n", m, name);
+                    return false;
+                }
+            }
+
+            if (cull.coneCutoff < 1.f)
+            {
+                ++stats.coneCullable;
+
+                static const float s_directions[][3] =
+                {
+                    { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+                    { 1, 1, 1 }, { 1, 1, -1 }, { 1, -1, 1 }, { 1, -1, -1 },
+                    { -1, 1, 1 }, { -1, 1, -1 }, { -1, -1, 1 }, { -1, -1, -1 },
+                };
+
+                const XMVECTOR axis = XMLoadFloat3(&cull.coneAxis);
+                for (size_t e = 0; e <= std::size(s_directions); ++e)
+                {
+                    const XMVECTOR dir = (e < std::size(s_directions))
+                        ? XMVector3Normalize(XMVectorSet(s_directions[e][0], s_directions[e][1], s_directions[e][2], 0.f))
+                        : XMVectorScale(axis, -1.f);
+                    const XMVECTOR eye = XMVectorAdd(center, XMVectorScale(dir, radius * 3.f + 1.f));
+                    if (!DX::IsMeshletBackFacing(cull, eye))
+                        continue;
+
+                    for (uint32_t j = 0; j < meshlet.primitiveCount; ++j)
+                    {
+                        const auto& prim = primitiveIndices[size_t(meshlet.primitiveOffset) + j];
+                        const XMVECTOR p0 = XMLoadFloat3(&positions[vertexIndices[prim.i0]]);
+                        const XMVECTOR p1 = XMLoadFloat3(&positions[vertexIndices[prim.i1]]);
+                        const XMVECTOR p2 = XMLoadFloat3(&positions[vertexIndices[prim.i2]]);
+                        const XMVECTOR n = XMVector3Normalize(XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0)));
+                        if (XMVectorGetX(XMVector3Dot(n, XMVectorSubtract(eye, p0))) > epsilon)
+                        {
+                            printf("ERROR: Meshlet %zu normal cone culls a front-facing triangle for %s\n", m, name);
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+
+        stats.meshlets += meshlets.size();
+        stats.vertices += uniqueVertexIndices.size();
+        stats.primitives += primitiveIndices.size();
+        return true;
+    }
+
+    // Reads the triangle list and positions of a model part from its CPU-side buffers.
+    bool GetPartGeometry(const ModelMeshPart& part, std::vector<uint32_t>& indices, std::vector<XMFLOAT3>& positions)
+    {
+        indices.clear();
+        positions.clear();
+
+        if (part.primitiveType != D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+            || !part.indexBuffer.Memory() || !part.vertexBuffer.Memory() || !part.vertexStride
+            || !part.vbDecl || part.vbDecl->empty())
+            return false;
+
+        // Position must be the first element of the vertex
+        const auto& element = part.vbDecl->front();
+        if ((strcmp(element.SemanticName, "SV_Position") != 0 && strcmp(element.SemanticName, "POSITION") != 0)
+            || (element.Format != DXGI_FORMAT_R32G32B32_FLOAT && element.Format != DXGI_FORMAT_R32G32B32A32_FLOAT)
+            || (element.AlignedByteOffset != 0 && element.AlignedByteOffset != D3D12_APPEND_ALIGNED_ELEMENT))
+            return false;
+
+        const size_t nVerts = part.vertexBufferSize / part.vertexStride;
+        auto vertexData = static_cast<const uint8_t*>(part.vertexBuffer.Memory());
+        positions.resize(nVerts);
+        for (size_t j = 0; j < nVerts; ++j)
+        {
+            memcpy(&positions[j], vertexData + j * part.vertexStride, sizeof(XMFLOAT3));
+        }
+
+        const bool use32 = (part.indexFormat == DXGI_FORMAT_R32_UINT);
+        const size_t indexSize = use32 ? sizeof(uint32_t) : sizeof(uint16_t);
+        if ((size_t(part.startIndex) + part.indexCount) * indexSize > part.indexBufferSize)
+            return false;
+
+        auto indexData = static_cast<const uint8_t*>(part.indexBuffer.Memory());
+        indices.resize(part.indexCount);
+        for (size_t j = 0; j < part.indexCount; ++j)
+        {
+            const size_t offset = (size_t(part.startIndex) + j) * indexSize;
+            uint32_t index = 0;
+            if (use32)
+            {
+                memcpy(&index, indexData + offset, sizeof(uint32_t));
+            }
+            else
+            {
+                uint16_t index16 = 0;
+                memcpy(&index16, indexData + offset, sizeof(uint16_t));
+                index = index16;
+            }
+
+            index += static_cast<uint32_t>(part.vertexOffset);
+            if (index >= nVerts)
+                return false;
+
+            indices[j] = index;
+        }
+
+        return true;
+    }
+
+    // Validates a chain of levels of detail: each level is a smaller set of triangles over the original
+    // vertices, none degenerate, with non-decreasing error, that still references every vertex in 'keep'.
+    bool ValidateLODs(const std::vector<DX::MeshLOD<uint32_t>>& lods, const std::vector<XMFLOAT3>& positions, const std::vector<uint32_t>& keep, const char* name)
+    {
+        std::vector<uint8_t> used;
+        for (size_t level = 1; level < lods.size(); ++level)
+        {
+            const auto& lod = lods[level];
+            if (lod.indices.empty() || (lod.indices.size() % 3) != 0 || lod.indices.size() >= lods[level - 1].indices.size())
+            {
+                printf("ERROR: LOD %zu of %s does not reduce the triangle count (%zu -> %zu)\n", level, name, lods[level - 1].indices.size() / 3, lod.indices.size() / 3);
+                return false;
+            }
+
+            if (!(lod.error >= lods[level - 1].error))
+            {
+                printf("ERROR: LOD %zu of %s has decreasing error (%f -> %f)\n", level, name, double(lods[level - 1].error), double(lod.error));
+                return false;
+            }
+
+            used.assign(positions.size(), 0);
+            for (size_t j = 0; j < lod.indices.size(); j += 3)
+            {
+                const uint32_t* tri = &lod.indices[j];
+                if (tri[0] >= positions.size() || tri[1] >= positions.size() || tri[2] >= positions.size())
+                {
+                    printf("ERROR: LOD %zu of %s references a vertex out of range\n", level, name);
+                    return false;
+                }
+
+                const XMFLOAT3& a = positions[tri[0]];
+                const XMFLOAT3& b = positions[tri[1]];
+                const XMFLOAT3& c = positions[tri[2]];
+                if ((a.x == b.x && a.y == b.y && a.z == b.z)
+                    || (b.x == c.x && b.y == c.y && b.z == c.z)
+                    || (a.x == c.x && a.y == c.y && a.z == c.z))
+                {
+                    printf("ERROR: LOD %zu of %s has a degenerate triangle %zu\n", level, name, j / 3);
+                    return false;
+                }
+
+                used[tri[0]] = used[tri[1]] = used[tri[2]] = 1;
+            }
+
+            for (const auto v : keep)
+            {
+                if (!used[v])
+                {
+                    printf("ERROR: LOD %zu of %s removed seam or border vertex %u\n", level, name, v);
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    void PrintMeshletStats(const char* name, size_t maxVerts, size_t maxPrims, const MeshletStats& stats)
+    {
+        const double meshlets = double(std::max<size_t>(stats.meshlets, 1));
+        printf("\t%s (%zu/%zu): %zu meshlets, vertex fill %.1f%%, primitive fill %.1f%%, %.1f%% cone-cullable, %.2f ms\n",
+            name, maxVerts, maxPrims, stats.meshlets,
+            100.0 * double(stats.vertices) / (meshlets * double(maxVerts)),
+            100.0 * double(stats.primitives) / (meshlets * double(maxPrims)),
+            100.0 * double(stats.coneCullable) / meshlets,
+            stats.time);
+    }
+}
+
+_Success_(return)
+bool Test24(_In_ ID3D12Device* device)
+{
+    if (!device)
+        return false;
+
+    bool success = true;
+
+    // Test media, grouped by material as CreateModelFromOBJ does
+    {
+        DX::WaveFrontReader<uint32_t> reader;
+        HRESULT hr = reader.Load(L"ModelTest\\cup._obj", true, false);
+        if (FAILED(hr))
+        {
+            printf("ERROR: Failed loading cup._obj (%08X)\n", static_cast<unsigned int>(hr));
+            success = false;
+        }
+        else
+        {
+            std::vector<uint32_t> indices(reader.indices.size());
+            std::vector<uint32_t> offsets;
+            hr = reader.SortByAttribute(indices.data(), indices.size(), offsets);
+
+            OptimizeResult result = {};
+            if (FAILED(hr))
+            {
+                printf("ERROR: SortByAttribute failed for cup._obj (%08X)\n", static_cast<unsigned int>(hr));
+                success = false;
+            }
+            else if (!OptimizeAndValidate(indices, offsets, reader.vertices.size(), "cup._obj", result))
+            {
+                success = false;
+            }
+            else if (std::vector<uint16_t> indices16(indices.size());
+                FAILED(reader.SortByAttribute(indices16.data(), indices16.size(), offsets))
+                || !std::equal(indices.cbegin(), indices.cend(), indices16.cbegin()))
+            {
+                printf("ERROR: SortByAttribute with 16-bit indices does not match for cup._obj\n");
+                success = false;
+            }
+            else
+            {
+                printf("\n\tcup._obj: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%.2f ms)\n",
+                    double(result.acmrBefore), double(result.acmrAfter),
+                    double(result.atvrBefore), double(result.atvrAfter), result.time);
+            }
+        }
+    }
+
+    // Levels of detail for generated grids
+    {
+        constexpr uint32_t c_gridSize = 64;
+        constexpr uint32_t c_stride = c_gridSize + 1;
+        constexpr size_t c_lodCount = 4;
+
+        std::vector<uint32_t> offsets;
+        auto indices = CreateGrid(c_gridSize, { 0, c_gridSize }, false, offsets);
+        const size_t nFaces = indices.size() / 3;
+
+        std::vector<XMFLOAT3> positions;
+        positions.reserve(size_t(c_stride) * (c_stride + 1));
+        for (uint32_t y = 0; y < c_stride; ++y)
+        {
+            for (uint32_t x = 0; x < c_stride; ++x)
+            {
+                positions.emplace_back(float(x), float(y), 0.f);
+            }
+        }
+
+        // The border of the grid must be kept
+        std::vector<uint32_t> keep;
+        for (uint32_t j = 0; j < c_stride; ++j)
+        {
+            keep.insert(keep.end(), { j, c_gridSize * c_stride + j, j * c_stride, j * c_stride + c_gridSize });
+        }
+
+        std::vector<DX::MeshLOD<uint32_t>> lods;
+        HRESULT hr = DX::GenerateLODs(indices.data(), nFaces, positions.data(), positions.size(), c_lodCount, 0.5f, lods);
+        if (FAILED(hr))
+        {
+            printf("ERROR: GenerateLODs failed for flat grid (%08X)\n", static_cast<unsigned int>(hr));
+            success = false;
+        }
+        else if (!ValidateLODs(lods, positions, keep, "flat grid"))
+        {
+            success = false;
+        }
+        else if (lods.size() != c_lodCount || lods.back().indices.size() / 3 > nFaces / 8 || lods.back().error > 1e-4f)
+        {
+            printf("ERROR: Unexpected LODs for flat grid (%zu levels, %zu faces, error %f)\n",
+                lods.size(), lods.back().indices.size() / 3, double(lods.back().error));
+            success = false;
+        }
+        else
+        {
+            printf("\n\tflat %zu-face grid: LOD%zu has %zu faces\n", nFaces, lods.size() - 1, lods.back().indices.size() / 3);
+        }
+
+        // Curve the grid and give the right half its own copy of the middle column, as for a UV seam
+        constexpr uint32_t c_seam = c_gridSize / 2;
+        const auto seamBase = static_cast<uint32_t>(positions.size());
+        for (uint32_t y = 0; y < c_stride; ++y)
+        {
+            keep.push_back(y * c_stride + c_seam);
+            keep.push_back(seamBase + y);
+            positions.push_back(positions[y * c_stride + c_seam]);
+        }
+
+        for (auto& it : positions)
+        {
+            it.z = 4.f * std::sin(it.x * 0.2f) * std::cos(it.y * 0.15f);
+        }
+
+        for (size_t j = 0; j < nFaces; ++j)
+        {
+            uint32_t* tri = &indices[j * 3];
+            if (std::max({ tri[0] % c_stride, tri[1] % c_stride, tri[2] % c_stride }) <= c_seam)
+                continue;
+
+            for (size_t k = 0; k < 3; ++k)
+            {
+                if (tri[k] % c_stride == c_seam)
+                    tri[k] = seamBase + tri[k] / c_stride;
+            }
+        }
+
+        hr = DX::GenerateLODs(indices.data(), nFaces, positions.data(), positions.size(), c_lodCount, 0.5f, lods);
+        if (FAILED(hr))
+        {
+            printf("ERROR: GenerateLODs failed for curved grid (%08X)\n", static_cast<unsigned int>(hr));
+            success = false;
+        }
+        else if (!ValidateLODs(lods, positions, keep, "curved grid with a seam"))
+        {
+            success = false;
+        }
+        else if (lods.size() < 2 || !(lods.back().error > 0.f))
+        {
+            printf("ERROR: Unexpected LODs for curved grid (%zu levels, error %f)\n", lods.size(), double(lods.back().error));
+            success = false;
+        }
+        else
+        {
+            printf("\tcurved %zu-face grid with a seam: LOD%zu has %zu faces, error %.4f\n",
+                nFaces, lods.size() - 1, lods.back().indices.size() / 3, double(lods.back().error));
+        }
+
+        // An error limit stops the simplification early
+        std::vector<uint32_t> simplified;
+        float error = 0.f;
+        const float maxError = lods.back().error * 0.25f;
+        hr = DX::SimplifyMesh(indices.data(), nFaces, positions.data(), positions.size(), 0, maxError, simplified, error);
+        if (FAILED(hr) || error > maxError || simplified.empty())
+        {
+            printf("ERROR: SimplifyMesh did not respect the error limit %f (%08X, %f)\n", double(maxError), static_cast<unsigned int>(hr), double(error));
+            success = false;
+        }
+
+        // LOD selection from the projected size of the bounding sphere
+        lods.resize(3);
+        lods[0].error = 0.f;
+        lods[1].error = 0.01f;
+        lods[2].error = 0.05f;
+
+        const BoundingSphere sphere(XMFLOAT3(0.f, 0.f, 10.f), 1.f);
+        const float projected = DX::ComputeProjectedRadius(sphere, g_XMZero, XM_PIDIV2, 1080.f);
+        if (std::abs(projected - 54.f) > 1e-3f
+            || DX::ComputeProjectedRadius(sphere, XMVectorSet(0.f, 0.f, 9.5f, 0.f), XM_PIDIV2, 1080.f) != FLT_MAX)
+        {
+            printf("ERROR: Unexpected projected radius %f\n", double(projected));
+            success = false;
+        }
+
+        if (DX::SelectLOD(lods, 1.f, 1000.f) != 0
+            || DX::SelectLOD(lods, 1.f, projected) != 1
+            || DX::SelectLOD(lods, 1.f, 10.f) != 2
+            || DX::SelectLOD(lods, 1.f, FLT_MAX) != 0
+            || DX::SelectLOD(lods, 2.f, 1000.f, 30.f) != 2)
+        {
+            printf("ERROR: Unexpected LOD selection\n");
+            success = false;
+        }
+    }
+
+    // Invalid arguments
+    {
+        static const uint32_t s_indices[] = { 0, 1, 2, 2, 1, 3 };
+        static const uint32_t s_badIndices[] = { 0, 1, 2, 2, 1, 4 };
+
+        uint32_t out[6] = {};
+        std::vector<uint32_t> remap;
+        float acmr, atvr;
+
+        if (DX::OptimizeFacesLRU<uint32_t>(nullptr, 2, 4, out) != E_INVALIDARG
+            || DX::OptimizeFacesLRU(s_indices, 2, 4, static_cast<uint32_t*>(nullptr)) != E_INVALIDARG
+            || DX::OptimizeFacesLRU(s_indices, 0, 4, out) != E_INVALIDARG
+            || DX::OptimizeFacesLRU(s_badIndices, 2, 4, out) != E_UNEXPECTED)
+        {
+            printf("ERROR: Expected failure for invalid OptimizeFacesLRU arguments\n");
+            success = false;
+        }
+
+        std::copy(std::begin(s_badIndices), std::end(s_badIndices), out);
+        if (DX::OptimizeVertices<uint32_t>(nullptr, 2, 4, remap) != E_INVALIDARG
+            || DX::OptimizeVertices(out, 2, 4, remap) != E_UNEXPECTED
+            || !remap.empty())
+        {
+            printf("ERROR: Expected failure for invalid OptimizeVertices arguments\n");
+            success = false;
+        }
+
+        std::vector<DX::IndexSubset> subsets;
+        if (DX::SplitIndices16<uint32_t>(nullptr, 1, subsets) != E_INVALIDARG
+            || DX::SplitIndices16(s_indices, 0, subsets) != E_INVALIDARG)
+        {
+            printf("ERROR: Expected failure for invalid SplitIndices16 arguments\n");
+            success = false;
+        }
+
+        std::vector<DX::Meshlet> meshlets;
+        std::vector<uint32_t> uniqueVertexIndices;
+        std::vector<DX::MeshletTriangle> primitiveIndices;
+        if (DX::ComputeMeshlets<uint32_t>(nullptr, 2, 4, meshlets, uniqueVertexIndices, primitiveIndices) != E_INVALIDARG
+            || DX::ComputeMeshlets(s_indices, 2, 4, meshlets, uniqueVertexIndices, primitiveIndices, 2, 1) != E_INVALIDARG
+            || DX::ComputeMeshlets(s_indices, 2, 4, meshlets, uniqueVertexIndices, primitiveIndices, 3, DX::MESHLET_MAXIMUM_SIZE + 1) != E_INVALIDARG
+            || DX::ComputeMeshlets(s_badIndices, 2, 4, meshlets, uniqueVertexIndices, primitiveIndices) != E_UNEXPECTED
+            || !meshlets.empty())
+        {
+            printf("ERROR: Expected failure for invalid ComputeMeshlets arguments\n");
+            success = false;
+        }
+
+        // A quad split at the primitive limit
+        if (FAILED(DX::ComputeMeshlets(s_indices, 2, 4, meshlets, uniqueVertexIndices, primitiveIndices, 3, 1))
+            || meshlets.size() != 2 || uniqueVertexIndices.size() != 6 || primitiveIndices.size() != 2)
+        {
+            printf("ERROR: Unexpected meshlets for a quad (%zu, %zu, %zu)\n", meshlets.size(), uniqueVertexIndices.size(), primitiveIndices.size());
+            success = false;
+        }
+
+        if (DX::ComputeVertexCacheMissRate(s_indices, 2, 4, 0, acmr, atvr) != E_INVALIDARG
+            || DX::ComputeVertexCacheMissRate(s_badIndices, 2, 4, DX::VCACHE_FIFO_DEFAULT, acmr, atvr) != E_UNEXPECTED)
+        {
+            printf("ERROR: Expected failure for invalid ComputeVertexCacheMissRate arguments\n");
+            success = false;
+        }
+
+        static const XMFLOAT3 s_positions[] =
+        {
+            XMFLOAT3(0.f, 0.f, 0.f), XMFLOAT3(1.f, 0.f, 0.f), XMFLOAT3(0.f, 1.f, 0.f), XMFLOAT3(1.f, 1.f, 0.f),
+        };
+
+        std::vector<DX::MeshLOD<uint32_t>> lods;
+        std::vector<uint32_t> simplified;
+        float error = 0.f;
+        if (DX::SimplifyMesh<uint32_t>(nullptr, 2, s_positions, 4, 1, FLT_MAX, simplified, error) != E_INVALIDARG
+            || DX::SimplifyMesh(s_indices, 2, static_cast<const XMFLOAT3*>(nullptr), 4, 1, FLT_MAX, simplified, error) != E_INVALIDARG
+            || DX::SimplifyMesh(s_badIndices, 2, s_positions, 4, 1, FLT_MAX, simplified, error) != E_UNEXPECTED
+            || DX::GenerateLODs(s_indices, 2, s_positions, 4, 0, 0.5f, lods) != E_INVALIDARG
+            || DX::GenerateLODs(s_indices, 2, s_positions, 4, 2, 1.f, lods) != E_INVALIDARG
+            || DX::GenerateLODs(s_badIndices, 2, s_positions, 4, 2, 0.5f, lods) != E_UNEXPECTED
+            || !lods.empty())
+        {
+            printf("ERROR: Expected failure for invalid SimplifyMesh or GenerateLODs arguments\n");
+            success = false;
+        }
+
+        // A quad has only border vertices, so it cannot be reduced
+        if (FAILED(DX::GenerateLODs(s_indices, 2, s_positions, 4, 2, 0.5f, lods)) || lods.size() != 1)
+        {
+            printf("ERROR: Unexpected LODs for a quad (%zu)\n", lods.size());
+            success = false;
+        }
+
+        if (FAILED(DX::ComputeVertexCacheMissRate(s_indices, 2, 4, DX::VCACHE_FIFO_DEFAULT, acmr, atvr))
+            || acmr != 2.f || atvr != 1.f)
+        {
+            printf("ERROR: Unexpected cache statistics for a quad (%f, %f)\n", double(acmr), double(atvr));
+            success = false;
+        }
+    }
+
+    return success;
+}
+
+// Timings for large generated grids and the test models
+_Success_(return)
+bool Test36(_In_ ID3D12Device* device)
+{
+    if (!device)
+        return false;
+
+    bool success = true;
+
+    // Generated grid with shuffled triangles
+    {
+        constexpr uint32_t c_gridSize = 256;
+        const size_t nVerts = size_t(c_gridSize + 1) * (c_gridSize + 1);
+
+        // Bands of rows, including an empty one
+        std::vector<uint32_t> offsets;
+        const auto indices = CreateGrid(c_gridSize, { 0, 40, 40, 128, c_gridSize }, true, offsets);
+
+        OptimizeResult result = {};
+        if (!OptimizeAndValidate(indices, offsets, nVerts, "shuffled grid", result))
+        {
+            success = false;
+        }
+        else if (result.acmrAfter >= 0.8f || result.atvrAfter >= 1.6f)
+        {
+            printf("ERROR: Poor vertex cache optimization for shuffled grid: ACMR %f -> %f, ATVR %f -> %f\n",
+                double(result.acmrBefore), double(result.acmrAfter), double(result.atvrBefore), double(result.atvrAfter));
+            success = false;
+        }
+        else
+        {
+            printf("\n\tshuffled %zu-face grid: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%.2f ms)\n",
+                indices.size() / 3,
+                double(result.acmrBefore), double(result.acmrAfter),
+                double(result.atvrBefore), double(result.atvrAfter), result.time);
+        }
+    }
+
+    // Split meshes with more vertices than 16-bit indices can address
+    {
+        constexpr uint32_t c_gridSize = 300;
+        const size_t nVerts = size_t(c_gridSize + 1) * (c_gridSize + 1);
+
+        std::vector<uint32_t> offsets;
+        auto indices = CreateGrid(c_gridSize, { 0, c_gridSize }, false, offsets);
+
+        std::vector<DX::IndexSubset> subsets;
+        HRESULT hr = DX::SplitIndices16(indices.data(), indices.size() / 3, subsets);
+        if (FAILED(hr))
+        {
+            printf("ERROR: SplitIndices16 failed for %zu vertices (%08X)\n", nVerts, static_cast<unsigned int>(hr));
+            success = false;
+        }
+        else if (!ValidateSubsets(indices, subsets, "grid") || subsets.size() != 2)
+        {
+            success = false;
+        }
+        else
+        {
+            printf("\t%zu-face grid with %zu vertices: %zu 16-bit parts\n", indices.size() / 3, nVerts, subsets.size());
+        }
+
+        // A triangle that spans more than 16 bits cannot be split
+        indices[0] = 0;
+        indices[1] = 1;
+        indices[2] = UINT16_MAX;
+        if (DX::SplitIndices16(indices.data(), indices.size() / 3, subsets) != E_FAIL || !subsets.empty())
+        {
+            printf("ERROR: Expected failure for triangle spanning more than 16 bits\n");
+            success = false;
+        }
+
+        indices[2] = UINT16_MAX - 1;
+        if (FAILED(DX::SplitIndices16(indices.data(), indices.size() / 3, subsets))
+            || !ValidateSubsets(indices, subsets, "grid with a wide triangle"))
+        {
+            printf("ERROR: SplitIndices16 failed for triangle spanning 16 bits\n");
+            success = false;
+        }
+    }
+
+    // Meshlets for model parts
+    {
+        static const size_t s_limits[][2] = { { 64, 126 }, { DX::MESHLET_DEFAULT_MAX_VERTS, DX::MESHLET_DEFAULT_MAX_PRIMS } };
+
+        static const struct
+        {
+            const wchar_t* fileName;
+            const char* name;
+            bool sdkmesh;
+        } s_models[] =
+        {
+            { L"ModelTest\\gamelevel.cmo", "gamelevel.cmo", false },
+            { L"ModelTest\\soldier.sdkmesh", "soldier.sdkmesh", true },
+        };
+
+        for (const auto& model : s_models)
+        {
+            std::unique_ptr<Model> obj;
+            try
+            {
+                obj = model.sdkmesh
+                    ? Model::CreateFromSDKMESH(device, model.fileName)
+                    : Model::CreateFromCMO(device, model.fileName);
+            }
+            catch (const std::exception& e)
+            {
+                printf("ERROR: Failed loading %s (except: %s)\n", model.name, e.what());
+                success = false;
+                continue;
+            }
+
+            for (const auto& limits : s_limits)
+            {
+                MeshletStats stats = {};
+                std::vector<uint32_t> indices;
+                std::vector<XMFLOAT3> positions;
+                for (const auto& mesh : obj->meshes)
+                {
+                    for (const auto* parts : { &mesh->opaqueMeshParts, &mesh->alphaMeshParts })
+                    {
+                        for (const auto& part : *parts)
+                        {
+                            if (!GetPartGeometry(*part, indices, positions))
+                            {
+                                printf("ERROR: Unsupported part %u in %s\n", part->partIndex, model.name);
+                                success = false;
+                            }
+                            else if (!BuildMeshlets(indices.data(), indices.size() / 3, positions, limits[0], limits[1], model.name, stats))
+                            {
+                                success = false;
+                            }
+                        }
+                    }
+                }
+
+                PrintMeshletStats(model.name, limits[0], limits[1], stats);
+            }
+        }
+
+        DX::WaveFrontReader<uint32_t> reader;
+        HRESULT hr = reader.Load(L"ModelTest\\cup._obj", true, false);
+        std::vector<uint32_t> indices(reader.indices.size());
+        std::vector<uint32_t> offsets;
+        if (SUCCEEDED(hr))
+        {
+            hr = reader.SortByAttribute(indices.data(), indices.size(), offsets);
+        }
+
+        if (FAILED(hr))
+        {
+            printf("ERROR: Failed loading cup._obj for meshlets (%08X)\n", static_cast<unsigned int>(hr));
+            success = false;
+        }
+        else
+        {
+            std::vector<XMFLOAT3> positions;
+            positions.reserve(reader.vertices.size());
+            for (const auto& it : reader.vertices)
+            {
+                positions.push_back(it.position);
+            }
+
+            for (const auto& limits : s_limits)
+            {
+                MeshletStats stats = {};
+                for (size_t j = 0; j + 1 < offsets.size(); ++j)
+                {
+                    const size_t count = offsets[j + 1] - offsets[j];
+                    if (count > 0
+                        && !BuildMeshlets(indices.data() + offsets[j], count / 3, positions, limits[0], limits[1], "cup._obj", stats))
+                    {
+                        success = false;
+                    }
+                }
+
+                PrintMeshletStats("cup._obj", limits[0], limits[1], stats);
+            }
+        }
+    }
+
+    // Levels of detail for test models
+    {
+        constexpr size_t c_lodCount = 4;
+
+        static const struct
+        {
+            const wchar_t* fileName;
+            const char* name;
+            bool sdkmesh;
+        } s_models[] =
+        {
+            { L"ModelTest\\Helmet.sdkmesh", "Helmet.sdkmesh", true },
+            { L"ModelTest\\dwarf.sdkmesh", "dwarf.sdkmesh", true },
+            { L"ModelTest\\gamelevel.cmo", "gamelevel.cmo", false },
+        };
+
+        for (const auto& model : s_models)
+        {
+            std::unique_ptr<Model> obj;
+            try
+            {
+                obj = model.sdkmesh
+                    ? Model::CreateFromSDKMESH(device, model.fileName)
+                    : Model::CreateFromCMO(device, model.fileName);
+            }
+            catch (const std::exception& e)
+            {
+                printf("ERROR: Failed loading %s (except: %s)\n", model.name, e.what());
+                success = false;
+                continue;
+            }
+
+            size_t faces[c_lodCount] = {};
+            float errors[c_lodCount] = {};
+            XMVECTOR vmin = XMVectorReplicate(FLT_MAX);
+            XMVECTOR vmax = XMVectorReplicate(-FLT_MAX);
+
+            auto start = std::chrono::steady_clock::now();
+
+            std::vector<uint32_t> indices;
+            std::vector<XMFLOAT3> positions;
+            std::vector<DX::MeshLOD<uint32_t>> lods;
+            for (const auto& mesh : obj->meshes)
+            {
+                for (const auto* parts : { &mesh->opaqueMeshParts, &mesh->alphaMeshParts })
+                {
+                    for (const auto& part : *parts)
+                    {
+                        if (!GetPartGeometry(*part, indices, positions))
+                        {
+                            printf("ERROR: Unsupported part %u in %s\n", part->partIndex, model.name);
+                            success = false;
+                            continue;
+                        }
+
+                        HRESULT hr = DX::GenerateLODs(indices.data(), indices.size() / 3, positions.data(), positions.size(), c_lodCount, 0.5f, lods);
+                        if (FAILED(hr))
+                        {
+                            printf("ERROR: GenerateLODs failed for part %u in %s (%08X)\n", part->partIndex, model.name, static_cast<unsigned int>(hr));
+                            success = false;
+                            continue;
+                        }
+
+                        if (!ValidateLODs(lods, positions, {}, model.name))
+                        {
+                            success = false;
+                            continue;
+                        }
+
+                        // Parts that stop reducing are drawn at their last level
+                        for (size_t level = 0; level < c_lodCount; ++level)
+                        {
+                            const auto& lod = lods[std::min(level, lods.size() - 1)];
+                            faces[level] += lod.indices.size() / 3;
+                            errors[level] = std::max(errors[level], lod.error);
+                        }
+
+                        for (const auto& it : positions)
+                        {
+                            const XMVECTOR p = XMLoadFloat3(&it);
+                            vmin = XMVectorMin(vmin, p);
+                            vmax = XMVectorMax(vmax, p);
+                        }
+                    }
+                }
+            }
+
+            const double time = ElapsedMilliseconds(start);
+
+            // Error is reported relative to the radius of the model bounds
+            const float radius = std::max(XMVectorGetX(XMVector3Length(XMVectorSubtract(vmax, vmin))) * 0.5f, FLT_EPSILON);
+
+            printf("\t%s: %zu faces", model.name, faces[0]);
+            for (size_t level = 1; level < c_lodCount; ++level)
+            {
+                printf(" -> %zu (%.1f%%, error %.3f%%)",
+                    faces[level],
+                    100.0 * double(faces[level]) / double(std::max<size_t>(faces[0], 1)),
+                    100.0 * double(errors[level] / radius));
+            }
+            printf(" (%.2f ms)\n", time);
+        }
+    }
+
+    return success;
+}
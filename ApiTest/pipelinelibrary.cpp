@@ -0,0 +1,248 @@
+//--------------------------------------------------------------------------------------
+// File: pipelinelibrary.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkID=615561
+//-------------------------------------------------------------------------------------
+
+#ifdef __MINGW32__
+#include <unknwn.h>
+#endif
+
+#include "Effects.h"
+
+#include "CommonStates.h"
+#include "EffectPipelineStateDescription.h"
+#include "GraphicsMemory.h"
+#include "RenderTargetState.h"
+#include "VertexTypes.h"
+
+#include "PipelineLibrary.h"
+#include "PipelineStateCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <wrl/client.h>
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    const uint32_t c_flags[] =
+    {
+        EffectFlags::None,
+        EffectFlags::Fog,
+        EffectFlags::VertexColor,
+        EffectFlags::Texture,
+        EffectFlags::Texture | EffectFlags::VertexColor,
+        EffectFlags::Lighting,
+        EffectFlags::Lighting | EffectFlags::Texture,
+        EffectFlags::PerPixelLighting,
+        EffectFlags::PerPixelLighting | EffectFlags::Texture,
+    };
+
+    struct Startup
+    {
+        DX::PipelineLibrary::State      state;
+        DX::PipelineLibrary::Statistics stats;
+        double                          effectsTime;
+        HRESULT                         saved;
+    };
+
+    // Opens the library, creates the effects through it as an application would at startup, and
+    // saves it as on exit.
+    Startup Start(ID3D12Device* device, ID3D12Device* effectDevice, const wchar_t* fileName, const EffectPipelineStateDescription& pd)
+    {
+        auto& cache = DX::PipelineStateCache::Get();
+        cache.Clear();
+
+        DX::PipelineLibrary library(device, fileName);
+        cache.SetLibrary(&library);
+
+        Startup result = {};
+
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::vector<std::unique_ptr<BasicEffect>> effects;
+            for (auto flags : c_flags)
+            {
+                effects.emplace_back(std::make_unique<BasicEffect>(effectDevice, flags, pd));
+            }
+        }
+        result.effectsTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        cache.SetLibrary(nullptr);
+        cache.Clear();
+
+        result.saved = library.Save();
+        result.state = library.GetState();
+        result.stats = library.GetStatistics();
+        return result;
+    }
+
+    // Overwrites 'size' bytes of the file at 'offset'.
+    bool Overwrite(const std::wstring& fileName, std::streamoff offset, const void* data, size_t size)
+    {
+        std::fstream file(fileName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+        if (!file)
+            return false;
+
+        file.seekp(offset, std::ios::beg);
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        return !file.fail();
+    }
+}
+
+_Success_(return)
+bool Test35(_In_ ID3D12Device* device)
+{
+    if (!device)
+        return false;
+
+    bool success = true;
+
+    wchar_t tempPath[MAX_PATH] = {};
+    if (!GetTempPathW(MAX_PATH, tempPath))
+    {
+        printf("ERROR: Failed to get the temp path\n");
+        return false;
+    }
+
+    std::wstring fileName(tempPath);
+    fileName += L"apitest_pipelinelibrary.bin";
+
+    std::ignore = DeleteFileW(fileName.c_str());
+
+    // invalid args
+    try
+    {
+        DX::PipelineLibrary library(nullptr, fileName.c_str());
+
+        printf("ERROR: Failed to catch null device\n");
+        success = false;
+    }
+    catch (const std::invalid_argument&)
+    {
+    }
+
+    ComPtr<DX::PipelineCachingDevice> wrapper;
+    HRESULT hr = DX::PipelineCachingDevice::Create(device, wrapper.GetAddressOf());
+    if (FAILED(hr))
+    {
+        printf("ERROR: Failed to wrap the device (%08X)\n", static_cast<unsigned int>(hr));
+        return false;
+    }
+
+    const RenderTargetState rtState(DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_FORMAT_D32_FLOAT);
+
+    const EffectPipelineStateDescription pd(
+        &VertexPositionNormalColorTexture::InputLayout,
+        CommonStates::Opaque,
+        CommonStates::DepthDefault,
+        CommonStates::CullNone,
+        rtState);
+
+    try
+    {
+        // The effects look up the constant buffer memory by the device they are given
+        GraphicsMemory graphicsMemory(wrapper.Get());
+
+        const auto cold = Start(device, wrapper.Get(), fileName.c_str(), pd);
+        if (cold.state == DX::PipelineLibrary::State::Unsupported)
+        {
+            printf("\n\tPipeline libraries are not supported by this device\n");
+            return success;
+        }
+
+        if (cold.state != DX::PipelineLibrary::State::Missing
+            || cold.stats.loaded != 0 || cold.stats.created == 0 || cold.stats.stored != cold.stats.created || cold.saved != S_OK)
+        {
+            printf("ERROR: Expected a cold start to create and store every pipeline state (%s, %llu loaded, %llu created, %llu stored, %08X)\n",
+                DX::PipelineLibrary::GetStateName(cold.state), cold.stats.loaded, cold.stats.created, cold.stats.stored,
+                static_cast<unsigned int>(cold.saved));
+            success = false;
+        }
+
+        const auto warm = Start(device, wrapper.Get(), fileName.c_str(), pd);
+        if (warm.state != DX::PipelineLibrary::State::Loaded
+            || warm.stats.loaded != cold.stats.created || warm.stats.created != 0 || warm.saved != S_FALSE)
+        {
+            printf("ERROR: Expected a warm start to load every pipeline state (%s, %llu loaded, %llu created)\n",
+                DX::PipelineLibrary::GetStateName(warm.state), warm.stats.loaded, warm.stats.created);
+            success = false;
+        }
+
+        printf("\n\t%zu BasicEffects: cold start %.3f ms (%llu created in %.3f ms), warm start %.3f ms (%.3f ms opening %zu bytes, %llu loaded in %.3f ms)\n",
+            std::size(c_flags),
+            cold.stats.openTime + cold.effectsTime, cold.stats.created, cold.stats.createTime,
+            warm.stats.openTime + warm.effectsTime, warm.stats.openTime, warm.stats.fileSize, warm.stats.loaded, warm.stats.loadTime);
+
+        // A damaged file is discarded, then replaced
+        const uint8_t garbage[16] = { 0xBA, 0xAD, 0xF0, 0x0D, 0xBA, 0xAD, 0xF0, 0x0D, 0xBA, 0xAD, 0xF0, 0x0D, 0xBA, 0xAD, 0xF0, 0x0D };
+        if (!Overwrite(fileName, static_cast<std::streamoff>(warm.stats.fileSize / 2), garbage, sizeof(garbage)))
+        {
+            printf("ERROR: Failed to write %ls\n", fileName.c_str());
+            success = false;
+        }
+        else
+        {
+            const auto corrupt = Start(device, wrapper.Get(), fileName.c_str(), pd);
+            if (corrupt.state != DX::PipelineLibrary::State::Corrupt || corrupt.stats.created != cold.stats.created || corrupt.saved != S_OK)
+            {
+                printf("ERROR: Expected a corrupt file to be discarded (%s, %llu created)\n",
+                    DX::PipelineLibrary::GetStateName(corrupt.state), corrupt.stats.created);
+                success = false;
+            }
+        }
+
+        // As is one from another version
+        const uint32_t version = DX::PipelineLibrary::c_version + 1;
+        if (!Overwrite(fileName, sizeof(uint32_t), &version, sizeof(version)))
+        {
+            printf("ERROR: Failed to write %ls\n", fileName.c_str());
+            success = false;
+        }
+        else
+        {
+            const auto stale = Start(device, wrapper.Get(), fileName.c_str(), pd);
+            if (stale.state != DX::PipelineLibrary::State::Stale || stale.stats.created != cold.stats.created)
+            {
+                printf("ERROR: Expected a file from another version to be discarded (%s, %llu created)\n",
+                    DX::PipelineLibrary::GetStateName(stale.state), stale.stats.created);
+                success = false;
+            }
+
+            const auto rewarm = Start(device, wrapper.Get(), fileName.c_str(), pd);
+            if (rewarm.state != DX::PipelineLibrary::State::Loaded || rewarm.stats.created != 0)
+            {
+                printf("ERROR: Expected the replaced file to load (%s, %llu created)\n",
+                    DX::PipelineLibrary::GetStateName(rewarm.state), rewarm.stats.created);
+                success = false;
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        printf("ERROR: Failed creating effects through the pipeline library (except: %s)\n", e.what());
+        success = false;
+    }
+
+    DX::PipelineStateCache::Get().SetLibrary(nullptr);
+    DX::PipelineStateCache::Get().Clear();
+
+    std::ignore = DeleteFileW(fileName.c_str());
+
+    return success;
+}
@@ -0,0 +1,208 @@
+//--------------------------------------------------------------------------------------
+// File: pipelinestatecache.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkID=615561
+//-------------------------------------------------------------------------------------
+
+#ifdef __MINGW32__
+#include <unknwn.h>
+#endif
+
+#include "Effects.h"
+
+#include "CommonStates.h"
+#include "EffectPipelineStateDescription.h"
+#include "GraphicsMemory.h"
+#include "RenderTargetState.h"
+#include "VertexTypes.h"
+
+#include "PipelineStateCache.h"
+
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include <wrl/client.h>
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    const uint32_t c_flags[] =
+    {
+        EffectFlags::None,
+        EffectFlags::Fog,
+        EffectFlags::VertexColor,
+        EffectFlags::VertexColor | EffectFlags::Fog,
+        EffectFlags::Texture,
+        EffectFlags::Texture | EffectFlags::Fog,
+        EffectFlags::Texture | EffectFlags::VertexColor,
+        EffectFlags::Lighting,
+        EffectFlags::Lighting | EffectFlags::Fog,
+        EffectFlags::Lighting | EffectFlags::Texture,
+        EffectFlags::PerPixelLighting,
+        EffectFlags::PerPixelLighting | EffectFlags::Texture,
+    };
+
+    // Creates one BasicEffect for each of c_flags, returning the milliseconds it took.
+    double CreateEffects(ID3D12Device* device, const EffectPipelineStateDescription& pd, std::vector<std::unique_ptr<BasicEffect>>& effects)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (auto flags : c_flags)
+        {
+            effects.emplace_back(std::make_unique<BasicEffect>(device, flags, pd));
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+_Success_(return)
+bool Test34(_In_ ID3D12Device* device)
+{
+    if (!device)
+        return false;
+
+    bool success = true;
+
+    auto& cache = DX::PipelineStateCache::Get();
+    cache.Clear();
+    cache.ResetStatistics();
+
+    // invalid args
+    {
+        ComPtr<ID3D12PipelineState> pso;
+        const D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
+        if (cache.CreateGraphicsPipelineState(nullptr, &desc, IID_PPV_ARGS(pso.GetAddressOf())) != E_INVALIDARG
+            || cache.CreateGraphicsPipelineState(device, nullptr, IID_PPV_ARGS(pso.GetAddressOf())) != E_INVALIDARG)
+        {
+            printf("ERROR: Expected E_INVALIDARG for a null device or description\n");
+            success = false;
+        }
+
+        ComPtr<DX::PipelineCachingDevice> nullWrapper;
+        if (SUCCEEDED(DX::PipelineCachingDevice::Create(nullptr, nullWrapper.GetAddressOf())))
+        {
+            printf("ERROR: Expected wrapping a null device to fail\n");
+            success = false;
+        }
+    }
+
+    // Descriptions are compared by content, not by the pointers in them
+    {
+        char semantic[] = "POSITION";
+        const D3D12_INPUT_ELEMENT_DESC elementA = { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+        const D3D12_INPUT_ELEMENT_DESC elementB = { semantic, 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+        const uint8_t shaderA[] = { 1, 2, 3, 4 };
+        const uint8_t shaderB[] = { 1, 2, 3, 4 };
+
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC descA = {};
+        descA.VS = { shaderA, sizeof(shaderA) };
+        descA.InputLayout = { &elementA, 1 };
+        descA.BlendState = CommonStates::Opaque;
+        descA.SampleMask = UINT_MAX;
+
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC descB = descA;
+        descB.VS = { shaderB, sizeof(shaderB) };
+        descB.InputLayout = { &elementB, 1 };
+
+        std::vector<uint8_t> keyA;
+        std::vector<uint8_t> keyB;
+        DX::PipelineStateCache::DescribePipeline(descA, keyA);
+        DX::PipelineStateCache::DescribePipeline(descB, keyB);
+
+        if (keyA != keyB)
+        {
+            printf("ERROR: Expected equal descriptions to describe the same pipeline\n");
+            success = false;
+        }
+
+        descB.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_RED;
+        DX::PipelineStateCache::DescribePipeline(descB, keyB);
+        semantic[0] = 'Q';
+        std::vector<uint8_t> keyC;
+        descB = descA;
+        descB.InputLayout = { &elementB, 1 };
+        DX::PipelineStateCache::DescribePipeline(descB, keyC);
+
+        if (keyA == keyB || keyA == keyC)
+        {
+            printf("ERROR: Expected different descriptions to describe different pipelines\n");
+            success = false;
+        }
+    }
+
+    // Effects created through the wrapper share pipeline states
+    ComPtr<DX::PipelineCachingDevice> wrapper;
+    HRESULT hr = DX::PipelineCachingDevice::Create(device, wrapper.GetAddressOf());
+    if (FAILED(hr))
+    {
+        printf("ERROR: Failed to wrap the device (%08X)\n", static_cast<unsigned int>(hr));
+        return false;
+    }
+
+    const RenderTargetState rtState(DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_FORMAT_D32_FLOAT);
+
+    const EffectPipelineStateDescription pd(
+        &VertexPositionNormalColorTexture::InputLayout,
+        CommonStates::Opaque,
+        CommonStates::DepthDefault,
+        CommonStates::CullNone,
+        rtState);
+
+    try
+    {
+        // The effects look up the constant buffer memory by the device they are given
+        GraphicsMemory graphicsMemory(wrapper.Get());
+
+        std::vector<std::unique_ptr<BasicEffect>> effects;
+
+        const double uncachedTime = CreateEffects(device, pd, effects);
+
+        const double coldTime = CreateEffects(wrapper.Get(), pd, effects);
+        const auto cold = cache.GetStatistics();
+
+        const double warmTime = CreateEffects(wrapper.Get(), pd, effects);
+        const auto warm = cache.GetStatistics();
+
+        if (cold.misses != cold.pipelines || cold.pipelines == 0 || cold.failures != 0)
+        {
+            printf("ERROR: Expected a pipeline state for each miss (%llu misses, %zu pipelines, %llu failed)\n",
+                cold.misses, cold.pipelines, cold.failures);
+            success = false;
+        }
+
+        if (warm.misses != cold.misses || warm.hits - cold.hits != std::size(c_flags))
+        {
+            printf("ERROR: Expected every effect to hit the second time (%llu hits, %llu misses)\n",
+                warm.hits - cold.hits, warm.misses - cold.misses);
+            success = false;
+        }
+
+        printf("\n\t%zu BasicEffects: uncached %.3f ms, cold %.3f ms (%llu pipeline states, %.3f ms creating), warm %.3f ms\n",
+            std::size(c_flags), uncachedTime, coldTime, cold.misses, cold.createTime, warmTime);
+
+        effects.clear();
+    }
+    catch (const std::exception& e)
+    {
+        printf("ERROR: Failed creating effects through the pipeline state cache (except: %s)\n", e.what());
+        success = false;
+    }
+
+    cache.Clear(device);
+    if (cache.GetStatistics().pipelines != 0)
+    {
+        printf("ERROR: Expected Clear to release the device's pipeline states\n");
+        success = false;
+    }
+
+    return success;
+}
@@ -0,0 +1,269 @@
+//--------------------------------------------------------------------------------------
+// File: recordingcommandlist.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkID=615561
+//-------------------------------------------------------------------------------------
+
+#ifdef __MINGW32__
+#include <unknwn.h>
+#endif
+
+#include "Effects.h"
+#include "GeometricPrimitive.h"
+
+#include "CommonStates.h"
+#include "EffectPipelineStateDescription.h"
+#include "RenderTargetState.h"
+
+#include "RecordingCommandList.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include <wrl/client.h>
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    // Stand-ins for interface pointers, which the recording command list never dereferences
+    template<typename T>
+    T* FakeObject(uintptr_t id) noexcept
+    {
+        return reinterpret_cast<T*>(id * 16);
+    }
+
+    void PrintStats(const char* name, const DX::RecordingStats& stats, size_t streamSize)
+    {
+        printf("\t%s: %u draws, %u PSO sets (%u changes), %u root parameter sets, %u redundant sets, %zu bytes, %.3f ms\n",
+            name, stats.draws,
+            stats.counts[static_cast<size_t>(DX::RecordedCommand::SetPipelineState)], stats.pipelineChanges,
+            stats.rootParameterSets, stats.redundantSets, streamSize, stats.cpuTime);
+    }
+}
+
+_Success_(return)
+bool Test26(_In_ ID3D12Device* device)
+{
+    if (!device)
+        return false;
+
+    bool success = true;
+
+    // COM identity
+    ComPtr<DX::RecordingCommandList> recorder;
+    HRESULT hr = DX::RecordingCommandList::Create(device, D3D12_COMMAND_LIST_TYPE_DIRECT, recorder.GetAddressOf());
+    if (FAILED(hr))
+    {
+        printf("ERROR: Failed creating recording command list (%08X)\n", static_cast<unsigned int>(hr));
+        return false;
+    }
+
+    {
+        ComPtr<ID3D12GraphicsCommandList> commandList;
+        ComPtr<ID3D12CommandList> baseList;
+        ComPtr<ID3D12Device> listDevice;
+        ComPtr<ID3D12Device> notDevice;
+        if (FAILED(recorder.As(&commandList))
+            || FAILED(commandList.As(&baseList))
+            || recorder->QueryInterface(IID_PPV_ARGS(notDevice.GetAddressOf())) != E_NOINTERFACE
+            || FAILED(commandList->GetDevice(IID_PPV_ARGS(listDevice.GetAddressOf())))
+            || listDevice.Get() != device
+            || baseList->GetType() != D3D12_COMMAND_LIST_TYPE_DIRECT)
+        {
+            printf("ERROR: Unexpected interfaces for recording command list\n");
+            success = false;
+        }
+
+        if (DX::RecordingCommandList::Create(device, D3D12_COMMAND_LIST_TYPE_DIRECT, nullptr) != E_INVALIDARG)
+        {
+            printf("ERROR: Expected failure for null recording command list\n");
+            success = false;
+        }
+    }
+
+    // Known command sequence
+    {
+        auto commandList = recorder.Get();
+        auto heap = FakeObject<ID3D12DescriptorHeap>(1);
+        auto rootSignature = FakeObject<ID3D12RootSignature>(2);
+        auto psoA = FakeObject<ID3D12PipelineState>(3);
+        auto psoB = FakeObject<ID3D12PipelineState>(4);
+
+        D3D12_VERTEX_BUFFER_VIEW vbv = { 0x10000, 1024, 32 };
+        D3D12_INDEX_BUFFER_VIEW ibv = { 0x20000, 512, DXGI_FORMAT_R16_UINT };
+
+        commandList->SetDescriptorHeaps(1, &heap);
+        commandList->SetDescriptorHeaps(1, &heap);
+        commandList->SetGraphicsRootSignature(rootSignature);
+        commandList->SetPipelineState(psoA);
+        commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        commandList->IASetVertexBuffers(0, 1, &vbv);
+        commandList->IASetIndexBuffer(&ibv);
+        commandList->SetGraphicsRootDescriptorTable(1, D3D12_GPU_DESCRIPTOR_HANDLE{ 0x30000 });
+        commandList->SetGraphicsRootConstantBufferView(0, 0x40000);
+        commandList->DrawIndexedInstanced(36, 1, 0, 0, 0);
+        commandList->SetPipelineState(psoA);
+        commandList->SetGraphicsRootDescriptorTable(1, D3D12_GPU_DESCRIPTOR_HANDLE{ 0x30000 });
+        commandList->SetGraphicsRootConstantBufferView(0, 0x40100);
+        commandList->DrawIndexedInstanced(36, 1, 36, 8, 0);
+        commandList->SetPipelineState(psoB);
+        commandList->IASetIndexBuffer(&ibv);
+        commandList->DrawInstanced(3, 2, 0, 0);
+
+        hr = commandList->Close();
+        const auto& stats = recorder->GetStats();
+        if (FAILED(hr)
+            || stats.draws != 3
+            || stats.counts[static_cast<size_t>(DX::RecordedCommand::SetPipelineState)] != 3
+            || stats.pipelineChanges != 2
+            || stats.rootSignatureChanges != 1
+            || stats.rootParameterSets != 4
+            || stats.descriptorHeapChanges != 1
+            || stats.redundantSets != 4)
+        {
+            printf("ERROR: Unexpected stats for known commands (%u draws, %u PSO changes, %u root parameter sets, %u redundant)\n",
+                stats.draws, stats.pipelineChanges, stats.rootParameterSets, stats.redundantSets);
+            success = false;
+        }
+
+        // Decode the stream
+        size_t commands = 0;
+        bool drawMatches = false;
+        const bool complete = DX::RecordingCommandList::ForEachCommand(recorder->GetStream(),
+            [&](DX::RecordedCommand command, const uint8_t* payload, size_t size)
+            {
+                if (command == DX::RecordedCommand::DrawIndexedInstanced && size == 5 * sizeof(uint32_t) && !drawMatches)
+                {
+                    uint32_t args[5] = {};
+                    memcpy(args, payload, sizeof(args));
+                    drawMatches = (args[0] == 36 && args[1] == 1 && args[2] == 0 && args[3] == 0 && args[4] == 0);
+                }
+                ++commands;
+            });
+
+        if (!complete || commands != 18 || !drawMatches)
+        {
+            printf("ERROR: Unexpected recorded stream (%zu commands, %zu bytes)\n", commands, recorder->GetStream().size());
+            success = false;
+        }
+
+        if (commandList->Close() != E_FAIL)
+        {
+            printf("ERROR: Expected failure closing a closed command list\n");
+            success = false;
+        }
+
+        if (FAILED(commandList->Reset(FakeObject<ID3D12CommandAllocator>(5), nullptr))
+            || recorder->GetStats().draws != 0
+            || recorder->GetStats().counts[static_cast<size_t>(DX::RecordedCommand::Reset)] != 1
+            || commandList->Reset(FakeObject<ID3D12CommandAllocator>(5), nullptr) != E_FAIL)
+        {
+            printf("ERROR: Unexpected Reset behavior for recording command list\n");
+            success = false;
+        }
+    }
+
+    // Effect and primitive draws, in submission order and sorted by effect
+    {
+        const RenderTargetState rtState(DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_FORMAT_D32_FLOAT);
+
+        const EffectPipelineStateDescription pd(
+            &GeometricPrimitive::VertexType::InputLayout,
+            CommonStates::Opaque,
+            CommonStates::DepthDefault,
+            CommonStates::CullNone,
+            rtState);
+
+        std::unique_ptr<BasicEffect> effects[3];
+        std::unique_ptr<GeometricPrimitive> shapes[4];
+        try
+        {
+            effects[0] = std::make_unique<BasicEffect>(device, EffectFlags::None, pd);
+            effects[1] = std::make_unique<BasicEffect>(device, EffectFlags::Lighting, pd);
+            effects[2] = std::make_unique<BasicEffect>(device, EffectFlags::PerPixelLighting, pd);
+
+            shapes[0] = GeometricPrimitive::CreateCube();
+            shapes[1] = GeometricPrimitive::CreateSphere();
+            shapes[2] = GeometricPrimitive::CreateTorus();
+            shapes[3] = GeometricPrimitive::CreateTeapot();
+        }
+        catch (const std::exception& e)
+        {
+            printf("ERROR: Failed creating effects and shapes (except: %s)\n", e.what());
+            return false;
+        }
+
+        constexpr size_t c_objectCount = 300;
+
+        struct DrawItem
+        {
+            size_t effect;
+            size_t shape;
+            XMFLOAT4X4 world;
+        };
+
+        std::vector<DrawItem> items(c_objectCount);
+        for (size_t j = 0; j < c_objectCount; ++j)
+        {
+            items[j].effect = j % std::size(effects);
+            items[j].shape = (j / 7) % std::size(shapes);
+            XMStoreFloat4x4(&items[j].world, XMMatrixTranslation(float(j % 20), float(j / 20), 0.f));
+        }
+
+        auto drawAll = [&](const std::vector<DrawItem>& list)
+            {
+                for (const auto& it : list)
+                {
+                    auto effect = effects[it.effect].get();
+                    effect->SetWorld(XMLoadFloat4x4(&it.world));
+                    effect->Apply(recorder.Get());
+                    shapes[it.shape]->Draw(recorder.Get());
+                }
+            };
+
+        recorder->Close();
+        recorder->Reset(FakeObject<ID3D12CommandAllocator>(5), nullptr);
+        drawAll(items);
+        recorder->Close();
+
+        const DX::RecordingStats unsorted = recorder->GetStats();
+        const size_t unsortedSize = recorder->GetStream().size();
+
+        std::vector<DrawItem> sorted(items);
+        std::stable_sort(sorted.begin(), sorted.end(), [](const DrawItem& a, const DrawItem& b) noexcept
+            {
+                return (a.effect != b.effect) ? (a.effect < b.effect) : (a.shape < b.shape);
+            });
+
+        recorder->Reset(FakeObject<ID3D12CommandAllocator>(5), nullptr);
+        drawAll(sorted);
+        recorder->Close();
+
+        const DX::RecordingStats& sortedStats = recorder->GetStats();
+        if (unsorted.draws != c_objectCount || sortedStats.draws != c_objectCount
+            || sortedStats.pipelineChanges > std::size(effects)
+            || sortedStats.pipelineChanges >= unsorted.pipelineChanges
+            || sortedStats.redundantSets <= unsorted.redundantSets)
+        {
+            printf("ERROR: Unexpected state changes for sorted draws (%u vs %u PSO changes)\n",
+                sortedStats.pipelineChanges, unsorted.pipelineChanges);
+            success = false;
+        }
+
+        printf("\n");
+        PrintStats("submission order", unsorted, unsortedSize);
+        PrintStats("sorted by effect", sortedStats, recorder->GetStream().size());
+    }
+
+    return success;
+}
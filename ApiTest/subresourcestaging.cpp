@@ -0,0 +1,242 @@
+//--------------------------------------------------------------------------------------
+// File: subresourcestaging.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkID=615561
+//-------------------------------------------------------------------------------------
+
+#ifdef __MINGW32__
+#include <unknwn.h>
+#endif
+
+#include "GraphicsMemory.h"
+
+#include "d3dx12.h"
+
+#include "SubresourceStaging.h"
+
+#include "ApiTest.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr size_t c_iterations = 8;
+
+    double GigabytesPerSecond(size_t bytes, double ms)
+    {
+        return (ms > 0.0) ? double(bytes) / (ms * 1000.0 * 1000.0) : 0.0;
+    }
+
+    struct TestCase
+    {
+        const char* name;
+        D3D12_RESOURCE_DESC desc;
+    };
+
+    // Staging only touches the CPU side, so this needs the footprints but no GPU work.
+    struct Footprints
+    {
+        std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts;
+        std::vector<UINT> numRows;
+        std::vector<UINT64> rowSizes;
+        std::vector<D3D12_SUBRESOURCE_DATA> srcData;
+        std::vector<uint8_t> source;
+        UINT64 requiredSize;
+        size_t bytes;
+    };
+
+    void GetFootprints(_In_ ID3D12Device* device, const D3D12_RESOURCE_DESC& desc, Footprints& result)
+    {
+        const UINT numSubresources = (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D)
+            ? desc.MipLevels
+            : UINT(desc.MipLevels) * desc.DepthOrArraySize;
+
+        result.layouts.resize(numSubresources);
+        result.numRows.resize(numSubresources);
+        result.rowSizes.resize(numSubresources);
+        result.srcData.resize(numSubresources);
+        result.requiredSize = 0;
+
+        device->GetCopyableFootprints(&desc, 0, numSubresources, 0,
+            result.layouts.data(), result.numRows.data(), result.rowSizes.data(), &result.requiredSize);
+
+        // Tightly packed source, as loaded from a DDS file
+        result.bytes = 0;
+        for (UINT i = 0; i < numSubresources; ++i)
+        {
+            result.bytes += size_t(result.rowSizes[i]) * result.numRows[i] * result.layouts[i].Footprint.Depth;
+        }
+
+        result.source.resize(result.bytes);
+        for (size_t j = 0; j < result.bytes; ++j)
+        {
+            result.source[j] = static_cast<uint8_t>((j * 7) ^ (j >> 11));
+        }
+
+        size_t offset = 0;
+        for (UINT i = 0; i < numSubresources; ++i)
+        {
+            const auto rowSize = static_cast<size_t>(result.rowSizes[i]);
+            result.srcData[i].pData = result.source.data() + offset;
+            result.srcData[i].RowPitch = static_cast<LONG_PTR>(rowSize);
+            result.srcData[i].SlicePitch = static_cast<LONG_PTR>(rowSize * result.numRows[i]);
+            offset += rowSize * result.numRows[i] * result.layouts[i].Footprint.Depth;
+        }
+    }
+
+    // What UpdateSubresources does once the intermediate is mapped
+    void MemcpySubresources(uint8_t* dest, const Footprints& fp)
+    {
+        for (size_t i = 0; i < fp.layouts.size(); ++i)
+        {
+            const D3D12_MEMCPY_DEST destData = {
+                dest + fp.layouts[i].Offset,
+                fp.layouts[i].Footprint.RowPitch,
+                SIZE_T(fp.layouts[i].Footprint.RowPitch) * SIZE_T(fp.numRows[i])
+            };
+            MemcpySubresource(&destData, &fp.srcData[i], static_cast<SIZE_T>(fp.rowSizes[i]), fp.numRows[i], fp.layouts[i].Footprint.Depth);
+        }
+    }
+}
+
+_Success_(return)
+bool Test30(_In_ ID3D12Device* device)
+{
+    if (!device)
+        return false;
+
+    bool success = true;
+
+    auto& graphicsMemory = GraphicsMemory::Get(device);
+
+    const TestCase cases[] =
+    {
+        // Mip chain with pitches that match the row size down to the 64 x 64 level
+        { "BC7 4096 x 4096 mips", CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_BC7_UNORM, 4096, 4096, 1, 0) },
+
+        // Every row, slice, and the whole volume is contiguous
+        { "RGBA8 256 x 256 x 64 volume", CD3DX12_RESOURCE_DESC::Tex3D(DXGI_FORMAT_R8G8B8A8_UNORM, 256, 256, 64, 1) },
+
+        // Rows are padded to a 256 byte pitch, so are copied one at a time
+        { "R8 1000 x 1000 x 6 array", CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8_UNORM, 1000, 1000, 6, 1) },
+    };
+
+    const unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+
+    printf("\n");
+
+    for (const auto& test : cases)
+    {
+        Footprints fp;
+        GetFootprints(device, test.desc, fp);
+
+        if (!fp.requiredSize || fp.requiredSize > SIZE_T(-1))
+        {
+            printf("ERROR: Failed to get copyable footprints for %s\n", test.name);
+            success = false;
+            continue;
+        }
+
+        const auto size = static_cast<size_t>(fp.requiredSize);
+
+        GraphicsResource reference;
+        GraphicsResource staged;
+        GraphicsResource stagedParallel;
+        try
+        {
+            reference = graphicsMemory.Allocate(size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+            staged = graphicsMemory.Allocate(size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+            stagedParallel = graphicsMemory.Allocate(size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        }
+        catch (const std::exception& e)
+        {
+            printf("ERROR: Failed allocating upload memory (except: %s)\n", e.what());
+            return false;
+        }
+
+        // Padding is never written, so clear it to compare whole buffers
+        memset(reference.Memory(), 0, size);
+        memset(staged.Memory(), 0, size);
+        memset(stagedParallel.Memory(), 0, size);
+
+        auto referenceDest = static_cast<uint8_t*>(reference.Memory());
+        double referenceTime = DBL_MAX;
+        for (size_t iter = 0; iter < c_iterations; ++iter)
+        {
+            auto start = std::chrono::steady_clock::now();
+            MemcpySubresources(referenceDest, fp);
+            referenceTime = std::min(referenceTime, ElapsedMilliseconds(start));
+        }
+
+        const auto numSubresources = static_cast<UINT>(fp.layouts.size());
+
+        auto stagedDest = static_cast<uint8_t*>(staged.Memory());
+        double singleTime = DBL_MAX;
+        for (size_t iter = 0; iter < c_iterations; ++iter)
+        {
+            auto start = std::chrono::steady_clock::now();
+            DX::StageSubresources(stagedDest, numSubresources,
+                fp.layouts.data(), fp.numRows.data(), fp.rowSizes.data(), fp.srcData.data(), 1);
+            singleTime = std::min(singleTime, ElapsedMilliseconds(start));
+        }
+
+        auto parallelDest = static_cast<uint8_t*>(stagedParallel.Memory());
+        double parallelTime = DBL_MAX;
+        for (size_t iter = 0; iter < c_iterations; ++iter)
+        {
+            auto start = std::chrono::steady_clock::now();
+            DX::StageSubresources(parallelDest, numSubresources,
+                fp.layouts.data(), fp.numRows.data(), fp.rowSizes.data(), fp.srcData.data(), 0);
+            parallelTime = std::min(parallelTime, ElapsedMilliseconds(start));
+        }
+
+        // Read back once from write-combined memory for the comparison
+        const std::vector<uint8_t> expected(referenceDest, referenceDest + size);
+        if (memcmp(stagedDest, expected.data(), size) != 0)
+        {
+            printf("ERROR: Staged data for %s does not match MemcpySubresource\n", test.name);
+            success = false;
+        }
+
+        if (memcmp(parallelDest, expected.data(), size) != 0)
+        {
+            printf("ERROR: Staged data in parallel for %s does not match MemcpySubresource\n", test.name);
+            success = false;
+        }
+
+        printf("\t%s (%u subresources, %.1f MB): MemcpySubresource %.3f ms (%.2f GB/s), staged %.3f ms (%.2f GB/s), %u threads %.3f ms (%.2f GB/s)\n",
+            test.name, numSubresources, double(fp.bytes) / (1024.0 * 1024.0),
+            referenceTime, GigabytesPerSecond(fp.bytes, referenceTime),
+            singleTime, GigabytesPerSecond(fp.bytes, singleTime),
+            threads, parallelTime, GigabytesPerSecond(fp.bytes, parallelTime));
+    }
+
+    // Nothing to copy
+    {
+        uint8_t dest[16] = {};
+        DX::StageSubresources(dest, 0, nullptr, nullptr, nullptr, nullptr, 0);
+        for (auto it : dest)
+        {
+            if (it)
+            {
+                printf("ERROR: Staging no subresources wrote data\n");
+                success = false;
+                break;
+            }
+        }
+    }
+
+    return success;
+}
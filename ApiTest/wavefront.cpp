@@ -0,0 +1,928 @@
+//--------------------------------------------------------------------------------------
+// File: wavefront.cpp
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkID=615561
+//-------------------------------------------------------------------------------------
+
+#ifdef __MINGW32__
+#include <unknwn.h>
+#endif
+
+#include "WaveFrontReader.h"
+
+#include "ApiTest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <locale>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    using Reader = DX::WaveFrontReader<uint32_t>;
+
+    struct ReferenceOBJ
+    {
+        std::vector<Reader::Vertex> vertices;
+        std::vector<uint32_t>       indices;
+        std::vector<uint32_t>       attributes;
+        std::vector<std::wstring>   materials;
+    };
+
+    // This is the original std::wifstream tokenizer for WaveFrontReader::Load. It is kept here as the
+    // reference implementation to validate and benchmark the buffered parser.
+    HRESULT LoadReference(const std::filesystem::path& fileName, ReferenceOBJ& obj)
+    {
+        constexpr size_t MAX_POLY = 64;
+
+        std::wifstream InFile(fileName);
+        if (!InFile)
+            return E_FAIL;
+
+        InFile.imbue(std::locale::classic());
+
+        std::vector<XMFLOAT3>   positions;
+        std::vector<XMFLOAT3>   normals;
+        std::vector<XMFLOAT2>   texCoords;
+
+        std::unordered_multimap<uint32_t, uint32_t> vertexCache;
+
+        obj.materials.emplace_back(L"default");
+
+        uint32_t curSubset = 0;
+
+        auto resolve = [](int value, size_t count, uint32_t& result) -> bool
+            {
+                if (!value)
+                    return false;
+
+                result = (value < 0) ? uint32_t(ptrdiff_t(count) + value) : uint32_t(value - 1);
+                return result < count;
+            };
+
+        for (;; )
+        {
+            std::wstring strCommand;
+            InFile.width(MAX_PATH);
+            InFile >> strCommand;
+            if (!InFile)
+                break;
+
+            if (strCommand == L"v")
+            {
+                float x, y, z;
+                InFile >> x >> y >> z;
+                positions.emplace_back(XMFLOAT3(x, y, z));
+            }
+            else if (strCommand == L"vt")
+            {
+                float u, v;
+                InFile >> u >> v;
+                texCoords.emplace_back(XMFLOAT2(u, v));
+            }
+            else if (strCommand == L"vn")
+            {
+                float x, y, z;
+                InFile >> x >> y >> z;
+                normals.emplace_back(XMFLOAT3(x, y, z));
+            }
+            else if (strCommand == L"f")
+            {
+                int iPosition, iTexCoord, iNormal;
+                Reader::Vertex vertex;
+
+                uint32_t faceIndex[MAX_POLY];
+                size_t iFace = 0;
+                for (;;)
+                {
+                    if (iFace >= MAX_POLY)
+                        return E_FAIL;
+
+                    memset(&vertex, 0, sizeof(vertex));
+
+                    InFile >> iPosition;
+
+                    uint32_t vertexIndex = 0;
+                    if (!resolve(iPosition, positions.size(), vertexIndex))
+                        return E_FAIL;
+
+                    vertex.position = positions[vertexIndex];
+
+                    if ('/' == InFile.peek())
+                    {
+                        InFile.ignore();
+
+                        if ('/' != InFile.peek())
+                        {
+                            InFile >> iTexCoord;
+
+                            uint32_t coordIndex = 0;
+                            if (!resolve(iTexCoord, texCoords.size(), coordIndex))
+                                return E_FAIL;
+
+                            vertex.textureCoordinate = texCoords[coordIndex];
+                        }
+
+                        if ('/' == InFile.peek())
+                        {
+                            InFile.ignore();
+
+                            InFile >> iNormal;
+
+                            uint32_t normIndex = 0;
+                            if (!resolve(iNormal, normals.size(), normIndex))
+                                return E_FAIL;
+
+                            vertex.normal = normals[normIndex];
+                        }
+                    }
+
+                    uint32_t index = uint32_t(-1);
+                    auto f = vertexCache.equal_range(vertexIndex);
+                    for (auto it = f.first; it != f.second; ++it)
+                    {
+                        if (0 == memcmp(&vertex, &obj.vertices[it->second], sizeof(vertex)))
+                        {
+                            index = it->second;
+                            break;
+                        }
+                    }
+
+                    if (index == uint32_t(-1))
+                    {
+                        index = static_cast<uint32_t>(obj.vertices.size());
+                        obj.vertices.emplace_back(vertex);
+                        vertexCache.emplace(vertexIndex, index);
+                    }
+
+                    faceIndex[iFace++] = index;
+
+                    bool faceEnd = false;
+                    for (;;)
+                    {
+                        const wchar_t p = static_cast<wchar_t>(InFile.peek());
+
+                        if ('\n' == p || !InFile)
+                        {
+                            faceEnd = true;
+                            break;
+                        }
+                        else if (isdigit(p) || p == '-' || p == '+')
+                            break;
+
+                        InFile.ignore();
+                    }
+
+                    if (faceEnd)
+                        break;
+                }
+
+                if (iFace < 3)
+                    return E_FAIL;
+
+                const uint32_t i0 = faceIndex[0];
+                uint32_t i1 = faceIndex[1];
+
+                for (size_t j = 2; j < iFace; ++j)
+                {
+                    const uint32_t index = faceIndex[j];
+                    obj.indices.emplace_back(i0);
+                    obj.indices.emplace_back(i1);
+                    obj.indices.emplace_back(index);
+                    obj.attributes.emplace_back(curSubset);
+
+                    i1 = index;
+                }
+            }
+            else if (strCommand == L"usemtl")
+            {
+                std::wstring strName;
+                InFile.width(MAX_PATH);
+                InFile >> strName;
+
+                auto it = std::find(obj.materials.cbegin(), obj.materials.cend(), strName);
+                curSubset = static_cast<uint32_t>(it - obj.materials.cbegin());
+                if (it == obj.materials.cend())
+                {
+                    obj.materials.emplace_back(strName);
+                }
+            }
+
+            InFile.ignore(1000, L'\n');
+        }
+
+        return positions.empty() ? E_FAIL : S_OK;
+    }
+
+    bool CompareResults(const Reader& reader, const ReferenceOBJ& ref)
+    {
+        if (reader.vertices.size() != ref.vertices.size()
+            || memcmp(reader.vertices.data(), ref.vertices.data(), sizeof(Reader::Vertex) * ref.vertices.size()) != 0)
+        {
+            printf("ERROR: vertices mismatch (%zu vs. %zu)\n", reader.vertices.size(), ref.vertices.size());
+            return false;
+        }
+
+        if (reader.indices != ref.indices)
+        {
+            printf("ERROR: indices mismatch (%zu vs. %zu)\n", reader.indices.size(), ref.indices.size());
+            return false;
+        }
+
+        if (reader.attributes != ref.attributes)
+        {
+            printf("ERROR: attributes mismatch (%zu vs. %zu)\n", reader.attributes.size(), ref.attributes.size());
+            return false;
+        }
+
+        if (reader.materials.size() != ref.materials.size())
+        {
+            printf("ERROR: materials mismatch (%zu vs. %zu)\n", reader.materials.size(), ref.materials.size());
+            return false;
+        }
+
+        for (size_t j = 0; j < ref.materials.size(); ++j)
+        {
+            if (ref.materials[j] != reader.materials[j].strName)
+            {
+                printf("ERROR: material name mismatch (%ls vs. %ls)\n", reader.materials[j].strName, ref.materials[j].c_str());
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool CompareReaders(const Reader& reader, const Reader& ref)
+    {
+        if (reader.vertices.size() != ref.vertices.size()
+            || memcmp(reader.vertices.data(), ref.vertices.data(), sizeof(Reader::Vertex) * ref.vertices.size()) != 0)
+        {
+            printf("ERROR: vertices mismatch (%zu vs. %zu)\n", reader.vertices.size(), ref.vertices.size());
+            return false;
+        }
+
+        if (reader.indices != ref.indices || reader.attributes != ref.attributes)
+        {
+            printf("ERROR: indices/attributes mismatch (%zu vs. %zu)\n", reader.indices.size(), ref.indices.size());
+            return false;
+        }
+
+        if (reader.materials.size() != ref.materials.size())
+        {
+            printf("ERROR: materials mismatch (%zu vs. %zu)\n", reader.materials.size(), ref.materials.size());
+            return false;
+        }
+
+        for (size_t j = 0; j < ref.materials.size(); ++j)
+        {
+            if (wcscmp(reader.materials[j].strName, ref.materials[j].strName) != 0)
+            {
+                printf("ERROR: material name mismatch (%ls vs. %ls)\n", reader.materials[j].strName, ref.materials[j].strName);
+                return false;
+            }
+        }
+
+        if (reader.hasNormals != ref.hasNormals
+            || reader.hasTexcoords != ref.hasTexcoords
+            || memcmp(&reader.bounds, &ref.bounds, sizeof(BoundingBox)) != 0)
+        {
+            printf("ERROR: flags/bounds mismatch\n");
+            return false;
+        }
+
+        return true;
+    }
+
+    // Writes a closed triangle fan where every face has its own texture coordinates, so the center
+    // position is shared by one vertex per triangle and each ring position by two.
+    bool WriteFanOBJ(const std::filesystem::path& fileName, uint32_t triangleCount)
+    {
+        std::ofstream outFile(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!outFile)
+            return false;
+
+        outFile << "# WaveFrontReader high-valence test mesh\r\n";
+        outFile << "v 0 0 0\r\nvn 0 1 0\r\n";
+
+        for (uint32_t k = 0; k < triangleCount; ++k)
+        {
+            const float angle = XM_2PI * float(k) / float(triangleCount);
+            const float u = float(k) / float(triangleCount);
+
+            char line[256] = {};
+            int len = snprintf(line, sizeof(line), "v %.7g 0 %.7g\r\nvt 0.5 %.7g\r\nvt %.7g 0\r\nvt %.7g 1\r\n",
+                double(std::cos(angle)), double(std::sin(angle)), double(u), double(u), double(u));
+            outFile.write(line, len);
+        }
+
+        for (uint32_t k = 0; k < triangleCount; ++k)
+        {
+            const uint32_t a = k + 2;
+            const uint32_t b = ((k + 1) % triangleCount) + 2;
+
+            char line[256] = {};
+            int len = snprintf(line, sizeof(line), "f 1/%u/1 %u/%u/1 %u/%u/1\r\n",
+                k * 3 + 1, a, k * 3 + 2, b, k * 3 + 3);
+            outFile.write(line, len);
+        }
+
+        return true;
+    }
+
+    // Writes a tessellated grid with positions, texture coordinates, and normals. It mixes absolute and
+    // relative indices, quads and triangles, CRLF line endings, and several materials.
+    bool WriteTestOBJ(const std::filesystem::path& fileName, uint32_t gridSize)
+    {
+        std::ofstream outFile(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!outFile)
+            return false;
+
+        outFile << "# WaveFrontReader test mesh\r\n";
+        outFile << "o grid\r\n";
+
+        const uint32_t stride = gridSize + 1;
+        for (uint32_t y = 0; y <= gridSize; ++y)
+        {
+            for (uint32_t x = 0; x <= gridSize; ++x)
+            {
+                const float fx = float(x) / float(gridSize);
+                const float fy = float(y) / float(gridSize);
+                const float h = std::sin(fx * 12.f) * std::cos(fy * 7.f) * 0.125f;
+
+                char line[256] = {};
+                int len = snprintf(line, sizeof(line), "v %.7g %.7g %.7g\r\nvt %.6g %.6g\r\nvn %.6g %.6g %.6g\r\n",
+                    double(fx * 10.f - 5.f), double(h), double(fy * -10.f + 5.f),
+                    double(fx), double(1.f - fy),
+                    double(-h), double(1.f), double(h * 0.5f));
+                outFile.write(line, len);
+            }
+        }
+
+        const uint32_t total = stride * stride;
+        for (uint32_t y = 0; y < gridSize; ++y)
+        {
+            if ((y % 16) == 0)
+            {
+                outFile << "usemtl material" << ((y / 16) % 4) << "\r\n";
+                outFile << "s " << (y / 16) << "\r\n";
+            }
+
+            for (uint32_t x = 0; x < gridSize; ++x)
+            {
+                const uint32_t a = y * stride + x + 1;
+                const uint32_t b = a + 1;
+                const uint32_t c = a + stride + 1;
+                const uint32_t d = a + stride;
+
+                char line[256] = {};
+                int len = 0;
+                if ((x + y) & 1)
+                {
+                    // Quad using relative indices
+                    const auto ra = int(a) - int(total) - 1;
+                    const auto rb = int(b) - int(total) - 1;
+                    const auto rc = int(c) - int(total) - 1;
+                    const auto rd = int(d) - int(total) - 1;
+                    len = snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\r\n",
+                        ra, ra, ra, rb, rb, rb, rc, rc, rc, rd, rd, rd);
+                }
+                else
+                {
+                    // Two triangles, one without texture coordinates
+                    len = snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\r\nf %u//%u %u//%u %u//%u\r\n",
+                        a, a, a, b, b, b, c, c, c,
+                        a, a, c, c, d, d);
+                }
+                outFile.write(line, len);
+            }
+        }
+
+        outFile.close();
+        return !outFile.fail();
+    }
+
+    // This is the original stable_sort grouping from CreateModelFromOBJ, kept as the reference for
+    // WaveFrontReader::SortByAttribute.
+    void SortByAttributeReference(Reader& obj)
+    {
+        struct Face
+        {
+            uint32_t attribute;
+            uint32_t a;
+            uint32_t b;
+            uint32_t c;
+        };
+
+        std::vector<Face> faces;
+        faces.reserve(obj.attributes.size());
+
+        for (size_t i = 0; i < obj.attributes.size(); ++i)
+        {
+            Face f;
+            f.attribute = obj.attributes[i];
+            f.a = obj.indices[i * 3];
+            f.b = obj.indices[i * 3 + 1];
+            f.c = obj.indices[i * 3 + 2];
+
+            faces.push_back(f);
+        }
+
+        std::stable_sort(faces.begin(), faces.end(), [](const Face& a, const Face& b) -> bool
+        {
+            return (a.attribute < b.attribute);
+        });
+
+        obj.attributes.clear();
+        obj.indices.clear();
+
+        for (const auto& it : faces)
+        {
+            obj.attributes.push_back(it.attribute);
+            obj.indices.push_back(it.a);
+            obj.indices.push_back(it.b);
+            obj.indices.push_back(it.c);
+        }
+    }
+}
+
+_Success_(return)
+bool Test23(_In_ ID3D12Device* device)
+{
+    if (!device)
+        return false;
+
+    bool success = true;
+
+    // Validate against reference on test media
+    {
+        Reader reader;
+        HRESULT hr = reader.Load(L"ModelTest\\cup._obj", true, false);
+        if (FAILED(hr))
+        {
+            printf("ERROR: Failed loading cup._obj (%08X)\n", static_cast<unsigned int>(hr));
+            success = false;
+        }
+        else
+        {
+            ReferenceOBJ ref;
+            hr = LoadReference(L"ModelTest\\cup._obj", ref);
+            if (FAILED(hr))
+            {
+                printf("ERROR: Failed loading reference cup._obj (%08X)\n", static_cast<unsigned int>(hr));
+                success = false;
+            }
+            else if (!CompareResults(reader, ref))
+            {
+                printf("ERROR: Buffered reader does not match reference for cup._obj\n");
+                success = false;
+            }
+        }
+    }
+
+    // Validate and benchmark against reference on a generated mesh
+    const auto tempFile = std::filesystem::temp_directory_path() / L"directxtk12_wavefront_test.obj";
+    if (!WriteTestOBJ(tempFile, 256))
+    {
+        printf("ERROR: Failed to write test OBJ file\n");
+        return false;
+    }
+
+    const std::wstring tempName = tempFile.wstring();
+    const auto fileSize = static_cast<double>(std::filesystem::file_size(tempFile)) / (1024.0 * 1024.0);
+
+    {
+        ReferenceOBJ ref;
+        auto start = std::chrono::steady_clock::now();
+        HRESULT hr = LoadReference(tempFile, ref);
+        const double refTime = ElapsedMilliseconds(start);
+
+        Reader reader;
+        start = std::chrono::steady_clock::now();
+        HRESULT hr2 = reader.Load(tempName.c_str(), true, false);
+        const double bufferedTime = ElapsedMilliseconds(start);
+
+        if (FAILED(hr) || FAILED(hr2))
+        {
+            printf("ERROR: Failed loading generated OBJ (%08X, %08X)\n", static_cast<unsigned int>(hr), static_cast<unsigned int>(hr2));
+            success = false;
+        }
+        else if (!CompareResults(reader, ref))
+        {
+            printf("ERROR: Buffered reader does not match reference for generated OBJ\n");
+            success = false;
+        }
+        else if (reader.attributes.empty() || reader.materials.size() != 5)
+        {
+            printf("ERROR: Unexpected content in generated OBJ (%zu faces, %zu materials)\n", reader.attributes.size(), reader.materials.size());
+            success = false;
+        }
+        else
+        {
+            printf("\n\t%.1f MB OBJ: stream reader %.1f MB/s, buffered reader %.1f MB/s\n",
+                fileSize,
+                fileSize * 1000.0 / std::max(refTime, 0.001),
+                fileSize * 1000.0 / std::max(bufferedTime, 0.001));
+        }
+
+        // Parallel chunked parsing must match the single-threaded load
+        static const unsigned int s_threads[] = { 2, 4, 0 };
+        for (const auto threads : s_threads)
+        {
+            Reader parallel;
+            start = std::chrono::steady_clock::now();
+            hr = parallel.Load(tempName.c_str(), true, false, threads);
+            const double parallelTime = ElapsedMilliseconds(start);
+
+            if (FAILED(hr))
+            {
+                printf("ERROR: Failed loading generated OBJ with %u threads (%08X)\n", threads, static_cast<unsigned int>(hr));
+                success = false;
+            }
+            else if (!CompareReaders(parallel, reader))
+            {
+                printf("ERROR: Parallel reader with %u threads does not match single-threaded load\n", threads);
+                success = false;
+            }
+            else
+            {
+                printf("\tparallel reader (%u threads) %.1f MB/s\n",
+                    threads ? threads : std::thread::hardware_concurrency(),
+                    fileSize * 1000.0 / std::max(parallelTime, 0.001));
+            }
+        }
+
+        // With enough cores the parallel reader must beat the single-threaded one, best of a few runs each
+        const unsigned int cores = std::thread::hardware_concurrency();
+        if (cores >= 4)
+        {
+            double serialBest = 0.0;
+            double parallelBest = 0.0;
+            for (int run = 0; run < 3; ++run)
+            {
+                Reader serial;
+                start = std::chrono::steady_clock::now();
+                std::ignore = serial.Load(tempName.c_str(), true, false, 1);
+                const double serialTime = ElapsedMilliseconds(start);
+
+                Reader parallel;
+                start = std::chrono::steady_clock::now();
+                std::ignore = parallel.Load(tempName.c_str(), true, false, cores);
+                const double parallelTime = ElapsedMilliseconds(start);
+
+                serialBest = (run == 0) ? serialTime : std::min(serialBest, serialTime);
+                parallelBest = (run == 0) ? parallelTime : std::min(parallelBest, parallelTime);
+            }
+
+            if (parallelBest >= serialBest)
+            {
+                printf("ERROR: Parallel reader with %u threads does not scale (%.1f ms vs. %.1f ms single-threaded)\n", cores, parallelBest, serialBest);
+                success = false;
+            }
+            else
+            {
+                printf("\tparallel reader speedup %.2fx with %u threads\n", serialBest / std::max(parallelBest, 0.001), cores);
+            }
+        }
+    }
+
+    // Binary cache of the parsed mesh
+    {
+        const std::wstring cacheName = Reader::GetCacheFileName(tempName.c_str());
+
+        std::error_code ec;
+        std::filesystem::remove(cacheName, ec);
+
+        Reader parsed;
+        auto start = std::chrono::steady_clock::now();
+        HRESULT hr = parsed.LoadCached(tempName.c_str(), true, false);
+        const double parseTime = ElapsedMilliseconds(start);
+
+        Reader cached;
+        start = std::chrono::steady_clock::now();
+        HRESULT hr2 = cached.LoadCached(tempName.c_str(), true, false);
+        const double cachedTime = ElapsedMilliseconds(start);
+
+        Reader reader;
+        std::ignore = reader.Load(tempName.c_str(), true, false);
+
+        if (FAILED(hr) || FAILED(hr2))
+        {
+            printf("ERROR: Failed loading generated OBJ with cache (%08X, %08X)\n", static_cast<unsigned int>(hr), static_cast<unsigned int>(hr2));
+            success = false;
+        }
+        else if (!std::filesystem::exists(cacheName))
+        {
+            printf("ERROR: Expected cache file to be written\n");
+            success = false;
+        }
+        else if (!CompareReaders(parsed, reader) || !CompareReaders(cached, reader) || cached.name != reader.name)
+        {
+            printf("ERROR: Cached load does not match parsed load\n");
+            success = false;
+        }
+        else
+        {
+            printf("\tcache: parse and write %.1f ms, cached load %.1f ms\n", parseTime, cachedTime);
+        }
+
+        // A cache written with other options must not be used
+        {
+            Reader cw;
+            Reader cwRef;
+            if (FAILED(cw.LoadCached(tempName.c_str(), false, false))
+                || FAILED(cwRef.Load(tempName.c_str(), false, false))
+                || !CompareReaders(cw, cwRef))
+            {
+                printf("ERROR: Cached load ignored the winding option\n");
+                success = false;
+            }
+        }
+
+        // A corrupt cache fails its checksum and falls back to parsing
+        {
+            const auto cacheSize = std::filesystem::file_size(cacheName, ec);
+            {
+                std::fstream cacheFile(std::filesystem::path(cacheName), std::ios::in | std::ios::out | std::ios::binary);
+                cacheFile.seekp(static_cast<std::streamoff>(cacheSize / 2));
+                const char garbage[16] = { '\x7F', '\x7F', '\x7F', '\x7F', '\x7F', '\x7F', '\x7F', '\x7F', '\x7F', '\x7F', '\x7F', '\x7F', '\x7F', '\x7F', '\x7F', '\x7F' };
+                cacheFile.write(garbage, sizeof(garbage));
+            }
+
+            Reader corrupt;
+            if (FAILED(corrupt.LoadCached(tempName.c_str(), true, false)) || !CompareReaders(corrupt, reader))
+            {
+                printf("ERROR: Cached load failed with corrupt cache\n");
+                success = false;
+            }
+        }
+
+        // A truncated cache falls back to parsing
+        std::filesystem::resize_file(cacheName, sizeof(uint32_t) * 16, ec);
+        {
+            Reader truncated;
+            if (FAILED(truncated.LoadCached(tempName.c_str(), true, false)) || !CompareReaders(truncated, reader))
+            {
+                printf("ERROR: Cached load failed with truncated cache\n");
+                success = false;
+            }
+        }
+
+        std::filesystem::remove(cacheName, ec);
+    }
+
+    // A change to the material file invalidates the cache
+    {
+        const auto objFile = std::filesystem::temp_directory_path() / L"directxtk12_wavefront_mtl.obj";
+        const auto mtlFile = std::filesystem::temp_directory_path() / L"directxtk12_wavefront_mtl.mtl";
+        const std::wstring objName = objFile.wstring();
+        const std::wstring cacheName = Reader::GetCacheFileName(objName.c_str());
+
+        {
+            std::ofstream outFile(objFile, std::ios::out | std::ios::binary | std::ios::trunc);
+            outFile << "mtllib directxtk12_wavefront_mtl.mtl\nv 0 0 0\nv 1 0 0\nv 0 1 0\nusemtl red\nf 1 2 3\n";
+        }
+
+        {
+            std::ofstream outFile(mtlFile, std::ios::out | std::ios::binary | std::ios::trunc);
+            outFile << "newmtl red\nKd 1 0 0\n";
+        }
+
+        Reader first;
+        HRESULT hr = first.LoadCached(objName.c_str());
+
+        {
+            std::ofstream outFile(mtlFile, std::ios::out | std::ios::binary | std::ios::trunc);
+            outFile << "newmtl red\nKd 0 0 1\n";
+        }
+
+        Reader second;
+        HRESULT hr2 = second.LoadCached(objName.c_str());
+
+        if (FAILED(hr) || FAILED(hr2) || first.materials.size() != 2 || second.materials.size() != 2)
+        {
+            printf("ERROR: Failed loading OBJ with material through cache (%08X, %08X)\n", static_cast<unsigned int>(hr), static_cast<unsigned int>(hr2));
+            success = false;
+        }
+        else if (first.materials[1].vDiffuse.x != 1.f || second.materials[1].vDiffuse.z != 1.f)
+        {
+            printf("ERROR: Cached load did not pick up the changed material file\n");
+            success = false;
+        }
+
+        std::error_code ec;
+        std::filesystem::remove(objFile, ec);
+        std::filesystem::remove(mtlFile, ec);
+        std::filesystem::remove(cacheName, ec);
+    }
+
+    // Group triangles by material
+    {
+        Reader reader;
+        if (FAILED(reader.Load(tempName.c_str(), true, false)))
+        {
+            printf("ERROR: Failed loading generated OBJ for material grouping\n");
+            success = false;
+        }
+        else
+        {
+            // The generated mesh cycles through its materials in bands; also scatter the same triangles
+            // across many materials.
+            Reader scattered = reader;
+            scattered.materials.resize(64);
+            for (size_t j = 0; j < scattered.attributes.size(); ++j)
+            {
+                scattered.attributes[j] = static_cast<uint32_t>((j * 2654435761u) >> 7) % 64;
+            }
+
+            for (const Reader* source : { &reader, &scattered })
+            {
+                Reader ref = *source;
+                auto start = std::chrono::steady_clock::now();
+                SortByAttributeReference(ref);
+                const double refTime = ElapsedMilliseconds(start);
+
+                std::vector<uint32_t> sorted(source->indices.size());
+                std::vector<uint32_t> offsets;
+                start = std::chrono::steady_clock::now();
+                HRESULT hr = source->SortByAttribute(sorted.data(), sorted.size(), offsets);
+                const double countingTime = ElapsedMilliseconds(start);
+
+                bool match = SUCCEEDED(hr) && sorted == ref.indices
+                    && offsets.size() == source->materials.size() + 1
+                    && offsets.front() == 0 && offsets.back() == sorted.size();
+                for (size_t j = 0; match && j + 1 < offsets.size(); ++j)
+                {
+                    for (size_t k = offsets[j]; k < offsets[j + 1]; k += 3)
+                    {
+                        if (ref.attributes[k / 3] != j)
+                        {
+                            match = false;
+                            break;
+                        }
+                    }
+                }
+
+                if (!match)
+                {
+                    printf("ERROR: SortByAttribute does not match stable_sort with %zu materials (%08X)\n",
+                        source->materials.size(), static_cast<unsigned int>(hr));
+                    success = false;
+                }
+                else
+                {
+                    printf("\tgroup %zu faces by %zu materials: stable_sort %.2f ms, counting sort %.2f ms\n",
+                        source->attributes.size(), source->materials.size(), refTime, countingTime);
+                }
+            }
+
+            // Invalid arguments
+            std::vector<uint32_t> sorted(reader.indices.size());
+            std::vector<uint32_t> offsets;
+            if (reader.SortByAttribute(sorted.data(), sorted.size() - 3, offsets) != E_INVALIDARG
+                || reader.SortByAttribute<uint32_t>(nullptr, sorted.size(), offsets) != E_INVALIDARG)
+            {
+                printf("ERROR: Expected failure for invalid SortByAttribute arguments\n");
+                success = false;
+            }
+
+            // The generated mesh has more vertices than 16-bit indices can address
+            std::vector<uint16_t> sorted16(reader.indices.size());
+            if (reader.vertices.size() <= UINT16_MAX
+                || reader.SortByAttribute(sorted16.data(), sorted16.size(), offsets) != E_FAIL)
+            {
+                printf("ERROR: Expected failure for SortByAttribute with 16-bit indices\n");
+                success = false;
+            }
+
+            reader.attributes.back() = static_cast<uint32_t>(reader.materials.size());
+            if (SUCCEEDED(reader.SortByAttribute(sorted.data(), sorted.size(), offsets)) || !offsets.empty())
+            {
+                printf("ERROR: Expected failure for out-of-range attribute\n");
+                success = false;
+            }
+        }
+    }
+
+    // Vertex deduplication on a mesh with a high-valence position
+    {
+        const auto fanFile = std::filesystem::temp_directory_path() / L"directxtk12_wavefront_fan.obj";
+        constexpr uint32_t c_fanTriangles = 16384;
+        if (!WriteFanOBJ(fanFile, c_fanTriangles))
+        {
+            printf("ERROR: Failed to write fan OBJ file\n");
+            success = false;
+        }
+        else
+        {
+            ReferenceOBJ ref;
+            auto start = std::chrono::steady_clock::now();
+            HRESULT hr = LoadReference(fanFile, ref);
+            const double refTime = ElapsedMilliseconds(start);
+
+            Reader reader;
+            start = std::chrono::steady_clock::now();
+            HRESULT hr2 = reader.Load(fanFile.wstring().c_str(), true, false);
+            const double bufferedTime = ElapsedMilliseconds(start);
+
+            if (FAILED(hr) || FAILED(hr2))
+            {
+                printf("ERROR: Failed loading fan OBJ (%08X, %08X)\n", static_cast<unsigned int>(hr), static_cast<unsigned int>(hr2));
+                success = false;
+            }
+            else if (!CompareResults(reader, ref))
+            {
+                printf("ERROR: Buffered reader does not match reference for fan OBJ\n");
+                success = false;
+            }
+            else if (reader.vertices.size() != size_t(c_fanTriangles) * 3)
+            {
+                printf("ERROR: Unexpected vertex count for fan OBJ (%zu)\n", reader.vertices.size());
+                success = false;
+            }
+            else
+            {
+                printf("\tfan with %u triangles on one position: reference reader %.1f ms, buffered reader %.1f ms\n",
+                    c_fanTriangles, refTime, bufferedTime);
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::remove(fanFile, ec);
+    }
+
+    // Errors in later chunks must be reported by the parallel reader
+    {
+        {
+            std::ofstream outFile(tempFile, std::ios::out | std::ios::binary | std::ios::app);
+            outFile << "f 1 2 99999999\r\n";
+        }
+
+        Reader reader;
+        if (SUCCEEDED(reader.Load(tempName.c_str(), true, false, 4)))
+        {
+            printf("ERROR: Expected failure for out-of-range index with parallel reader\n");
+            success = false;
+        }
+    }
+
+    // Invalid arguments and malformed content
+    {
+        Reader reader;
+        if (reader.Load(nullptr) != E_INVALIDARG)
+        {
+            printf("ERROR: Expected failure for null filename\n");
+            success = false;
+        }
+
+        if (SUCCEEDED(reader.Load(L"TestFileNotExist.obj")))
+        {
+            printf("ERROR: Expected failure for missing file\n");
+            success = false;
+        }
+
+        static const char* s_badFiles[] =
+        {
+            "v 1 2 3\nf 1 2\n",
+            "v 1 2 3\nf 0 1 1\n",
+            "v 1 2 3\nf 1 2 3\n",
+            "v 1 2 3\nf 1/5 1/5 1/5\n",
+            "v 1 two 3\n",
+            "\x01\x02\x03\n",
+            "# no geometry\n",
+        };
+
+        for (size_t j = 0; j < std::size(s_badFiles); ++j)
+        {
+            {
+                std::ofstream outFile(tempFile, std::ios::out | std::ios::binary | std::ios::trunc);
+                outFile << s_badFiles[j];
+            }
+
+            if (SUCCEEDED(reader.Load(tempName.c_str(), true, false)))
+            {
+                printf("ERROR: Expected failure for malformed OBJ %zu\n", j);
+                success = false;
+            }
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove(tempFile, ec);
+
+    return success;
+}
@@ -0,0 +1,377 @@
+//
+// AssetLoader.h - Loads assets in stages: file reads on an I/O pool, parsing and decoding on
+// a CPU pool, and texture uploads through a ResourceUploadBatch on the calling thread
+//
+
+#pragma once
+
+#include "ReadData.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cwchar>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Expects DDSTextureLoader.h, WICTextureLoader.h, and ResourceUploadBatch.h to be included first.
+
+namespace DX
+{
+    namespace Internal
+    {
+        // Runs jobs in order of submission on a fixed set of threads. The destructor runs the
+        // jobs still queued before joining.
+        class WorkQueue
+        {
+        public:
+            explicit WorkQueue(unsigned int threadCount) :
+                m_stop(false)
+            {
+                m_threads.reserve(threadCount);
+                for (unsigned int j = 0; j < threadCount; ++j)
+                    m_threads.emplace_back(&WorkQueue::Run, this);
+            }
+
+            ~WorkQueue()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_stop = true;
+                }
+                m_wake.notify_all();
+
+                for (auto& it : m_threads)
+                    it.join();
+            }
+
+            WorkQueue(WorkQueue const&) = delete;
+            WorkQueue& operator= (WorkQueue const&) = delete;
+
+            void Push(std::function<void()> job)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_jobs.emplace_back(std::move(job));
+                }
+                m_wake.notify_one();
+            }
+
+        private:
+            void Run()
+            {
+                for (;;)
+                {
+                    std::function<void()> job;
+                    {
+                        std::unique_lock<std::mutex> lock(m_mutex);
+                        m_wake.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+                        if (m_jobs.empty())
+                            return;
+
+                        job = std::move(m_jobs.front());
+                        m_jobs.pop_front();
+                    }
+
+                    job();
+                }
+            }
+
+            std::mutex                          m_mutex;
+            std::condition_variable             m_wake;
+            std::deque<std::function<void()>>   m_jobs;
+            bool                                m_stop;
+            std::vector<std::thread>            m_threads;
+        };
+    }
+
+    // Each Load call returns a future for its asset at once. The file is read on one of the I/O
+    // threads, then handed to one of the CPU threads to parse, so reads overlap each other and
+    // the parsing of files that have already arrived. Textures are decoded on the CPU threads
+    // into resources and subresource data, and Upload records them into a ResourceUploadBatch
+    // on the calling thread as they become ready; the batch may be begun on a copy queue.
+    //
+    // WIC decoding on the CPU threads relies on the process being in the multithreaded
+    // apartment, as the Main*.cpp entry points set up.
+    class AssetLoader
+    {
+    public:
+        struct Texture
+        {
+            Microsoft::WRL::ComPtr<ID3D12Resource>  resource;
+            bool                                    isCubeMap;
+        };
+
+        struct Statistics
+        {
+            size_t  assets;
+            UINT64  bytesRead;
+            double  readTime;       // Milliseconds, summed over the I/O threads
+            double  parseTime;      // Milliseconds, summed over the CPU threads
+            double  uploadTime;     // Milliseconds recording uploads on the calling thread
+        };
+
+        static constexpr unsigned int c_defaultIOThreads = 2;
+
+        // 'cpuThreads' of zero uses one per core.
+        explicit AssetLoader(_In_ ID3D12Device* device, unsigned int ioThreads = c_defaultIOThreads, unsigned int cpuThreads = 0) :
+            m_device(device),
+            m_texturesPending(0),
+            m_stats{}
+        {
+            if (!device)
+            {
+                throw std::invalid_argument("AssetLoader requires a device");
+            }
+
+            if (!cpuThreads)
+            {
+                cpuThreads = std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            m_cpu = std::make_unique<Internal::WorkQueue>(cpuThreads);
+            m_io = std::make_unique<Internal::WorkQueue>(std::max(1u, ioThreads));
+        }
+
+        // Finishes the jobs already submitted. Textures not uploaded by then fail with broken_promise.
+        ~AssetLoader()
+        {
+            m_io.reset();
+            m_cpu.reset();
+        }
+
+        AssetLoader(AssetLoader const&) = delete;
+        AssetLoader& operator= (AssetLoader const&) = delete;
+
+        // Reads 'fileName', then calls 'parse(const uint8_t* data, size_t size)' on a CPU thread.
+        // The future holds its result, or the exception from either stage.
+        template<typename Parse>
+        auto Load(_In_z_ const wchar_t* fileName, Parse parse)
+            -> std::future<decltype(parse(std::declval<const uint8_t*>(), size_t()))>
+        {
+            using Result = decltype(parse(std::declval<const uint8_t*>(), size_t()));
+
+            auto promise = std::make_shared<std::promise<Result>>();
+            auto future = promise->get_future();
+            auto parser = std::make_shared<Parse>(std::move(parse));
+
+            Read(fileName, [this, promise, parser](std::shared_ptr<std::vector<uint8_t>> data, std::exception_ptr error)
+                {
+                    if (error)
+                    {
+                        promise->set_exception(error);
+                        return;
+                    }
+
+                    try
+                    {
+                        auto start = std::chrono::steady_clock::now();
+                        auto result = (*parser)(data->data(), data->size());
+                        AddTime(m_stats.parseTime, start);
+
+                        promise->set_value(std::move(result));
+                    }
+                    catch (...)
+                    {
+                        promise->set_exception(std::current_exception());
+                    }
+                });
+
+            return future;
+        }
+
+        // Loads a .dds file with LoadDDSTextureFromMemoryEx, or any other with
+        // LoadWICTextureFromMemoryEx. The future is ready once Upload has recorded the texture,
+        // which is then usable when the batch's End completes, as for CreateDDSTextureFromFile.
+        // Mip generation needs the batch itself, so the MIP_AUTOGEN flags are not supported.
+        std::future<Texture> LoadTexture(
+            _In_z_ const wchar_t* fileName,
+            DirectX::DDS_LOADER_FLAGS ddsFlags = DirectX::DDS_LOADER_DEFAULT,
+            DirectX::WIC_LOADER_FLAGS wicFlags = DirectX::WIC_LOADER_DEFAULT)
+        {
+            if ((ddsFlags & DirectX::DDS_LOADER_MIP_AUTOGEN) || (wicFlags & DirectX::WIC_LOADER_MIP_AUTOGEN))
+            {
+                throw std::invalid_argument("AssetLoader does not generate mips");
+            }
+
+            auto pending = std::make_shared<PendingTexture>();
+            pending->texture.isCubeMap = false;
+            auto future = pending->promise.get_future();
+
+            const size_t len = wcslen(fileName);
+            const bool isDDS = (len > 4) && (_wcsicmp(fileName + len - 4, L".dds") == 0);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                ++m_texturesPending;
+            }
+
+            Read(fileName, [this, pending, isDDS, ddsFlags, wicFlags](std::shared_ptr<std::vector<uint8_t>> data, std::exception_ptr error)
+                {
+                    pending->error = error;
+                    if (!error)
+                    {
+                        try
+                        {
+                            auto start = std::chrono::steady_clock::now();
+                            pending->fileData = std::move(data);
+                            Decode(*pending, isDDS, ddsFlags, wicFlags);
+                            AddTime(m_stats.parseTime, start);
+                        }
+                        catch (...)
+                        {
+                            pending->error = std::current_exception();
+                        }
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        m_decoded.push_back(pending);
+                    }
+                    m_ready.notify_one();
+                });
+
+            return future;
+        }
+
+        // Records the uploads of every texture requested so far into 'resourceUpload', which must
+        // be between Begin and End, waiting for each to be decoded and taking them in the order
+        // they become ready. Each is left in the pixel shader resource state, as the Create
+        // functions do.
+        void Upload(DirectX::ResourceUploadBatch& resourceUpload)
+        {
+            for (;;)
+            {
+                std::shared_ptr<PendingTexture> pending;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    if (!m_texturesPending)
+                        break;
+
+                    m_ready.wait(lock, [this] { return !m_decoded.empty(); });
+                    pending = std::move(m_decoded.front());
+                    m_decoded.pop_front();
+                    --m_texturesPending;
+                }
+
+                if (pending->error)
+                {
+                    pending->promise.set_exception(pending->error);
+                    continue;
+                }
+
+                try
+                {
+                    auto start = std::chrono::steady_clock::now();
+
+                    auto resource = pending->texture.resource.Get();
+                    resourceUpload.Upload(resource, 0, pending->subresources.data(), static_cast<UINT>(pending->subresources.size()));
+                    resourceUpload.Transition(resource, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+                    AddTime(m_stats.uploadTime, start);
+
+                    pending->promise.set_value(std::move(pending->texture));
+                }
+                catch (...)
+                {
+                    pending->promise.set_exception(std::current_exception());
+                }
+            }
+        }
+
+        Statistics GetStatistics() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_stats;
+        }
+
+    private:
+        struct PendingTexture
+        {
+            std::shared_ptr<std::vector<uint8_t>>   fileData;
+            std::unique_ptr<uint8_t[]>              decodedData;
+            std::vector<D3D12_SUBRESOURCE_DATA>     subresources;
+            Texture                                 texture;
+            std::exception_ptr                      error;
+            std::promise<Texture>                   promise;
+        };
+
+        using ReadComplete = std::function<void(std::shared_ptr<std::vector<uint8_t>>, std::exception_ptr)>;
+
+        // Reads on an I/O thread, then calls 'complete' on a CPU thread with the data or the error.
+        void Read(_In_z_ const wchar_t* fileName, ReadComplete complete)
+        {
+            std::wstring name(fileName);
+            m_io->Push([this, name, complete]()
+                {
+                    std::shared_ptr<std::vector<uint8_t>> data;
+                    std::exception_ptr error;
+                    try
+                    {
+                        auto start = std::chrono::steady_clock::now();
+                        data = std::make_shared<std::vector<uint8_t>>(ReadData(name.c_str()));
+                        AddTime(m_stats.readTime, start);
+
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        ++m_stats.assets;
+                        m_stats.bytesRead += data->size();
+                    }
+                    catch (...)
+                    {
+                        error = std::current_exception();
+                    }
+
+                    m_cpu->Push([complete, data, error]() { complete(data, error); });
+                });
+        }
+
+        void Decode(PendingTexture& pending, bool isDDS, DirectX::DDS_LOADER_FLAGS ddsFlags, DirectX::WIC_LOADER_FLAGS wicFlags) const
+        {
+            const auto& data = *pending.fileData;
+
+            if (isDDS)
+            {
+                ThrowIfFailed(DirectX::LoadDDSTextureFromMemoryEx(m_device,
+                    data.data(), data.size(), 0, D3D12_RESOURCE_FLAG_NONE, ddsFlags,
+                    pending.texture.resource.ReleaseAndGetAddressOf(), pending.subresources,
+                    nullptr, &pending.texture.isCubeMap));
+                return;
+            }
+
+            pending.subresources.resize(1);
+            ThrowIfFailed(DirectX::LoadWICTextureFromMemoryEx(m_device,
+                data.data(), data.size(), 0, D3D12_RESOURCE_FLAG_NONE, wicFlags,
+                pending.texture.resource.ReleaseAndGetAddressOf(), pending.decodedData, pending.subresources[0]));
+        }
+
+        void AddTime(double& total, std::chrono::steady_clock::time_point start)
+        {
+            const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            total += elapsed;
+        }
+
+        ID3D12Device*                                   m_device;
+
+        mutable std::mutex                              m_mutex;
+        std::condition_variable                         m_ready;
+        std::deque<std::shared_ptr<PendingTexture>>     m_decoded;
+        size_t                                          m_texturesPending;
+        Statistics                                      m_stats;
+
+        // Declared last so the threads are stopped before the state they use is destroyed.
+        std::unique_ptr<Internal::WorkQueue>            m_cpu;
+        std::unique_ptr<Internal::WorkQueue>            m_io;
+    };
+}
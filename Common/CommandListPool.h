@@ -0,0 +1,222 @@
+//
+// CommandListPool.h - Per-thread command allocators and lists for recording in parallel
+//
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cwchar>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifndef IID_GRAPHICS_PPV_ARGS
+#define IID_GRAPHICS_PPV_ARGS(x) IID_PPV_ARGS(x)
+#endif
+
+namespace DX
+{
+    // Owns a command allocator per frame and worker, and a command list per worker. Record forks
+    // the work across the workers and joins before returning; Execute then submits the commands
+    // recorded before the fork, each worker's list in order, and the commands recorded after, in
+    // a single ExecuteCommandLists.
+    template<typename T = ID3D12GraphicsCommandList>
+    class CommandListPool
+    {
+    public:
+        static constexpr unsigned int c_MaxWorkers = 8;
+
+        CommandListPool() noexcept :
+            m_device(nullptr),
+            m_frameCount(0),
+            m_workerCount(0),
+            m_activeWorkers(0),
+            m_pending(false)
+        {
+        }
+
+        CommandListPool(CommandListPool&&) = default;
+        CommandListPool& operator= (CommandListPool&&) = default;
+
+        CommandListPool(CommandListPool const&) = delete;
+        CommandListPool& operator= (CommandListPool const&) = delete;
+
+        // The allocators and lists are created on first use. A worker count of zero uses one
+        // worker per core, up to c_MaxWorkers.
+        void Create(_In_ ID3D12Device* device, UINT frameCount, unsigned int workerCount = 0) noexcept
+        {
+            Release();
+
+            if (!workerCount)
+            {
+                workerCount = std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            m_device = device;
+            m_frameCount = frameCount;
+            m_workerCount = std::min(workerCount, c_MaxWorkers);
+        }
+
+        void Release() noexcept
+        {
+            m_allocators.clear();
+            m_commandLists.clear();
+            m_spare.Reset();
+            m_recordTimes.clear();
+            m_device = nullptr;
+            m_activeWorkers = 0;
+            m_pending = false;
+        }
+
+        // Closes 'commandList' and calls fn(workerList, begin, end) over contiguous ranges of
+        // [0, count), one per worker, on the calling thread and up to GetWorkerCount() - 1 others.
+        // Worker lists start with no state set. On return 'commandList' has been replaced by an
+        // open list, reset with 'allocator', for the commands that follow the workers' ones.
+        template<typename Fn>
+        void Record(Microsoft::WRL::ComPtr<T>& commandList, _In_ ID3D12CommandAllocator* allocator, UINT frameIndex, size_t count, const Fn& fn)
+        {
+            if (m_pending)
+            {
+                throw std::logic_error("CommandListPool::Record can only be used once per frame");
+            }
+
+            if (!count)
+                return;
+
+            if (!m_device || frameIndex >= m_frameCount)
+            {
+                throw std::logic_error("CommandListPool is not created");
+            }
+
+            CreateCommandLists();
+
+            const auto workers = static_cast<unsigned int>(std::min<size_t>(m_workerCount, count));
+
+            // The recorded list is kept for Execute, and the spare takes its place.
+            ThrowIfFailed(commandList->Close());
+            commandList.Swap(m_spare);
+            ThrowIfFailed(commandList->Reset(allocator, nullptr));
+
+            m_activeWorkers = workers;
+            m_pending = true;
+            m_recordTimes.assign(workers, 0.0);
+
+            std::vector<std::exception_ptr> errors(workers);
+
+            auto worker = [&](unsigned int index)
+                {
+                    auto start = std::chrono::steady_clock::now();
+
+                    try
+                    {
+                        auto workerAllocator = m_allocators[size_t(frameIndex) * m_workerCount + index].Get();
+                        auto workerList = m_commandLists[index].Get();
+                        ThrowIfFailed(workerAllocator->Reset());
+                        ThrowIfFailed(workerList->Reset(workerAllocator, nullptr));
+
+                        fn(workerList, count * index / workers, count * (index + 1) / workers);
+
+                        ThrowIfFailed(workerList->Close());
+                    }
+                    catch (...)
+                    {
+                        errors[index] = std::current_exception();
+                    }
+
+                    m_recordTimes[index] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                };
+
+            std::vector<std::thread> threads;
+            threads.reserve(workers - 1);
+            for (unsigned int j = 1; j < workers; ++j)
+                threads.emplace_back(worker, j);
+
+            worker(0);
+
+            for (auto& it : threads)
+                it.join();
+
+            for (auto& it : errors)
+            {
+                if (it)
+                    std::rethrow_exception(it);
+            }
+        }
+
+        // Submits 'commandList', which must be closed, after any lists from Record this frame.
+        void Execute(_In_ ID3D12CommandQueue* commandQueue, _In_ T* commandList)
+        {
+            m_submission.clear();
+
+            if (m_pending)
+            {
+                m_submission.push_back(m_spare.Get());
+                for (unsigned int j = 0; j < m_activeWorkers; ++j)
+                {
+                    m_submission.push_back(m_commandLists[j].Get());
+                }
+                m_pending = false;
+            }
+
+            m_submission.push_back(commandList);
+
+            commandQueue->ExecuteCommandLists(static_cast<UINT>(m_submission.size()), m_submission.data());
+        }
+
+        unsigned int GetWorkerCount() const noexcept { return m_workerCount; }
+
+        // Time in milliseconds each active worker spent recording during the last Record.
+        const std::vector<double>& GetRecordTimes() const noexcept { return m_recordTimes; }
+
+    private:
+        void CreateCommandLists()
+        {
+            if (!m_commandLists.empty())
+                return;
+
+            m_allocators.resize(size_t(m_frameCount) * m_workerCount);
+            for (UINT n = 0; n < m_frameCount; ++n)
+            {
+                for (unsigned int j = 0; j < m_workerCount; ++j)
+                {
+                    auto& allocator = m_allocators[size_t(n) * m_workerCount + j];
+                    ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_GRAPHICS_PPV_ARGS(allocator.ReleaseAndGetAddressOf())));
+
+                    wchar_t name[48] = {};
+                    swprintf_s(name, L"Render target %u, worker %u", n, j);
+                    allocator->SetName(name);
+                }
+            }
+
+            m_commandLists.resize(m_workerCount);
+            for (unsigned int j = 0; j < m_workerCount; ++j)
+            {
+                ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_allocators[j].Get(), nullptr, IID_GRAPHICS_PPV_ARGS(m_commandLists[j].ReleaseAndGetAddressOf())));
+                ThrowIfFailed(m_commandLists[j]->Close());
+
+                wchar_t name[32] = {};
+                swprintf_s(name, L"CommandListPool worker %u", j);
+                m_commandLists[j]->SetName(name);
+            }
+
+            ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_allocators[0].Get(), nullptr, IID_GRAPHICS_PPV_ARGS(m_spare.ReleaseAndGetAddressOf())));
+            ThrowIfFailed(m_spare->Close());
+
+            m_spare->SetName(L"DeviceResources");
+        }
+
+        ID3D12Device*                                           m_device;
+        UINT                                                    m_frameCount;
+        unsigned int                                            m_workerCount;
+        unsigned int                                            m_activeWorkers;
+        bool                                                    m_pending;
+
+        std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> m_allocators;
+        std::vector<Microsoft::WRL::ComPtr<T>>                  m_commandLists;
+        Microsoft::WRL::ComPtr<T>                               m_spare;
+        std::vector<ID3D12CommandList*>                         m_submission;
+        std::vector<double>                                     m_recordTimes;
+    };
+}
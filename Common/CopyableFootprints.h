@@ -0,0 +1,379 @@
+//--------------------------------------------------------------------------------------
+// File: CopyableFootprints.h
+//
+// Computes the placed footprints of a resource's subresources in an upload buffer, as
+// ID3D12Device::GetCopyableFootprints does, without a device
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// Expects d3d12.h to be included first.
+
+namespace DX
+{
+    namespace Internal
+    {
+        // Bytes per block of 'width' x 'height' pixels in one plane, as laid out for copies
+        struct FootprintBlock
+        {
+            DXGI_FORMAT format;
+            UINT        bytes;
+            UINT        width;
+            UINT        height;
+            UINT        subsampleX;
+            UINT        subsampleY;
+        };
+
+        constexpr UINT64 AlignFootprint(UINT64 value, UINT64 alignment) noexcept
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        inline bool GetFootprintBlock(DXGI_FORMAT format, UINT plane, _Out_ FootprintBlock& block) noexcept
+        {
+            block = { format, 0, 1, 1, 1, 1 };
+
+            switch (static_cast<int>(format))
+            {
+            case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+            case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            case DXGI_FORMAT_R32G32B32A32_UINT:
+            case DXGI_FORMAT_R32G32B32A32_SINT:
+                block.bytes = 16;
+                return plane == 0;
+
+            case DXGI_FORMAT_R32G32B32_TYPELESS:
+            case DXGI_FORMAT_R32G32B32_FLOAT:
+            case DXGI_FORMAT_R32G32B32_UINT:
+            case DXGI_FORMAT_R32G32B32_SINT:
+                block.bytes = 12;
+                return plane == 0;
+
+            case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+            case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            case DXGI_FORMAT_R16G16B16A16_UNORM:
+            case DXGI_FORMAT_R16G16B16A16_UINT:
+            case DXGI_FORMAT_R16G16B16A16_SNORM:
+            case DXGI_FORMAT_R16G16B16A16_SINT:
+            case DXGI_FORMAT_R32G32_TYPELESS:
+            case DXGI_FORMAT_R32G32_FLOAT:
+            case DXGI_FORMAT_R32G32_UINT:
+            case DXGI_FORMAT_R32G32_SINT:
+            case DXGI_FORMAT_Y416:
+                block.bytes = 8;
+                return plane == 0;
+
+            case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+            case DXGI_FORMAT_R10G10B10A2_UNORM:
+            case DXGI_FORMAT_R10G10B10A2_UINT:
+            case DXGI_FORMAT_R11G11B10_FLOAT:
+            case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+            case DXGI_FORMAT_R8G8B8A8_UNORM:
+            case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+            case DXGI_FORMAT_R8G8B8A8_UINT:
+            case DXGI_FORMAT_R8G8B8A8_SNORM:
+            case DXGI_FORMAT_R8G8B8A8_SINT:
+            case DXGI_FORMAT_R16G16_TYPELESS:
+            case DXGI_FORMAT_R16G16_FLOAT:
+            case DXGI_FORMAT_R16G16_UNORM:
+            case DXGI_FORMAT_R16G16_UINT:
+            case DXGI_FORMAT_R16G16_SNORM:
+            case DXGI_FORMAT_R16G16_SINT:
+            case DXGI_FORMAT_R32_TYPELESS:
+            case DXGI_FORMAT_D32_FLOAT:
+            case DXGI_FORMAT_R32_FLOAT:
+            case DXGI_FORMAT_R32_UINT:
+            case DXGI_FORMAT_R32_SINT:
+            case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+            case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+            case DXGI_FORMAT_B8G8R8A8_UNORM:
+            case DXGI_FORMAT_B8G8R8X8_UNORM:
+            case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+            case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+            case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+            case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            case DXGI_FORMAT_AYUV:
+            case DXGI_FORMAT_Y410:
+                block.bytes = 4;
+                return plane == 0;
+
+            case DXGI_FORMAT_R8G8_TYPELESS:
+            case DXGI_FORMAT_R8G8_UNORM:
+            case DXGI_FORMAT_R8G8_UINT:
+            case DXGI_FORMAT_R8G8_SNORM:
+            case DXGI_FORMAT_R8G8_SINT:
+            case DXGI_FORMAT_R16_TYPELESS:
+            case DXGI_FORMAT_R16_FLOAT:
+            case DXGI_FORMAT_D16_UNORM:
+            case DXGI_FORMAT_R16_UNORM:
+            case DXGI_FORMAT_R16_UINT:
+            case DXGI_FORMAT_R16_SNORM:
+            case DXGI_FORMAT_R16_SINT:
+            case DXGI_FORMAT_B5G6R5_UNORM:
+            case DXGI_FORMAT_B5G5R5A1_UNORM:
+            case DXGI_FORMAT_A8P8:
+            case DXGI_FORMAT_B4G4R4A4_UNORM:
+                block.bytes = 2;
+                return plane == 0;
+
+            case DXGI_FORMAT_R8_TYPELESS:
+            case DXGI_FORMAT_R8_UNORM:
+            case DXGI_FORMAT_R8_UINT:
+            case DXGI_FORMAT_R8_SNORM:
+            case DXGI_FORMAT_R8_SINT:
+            case DXGI_FORMAT_A8_UNORM:
+            case DXGI_FORMAT_AI44:
+            case DXGI_FORMAT_IA44:
+            case DXGI_FORMAT_P8:
+                block.bytes = 1;
+                return plane == 0;
+
+            case DXGI_FORMAT_R1_UNORM:
+                block.bytes = 1;
+                block.width = 8;
+                return plane == 0;
+
+            // Packed 4:2:2, where each pair of pixels shares its chroma
+            case DXGI_FORMAT_R8G8_B8G8_UNORM:
+            case DXGI_FORMAT_G8R8_G8B8_UNORM:
+            case DXGI_FORMAT_YUY2:
+                block.bytes = 4;
+                block.width = 2;
+                return plane == 0;
+
+            case DXGI_FORMAT_Y210:
+            case DXGI_FORMAT_Y216:
+                block.bytes = 8;
+                block.width = 2;
+                return plane == 0;
+
+            case DXGI_FORMAT_BC1_TYPELESS:
+            case DXGI_FORMAT_BC1_UNORM:
+            case DXGI_FORMAT_BC1_UNORM_SRGB:
+            case DXGI_FORMAT_BC4_TYPELESS:
+            case DXGI_FORMAT_BC4_UNORM:
+            case DXGI_FORMAT_BC4_SNORM:
+                block.bytes = 8;
+                block.width = block.height = 4;
+                return plane == 0;
+
+            case DXGI_FORMAT_BC2_TYPELESS:
+            case DXGI_FORMAT_BC2_UNORM:
+            case DXGI_FORMAT_BC2_UNORM_SRGB:
+            case DXGI_FORMAT_BC3_TYPELESS:
+            case DXGI_FORMAT_BC3_UNORM:
+            case DXGI_FORMAT_BC3_UNORM_SRGB:
+            case DXGI_FORMAT_BC5_TYPELESS:
+            case DXGI_FORMAT_BC5_UNORM:
+            case DXGI_FORMAT_BC5_SNORM:
+            case DXGI_FORMAT_BC6H_TYPELESS:
+            case DXGI_FORMAT_BC6H_UF16:
+            case DXGI_FORMAT_BC6H_SF16:
+            case DXGI_FORMAT_BC7_TYPELESS:
+            case DXGI_FORMAT_BC7_UNORM:
+            case DXGI_FORMAT_BC7_UNORM_SRGB:
+                block.bytes = 16;
+                block.width = block.height = 4;
+                return plane == 0;
+
+            // Planar 4:2:0 and 4:1:1, a luma plane then an interleaved chroma plane
+            case DXGI_FORMAT_NV12:
+            case DXGI_FORMAT_420_OPAQUE:
+                block.format = plane ? DXGI_FORMAT_R8G8_TYPELESS : DXGI_FORMAT_R8_TYPELESS;
+                block.bytes = plane ? 2 : 1;
+                block.subsampleX = block.subsampleY = plane ? 2 : 1;
+                return plane < 2;
+
+            case DXGI_FORMAT_P010:
+            case DXGI_FORMAT_P016:
+                block.format = plane ? DXGI_FORMAT_R16G16_TYPELESS : DXGI_FORMAT_R16_TYPELESS;
+                block.bytes = plane ? 4 : 2;
+                block.subsampleX = block.subsampleY = plane ? 2 : 1;
+                return plane < 2;
+
+            case DXGI_FORMAT_NV11:
+                block.format = plane ? DXGI_FORMAT_R8G8_TYPELESS : DXGI_FORMAT_R8_TYPELESS;
+                block.bytes = plane ? 2 : 1;
+                block.subsampleX = plane ? 4 : 1;
+                return plane < 2;
+
+            // Depth and stencil are copied as separate planes
+            case DXGI_FORMAT_R32G8X24_TYPELESS:
+            case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+            case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
+            case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
+            case DXGI_FORMAT_R24G8_TYPELESS:
+            case DXGI_FORMAT_D24_UNORM_S8_UINT:
+            case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+            case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
+                block.format = plane ? DXGI_FORMAT_R8_TYPELESS : DXGI_FORMAT_R32_TYPELESS;
+                block.bytes = plane ? 1 : 4;
+                return plane < 2;
+
+            default:
+                return false;
+            }
+        }
+    }
+
+    // Returns the number of planes in a format, or zero if its copy layout is unknown.
+    inline UINT GetCopyablePlaneCount(DXGI_FORMAT format) noexcept
+    {
+        Internal::FootprintBlock block;
+        if (!Internal::GetFootprintBlock(format, 0, block))
+            return 0;
+
+        return Internal::GetFootprintBlock(format, 1, block) ? 2u : 1u;
+    }
+
+    // As ID3D12Device::GetCopyableFootprints. Each subresource starts at the next
+    // D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT boundary after 'baseOffset', rows are
+    // D3D12_TEXTURE_DATA_PITCH_ALIGNMENT apart, and 'totalBytes' ends at the last row of the
+    // last subresource, without padding. A MipLevels of zero is the full chain. On failure
+    // the outputs are filled with ~0, as the device does.
+    inline HRESULT GetCopyableFootprints(
+        const D3D12_RESOURCE_DESC& desc,
+        UINT firstSubresource,
+        UINT numSubresources,
+        UINT64 baseOffset,
+        _Out_writes_opt_(numSubresources) D3D12_PLACED_SUBRESOURCE_FOOTPRINT* layouts,
+        _Out_writes_opt_(numSubresources) UINT* numRows,
+        _Out_writes_opt_(numSubresources) UINT64* rowSizesInBytes,
+        _Out_opt_ UINT64* totalBytes) noexcept
+    {
+        auto fail = [&]() noexcept
+            {
+                for (UINT i = 0; i < numSubresources; ++i)
+                {
+                    if (layouts)
+                        memset(&layouts[i], 0xff, sizeof(D3D12_PLACED_SUBRESOURCE_FOOTPRINT));
+                    if (numRows)
+                        numRows[i] = UINT(-1);
+                    if (rowSizesInBytes)
+                        rowSizesInBytes[i] = UINT64(-1);
+                }
+                if (totalBytes)
+                    *totalBytes = UINT64(-1);
+                return E_INVALIDARG;
+            };
+
+        if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+        {
+            if (firstSubresource != 0 || numSubresources > 1 || desc.Width > UINT(-1))
+                return fail();
+
+            if (numSubresources)
+            {
+                if (layouts)
+                {
+                    layouts[0].Offset = baseOffset;
+                    layouts[0].Footprint = { DXGI_FORMAT_UNKNOWN, UINT(desc.Width), 1, 1, UINT(Internal::AlignFootprint(desc.Width, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT)) };
+                }
+                if (numRows)
+                    numRows[0] = 1;
+                if (rowSizesInBytes)
+                    rowSizesInBytes[0] = desc.Width;
+            }
+            if (totalBytes)
+                *totalBytes = numSubresources ? desc.Width : 0;
+            return S_OK;
+        }
+
+        if (desc.Dimension != D3D12_RESOURCE_DIMENSION_TEXTURE1D
+            && desc.Dimension != D3D12_RESOURCE_DIMENSION_TEXTURE2D
+            && desc.Dimension != D3D12_RESOURCE_DIMENSION_TEXTURE3D)
+        {
+            return fail();
+        }
+
+        const UINT planes = GetCopyablePlaneCount(desc.Format);
+        if (!planes || !desc.Width || !desc.Height || !desc.DepthOrArraySize || desc.Width > UINT(-1))
+            return fail();
+
+        const bool volume = (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D);
+
+        UINT mipLevels = desc.MipLevels;
+        if (!mipLevels)
+        {
+            UINT64 size = std::max<UINT64>(std::max<UINT64>(desc.Width, desc.Height), volume ? desc.DepthOrArraySize : 1u);
+            for (mipLevels = 1; size > 1; size >>= 1)
+                ++mipLevels;
+        }
+
+        const UINT arraySize = volume ? 1u : desc.DepthOrArraySize;
+        const UINT64 subresourceCount = UINT64(mipLevels) * arraySize * planes;
+        if (UINT64(firstSubresource) + numSubresources > subresourceCount)
+            return fail();
+
+        UINT64 total = 0;
+        for (UINT i = 0; i < numSubresources; ++i)
+        {
+            const UINT subresource = firstSubresource + i;
+            const UINT mip = subresource % mipLevels;
+            const UINT plane = subresource / (mipLevels * arraySize);
+
+            Internal::FootprintBlock block;
+            if (!Internal::GetFootprintBlock(desc.Format, plane, block))
+                return fail();
+
+            const UINT width = std::max(1u, UINT(desc.Width >> mip));
+            const UINT height = std::max(1u, desc.Height >> mip);
+            const UINT depth = volume ? std::max(1u, UINT(desc.DepthOrArraySize) >> mip) : 1u;
+
+            const UINT planeWidth = (width + block.subsampleX - 1) / block.subsampleX;
+            const UINT planeHeight = (height + block.subsampleY - 1) / block.subsampleY;
+
+            const UINT64 blocksWide = (UINT64(planeWidth) + block.width - 1) / block.width;
+            const UINT64 blocksHigh = (UINT64(planeHeight) + block.height - 1) / block.height;
+
+            const UINT64 rowSize = blocksWide * block.bytes;
+            const UINT64 rowPitch = Internal::AlignFootprint(rowSize, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+            if (rowPitch > UINT(-1))
+                return fail();
+
+            const UINT64 offset = Internal::AlignFootprint(total, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+            if (layouts)
+            {
+                layouts[i].Offset = baseOffset + offset;
+                layouts[i].Footprint.Format = block.format;
+                layouts[i].Footprint.Width = UINT(blocksWide * block.width);
+                layouts[i].Footprint.Height = UINT(blocksHigh * block.height);
+                layouts[i].Footprint.Depth = depth;
+                layouts[i].Footprint.RowPitch = UINT(rowPitch);
+            }
+            if (numRows)
+                numRows[i] = UINT(blocksHigh);
+            if (rowSizesInBytes)
+                rowSizesInBytes[i] = rowSize;
+
+            total = offset + rowPitch * (blocksHigh * depth - 1) + rowSize;
+        }
+
+        if (totalBytes)
+            *totalBytes = total;
+
+        return S_OK;
+    }
+
+    // As GetRequiredIntermediateSize in d3dx12.h, but from the description alone. Returns zero
+    // if the description or range is invalid.
+    inline UINT64 GetRequiredIntermediateSize(
+        const D3D12_RESOURCE_DESC& desc,
+        UINT firstSubresource,
+        UINT numSubresources) noexcept
+    {
+        UINT64 requiredSize = 0;
+        if (FAILED(GetCopyableFootprints(desc, firstSubresource, numSubresources, 0, nullptr, nullptr, nullptr, &requiredSize)))
+            return 0;
+
+        return requiredSize;
+    }
+}
@@ -0,0 +1,487 @@
+//
+// DescriptorAllocator.h - Recycling descriptor allocator over a range of a DescriptorPile
+//
+
+#pragma once
+
+#include "DescriptorHeap.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <wrl/client.h>
+#include <wrl/wrappers/corewrappers.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifndef IID_GRAPHICS_PPV_ARGS
+#define IID_GRAPHICS_PPV_ARGS(x) IID_PPV_ARGS(x)
+#endif
+
+namespace DX
+{
+    // Takes 'capacity' descriptors from the pile with AllocateRange and hands out single
+    // descriptors and contiguous ranges of them, which can be freed and reused. Free blocks are
+    // kept in segregated lists by size class (two-level segregated fit) with bitmaps of the
+    // non-empty lists, so Allocate and FreeImmediate take constant time, and a freed block is
+    // merged with free neighbors at once. All methods are thread-safe.
+    //
+    // Requests are rounded up to the next list boundary so that the first block found fits, so a
+    // range can fail to allocate while a free block of exactly its size sits in a list with
+    // smaller ones.
+    //
+    // Free holds the descriptors until the GPU passes the next Commit, for descriptors that
+    // command lists in flight may still read; FreeImmediate is for those it never saw.
+    class DescriptorAllocator
+    {
+    public:
+        using IndexType = DirectX::DescriptorPile::IndexType;
+
+        struct Statistics
+        {
+            size_t  capacity;
+            size_t  allocated;              // Includes descriptors waiting on a deferred free
+            size_t  peakAllocated;
+            size_t  pendingFree;
+            size_t  freeBlocks;
+            size_t  largestFreeBlock;
+            float   fragmentation;          // 1 - largestFreeBlock / free descriptors
+            UINT64  allocations;
+            UINT64  failedAllocations;
+            UINT64  stalls;                 // Times Allocate waited on the GPU for deferred frees
+        };
+
+        DescriptorAllocator(_In_ ID3D12Device* device, DirectX::DescriptorPile& pile, size_t capacity) :
+            m_pile(pile),
+            m_base(0),
+            m_capacity(0),
+            m_flBitmap(0),
+            m_slBitmap{},
+            m_freeBlocks(0),
+            m_fenceValue(0),
+            m_stats{}
+        {
+            if (!device)
+            {
+                throw std::invalid_argument("DescriptorAllocator requires a device");
+            }
+
+            if (!capacity || capacity >= c_none)
+            {
+                throw std::invalid_argument("DescriptorAllocator capacity is out of range");
+            }
+
+            IndexType end;
+            pile.AllocateRange(capacity, m_base, end);
+            m_capacity = static_cast<uint32_t>(capacity);
+
+            ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_GRAPHICS_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
+
+            m_fence->SetName(L"DescriptorAllocator");
+
+            m_fenceEvent.Attach(CreateEventEx(nullptr, nullptr, 0, EVENT_MODIFY_STATE | SYNCHRONIZE));
+            if (!m_fenceEvent.IsValid())
+            {
+                throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "CreateEventEx");
+            }
+
+            for (auto& fl : m_heads)
+            {
+                for (auto& sl : fl)
+                    sl = c_none;
+            }
+
+            m_flags.resize(capacity, 0);
+            m_size.resize(capacity, 0);
+            m_tag.resize(capacity, 0);
+            m_next.resize(capacity, static_cast<uint32_t>(c_none));
+            m_prev.resize(capacity, static_cast<uint32_t>(c_none));
+
+            InsertFree(0, m_capacity);
+
+            m_stats.capacity = capacity;
+        }
+
+        DescriptorAllocator(DescriptorAllocator const&) = delete;
+        DescriptorAllocator& operator= (DescriptorAllocator const&) = delete;
+
+        // Returns the pile index of the first of 'count' contiguous descriptors. When none are
+        // free, waits for committed deferred frees before throwing.
+        IndexType Allocate(size_t count = 1)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            uint32_t start = 0;
+            for (;;)
+            {
+                if (AllocateBlock(count, start))
+                    return m_base + start;
+
+                if (!Reclaim(true))
+                    break;
+            }
+
+            ++m_stats.failedAllocations;
+            throw std::runtime_error("DescriptorAllocator is out of descriptors");
+        }
+
+        // As Allocate, but returns false rather than wait on the GPU or throw.
+        bool TryAllocate(size_t count, IndexType& index)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            Reclaim(false);
+
+            uint32_t start = 0;
+            if (AllocateBlock(count, start))
+            {
+                index = m_base + start;
+                return true;
+            }
+
+            ++m_stats.failedAllocations;
+            return false;
+        }
+
+        void Free(IndexType index)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            const uint32_t start = GetAllocation(index);
+            m_flags[start] |= c_pending;
+            m_pending.push_back(start);
+            m_stats.pendingFree += m_size[start];
+        }
+
+        void FreeImmediate(IndexType index)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            FreeBlock(GetAllocation(index));
+        }
+
+        // Call after submitting the command lists that last read the descriptors freed since the
+        // previous Commit.
+        void Commit(_In_ ID3D12CommandQueue* commandQueue)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (!m_pending.empty())
+            {
+                ThrowIfFailed(commandQueue->Signal(m_fence.Get(), ++m_fenceValue));
+
+                m_frames.push_back({ m_fenceValue, std::move(m_pending) });
+                m_pending.clear();
+            }
+
+            Reclaim(false);
+        }
+
+        D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(IndexType index) const { return m_pile.GetCpuHandle(index); }
+        D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(IndexType index) const { return m_pile.GetGpuHandle(index); }
+
+        ID3D12DescriptorHeap* Heap() const noexcept { return m_pile.Heap(); }
+
+        Statistics GetStatistics() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            Statistics stats = m_stats;
+            stats.freeBlocks = m_freeBlocks;
+            stats.largestFreeBlock = 0;
+
+            if (m_flBitmap)
+            {
+                // The largest block is in the highest non-empty list
+                const uint32_t fl = HighestBit(m_flBitmap);
+                const uint32_t sl = HighestBit(m_slBitmap[fl]);
+                for (uint32_t block = m_heads[fl][sl]; block != c_none; block = m_next[block])
+                {
+                    stats.largestFreeBlock = std::max<size_t>(stats.largestFreeBlock, m_size[block]);
+                }
+            }
+
+            const size_t freeDescriptors = stats.capacity - stats.allocated;
+            stats.fragmentation = freeDescriptors ? 1.f - float(stats.largestFreeBlock) / float(freeDescriptors) : 0.f;
+            return stats;
+        }
+
+    private:
+        static constexpr uint32_t c_none = UINT32_MAX;
+
+        // Sizes below c_slCount have a list each; larger sizes split each power of two into
+        // c_slCount lists.
+        static constexpr uint32_t c_slBits = 3;
+        static constexpr uint32_t c_slCount = 1u << c_slBits;
+        static constexpr uint32_t c_flCount = 32 - c_slBits + 1;
+
+        // Per-descriptor flags, set on the first and last descriptor of each block
+        static constexpr uint8_t c_start = 0x1;
+        static constexpr uint8_t c_end = 0x2;
+        static constexpr uint8_t c_free = 0x4;
+        static constexpr uint8_t c_pending = 0x8;
+
+        struct Frame
+        {
+            UINT64                  fenceValue;
+            std::vector<uint32_t>   blocks;
+        };
+
+        static uint32_t LowestBit(uint32_t mask) noexcept
+        {
+        #ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return index;
+        #else
+            return static_cast<uint32_t>(__builtin_ctz(mask));
+        #endif
+        }
+
+        static uint32_t HighestBit(uint32_t mask) noexcept
+        {
+        #ifdef _MSC_VER
+            unsigned long index;
+            _BitScanReverse(&index, mask);
+            return index;
+        #else
+            return static_cast<uint32_t>(31 - __builtin_clz(mask));
+        #endif
+        }
+
+        static void Mapping(uint32_t size, uint32_t& fl, uint32_t& sl) noexcept
+        {
+            if (size < c_slCount)
+            {
+                fl = 0;
+                sl = size;
+            }
+            else
+            {
+                const uint32_t log2 = HighestBit(size);
+                fl = log2 - c_slBits + 1;
+                sl = (size >> (log2 - c_slBits)) - c_slCount;
+            }
+        }
+
+        void InsertFree(uint32_t start, uint32_t size) noexcept
+        {
+            SetBlock(start, size, c_free);
+            m_tag[start + size - 1] = start;
+
+            uint32_t fl, sl;
+            Mapping(size, fl, sl);
+
+            m_prev[start] = c_none;
+            m_next[start] = m_heads[fl][sl];
+            if (m_next[start] != c_none)
+                m_prev[m_next[start]] = start;
+            m_heads[fl][sl] = start;
+
+            m_flBitmap |= 1u << fl;
+            m_slBitmap[fl] |= 1u << sl;
+            ++m_freeBlocks;
+        }
+
+        void RemoveFree(uint32_t start) noexcept
+        {
+            uint32_t fl, sl;
+            Mapping(m_size[start], fl, sl);
+
+            if (m_prev[start] != c_none)
+                m_next[m_prev[start]] = m_next[start];
+            else
+                m_heads[fl][sl] = m_next[start];
+
+            if (m_next[start] != c_none)
+                m_prev[m_next[start]] = m_prev[start];
+
+            if (m_heads[fl][sl] == c_none)
+            {
+                m_slBitmap[fl] &= ~(1u << sl);
+                if (!m_slBitmap[fl])
+                    m_flBitmap &= ~(1u << fl);
+            }
+
+            ClearBlock(start, m_size[start]);
+            --m_freeBlocks;
+        }
+
+        void SetBlock(uint32_t start, uint32_t size, uint8_t state) noexcept
+        {
+            m_size[start] = size;
+            m_flags[start] = c_start | state;
+            m_flags[start + size - 1] |= c_end | state;
+        }
+
+        void ClearBlock(uint32_t start, uint32_t size) noexcept
+        {
+            m_flags[start] = 0;
+            m_flags[start + size - 1] = 0;
+        }
+
+        bool AllocateBlock(size_t count, uint32_t& start)
+        {
+            if (!count)
+            {
+                throw std::invalid_argument("DescriptorAllocator cannot allocate zero descriptors");
+            }
+
+            if (count > m_capacity)
+                return false;
+
+            // Round up to the next list boundary, so any block in the list found is large enough
+            auto size = static_cast<uint32_t>(count);
+            uint32_t search = size;
+            if (search >= c_slCount)
+            {
+                search += (1u << (HighestBit(search) - c_slBits)) - 1;
+            }
+
+            uint32_t fl, sl;
+            Mapping(search, fl, sl);
+
+            uint32_t slMap = (fl < c_flCount) ? (m_slBitmap[fl] & (~0u << sl)) : 0;
+            if (!slMap)
+            {
+                const uint32_t flMap = (fl + 1 < 32) ? (m_flBitmap & (~0u << (fl + 1))) : 0;
+                if (!flMap)
+                {
+                    // Only a block in the rounded-down list can fit, so check the one at its head
+                    Mapping(size, fl, sl);
+                    start = m_heads[fl][sl];
+                    if (start == c_none || m_size[start] < size)
+                        return false;
+                }
+                else
+                {
+                    fl = LowestBit(flMap);
+                    slMap = m_slBitmap[fl];
+                }
+            }
+
+            if (slMap)
+            {
+                start = m_heads[fl][LowestBit(slMap)];
+            }
+
+            const uint32_t blockSize = m_size[start];
+            RemoveFree(start);
+
+            SetBlock(start, size, 0);
+            if (blockSize > size)
+            {
+                InsertFree(start + size, blockSize - size);
+            }
+
+            ++m_stats.allocations;
+            m_stats.allocated += size;
+            m_stats.peakAllocated = std::max(m_stats.peakAllocated, m_stats.allocated);
+            return true;
+        }
+
+        void FreeBlock(uint32_t start) noexcept
+        {
+            uint32_t size = m_size[start];
+            m_stats.allocated -= size;
+            ClearBlock(start, size);
+
+            if (start > 0 && (m_flags[start - 1] & c_free))
+            {
+                const uint32_t prev = m_tag[start - 1];
+                size += m_size[prev];
+                RemoveFree(prev);
+                start = prev;
+            }
+
+            const uint32_t next = start + size;
+            if (next < m_capacity && (m_flags[next] & c_free))
+            {
+                size += m_size[next];
+                RemoveFree(next);
+            }
+
+            InsertFree(start, size);
+        }
+
+        uint32_t GetAllocation(IndexType index) const
+        {
+            if (index < m_base || index - m_base >= m_capacity)
+            {
+                throw std::out_of_range("DescriptorAllocator index is not in its range");
+            }
+
+            const auto start = static_cast<uint32_t>(index - m_base);
+            if ((m_flags[start] & (c_start | c_free | c_pending)) != c_start)
+            {
+                throw std::invalid_argument("DescriptorAllocator index is not an allocation");
+            }
+
+            return start;
+        }
+
+        // Frees the blocks of the frames the GPU has finished. If 'wait' is set and none have
+        // finished, waits for the oldest. Returns false if there were no committed frames.
+        bool Reclaim(bool wait)
+        {
+            if (m_frames.empty())
+                return false;
+
+            UINT64 completed = m_fence->GetCompletedValue();
+            if (wait && completed < m_frames.front().fenceValue)
+            {
+                ThrowIfFailed(m_fence->SetEventOnCompletion(m_frames.front().fenceValue, m_fenceEvent.Get()));
+                std::ignore = WaitForSingleObjectEx(m_fenceEvent.Get(), INFINITE, FALSE);
+                ++m_stats.stalls;
+                completed = m_fence->GetCompletedValue();
+            }
+
+            while (!m_frames.empty() && m_frames.front().fenceValue <= completed)
+            {
+                for (auto it : m_frames.front().blocks)
+                {
+                    m_stats.pendingFree -= m_size[it];
+                    FreeBlock(it);
+                }
+                m_frames.pop_front();
+            }
+
+            return true;
+        }
+
+        DirectX::DescriptorPile&                m_pile;
+        IndexType                               m_base;
+        uint32_t                                m_capacity;
+
+        mutable std::mutex                      m_mutex;
+
+        uint32_t                                m_flBitmap;
+        uint32_t                                m_slBitmap[c_flCount];
+        uint32_t                                m_heads[c_flCount][c_slCount];
+        size_t                                  m_freeBlocks;
+
+        std::vector<uint8_t>                    m_flags;
+        std::vector<uint32_t>                   m_size;     // At the first descriptor of each block
+        std::vector<uint32_t>                   m_tag;      // At the last descriptor of a free block, its first
+        std::vector<uint32_t>                   m_next;     // Free list links
+        std::vector<uint32_t>                   m_prev;
+
+        std::vector<uint32_t>                   m_pending;
+        std::deque<Frame>                       m_frames;
+        Microsoft::WRL::ComPtr<ID3D12Fence>     m_fence;
+        Microsoft::WRL::Wrappers::Event         m_fenceEvent;
+        UINT64                                  m_fenceValue;
+
+        Statistics                              m_stats;
+    };
+}
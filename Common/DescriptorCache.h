@@ -0,0 +1,309 @@
+//
+// DescriptorCache.h - Shares descriptors between identical views through a DescriptorAllocator
+//
+
+#pragma once
+
+#include "DescriptorAllocator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <wrl/client.h>
+
+namespace DX
+{
+    // Writes each distinct view once. Identical requests, with the same resource and view
+    // description, get the descriptor already written, counted by reference; the last Release
+    // hands it back to the allocator with a deferred Free, so Commit the allocator as usual.
+    // Each cached view holds a reference on its resource, so the address in the key cannot be
+    // reused by another resource while the descriptor is live. All methods are thread-safe.
+    //
+    // Shader resource and constant buffer views need an allocator over a CBV_SRV_UAV pile, and
+    // samplers one over a sampler pile, so use a cache for each.
+    class DescriptorCache
+    {
+    public:
+        using IndexType = DescriptorAllocator::IndexType;
+
+        struct Statistics
+        {
+            size_t  views;          // Distinct live descriptors
+            size_t  references;     // Live references over all of them
+            UINT64  hits;
+            UINT64  misses;         // Each one a view added to the cache
+        };
+
+        DescriptorCache(_In_ ID3D12Device* device, DescriptorAllocator& allocator) :
+            m_device(device),
+            m_allocator(allocator),
+            m_stats{}
+        {
+            if (!device)
+            {
+                throw std::invalid_argument("DescriptorCache requires a device");
+            }
+        }
+
+        DescriptorCache(DescriptorCache const&) = delete;
+        DescriptorCache& operator= (DescriptorCache const&) = delete;
+
+        // A null 'desc' is the resource's default view, as for ID3D12Device::CreateShaderResourceView.
+        IndexType CreateShaderResourceView(_In_ ID3D12Resource* resource, _In_opt_ const D3D12_SHADER_RESOURCE_VIEW_DESC* desc = nullptr)
+        {
+            if (!resource)
+            {
+                throw std::invalid_argument("DescriptorCache requires a resource for a shader resource view");
+            }
+
+            Key key = {};
+            key.resource = resource;
+            key.kind = c_srv;
+            if (desc)
+            {
+                key.kind = c_srvDesc;
+                NormalizeDesc(*desc, key);
+            }
+
+            return Acquire(key, [&](D3D12_CPU_DESCRIPTOR_HANDLE handle)
+                {
+                    m_device->CreateShaderResourceView(resource, desc, handle);
+                });
+        }
+
+        IndexType CreateConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc)
+        {
+            Key key = {};
+            key.kind = c_cbv;
+            std::memcpy(key.desc, &desc.BufferLocation, sizeof(desc.BufferLocation));
+            std::memcpy(key.desc + sizeof(desc.BufferLocation), &desc.SizeInBytes, sizeof(desc.SizeInBytes));
+
+            return Acquire(key, [&](D3D12_CPU_DESCRIPTOR_HANDLE handle)
+                {
+                    m_device->CreateConstantBufferView(&desc, handle);
+                });
+        }
+
+        IndexType CreateSampler(const D3D12_SAMPLER_DESC& desc)
+        {
+            static_assert(sizeof(D3D12_SAMPLER_DESC) <= c_maxDesc, "Key is too small for D3D12_SAMPLER_DESC");
+
+            Key key = {};
+            key.kind = c_sampler;
+            std::memcpy(key.desc, &desc, sizeof(desc));
+
+            return Acquire(key, [&](D3D12_CPU_DESCRIPTOR_HANDLE handle)
+                {
+                    m_device->CreateSampler(&desc, handle);
+                });
+        }
+
+        // Adds a reference to a descriptor from this cache, as for a second copy of its index.
+        void AddRef(IndexType index)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto& entry = Find(index);
+            ++entry.second.refCount;
+            ++m_stats.references;
+        }
+
+        void Release(IndexType index)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto& entry = Find(index);
+            --m_stats.references;
+            if (--entry.second.refCount > 0)
+                return;
+
+            m_allocator.Free(index);
+
+            const Key key = entry.first;
+            m_indices.erase(index);
+            m_views.erase(key);
+            m_stats.views = m_views.size();
+        }
+
+        D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(IndexType index) const { return m_allocator.GetCpuHandle(index); }
+        D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(IndexType index) const { return m_allocator.GetGpuHandle(index); }
+
+        ID3D12DescriptorHeap* Heap() const noexcept { return m_allocator.Heap(); }
+
+        Statistics GetStatistics() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_stats;
+        }
+
+    private:
+        static constexpr uint32_t c_srv = 0;
+        static constexpr uint32_t c_srvDesc = 1;
+        static constexpr uint32_t c_cbv = 2;
+        static constexpr uint32_t c_sampler = 3;
+
+        static constexpr size_t c_maxDesc = 56;
+
+        // Built from zeroed memory with only the fields in use copied in, so that padding and the
+        // unused bytes of unions compare equal.
+        struct Key
+        {
+            ID3D12Resource*     resource;
+            uint32_t            kind;
+            uint32_t            reserved;
+            uint8_t             desc[c_maxDesc];
+
+            bool operator== (const Key& other) const noexcept
+            {
+                return resource == other.resource && kind == other.kind && std::memcmp(desc, other.desc, c_maxDesc) == 0;
+            }
+        };
+
+        struct KeyHash
+        {
+            size_t operator()(const Key& key) const noexcept
+            {
+                // FNV-1a
+                uint64_t hash = 14695981039346656037ull;
+                auto bytes = reinterpret_cast<const uint8_t*>(&key);
+                for (size_t j = 0; j < sizeof(Key); ++j)
+                {
+                    hash = (hash ^ bytes[j]) * 1099511628211ull;
+                }
+                return static_cast<size_t>(hash);
+            }
+        };
+
+        struct View
+        {
+            IndexType                               index;
+            size_t                                  refCount;
+            Microsoft::WRL::ComPtr<ID3D12Resource>  resource;
+        };
+
+        using ViewMap = std::unordered_map<Key, View, KeyHash>;
+
+        static void NormalizeDesc(const D3D12_SHADER_RESOURCE_VIEW_DESC& desc, Key& key)
+        {
+            static_assert(sizeof(D3D12_SHADER_RESOURCE_VIEW_DESC) <= c_maxDesc, "Key is too small for D3D12_SHADER_RESOURCE_VIEW_DESC");
+
+            D3D12_SHADER_RESOURCE_VIEW_DESC normal;
+            std::memset(&normal, 0, sizeof(normal));
+            normal.Format = desc.Format;
+            normal.ViewDimension = desc.ViewDimension;
+            normal.Shader4ComponentMapping = desc.Shader4ComponentMapping;
+
+            switch (desc.ViewDimension)
+            {
+            case D3D12_SRV_DIMENSION_BUFFER:
+                // Field by field, since the struct has tail padding
+                normal.Buffer.FirstElement = desc.Buffer.FirstElement;
+                normal.Buffer.NumElements = desc.Buffer.NumElements;
+                normal.Buffer.StructureByteStride = desc.Buffer.StructureByteStride;
+                normal.Buffer.Flags = desc.Buffer.Flags;
+                break;
+
+            case D3D12_SRV_DIMENSION_TEXTURE1D:         normal.Texture1D = desc.Texture1D; break;
+            case D3D12_SRV_DIMENSION_TEXTURE1DARRAY:    normal.Texture1DArray = desc.Texture1DArray; break;
+            case D3D12_SRV_DIMENSION_TEXTURE2D:         normal.Texture2D = desc.Texture2D; break;
+            case D3D12_SRV_DIMENSION_TEXTURE2DARRAY:    normal.Texture2DArray = desc.Texture2DArray; break;
+            case D3D12_SRV_DIMENSION_TEXTURE2DMS:       normal.Texture2DMS = desc.Texture2DMS; break;
+            case D3D12_SRV_DIMENSION_TEXTURE2DMSARRAY:  normal.Texture2DMSArray = desc.Texture2DMSArray; break;
+            case D3D12_SRV_DIMENSION_TEXTURE3D:         normal.Texture3D = desc.Texture3D; break;
+            case D3D12_SRV_DIMENSION_TEXTURECUBE:       normal.TextureCube = desc.TextureCube; break;
+            case D3D12_SRV_DIMENSION_TEXTURECUBEARRAY:  normal.TextureCubeArray = desc.TextureCubeArray; break;
+            case D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE:
+                normal.RaytracingAccelerationStructure = desc.RaytracingAccelerationStructure;
+                break;
+
+            default:
+                break;
+            }
+
+            std::memcpy(key.desc, &normal, sizeof(normal));
+        }
+
+        // Allocate can wait on the GPU, so a miss allocates and writes the view without the lock
+        // held, and then checks whether another thread added the same view meanwhile.
+        template<typename Write>
+        IndexType Acquire(const Key& key, Write write)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                auto it = m_views.find(key);
+                if (it != m_views.end())
+                    return Hit(it->second);
+            }
+
+            const IndexType index = m_allocator.Allocate();
+            try
+            {
+                write(m_allocator.GetCpuHandle(index));
+            }
+            catch (...)
+            {
+                m_allocator.FreeImmediate(index);
+                throw;
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto it = m_views.find(key);
+            if (it != m_views.end())
+            {
+                m_allocator.FreeImmediate(index);
+                return Hit(it->second);
+            }
+
+            try
+            {
+                m_indices.emplace(index, key);
+                m_views.emplace(key, View{ index, 1, key.resource });
+            }
+            catch (...)
+            {
+                m_indices.erase(index);
+                m_allocator.FreeImmediate(index);
+                throw;
+            }
+
+            ++m_stats.misses;
+            ++m_stats.references;
+            m_stats.views = m_views.size();
+            return index;
+        }
+
+        // Called with the mutex held.
+        IndexType Hit(View& view) noexcept
+        {
+            ++m_stats.hits;
+            ++m_stats.references;
+            ++view.refCount;
+            return view.index;
+        }
+
+        ViewMap::value_type& Find(IndexType index)
+        {
+            auto it = m_indices.find(index);
+            if (it == m_indices.end())
+            {
+                throw std::out_of_range("Descriptor is not from this DescriptorCache");
+            }
+
+            return *m_views.find(it->second);
+        }
+
+        ID3D12Device*                           m_device;
+        DescriptorAllocator&                    m_allocator;
+
+        mutable std::mutex                      m_mutex;
+        ViewMap                                 m_views;
+        std::unordered_map<IndexType, Key>      m_indices;
+        Statistics                              m_stats;
+    };
+}
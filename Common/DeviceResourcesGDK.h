@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "CommandListPool.h"
+
 namespace DX
 {
     // Provides an interface for an application that owns DeviceResources to be notified of the device being lost or created.
@@ -55,6 +57,15 @@ namespace DX
 #endif
         void UpdateColorSpace() noexcept {};
 
+        // Records 'count' items across worker threads, each into its own command list (see
+        // CommandListPool::Record). The workers' lists are submitted in order after the commands
+        // recorded so far, and GetCommandList returns a new list for the commands that follow.
+        template<typename Fn>
+        void RecordParallel(size_t count, const Fn& fn)
+        {
+            m_commandListPool.Record(m_commandList, m_commandAllocators[m_backBufferIndex].Get(), m_backBufferIndex, count, fn);
+        }
+
         // Direct3D Properties.
         void SetClearColor(_In_reads_(4) const float* rgba) noexcept { memcpy(m_clearColor, rgba, sizeof(m_clearColor)); }
 
@@ -74,6 +85,8 @@ namespace DX
         ID3D12CommandQueue*         GetCommandQueue() const noexcept       { return m_commandQueue.Get(); }
         ID3D12CommandAllocator*     GetCommandAllocator() const noexcept   { return m_commandAllocators[m_backBufferIndex].Get(); }
         auto                        GetCommandList() const noexcept        { return m_commandList.Get(); }
+        unsigned int                GetWorkerCount() const noexcept        { return m_commandListPool.GetWorkerCount(); }
+        const std::vector<double>&  GetWorkerRecordTimes() const noexcept  { return m_commandListPool.GetRecordTimes(); }
         DXGI_FORMAT                 GetBackBufferFormat() const noexcept   { return m_backBufferFormat; }
         DXGI_FORMAT                 GetDepthBufferFormat() const noexcept  { return m_depthBufferFormat; }
         D3D12_VIEWPORT              GetScreenViewport() const noexcept     { return m_screenViewport; }
@@ -110,6 +123,7 @@ namespace DX
         Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>   m_commandList;
         Microsoft::WRL::ComPtr<ID3D12CommandQueue>          m_commandQueue;
         Microsoft::WRL::ComPtr<ID3D12CommandAllocator>      m_commandAllocators[MAX_BACK_BUFFER_COUNT];
+        CommandListPool<>                                   m_commandListPool;
 
         // Swap chain objects.
 #ifdef _GAMING_DESKTOP
@@ -165,6 +165,9 @@ void DeviceResources::CreateDeviceResources()
 
     m_commandList->SetName(L"DeviceResources");
 
+    // Worker command lists for RecordParallel are created on first use.
+    m_commandListPool.Create(m_d3dDevice.Get(), m_backBufferCount);
+
     // Create a fence for tracking GPU execution progress.
     ThrowIfFailed(m_d3dDevice->CreateFence(m_fenceValue, D3D12_FENCE_FLAG_NONE, IID_GRAPHICS_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
     m_fenceValue++;
@@ -417,7 +420,7 @@ void DeviceResources::Present(D3D12_RESOURCE_STATES beforeState, _In_opt_ const
 
     // Send the command list off to the GPU for processing.
     ThrowIfFailed(m_commandList->Close());
-    m_commandQueue->ExecuteCommandLists(1, CommandListCast(m_commandList.GetAddressOf()));
+    m_commandListPool.Execute(m_commandQueue.Get(), m_commandList.Get());
 
     // Present the backbuffer using the PresentX API.
     D3D12XBOX_PRESENT_PLANE_PARAMETERS planeParameters[2] = {};
@@ -288,6 +288,9 @@ void DeviceResources::CreateDeviceResources()
 
     m_commandList->SetName(L"DeviceResources");
 
+    // Worker command lists for RecordParallel are created on first use.
+    m_commandListPool.Create(m_d3dDevice.Get(), m_backBufferCount);
+
     // Create a fence for tracking GPU execution progress.
     ThrowIfFailed(m_d3dDevice->CreateFence(m_fenceValues[m_backBufferIndex], D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
     m_fenceValues[m_backBufferIndex]++;
@@ -612,6 +615,7 @@ void DeviceResources::HandleDeviceLost()
     m_depthStencil.Reset();
     m_commandQueue.Reset();
     m_commandList.Reset();
+    m_commandListPool.Release();
     m_fence.Reset();
     m_rtvDescriptorHeap.Reset();
     m_dsvDescriptorHeap.Reset();
@@ -669,7 +673,7 @@ void DeviceResources::Present(D3D12_RESOURCE_STATES beforeState)
 
     // Send the command list off to the GPU for processing.
     ThrowIfFailed(m_commandList->Close());
-    m_commandQueue->ExecuteCommandLists(1, CommandListCast(m_commandList.GetAddressOf()));
+    m_commandListPool.Execute(m_commandQueue.Get(), m_commandList.Get());
 
     HRESULT hr;
     if (m_options & c_AllowTearing)
@@ -0,0 +1,747 @@
+//
+// FileReadQueue.h - Batched, prioritized file reads on a thread pool
+//
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <wrl/wrappers/corewrappers.h>
+#else
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace DX
+{
+    // Requests name a range of an opened file and where to put it. They collect until Submit,
+    // which sorts them by priority and then position, and merges requests that are adjacent in
+    // the same file into one read of up to 'maxReadSize' bytes. A merged read goes straight to
+    // the destination when the requests' destinations are contiguous too, and otherwise through
+    // a scratch buffer on the worker thread.
+    //
+    // Each request's callback runs on a worker thread with the result of its read. Submit returns
+    // a fence value that completes once every request in the batch and the batches before it have
+    // finished; EnqueueSignal also signals a D3D12 fence at that point. Reads use overlapped
+    // ReadFile on Windows, with several outstanding per worker thread, and pread elsewhere.
+    class FileReadQueue
+    {
+    public:
+        using FileId = uint32_t;
+        using Callback = std::function<void(HRESULT)>;
+
+        struct Request
+        {
+            FileId      file;
+            UINT64      offset;
+            size_t      size;
+            void*       destination;
+            int         priority;       // Higher priorities are read first
+            Callback    callback;       // Optional; must not throw
+        };
+
+        struct Statistics
+        {
+            UINT64  requests;
+            UINT64  reads;              // Reads issued after merging adjacent requests
+            UINT64  bytesRead;
+            UINT64  failedReads;
+            UINT64  batches;
+            double  readTime;           // Milliseconds, summed over the reads
+        };
+
+        static constexpr unsigned int c_defaultThreads = 4;
+        static constexpr size_t c_defaultMaxReadSize = 4 * 1024 * 1024;
+
+        explicit FileReadQueue(unsigned int threadCount = c_defaultThreads, size_t maxReadSize = c_defaultMaxReadSize) :
+            m_maxReadSize(std::max<size_t>(maxReadSize, 1)),
+            m_sequence(0),
+            m_submitted(0),
+            m_completed(0),
+            m_stop(false),
+            m_stats{}
+        {
+            threadCount = std::max(1u, threadCount);
+            m_threads.reserve(threadCount);
+            for (unsigned int j = 0; j < threadCount; ++j)
+                m_threads.emplace_back(&FileReadQueue::Run, this);
+        }
+
+        // Finishes the submitted batches. Requests enqueued but not submitted are dropped.
+        ~FileReadQueue()
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_done.wait(lock, [this] { return m_completed == m_submitted; });
+                m_stop = true;
+            }
+            m_wake.notify_all();
+
+            for (auto& it : m_threads)
+                it.join();
+        }
+
+        FileReadQueue(FileReadQueue const&) = delete;
+        FileReadQueue& operator= (FileReadQueue const&) = delete;
+
+        FileId Open(_In_z_ const wchar_t* fileName)
+        {
+            auto file = std::make_shared<File>(fileName);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (size_t j = 0; j < m_files.size(); ++j)
+            {
+                if (!m_files[j])
+                {
+                    m_files[j] = std::move(file);
+                    return static_cast<FileId>(j);
+                }
+            }
+
+            m_files.emplace_back(std::move(file));
+            return static_cast<FileId>(m_files.size() - 1);
+        }
+
+        // Reads already submitted for the file still complete.
+        void Close(FileId file)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            GetFile(file).reset();
+        }
+
+        UINT64 GetFileSize(FileId file) const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return GetFile(file)->size;
+        }
+
+        void Enqueue(Request request)
+        {
+            if (!request.destination && request.size > 0)
+            {
+                throw std::invalid_argument("FileReadQueue request needs a destination");
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto& file = GetFile(request.file);
+            if (request.offset > file->size || request.size > file->size - request.offset)
+            {
+                throw std::out_of_range("FileReadQueue request is past the end of the file");
+            }
+
+            m_pending.push_back({ std::move(request), file });
+        }
+
+        // Signals 'fence' to 'value' from the CPU when the next batch submitted completes.
+        void EnqueueSignal(_In_ ID3D12Fence* fence, UINT64 value)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pendingSignals.push_back({ fence, value, 0 });
+        }
+
+        UINT64 Submit()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            const UINT64 batch = ++m_submitted;
+            ++m_stats.batches;
+            m_stats.requests += m_pending.size();
+
+            for (auto& it : m_pendingSignals)
+            {
+                it.batch = batch;
+                m_signals.emplace_back(std::move(it));
+            }
+            m_pendingSignals.clear();
+
+            std::sort(m_pending.begin(), m_pending.end(), [](const Pending& pa, const Pending& pb)
+                {
+                    const auto& a = pa.request;
+                    const auto& b = pb.request;
+                    if (a.priority != b.priority)
+                        return a.priority > b.priority;
+                    if (pa.file != pb.file)
+                        return std::less<File*>()(pa.file.get(), pb.file.get());
+                    return a.offset < b.offset;
+                });
+
+            size_t reads = 0;
+            for (size_t j = 0; j < m_pending.size();)
+            {
+                auto& request = m_pending[j].request;
+
+                auto read = std::make_unique<Read>();
+                read->file = std::move(m_pending[j].file);
+                read->offset = request.offset;
+                read->size = request.size;
+                read->direct = static_cast<uint8_t*>(request.destination);
+                read->priority = request.priority;
+                read->sequence = ++m_sequence;
+                read->batch = batch;
+                read->requests.emplace_back(std::move(request));
+
+                for (++j; j < m_pending.size(); ++j)
+                {
+                    const auto& next = m_pending[j].request;
+                    if (next.priority != read->priority
+                        || m_pending[j].file != read->file
+                        || next.offset != read->offset + read->size
+                        || next.size > m_maxReadSize - std::min(m_maxReadSize, read->size))
+                        break;
+
+                    if (read->direct && static_cast<uint8_t*>(next.destination) != read->direct + read->size)
+                    {
+                        read->direct = nullptr;
+                    }
+
+                    read->size += next.size;
+                    read->requests.emplace_back(std::move(m_pending[j].request));
+                }
+
+                m_queue.emplace_back(std::move(read));
+                std::push_heap(m_queue.begin(), m_queue.end(), ReadOrder());
+                ++reads;
+            }
+            m_pending.clear();
+
+            if (!reads)
+            {
+                // Nothing to read, so the batch completes once those before it do
+                m_remaining.push_back({ batch, 0 });
+                Retire();
+                return batch;
+            }
+
+            m_remaining.push_back({ batch, reads });
+            lock.unlock();
+
+            if (reads == 1)
+                m_wake.notify_one();
+            else
+                m_wake.notify_all();
+
+            return batch;
+        }
+
+        bool IsComplete(UINT64 fenceValue) const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_completed >= fenceValue;
+        }
+
+        void Wait(UINT64 fenceValue)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this, fenceValue] { return m_completed >= fenceValue; });
+        }
+
+        void WaitIdle()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this] { return m_completed == m_submitted; });
+        }
+
+        Statistics GetStatistics() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_stats;
+        }
+
+        void ResetStatistics()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats = {};
+        }
+
+    private:
+        struct File
+        {
+            explicit File(_In_z_ const wchar_t* fileName) : size(0)
+            {
+            #ifdef _WIN32
+                CREATEFILE2_EXTENDED_PARAMETERS params = {};
+                params.dwSize = sizeof(CREATEFILE2_EXTENDED_PARAMETERS);
+                params.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+                params.dwFileFlags = FILE_FLAG_OVERLAPPED;
+
+                handle.Attach(CreateFile2(fileName, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, &params));
+                if (!handle.IsValid())
+                {
+                    throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "CreateFile2");
+                }
+
+                FILE_STANDARD_INFO info = {};
+                if (!GetFileInformationByHandleEx(handle.Get(), FileStandardInfo, &info, sizeof(info)))
+                {
+                    throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "GetFileInformationByHandleEx");
+                }
+
+                size = static_cast<UINT64>(info.EndOfFile.QuadPart);
+            #else
+                const size_t len = wcstombs(nullptr, fileName, 0);
+                if (len == size_t(-1))
+                {
+                    throw std::invalid_argument("FileReadQueue cannot convert the file name");
+                }
+
+                std::vector<char> path(len + 1);
+                std::ignore = wcstombs(path.data(), fileName, path.size());
+
+                fd = open(path.data(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0)
+                {
+                    throw std::system_error(std::error_code(errno, std::generic_category()), "open");
+                }
+
+                struct stat st = {};
+                if (fstat(fd, &st) != 0)
+                {
+                    const int error = errno;
+                    close(fd);
+                    throw std::system_error(std::error_code(error, std::generic_category()), "fstat");
+                }
+
+                size = static_cast<UINT64>(st.st_size);
+            #endif
+            }
+
+            File(File const&) = delete;
+            File& operator= (File const&) = delete;
+
+        #ifdef _WIN32
+            Microsoft::WRL::Wrappers::FileHandle    handle;
+        #else
+            ~File() { close(fd); }
+
+            int                                     fd;
+        #endif
+            UINT64                                  size;
+        };
+
+        // Holds the file so it can be closed before the request is submitted.
+        struct Pending
+        {
+            Request                 request;
+            std::shared_ptr<File>   file;
+        };
+
+        struct Read
+        {
+            std::shared_ptr<File>   file;
+            UINT64                  offset;
+            size_t                  size;
+            uint8_t*                direct;     // Null when the destinations are not contiguous
+            int                     priority;
+            UINT64                  sequence;
+            UINT64                  batch;
+            std::vector<Request>    requests;
+        };
+
+        // Heap order: highest priority first, then first submitted.
+        struct ReadOrder
+        {
+            bool operator()(const std::unique_ptr<Read>& a, const std::unique_ptr<Read>& b) const noexcept
+            {
+                if (a->priority != b->priority)
+                    return a->priority < b->priority;
+                return a->sequence > b->sequence;
+            }
+        };
+
+        struct Batch
+        {
+            UINT64  batch;
+            size_t  reads;
+        };
+
+        struct FenceSignal
+        {
+            Microsoft::WRL::ComPtr<ID3D12Fence> fence;
+            UINT64                              value;
+            UINT64                              batch;
+        };
+
+    #ifdef _WIN32
+        static constexpr size_t c_readsInFlight = 4;
+
+        // An overlapped read outstanding on a worker thread, issued in chunks that fit a DWORD.
+        struct Slot
+        {
+            Microsoft::WRL::Wrappers::Event         event;
+            OVERLAPPED                              overlapped = {};
+            std::unique_ptr<Read>                   read;
+            std::vector<uint8_t>                    scratch;
+            uint8_t*                                dest = nullptr;
+            size_t                                  completed = 0;
+            DWORD                                   chunk = 0;
+            std::chrono::steady_clock::time_point   start;
+        };
+    #endif
+
+        std::shared_ptr<File>& GetFile(FileId file)
+        {
+            if (file >= m_files.size() || !m_files[file])
+            {
+                throw std::invalid_argument("FileReadQueue file is not open");
+            }
+            return m_files[file];
+        }
+
+        const std::shared_ptr<File>& GetFile(FileId file) const
+        {
+            return const_cast<FileReadQueue*>(this)->GetFile(file);
+        }
+
+    #ifdef _WIN32
+        // Each worker keeps up to c_readsInFlight overlapped reads outstanding, each with its own
+        // event, and waits for whichever completes first. If no event can be created, the reads
+        // the worker takes fail with that error rather than being issued.
+        void Run()
+        {
+            Slot slots[c_readsInFlight];
+            size_t slotCount = 0;
+            HRESULT eventError = S_OK;
+            for (auto& it : slots)
+            {
+                it.event.Attach(CreateEventEx(nullptr, nullptr, CREATE_EVENT_MANUAL_RESET, EVENT_MODIFY_STATE | SYNCHRONIZE));
+                if (!it.event.IsValid())
+                {
+                    eventError = HRESULT_FROM_WIN32(GetLastError());
+                    break;
+                }
+                ++slotCount;
+            }
+
+            if (!slotCount)
+            {
+                for (;;)
+                {
+                    auto read = Pop(true);
+                    if (!read)
+                        return;
+
+                    Finish(*read, eventError, nullptr, 0.0);
+                }
+            }
+
+            HANDLE events[c_readsInFlight] = {};
+            size_t waiting[c_readsInFlight] = {};
+
+            for (;;)
+            {
+                size_t inFlight = 0;
+                for (size_t j = 0; j < slotCount; ++j)
+                {
+                    if (slots[j].read)
+                        ++inFlight;
+                }
+
+                // Fill the free slots, only waiting for work when nothing is in flight
+                bool stopping = false;
+                for (size_t j = 0; j < slotCount; ++j)
+                {
+                    if (slots[j].read)
+                        continue;
+
+                    auto read = Pop(!inFlight);
+                    if (!read)
+                    {
+                        stopping = !inFlight;
+                        break;
+                    }
+
+                    Start(slots[j], std::move(read));
+                    if (slots[j].read)
+                        ++inFlight;
+                }
+
+                if (!inFlight)
+                {
+                    if (stopping)
+                        return;
+                    continue;
+                }
+
+                size_t count = 0;
+                for (size_t j = 0; j < slotCount; ++j)
+                {
+                    if (slots[j].read)
+                    {
+                        events[count] = slots[j].event.Get();
+                        waiting[count++] = j;
+                    }
+                }
+
+                // If the wait itself fails, block on the oldest slot's read instead
+                const DWORD result = WaitForMultipleObjects(static_cast<DWORD>(count), events, FALSE, INFINITE);
+                const bool signaled = (result >= WAIT_OBJECT_0 && result < WAIT_OBJECT_0 + count);
+                Continue(slots[waiting[signaled ? (result - WAIT_OBJECT_0) : 0]], !signaled);
+            }
+        }
+
+        // Takes a read into a free slot and issues its first chunk.
+        void Start(Slot& slot, std::unique_ptr<Read> read)
+        {
+            slot.start = std::chrono::steady_clock::now();
+            slot.completed = 0;
+            slot.dest = read->direct;
+            if (!slot.dest)
+            {
+                try
+                {
+                    slot.scratch.resize(read->size);
+                }
+                catch (const std::bad_alloc&)
+                {
+                    Finish(*read, E_OUTOFMEMORY, nullptr, 0.0);
+                    return;
+                }
+                slot.dest = slot.scratch.data();
+            }
+
+            if (!read->size)
+            {
+                Finish(*read, S_OK, slot.dest, 0.0);
+                return;
+            }
+
+            slot.read = std::move(read);
+
+            const HRESULT hr = IssueChunk(slot);
+            if (FAILED(hr))
+                Complete(slot, hr);
+        }
+
+        // Collects the result of the slot's outstanding chunk, and issues the next or completes the read.
+        void Continue(Slot& slot, bool wait)
+        {
+            DWORD bytesRead = 0;
+            HRESULT hr = S_OK;
+            if (!GetOverlappedResult(slot.read->file->handle.Get(), &slot.overlapped, &bytesRead, wait ? TRUE : FALSE))
+            {
+                hr = HRESULT_FROM_WIN32(GetLastError());
+            }
+            else if (bytesRead != slot.chunk)
+            {
+                hr = HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+            }
+            else
+            {
+                slot.completed += bytesRead;
+                if (slot.completed < slot.read->size)
+                {
+                    hr = IssueChunk(slot);
+                    if (SUCCEEDED(hr))
+                        return;
+                }
+            }
+
+            Complete(slot, hr);
+        }
+
+        static HRESULT IssueChunk(Slot& slot)
+        {
+            const UINT64 offset = slot.read->offset + slot.completed;
+
+            // ReadFile takes a DWORD count
+            slot.chunk = static_cast<DWORD>(std::min<size_t>(slot.read->size - slot.completed, 1u << 30));
+
+            slot.overlapped = {};
+            slot.overlapped.Offset = static_cast<DWORD>(offset);
+            slot.overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            slot.overlapped.hEvent = slot.event.Get();
+
+            // The event is signaled whether the read completes now or later
+            if (!ReadFile(slot.read->file->handle.Get(), slot.dest + slot.completed, slot.chunk, nullptr, &slot.overlapped))
+            {
+                const DWORD error = GetLastError();
+                if (error != ERROR_IO_PENDING)
+                    return HRESULT_FROM_WIN32(error);
+            }
+
+            return S_OK;
+        }
+
+        void Complete(Slot& slot, HRESULT hr)
+        {
+            const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - slot.start).count();
+
+            auto read = std::move(slot.read);
+            Finish(*read, hr, slot.dest, elapsed);
+        }
+    #else
+        void Run()
+        {
+            std::vector<uint8_t> scratch;
+
+            for (;;)
+            {
+                auto read = Pop(true);
+                if (!read)
+                    return;
+
+                auto start = std::chrono::steady_clock::now();
+
+                uint8_t* dest = read->direct;
+                if (!dest)
+                {
+                    scratch.resize(read->size);
+                    dest = scratch.data();
+                }
+
+                const HRESULT hr = ReadAt(*read->file, read->offset, dest, read->size);
+
+                const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                Finish(*read, hr, dest, elapsed);
+            }
+        }
+    #endif
+
+        // Takes the next read, waiting for one if 'wait' is set. Returns null if there is none, or
+        // when the queue is stopping.
+        std::unique_ptr<Read> Pop(bool wait)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (wait)
+                m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+
+            if (m_queue.empty())
+                return nullptr;
+
+            std::pop_heap(m_queue.begin(), m_queue.end(), ReadOrder());
+            auto read = std::move(m_queue.back());
+            m_queue.pop_back();
+            return read;
+        }
+
+        // Copies a merged read from the scratch buffer 'data' to its requests, runs their callbacks,
+        // and retires the read.
+        void Finish(const Read& read, HRESULT hr, _In_opt_ const uint8_t* data, double elapsed)
+        {
+            if (SUCCEEDED(hr) && !read.direct)
+            {
+                for (const auto& it : read.requests)
+                {
+                    if (it.size > 0)
+                        memcpy(it.destination, data + (it.offset - read.offset), it.size);
+                }
+            }
+
+            for (const auto& it : read.requests)
+            {
+                if (it.callback)
+                    it.callback(hr);
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            ++m_stats.reads;
+            m_stats.readTime += elapsed;
+            if (SUCCEEDED(hr))
+                m_stats.bytesRead += read.size;
+            else
+                ++m_stats.failedReads;
+
+            for (auto& it : m_remaining)
+            {
+                if (it.batch == read.batch)
+                {
+                    --it.reads;
+                    break;
+                }
+            }
+
+            Retire();
+        }
+
+        // Advances the completed fence value past every finished batch at the front, and signals
+        // the D3D12 fences that are now due before any waiter can see it. Called with the mutex held.
+        void Retire()
+        {
+            const UINT64 completed = m_completed;
+            while (!m_remaining.empty() && !m_remaining.front().reads)
+            {
+                m_completed = m_remaining.front().batch;
+                m_remaining.pop_front();
+            }
+
+            if (m_completed == completed)
+                return;
+
+            while (!m_signals.empty() && m_signals.front().batch <= m_completed)
+            {
+                std::ignore = m_signals.front().fence->Signal(m_signals.front().value);
+                m_signals.pop_front();
+            }
+
+            m_done.notify_all();
+        }
+
+    #ifndef _WIN32
+        static HRESULT ReadAt(const File& file, UINT64 offset, _Out_writes_bytes_(size) uint8_t* dest, size_t size)
+        {
+            while (size > 0)
+            {
+                const ssize_t bytesRead = pread(file.fd, dest, size, static_cast<off_t>(offset));
+                if (bytesRead < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    return E_FAIL;
+                }
+
+                if (!bytesRead)
+                    return E_FAIL;
+
+                offset += static_cast<UINT64>(bytesRead);
+                dest += bytesRead;
+                size -= static_cast<size_t>(bytesRead);
+            }
+
+            return S_OK;
+        }
+    #endif
+
+        size_t                                      m_maxReadSize;
+
+        mutable std::mutex                          m_mutex;
+        std::condition_variable                     m_wake;
+        std::condition_variable                     m_done;
+
+        std::vector<std::shared_ptr<File>>          m_files;
+        std::vector<Pending>                        m_pending;
+        std::vector<FenceSignal>                    m_pendingSignals;
+        std::vector<std::unique_ptr<Read>>          m_queue;
+        std::deque<Batch>                           m_remaining;
+        std::deque<FenceSignal>                     m_signals;
+
+        UINT64                                      m_sequence;
+        UINT64                                      m_submitted;
+        UINT64                                      m_completed;
+        bool                                        m_stop;
+        Statistics                                  m_stats;
+
+        std::vector<std::thread>                    m_threads;
+    };
+}
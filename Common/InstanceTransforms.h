@@ -0,0 +1,234 @@
+//--------------------------------------------------------------------------------------
+// File: InstanceTransforms.h
+//
+// Helpers for packing per-instance transforms into the XMFLOAT3X4 rows read by
+// DrawInstanced, optionally across several threads
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "GraphicsMemory.h"
+
+namespace DX
+{
+    // Below this many instances per thread, the cost of starting threads outweighs the packing.
+    constexpr size_t c_minParallelInstances = 16384;
+
+    namespace Internal
+    {
+        // Calls fn(begin, end) over contiguous ranges of [0, count), on up to 'threadCount' threads
+        // including the calling thread, or one per core if it is zero.
+        template<typename Fn>
+        void ForEachInstanceRange(size_t count, unsigned int threadCount, const Fn& fn)
+        {
+            if (!threadCount)
+            {
+                threadCount = std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            const size_t chunks = std::min<size_t>(threadCount, count / c_minParallelInstances);
+            if (chunks <= 1)
+            {
+                fn(size_t(0), count);
+                return;
+            }
+
+            const size_t perChunk = (count + chunks - 1) / chunks;
+
+            std::atomic<size_t> next(0);
+            auto worker = [&]()
+                {
+                    for (size_t j = next++; j < chunks; j = next++)
+                    {
+                        const size_t begin = j * perChunk;
+                        fn(begin, std::min(begin + perChunk, count));
+                    }
+                };
+
+            std::vector<std::thread> threads;
+            threads.reserve(chunks - 1);
+            for (size_t j = 1; j < chunks; ++j)
+                threads.emplace_back(worker);
+
+            worker();
+
+            for (auto& it : threads)
+                it.join();
+        }
+
+        // XMStoreFloat3x4 transposes the matrix with SIMD shuffles. Upload heap memory is
+        // write-combined, so each instance is written as three whole 16-byte rows, in order.
+        inline void XM_CALLCONV StoreInstance(_Out_ DirectX::XMFLOAT3X4* dest, DirectX::FXMMATRIX m, bool aligned) noexcept
+        {
+            if (aligned)
+                DirectX::XMStoreFloat3x4A(reinterpret_cast<DirectX::XMFLOAT3X4A*>(dest), m);
+            else
+                DirectX::XMStoreFloat3x4(dest, m);
+        }
+    }
+
+    // Writes 'transforms[j] * world' for each instance.
+    inline void XM_CALLCONV PackInstanceTransforms(
+        _Out_writes_(count) DirectX::XMFLOAT3X4* dest,
+        _In_reads_(count) const DirectX::XMMATRIX* transforms,
+        size_t count,
+        DirectX::FXMMATRIX world,
+        unsigned int threadCount = 1)
+    {
+        using namespace DirectX;
+
+        const bool aligned = !(reinterpret_cast<uintptr_t>(dest) & 15);
+        const bool identity = XMMatrixIsIdentity(world);
+        const XMMATRIX w = world;
+
+        Internal::ForEachInstanceRange(count, threadCount, [=](size_t begin, size_t end)
+            {
+                for (size_t j = begin; j < end; ++j)
+                {
+                    const XMMATRIX m = identity ? transforms[j] : XMMatrixMultiply(transforms[j], w);
+                    Internal::StoreInstance(dest + j, m, aligned);
+                }
+            });
+    }
+
+    // Writes 'scale * rotation * translation * world' for each instance. Strides are in bytes, as
+    // for the DirectXMath stream functions, and a stride of zero uses the same element for every
+    // instance. Missing rotations or scales are the identity.
+    inline void XM_CALLCONV PackInstanceTransforms(
+        _Out_writes_(count) DirectX::XMFLOAT3X4* dest,
+        _In_ const DirectX::XMFLOAT3* positions, size_t positionStride,
+        _In_opt_ const DirectX::XMFLOAT4* rotations, size_t rotationStride,
+        _In_opt_ const DirectX::XMFLOAT3* scales, size_t scaleStride,
+        size_t count,
+        DirectX::FXMMATRIX world,
+        unsigned int threadCount = 1)
+    {
+        using namespace DirectX;
+
+        const bool aligned = !(reinterpret_cast<uintptr_t>(dest) & 15);
+        const bool identity = XMMatrixIsIdentity(world);
+        const XMMATRIX w = world;
+
+        auto position = reinterpret_cast<const uint8_t*>(positions);
+        auto rotation = reinterpret_cast<const uint8_t*>(rotations);
+        auto scale = reinterpret_cast<const uint8_t*>(scales);
+
+        Internal::ForEachInstanceRange(count, threadCount, [=](size_t begin, size_t end)
+            {
+                for (size_t j = begin; j < end; ++j)
+                {
+                    XMMATRIX m = rotation
+                        ? XMMatrixRotationQuaternion(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(rotation + j * rotationStride)))
+                        : XMMatrixIdentity();
+
+                    if (scale)
+                    {
+                        const XMVECTOR s = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(scale + j * scaleStride));
+                        m.r[0] = XMVectorMultiply(m.r[0], XMVectorSplatX(s));
+                        m.r[1] = XMVectorMultiply(m.r[1], XMVectorSplatY(s));
+                        m.r[2] = XMVectorMultiply(m.r[2], XMVectorSplatZ(s));
+                    }
+
+                    m.r[3] = XMVectorSelect(g_XMIdentityR3,
+                        XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(position + j * positionStride)),
+                        g_XMSelect1110);
+
+                    if (!identity)
+                        m = XMMatrixMultiply(m, w);
+
+                    Internal::StoreInstance(dest + j, m, aligned);
+                }
+            });
+    }
+
+    // Writes 'local * translation * world' for each instance, where 'local' is shared by every
+    // instance and has no projection.
+    inline void XM_CALLCONV PackInstanceTransforms(
+        _Out_writes_(count) DirectX::XMFLOAT3X4* dest,
+        _In_ const DirectX::XMFLOAT3* positions, size_t positionStride,
+        DirectX::FXMMATRIX local,
+        size_t count,
+        DirectX::CXMMATRIX world,
+        unsigned int threadCount = 1)
+    {
+        using namespace DirectX;
+
+        const bool aligned = !(reinterpret_cast<uintptr_t>(dest) & 15);
+        const bool identity = XMMatrixIsIdentity(world);
+        const XMMATRIX l = local;
+        const XMMATRIX w = world;
+
+        auto position = reinterpret_cast<const uint8_t*>(positions);
+
+        Internal::ForEachInstanceRange(count, threadCount, [=](size_t begin, size_t end)
+            {
+                for (size_t j = begin; j < end; ++j)
+                {
+                    XMMATRIX m = l;
+                    m.r[3] = XMVectorAdd(l.r[3],
+                        XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(position + j * positionStride)));
+
+                    if (!identity)
+                        m = XMMatrixMultiply(m, w);
+
+                    Internal::StoreInstance(dest + j, m, aligned);
+                }
+            });
+    }
+
+    // Packs the transforms straight into a new upload heap allocation, ready to bind as an
+    // instance vertex buffer with a stride of sizeof(XMFLOAT3X4).
+    inline DirectX::GraphicsResource XM_CALLCONV AllocateInstanceTransforms(
+        DirectX::GraphicsMemory& memory,
+        _In_reads_(count) const DirectX::XMMATRIX* transforms,
+        size_t count,
+        DirectX::FXMMATRIX world,
+        unsigned int threadCount = 1)
+    {
+        DirectX::GraphicsResource result = memory.Allocate(std::max<size_t>(count, 1) * sizeof(DirectX::XMFLOAT3X4));
+        PackInstanceTransforms(static_cast<DirectX::XMFLOAT3X4*>(result.Memory()), transforms, count, world, threadCount);
+        return result;
+    }
+
+    inline DirectX::GraphicsResource XM_CALLCONV AllocateInstanceTransforms(
+        DirectX::GraphicsMemory& memory,
+        _In_ const DirectX::XMFLOAT3* positions, size_t positionStride,
+        _In_opt_ const DirectX::XMFLOAT4* rotations, size_t rotationStride,
+        _In_opt_ const DirectX::XMFLOAT3* scales, size_t scaleStride,
+        size_t count,
+        DirectX::FXMMATRIX world,
+        unsigned int threadCount = 1)
+    {
+        DirectX::GraphicsResource result = memory.Allocate(std::max<size_t>(count, 1) * sizeof(DirectX::XMFLOAT3X4));
+        PackInstanceTransforms(static_cast<DirectX::XMFLOAT3X4*>(result.Memory()),
+            positions, positionStride, rotations, rotationStride, scales, scaleStride,
+            count, world, threadCount);
+        return result;
+    }
+
+    inline DirectX::GraphicsResource XM_CALLCONV AllocateInstanceTransforms(
+        DirectX::GraphicsMemory& memory,
+        _In_ const DirectX::XMFLOAT3* positions, size_t positionStride,
+        DirectX::FXMMATRIX local,
+        size_t count,
+        DirectX::CXMMATRIX world,
+        unsigned int threadCount = 1)
+    {
+        DirectX::GraphicsResource result = memory.Allocate(std::max<size_t>(count, 1) * sizeof(DirectX::XMFLOAT3X4));
+        PackInstanceTransforms(static_cast<DirectX::XMFLOAT3X4*>(result.Memory()),
+            positions, positionStride, local, count, world, threadCount);
+        return result;
+    }
+}
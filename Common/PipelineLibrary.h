@@ -0,0 +1,350 @@
+//
+// PipelineLibrary.h - Graphics pipeline states backed by an ID3D12PipelineLibrary saved to a file
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <wrl/client.h>
+
+#ifndef IID_GRAPHICS_PPV_ARGS
+#define IID_GRAPHICS_PPV_ARGS(x) IID_PPV_ARGS(x)
+#endif
+
+namespace DX
+{
+    // Opens the pipeline library saved in 'fileName' by an earlier run, so that pipeline states it
+    // holds load from the driver's compiled form instead of compiling again. Pipelines are named by
+    // a 64-bit hash of their description, which must not depend on pointers, so that it is the same
+    // from run to run; PipelineStateCache passes its description hash. Pipeline states created
+    // here are stored in the library, and Save writes it back when it has new entries.
+    //
+    // The file starts with a header holding a format version and a checksum of the library. A file
+    // that is missing, truncated, fails its checksum, or that the driver rejects, such as after a
+    // driver update, is discarded and the library starts empty; GetState says which. On devices
+    // without pipeline library support every pipeline state is created as usual.
+    class PipelineLibrary
+    {
+    public:
+        enum class State
+        {
+            Missing,        // No file, so a cold start
+            Loaded,         // Warm start from the file
+            Corrupt,        // Bad header, size, or checksum, or the driver could not read it
+            Stale,          // Another file format version, or written by another driver or adapter
+            Unsupported,    // The device has no pipeline library support
+        };
+
+        struct Statistics
+        {
+            UINT64  loaded;     // Pipeline states loaded from the library
+            UINT64  created;    // Pipeline states compiled, and stored if the library is in use
+            UINT64  stored;
+            size_t  fileSize;   // Of the file opened, in bytes
+            double  openTime;   // Milliseconds reading and opening the file
+            double  loadTime;   // Milliseconds in LoadGraphicsPipeline, summed over the loads
+            double  createTime; // Milliseconds in CreateGraphicsPipelineState, summed over the creates
+        };
+
+        static constexpr uint32_t c_version = 1;
+
+        PipelineLibrary(_In_ ID3D12Device* device, _In_z_ const wchar_t* fileName) :
+            m_device(device),
+            m_fileName(fileName ? fileName : L""),
+            m_state(State::Unsupported),
+            m_dirty(false),
+            m_stats{}
+        {
+            if (!device || !fileName || !*fileName)
+            {
+                throw std::invalid_argument("PipelineLibrary requires a device and a file name");
+            }
+
+            auto start = std::chrono::steady_clock::now();
+
+            Open();
+
+            m_stats.openTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        PipelineLibrary(PipelineLibrary const&) = delete;
+        PipelineLibrary& operator= (PipelineLibrary const&) = delete;
+
+        // Loads the pipeline state named by 'hash' from the library, or creates it and stores it
+        // there. A pipeline with the same hash but a different description, such as one with another
+        // root signature, is created but cannot be stored.
+        HRESULT CreateGraphicsPipelineState(
+            _In_ const D3D12_GRAPHICS_PIPELINE_STATE_DESC* pDesc,
+            uint64_t hash,
+            REFIID riid,
+            _COM_Outptr_ void** ppPipelineState) noexcept
+        {
+            if (!ppPipelineState)
+                return E_INVALIDARG;
+
+            *ppPipelineState = nullptr;
+
+            if (!pDesc)
+                return E_INVALIDARG;
+
+            try
+            {
+                wchar_t name[32] = {};
+                swprintf_s(name, L"%016llX", static_cast<unsigned long long>(hash));
+
+                if (m_library)
+                {
+                    // LoadGraphicsPipeline is not safe for two threads loading the same name
+                    std::lock_guard<std::mutex> lock(m_mutex);
+
+                    auto start = std::chrono::steady_clock::now();
+
+                    // E_INVALIDARG when the name is not in the library, or its description differs
+                    const HRESULT hr = m_library->LoadGraphicsPipeline(name, pDesc, riid, ppPipelineState);
+
+                    m_stats.loadTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                    if (SUCCEEDED(hr))
+                    {
+                        ++m_stats.loaded;
+                        return hr;
+                    }
+                }
+
+                auto start = std::chrono::steady_clock::now();
+
+                Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState;
+                HRESULT hr = m_device->CreateGraphicsPipelineState(pDesc, IID_GRAPHICS_PPV_ARGS(pipelineState.GetAddressOf()));
+
+                const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+
+                    m_stats.createTime += elapsed;
+                    if (FAILED(hr))
+                        return hr;
+
+                    ++m_stats.created;
+
+                    if (m_library && SUCCEEDED(m_library->StorePipeline(name, pipelineState.Get())))
+                    {
+                        ++m_stats.stored;
+                        m_dirty = true;
+                    }
+                }
+
+                return pipelineState->QueryInterface(riid, ppPipelineState);
+            }
+            catch (const std::bad_alloc&)
+            {
+                return E_OUTOFMEMORY;
+            }
+            catch (...)
+            {
+                return E_FAIL;
+            }
+        }
+
+        // Writes the library to the file if pipeline states were stored since it was opened or last
+        // saved, returning S_FALSE if there was nothing to write. The file is written beside the old
+        // one and then moved over it, so a failed write leaves the old one.
+        HRESULT Save() noexcept
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (!m_library || !m_dirty)
+                return S_FALSE;
+
+            try
+            {
+                std::vector<uint8_t> data(sizeof(FileHeader) + m_library->GetSerializedSize());
+
+                auto library = data.data() + sizeof(FileHeader);
+                const size_t size = data.size() - sizeof(FileHeader);
+
+                HRESULT hr = m_library->Serialize(library, size);
+                if (FAILED(hr))
+                    return hr;
+
+                FileHeader header = {};
+                header.magic = c_magic;
+                header.version = c_version;
+                header.size = size;
+                header.checksum = Checksum(library, size);
+                memcpy(data.data(), &header, sizeof(header));
+
+                const std::wstring tempName = m_fileName + L".tmp";
+                {
+                    std::ofstream outFile(tempName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+                    if (!outFile)
+                        return E_ACCESSDENIED;
+
+                    outFile.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+                    outFile.close();
+                    if (!outFile)
+                    {
+                        std::ignore = DeleteFileW(tempName.c_str());
+                        return E_FAIL;
+                    }
+                }
+
+                if (!MoveFileExW(tempName.c_str(), m_fileName.c_str(), MOVEFILE_REPLACE_EXISTING))
+                {
+                    hr = HRESULT_FROM_WIN32(GetLastError());
+                    std::ignore = DeleteFileW(tempName.c_str());
+                    return hr;
+                }
+
+                m_dirty = false;
+                return S_OK;
+            }
+            catch (const std::bad_alloc&)
+            {
+                return E_OUTOFMEMORY;
+            }
+            catch (...)
+            {
+                return E_FAIL;
+            }
+        }
+
+        ID3D12Device* GetDevice() const noexcept { return m_device.Get(); }
+
+        State GetState() const noexcept { return m_state; }
+
+        static const char* GetStateName(State state) noexcept
+        {
+            switch (state)
+            {
+            case State::Missing:        return "missing";
+            case State::Loaded:         return "loaded";
+            case State::Corrupt:        return "corrupt";
+            case State::Stale:          return "stale";
+            case State::Unsupported:    return "unsupported";
+            default:                    return "unknown";
+            }
+        }
+
+        Statistics GetStatistics() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_stats;
+        }
+
+    private:
+        static constexpr uint32_t c_magic = 0x4C505844; // 'DXPL'
+
+        struct FileHeader
+        {
+            uint32_t    magic;
+            uint32_t    version;
+            uint64_t    size;       // Of the serialized library that follows
+            uint64_t    checksum;   // Of the serialized library
+        };
+
+        // FNV-1a
+        static uint64_t Checksum(_In_reads_bytes_(size) const uint8_t* data, size_t size) noexcept
+        {
+            uint64_t hash = 14695981039346656037ull;
+            for (size_t j = 0; j < size; ++j)
+            {
+                hash = (hash ^ data[j]) * 1099511628211ull;
+            }
+            return hash;
+        }
+
+        void Open()
+        {
+            D3D12_FEATURE_DATA_SHADER_CACHE shaderCache = {};
+            if (FAILED(m_device->CheckFeatureSupport(D3D12_FEATURE_SHADER_CACHE, &shaderCache, sizeof(shaderCache)))
+                || !(shaderCache.SupportFlags & D3D12_SHADER_CACHE_SUPPORT_LIBRARY))
+                return;
+
+            Microsoft::WRL::ComPtr<ID3D12Device1> device1;
+            if (FAILED(m_device.As(&device1)))
+                return;
+
+            m_state = ReadFile();
+
+            if (m_state == State::Loaded)
+            {
+                const HRESULT hr = device1->CreatePipelineLibrary(
+                    m_blob.data() + sizeof(FileHeader), m_blob.size() - sizeof(FileHeader),
+                    IID_PPV_ARGS(m_library.ReleaseAndGetAddressOf()));
+                if (SUCCEEDED(hr))
+                    return;
+
+                m_state = (hr == D3D12_ERROR_DRIVER_VERSION_MISMATCH || hr == D3D12_ERROR_ADAPTER_NOT_FOUND)
+                    ? State::Stale : State::Corrupt;
+            }
+
+            // The library reads the blob for as long as it lives, so only drop it if unused
+            m_blob.clear();
+            m_blob.shrink_to_fit();
+
+            const HRESULT hr = device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(m_library.ReleaseAndGetAddressOf()));
+            if (FAILED(hr))
+            {
+                m_library.Reset();
+                m_state = State::Unsupported;
+            }
+        }
+
+        State ReadFile()
+        {
+            std::ifstream inFile(m_fileName.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+            if (!inFile)
+                return State::Missing;
+
+            const std::streampos len = inFile.tellg();
+            if (!inFile || static_cast<uint64_t>(len) < sizeof(FileHeader))
+                return State::Corrupt;
+
+            m_stats.fileSize = static_cast<size_t>(len);
+            m_blob.resize(static_cast<size_t>(len));
+
+            inFile.seekg(0, std::ios::beg);
+            inFile.read(reinterpret_cast<char*>(m_blob.data()), len);
+            if (!inFile)
+                return State::Corrupt;
+
+            FileHeader header;
+            memcpy(&header, m_blob.data(), sizeof(header));
+
+            const size_t size = m_blob.size() - sizeof(FileHeader);
+            if (header.magic != c_magic || header.size != size)
+                return State::Corrupt;
+
+            if (header.version != c_version)
+                return State::Stale;
+
+            if (header.checksum != Checksum(m_blob.data() + sizeof(FileHeader), size))
+                return State::Corrupt;
+
+            return State::Loaded;
+        }
+
+        Microsoft::WRL::ComPtr<ID3D12Device>            m_device;
+        std::vector<uint8_t>                            m_blob;     // Declared before m_library so it outlives it
+        Microsoft::WRL::ComPtr<ID3D12PipelineLibrary>   m_library;
+        std::wstring                                    m_fileName;
+        State                                           m_state;
+
+        mutable std::mutex                              m_mutex;
+        bool                                            m_dirty;
+        Statistics                                      m_stats;
+    };
+}
@@ -0,0 +1,771 @@
+//
+// PipelineStateCache.h - Process-wide cache of graphics pipeline states, and a stand-in device
+// that routes the DirectX Tool Kit effects' pipeline state creation through it
+//
+
+#pragma once
+
+#include "PipelineLibrary.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <wrl/client.h>
+
+#ifndef IID_GRAPHICS_PPV_ARGS
+#define IID_GRAPHICS_PPV_ARGS(x) IID_PPV_ARGS(x)
+#endif
+
+namespace DX
+{
+    // Returns the pipeline state already created for an identical description on the same device,
+    // so that effects which differ only in settings their shaders share compile once. Entries are
+    // keyed on the device, the root signature, and every field of the description, with shaders
+    // compared by size and a 64-bit hash of their bytecode; CachedPSO is only a hint to the driver,
+    // so it is not part of the key. All methods are thread-safe, and a thread asking for a pipeline
+    // state another is creating waits for it rather than creating it again.
+    //
+    // The cache holds a reference on each pipeline state, so Clear a device's entries before
+    // releasing it, such as in OnDeviceLost.
+    //
+    // With a PipelineLibrary set, misses on its device load from or store into the library, named
+    // by the hash of the description, so later runs skip compiling them.
+    class PipelineStateCache
+    {
+    public:
+        struct Statistics
+        {
+            UINT64  hits;
+            UINT64  misses;
+            UINT64  failures;       // Misses where the device failed to create the pipeline state
+            size_t  pipelines;
+            double  createTime;     // Milliseconds creating or loading pipeline states, summed over the misses
+        };
+
+        static PipelineStateCache& Get()
+        {
+            static PipelineStateCache s_cache;
+            return s_cache;
+        }
+
+        PipelineStateCache(PipelineStateCache const&) = delete;
+        PipelineStateCache& operator= (PipelineStateCache const&) = delete;
+
+        HRESULT CreateGraphicsPipelineState(
+            _In_ ID3D12Device* device,
+            _In_ const D3D12_GRAPHICS_PIPELINE_STATE_DESC* pDesc,
+            REFIID riid,
+            _COM_Outptr_ void** ppPipelineState) noexcept
+        {
+            if (!ppPipelineState)
+                return E_INVALIDARG;
+
+            *ppPipelineState = nullptr;
+
+            if (!device || !pDesc)
+                return E_INVALIDARG;
+
+            try
+            {
+                Key key;
+                key.device = device;
+                key.rootSignature = pDesc->pRootSignature;
+                DescribePipeline(*pDesc, key.description);
+                key.hash = Hash(key.description.data(), key.description.size());
+
+                std::shared_future<Result> ready;
+                std::promise<Result> promise;
+                bool create = false;
+                PipelineLibrary* library = nullptr;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+
+                    auto it = m_pipelines.find(key);
+                    if (it != m_pipelines.end())
+                    {
+                        ++m_stats.hits;
+                        ready = it->second;
+                    }
+                    else
+                    {
+                        ++m_stats.misses;
+                        ready = promise.get_future().share();
+                        m_pipelines.emplace(key, ready);
+                        create = true;
+
+                        if (m_library && m_library->GetDevice() == device)
+                            library = m_library;
+                    }
+                }
+
+                if (create)
+                {
+                    try
+                    {
+                        auto start = std::chrono::steady_clock::now();
+
+                        Result result = {};
+                        result.hr = library
+                            ? library->CreateGraphicsPipelineState(pDesc, key.hash, IID_GRAPHICS_PPV_ARGS(result.pipelineState.GetAddressOf()))
+                            : device->CreateGraphicsPipelineState(pDesc, IID_GRAPHICS_PPV_ARGS(result.pipelineState.GetAddressOf()));
+
+                        const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                        {
+                            std::lock_guard<std::mutex> lock(m_mutex);
+
+                            m_stats.createTime += elapsed;
+                            if (FAILED(result.hr))
+                            {
+                                // Not kept, so a later request tries again
+                                ++m_stats.failures;
+                                m_pipelines.erase(key);
+                            }
+                        }
+
+                        promise.set_value(std::move(result));
+                    }
+                    catch (...)
+                    {
+                        // Waiters get the exception, and a later request tries again
+                        {
+                            std::lock_guard<std::mutex> lock(m_mutex);
+                            m_pipelines.erase(key);
+                        }
+
+                        promise.set_exception(std::current_exception());
+                        throw;
+                    }
+                }
+
+                const Result& result = ready.get();
+                if (FAILED(result.hr))
+                    return result.hr;
+
+                return result.pipelineState->QueryInterface(riid, ppPipelineState);
+            }
+            catch (const std::bad_alloc&)
+            {
+                return E_OUTOFMEMORY;
+            }
+            catch (...)
+            {
+                return E_FAIL;
+            }
+        }
+
+        // Releases the pipeline states created on 'device', or all of them if it is null.
+        void Clear(_In_opt_ ID3D12Device* device = nullptr)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            for (auto it = m_pipelines.begin(); it != m_pipelines.end();)
+            {
+                if (!device || it->first.device == device)
+                {
+                    it = m_pipelines.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+
+        // Backs misses on the library's device with it, or stops using a library if null. Set null
+        // before destroying the library.
+        void SetLibrary(_In_opt_ PipelineLibrary* library)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_library = library;
+        }
+
+        Statistics GetStatistics() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            Statistics stats = m_stats;
+            stats.pipelines = m_pipelines.size();
+            return stats;
+        }
+
+        void ResetStatistics()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats = {};
+        }
+
+        // FNV-1a
+        static uint64_t Hash(_In_reads_bytes_(size) const void* data, size_t size, uint64_t hash = 14695981039346656037ull) noexcept
+        {
+            auto bytes = static_cast<const uint8_t*>(data);
+            for (size_t j = 0; j < size; ++j)
+            {
+                hash = (hash ^ bytes[j]) * 1099511628211ull;
+            }
+            return hash;
+        }
+
+        // Writes every field that affects the pipeline state, apart from the root signature, field by
+        // field so that padding never takes part, with the contents of strings and shaders in place
+        // of their pointers. Two descriptions that write the same bytes with the same root signature
+        // create the same pipeline state.
+        static void DescribePipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, std::vector<uint8_t>& out)
+        {
+            out.clear();
+            out.reserve(512);
+
+            for (auto& shader : { desc.VS, desc.PS, desc.DS, desc.HS, desc.GS })
+            {
+                Append(out, static_cast<uint64_t>(shader.BytecodeLength));
+                Append(out, shader.pShaderBytecode ? Hash(shader.pShaderBytecode, shader.BytecodeLength) : 0);
+            }
+
+            const auto& so = desc.StreamOutput;
+            Append(out, so.NumEntries);
+            for (UINT j = 0; so.pSODeclaration && j < so.NumEntries; ++j)
+            {
+                const auto& entry = so.pSODeclaration[j];
+                Append(out, entry.Stream);
+                AppendString(out, entry.SemanticName);
+                Append(out, entry.SemanticIndex);
+                Append(out, entry.StartComponent);
+                Append(out, entry.ComponentCount);
+                Append(out, entry.OutputSlot);
+            }
+            Append(out, so.NumStrides);
+            for (UINT j = 0; so.pBufferStrides && j < so.NumStrides; ++j)
+            {
+                Append(out, so.pBufferStrides[j]);
+            }
+            Append(out, so.RasterizedStream);
+
+            const auto& blend = desc.BlendState;
+            Append(out, blend.AlphaToCoverageEnable);
+            Append(out, blend.IndependentBlendEnable);
+            for (const auto& rt : blend.RenderTarget)
+            {
+                Append(out, rt.BlendEnable);
+                Append(out, rt.LogicOpEnable);
+                Append(out, rt.SrcBlend);
+                Append(out, rt.DestBlend);
+                Append(out, rt.BlendOp);
+                Append(out, rt.SrcBlendAlpha);
+                Append(out, rt.DestBlendAlpha);
+                Append(out, rt.BlendOpAlpha);
+                Append(out, rt.LogicOp);
+                Append(out, rt.RenderTargetWriteMask);
+            }
+
+            Append(out, desc.SampleMask);
+
+            const auto& raster = desc.RasterizerState;
+            Append(out, raster.FillMode);
+            Append(out, raster.CullMode);
+            Append(out, raster.FrontCounterClockwise);
+            Append(out, raster.DepthBias);
+            Append(out, raster.DepthBiasClamp);
+            Append(out, raster.SlopeScaledDepthBias);
+            Append(out, raster.DepthClipEnable);
+            Append(out, raster.MultisampleEnable);
+            Append(out, raster.AntialiasedLineEnable);
+            Append(out, raster.ForcedSampleCount);
+            Append(out, raster.ConservativeRaster);
+
+            const auto& depth = desc.DepthStencilState;
+            Append(out, depth.DepthEnable);
+            Append(out, depth.DepthWriteMask);
+            Append(out, depth.DepthFunc);
+            Append(out, depth.StencilEnable);
+            Append(out, depth.StencilReadMask);
+            Append(out, depth.StencilWriteMask);
+            for (const auto& face : { depth.FrontFace, depth.BackFace })
+            {
+                Append(out, face.StencilFailOp);
+                Append(out, face.StencilDepthFailOp);
+                Append(out, face.StencilPassOp);
+                Append(out, face.StencilFunc);
+            }
+
+            const auto& layout = desc.InputLayout;
+            Append(out, layout.NumElements);
+            for (UINT j = 0; layout.pInputElementDescs && j < layout.NumElements; ++j)
+            {
+                const auto& element = layout.pInputElementDescs[j];
+                AppendString(out, element.SemanticName);
+                Append(out, element.SemanticIndex);
+                Append(out, element.Format);
+                Append(out, element.InputSlot);
+                Append(out, element.AlignedByteOffset);
+                Append(out, element.InputSlotClass);
+                Append(out, element.InstanceDataStepRate);
+            }
+
+            Append(out, desc.IBStripCutValue);
+            Append(out, desc.PrimitiveTopologyType);
+            Append(out, desc.NumRenderTargets);
+            for (auto format : desc.RTVFormats)
+            {
+                Append(out, format);
+            }
+            Append(out, desc.DSVFormat);
+            Append(out, desc.SampleDesc.Count);
+            Append(out, desc.SampleDesc.Quality);
+            Append(out, desc.NodeMask);
+            Append(out, desc.Flags);
+        }
+
+    private:
+        PipelineStateCache() :
+            m_library(nullptr),
+            m_stats{}
+        {
+        }
+
+        struct Result
+        {
+            HRESULT                                         hr;
+            Microsoft::WRL::ComPtr<ID3D12PipelineState>     pipelineState;
+        };
+
+        struct Key
+        {
+            ID3D12Device*           device;
+            ID3D12RootSignature*    rootSignature;
+            uint64_t                hash;               // Of the description alone, so stable from run to run
+            std::vector<uint8_t>    description;
+
+            bool operator== (const Key& other) const noexcept
+            {
+                return device == other.device
+                    && rootSignature == other.rootSignature
+                    && hash == other.hash
+                    && description == other.description;
+            }
+        };
+
+        struct KeyHash
+        {
+            size_t operator()(const Key& key) const noexcept
+            {
+                uint64_t hash = Hash(&key.device, sizeof(key.device), key.hash);
+                hash = Hash(&key.rootSignature, sizeof(key.rootSignature), hash);
+                return static_cast<size_t>(hash);
+            }
+        };
+
+        template<typename T>
+        static void Append(std::vector<uint8_t>& out, const T& value)
+        {
+            auto bytes = reinterpret_cast<const uint8_t*>(&value);
+            out.insert(out.end(), bytes, bytes + sizeof(T));
+        }
+
+        static void AppendString(std::vector<uint8_t>& out, _In_opt_z_ const char* str)
+        {
+            const uint32_t length = str ? static_cast<uint32_t>(strlen(str)) : UINT32_MAX;
+            Append(out, length);
+            if (str)
+                out.insert(out.end(), str, str + length);
+        }
+
+        mutable std::mutex                                              m_mutex;
+        std::unordered_map<Key, std::shared_future<Result>, KeyHash>    m_pipelines;
+        PipelineLibrary*                                                m_library;
+        Statistics                                                      m_stats;
+    };
+
+#if !defined(_GAMING_XBOX) && !defined(_XBOX_ONE)
+    // Forwards every call to the device it wraps, except that CreateGraphicsPipelineState goes
+    // through PipelineStateCache. Pass it to the effect constructors, which create their pipeline
+    // states through the device they are given. GraphicsMemory::Get looks up the memory for the
+    // device an effect was created with, so create the GraphicsMemory with this device too.
+    //
+    // QueryInterface for a later ID3D12Device version returns the wrapped device's interface,
+    // which bypasses the cache.
+    class PipelineCachingDevice final : public ID3D12Device
+    {
+    public:
+        static HRESULT Create(_In_ ID3D12Device* device, _COM_Outptr_ PipelineCachingDevice** ppDevice) noexcept
+        {
+            if (!ppDevice)
+                return E_INVALIDARG;
+
+            *ppDevice = nullptr;
+
+            if (!device)
+                return E_INVALIDARG;
+
+            *ppDevice = new (std::nothrow) PipelineCachingDevice(device);
+            return (*ppDevice) ? S_OK : E_OUTOFMEMORY;
+        }
+
+        PipelineCachingDevice(PipelineCachingDevice&&) = delete;
+        PipelineCachingDevice& operator= (PipelineCachingDevice&&) = delete;
+
+        PipelineCachingDevice(PipelineCachingDevice const&) = delete;
+        PipelineCachingDevice& operator= (PipelineCachingDevice const&) = delete;
+
+        ID3D12Device* GetWrappedDevice() const noexcept { return m_device.Get(); }
+
+        // IUnknown
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, _COM_Outptr_ void** ppvObject) override
+        {
+            if (!ppvObject)
+                return E_POINTER;
+
+            if (riid == __uuidof(IUnknown)
+                || riid == __uuidof(ID3D12Object)
+                || riid == __uuidof(ID3D12Device))
+            {
+                *ppvObject = static_cast<ID3D12Device*>(this);
+                AddRef();
+                return S_OK;
+            }
+
+            return m_device->QueryInterface(riid, ppvObject);
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef() override
+        {
+            return ++m_refCount;
+        }
+
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            const ULONG count = --m_refCount;
+            if (!count)
+                delete this;
+            return count;
+        }
+
+        // ID3D12Object
+        HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID guid, _Inout_ UINT* pDataSize, _Out_writes_bytes_opt_(*pDataSize) void* pData) override
+        {
+            return m_device->GetPrivateData(guid, pDataSize, pData);
+        }
+
+        HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID guid, UINT DataSize, _In_reads_bytes_opt_(DataSize) const void* pData) override
+        {
+            return m_device->SetPrivateData(guid, DataSize, pData);
+        }
+
+        HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID guid, _In_opt_ const IUnknown* pData) override
+        {
+            return m_device->SetPrivateDataInterface(guid, pData);
+        }
+
+        HRESULT STDMETHODCALLTYPE SetName(_In_z_ LPCWSTR Name) override
+        {
+            return m_device->SetName(Name);
+        }
+
+        // ID3D12Device
+        UINT STDMETHODCALLTYPE GetNodeCount() override
+        {
+            return m_device->GetNodeCount();
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateCommandQueue(_In_ const D3D12_COMMAND_QUEUE_DESC* pDesc, REFIID riid, _COM_Outptr_ void** ppCommandQueue) override
+        {
+            return m_device->CreateCommandQueue(pDesc, riid, ppCommandQueue);
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateCommandAllocator(_In_ D3D12_COMMAND_LIST_TYPE type, REFIID riid, _COM_Outptr_ void** ppCommandAllocator) override
+        {
+            return m_device->CreateCommandAllocator(type, riid, ppCommandAllocator);
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateGraphicsPipelineState(_In_ const D3D12_GRAPHICS_PIPELINE_STATE_DESC* pDesc, REFIID riid, _COM_Outptr_ void** ppPipelineState) override
+        {
+            return PipelineStateCache::Get().CreateGraphicsPipelineState(m_device.Get(), pDesc, riid, ppPipelineState);
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateComputePipelineState(_In_ const D3D12_COMPUTE_PIPELINE_STATE_DESC* pDesc, REFIID riid, _COM_Outptr_ void** ppPipelineState) override
+        {
+            return m_device->CreateComputePipelineState(pDesc, riid, ppPipelineState);
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateCommandList(
+            _In_ UINT nodeMask,
+            _In_ D3D12_COMMAND_LIST_TYPE type,
+            _In_ ID3D12CommandAllocator* pCommandAllocator,
+            _In_opt_ ID3D12PipelineState* pInitialState,
+            REFIID riid,
+            _COM_Outptr_ void** ppCommandList) override
+        {
+            return m_device->CreateCommandList(nodeMask, type, pCommandAllocator, pInitialState, riid, ppCommandList);
+        }
+
+        HRESULT STDMETHODCALLTYPE CheckFeatureSupport(D3D12_FEATURE Feature, _Inout_updates_bytes_(FeatureSupportDataSize) void* pFeatureSupportData, UINT FeatureSupportDataSize) override
+        {
+            return m_device->CheckFeatureSupport(Feature, pFeatureSupportData, FeatureSupportDataSize);
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateDescriptorHeap(_In_ const D3D12_DESCRIPTOR_HEAP_DESC* pDescriptorHeapDesc, REFIID riid, _COM_Outptr_ void** ppvHeap) override
+        {
+            return m_device->CreateDescriptorHeap(pDescriptorHeapDesc, riid, ppvHeap);
+        }
+
+        UINT STDMETHODCALLTYPE GetDescriptorHandleIncrementSize(_In_ D3D12_DESCRIPTOR_HEAP_TYPE DescriptorHeapType) override
+        {
+            return m_device->GetDescriptorHandleIncrementSize(DescriptorHeapType);
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateRootSignature(
+            _In_ UINT nodeMask,
+            _In_reads_(blobLengthInBytes) const void* pBlobWithRootSignature,
+            _In_ SIZE_T blobLengthInBytes,
+            REFIID riid,
+            _COM_Outptr_ void** ppvRootSignature) override
+        {
+            return m_device->CreateRootSignature(nodeMask, pBlobWithRootSignature, blobLengthInBytes, riid, ppvRootSignature);
+        }
+
+        void STDMETHODCALLTYPE CreateConstantBufferView(_In_opt_ const D3D12_CONSTANT_BUFFER_VIEW_DESC* pDesc, _In_ D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override
+        {
+            m_device->CreateConstantBufferView(pDesc, DestDescriptor);
+        }
+
+        void STDMETHODCALLTYPE CreateShaderResourceView(_In_opt_ ID3D12Resource* pResource, _In_opt_ const D3D12_SHADER_RESOURCE_VIEW_DESC* pDesc, _In_ D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override
+        {
+            m_device->CreateShaderResourceView(pResource, pDesc, DestDescriptor);
+        }
+
+        void STDMETHODCALLTYPE CreateUnorderedAccessView(
+            _In_opt_ ID3D12Resource* pResource,
+            _In_opt_ ID3D12Resource* pCounterResource,
+            _In_opt_ const D3D12_UNORDERED_ACCESS_VIEW_DESC* pDesc,
+            _In_ D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override
+        {
+            m_device->CreateUnorderedAccessView(pResource, pCounterResource, pDesc, DestDescriptor);
+        }
+
+        void STDMETHODCALLTYPE CreateRenderTargetView(_In_opt_ ID3D12Resource* pResource, _In_opt_ const D3D12_RENDER_TARGET_VIEW_DESC* pDesc, _In_ D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override
+        {
+            m_device->CreateRenderTargetView(pResource, pDesc, DestDescriptor);
+        }
+
+        void STDMETHODCALLTYPE CreateDepthStencilView(_In_opt_ ID3D12Resource* pResource, _In_opt_ const D3D12_DEPTH_STENCIL_VIEW_DESC* pDesc, _In_ D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override
+        {
+            m_device->CreateDepthStencilView(pResource, pDesc, DestDescriptor);
+        }
+
+        void STDMETHODCALLTYPE CreateSampler(_In_ const D3D12_SAMPLER_DESC* pDesc, _In_ D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override
+        {
+            m_device->CreateSampler(pDesc, DestDescriptor);
+        }
+
+        void STDMETHODCALLTYPE CopyDescriptors(
+            _In_ UINT NumDestDescriptorRanges,
+            _In_reads_(NumDestDescriptorRanges) const D3D12_CPU_DESCRIPTOR_HANDLE* pDestDescriptorRangeStarts,
+            _In_reads_opt_(NumDestDescriptorRanges) const UINT* pDestDescriptorRangeSizes,
+            _In_ UINT NumSrcDescriptorRanges,
+            _In_reads_(NumSrcDescriptorRanges) const D3D12_CPU_DESCRIPTOR_HANDLE* pSrcDescriptorRangeStarts,
+            _In_reads_opt_(NumSrcDescriptorRanges) const UINT* pSrcDescriptorRangeSizes,
+            _In_ D3D12_DESCRIPTOR_HEAP_TYPE DescriptorHeapsType) override
+        {
+            m_device->CopyDescriptors(NumDestDescriptorRanges, pDestDescriptorRangeStarts, pDestDescriptorRangeSizes,
+                NumSrcDescriptorRanges, pSrcDescriptorRangeStarts, pSrcDescriptorRangeSizes, DescriptorHeapsType);
+        }
+
+        void STDMETHODCALLTYPE CopyDescriptorsSimple(
+            _In_ UINT NumDescriptors,
+            _In_ D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptorRangeStart,
+            _In_ D3D12_CPU_DESCRIPTOR_HANDLE SrcDescriptorRangeStart,
+            _In_ D3D12_DESCRIPTOR_HEAP_TYPE DescriptorHeapsType) override
+        {
+            m_device->CopyDescriptorsSimple(NumDescriptors, DestDescriptorRangeStart, SrcDescriptorRangeStart, DescriptorHeapsType);
+        }
+
+        // d3d12.h declares the methods returning structures with an out parameter where the
+        // compiler's ABI would not otherwise match the runtime's.
+#if defined(_MSC_VER) || !defined(_WIN32)
+        D3D12_RESOURCE_ALLOCATION_INFO STDMETHODCALLTYPE GetResourceAllocationInfo(
+            _In_ UINT visibleMask,
+            _In_ UINT numResourceDescs,
+            _In_reads_(numResourceDescs) const D3D12_RESOURCE_DESC* pResourceDescs) override
+        {
+            return m_device->GetResourceAllocationInfo(visibleMask, numResourceDescs, pResourceDescs);
+        }
+
+        D3D12_HEAP_PROPERTIES STDMETHODCALLTYPE GetCustomHeapProperties(_In_ UINT nodeMask, D3D12_HEAP_TYPE heapType) override
+        {
+            return m_device->GetCustomHeapProperties(nodeMask, heapType);
+        }
+#else
+        D3D12_RESOURCE_ALLOCATION_INFO* STDMETHODCALLTYPE GetResourceAllocationInfo(
+            D3D12_RESOURCE_ALLOCATION_INFO* RetVal,
+            _In_ UINT visibleMask,
+            _In_ UINT numResourceDescs,
+            _In_reads_(numResourceDescs) const D3D12_RESOURCE_DESC* pResourceDescs) override
+        {
+            return m_device->GetResourceAllocationInfo(RetVal, visibleMask, numResourceDescs, pResourceDescs);
+        }
+
+        D3D12_HEAP_PROPERTIES* STDMETHODCALLTYPE GetCustomHeapProperties(D3D12_HEAP_PROPERTIES* RetVal, _In_ UINT nodeMask, D3D12_HEAP_TYPE heapType) override
+        {
+            return m_device->GetCustomHeapProperties(RetVal, nodeMask, heapType);
+        }
+#endif
+
+        HRESULT STDMETHODCALLTYPE CreateCommittedResource(
+            _In_ const D3D12_HEAP_PROPERTIES* pHeapProperties,
+            D3D12_HEAP_FLAGS HeapFlags,
+            _In_ const D3D12_RESOURCE_DESC* pDesc,
+            D3D12_RESOURCE_STATES InitialResourceState,
+            _In_opt_ const D3D12_CLEAR_VALUE* pOptimizedClearValue,
+            REFIID riidResource,
+            _COM_Outptr_opt_ void** ppvResource) override
+        {
+            return m_device->CreateCommittedResource(pHeapProperties, HeapFlags, pDesc, InitialResourceState, pOptimizedClearValue, riidResource, ppvResource);
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateHeap(_In_ const D3D12_HEAP_DESC* pDesc, REFIID riid, _COM_Outptr_opt_ void** ppvHeap) override
+        {
+            return m_device->CreateHeap(pDesc, riid, ppvHeap);
+        }
+
+        HRESULT STDMETHODCALLTYPE CreatePlacedResource(
+            _In_ ID3D12Heap* pHeap,
+            UINT64 HeapOffset,
+            _In_ const D3D12_RESOURCE_DESC* pDesc,
+            D3D12_RESOURCE_STATES InitialState,
+            _In_opt_ const D3D12_CLEAR_VALUE* pOptimizedClearValue,
+            REFIID riid,
+            _COM_Outptr_opt_ void** ppvResource) override
+        {
+            return m_device->CreatePlacedResource(pHeap, HeapOffset, pDesc, InitialState, pOptimizedClearValue, riid, ppvResource);
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateReservedResource(
+            _In_ const D3D12_RESOURCE_DESC* pDesc,
+            D3D12_RESOURCE_STATES InitialState,
+            _In_opt_ const D3D12_CLEAR_VALUE* pOptimizedClearValue,
+            REFIID riid,
+            _COM_Outptr_opt_ void** ppvResource) override
+        {
+            return m_device->CreateReservedResource(pDesc, InitialState, pOptimizedClearValue, riid, ppvResource);
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateSharedHandle(
+            _In_ ID3D12DeviceChild* pObject,
+            _In_opt_ const SECURITY_ATTRIBUTES* pAttributes,
+            DWORD Access,
+            _In_opt_ LPCWSTR Name,
+            _Out_ HANDLE* pHandle) override
+        {
+            return m_device->CreateSharedHandle(pObject, pAttributes, Access, Name, pHandle);
+        }
+
+        HRESULT STDMETHODCALLTYPE OpenSharedHandle(_In_ HANDLE NTHandle, REFIID riid, _COM_Outptr_opt_ void** ppvObj) override
+        {
+            return m_device->OpenSharedHandle(NTHandle, riid, ppvObj);
+        }
+
+        HRESULT STDMETHODCALLTYPE OpenSharedHandleByName(_In_ LPCWSTR Name, DWORD Access, _Out_ HANDLE* pNTHandle) override
+        {
+            return m_device->OpenSharedHandleByName(Name, Access, pNTHandle);
+        }
+
+        HRESULT STDMETHODCALLTYPE MakeResident(UINT NumObjects, _In_reads_(NumObjects) ID3D12Pageable* const* ppObjects) override
+        {
+            return m_device->MakeResident(NumObjects, ppObjects);
+        }
+
+        HRESULT STDMETHODCALLTYPE Evict(UINT NumObjects, _In_reads_(NumObjects) ID3D12Pageable* const* ppObjects) override
+        {
+            return m_device->Evict(NumObjects, ppObjects);
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateFence(UINT64 InitialValue, D3D12_FENCE_FLAGS Flags, REFIID riid, _COM_Outptr_ void** ppFence) override
+        {
+            return m_device->CreateFence(InitialValue, Flags, riid, ppFence);
+        }
+
+        HRESULT STDMETHODCALLTYPE GetDeviceRemovedReason() override
+        {
+            return m_device->GetDeviceRemovedReason();
+        }
+
+        void STDMETHODCALLTYPE GetCopyableFootprints(
+            _In_ const D3D12_RESOURCE_DESC* pResourceDesc,
+            _In_range_(0, D3D12_REQ_SUBRESOURCES) UINT FirstSubresource,
+            _In_range_(0, D3D12_REQ_SUBRESOURCES - FirstSubresource) UINT NumSubresources,
+            UINT64 BaseOffset,
+            _Out_writes_opt_(NumSubresources) D3D12_PLACED_SUBRESOURCE_FOOTPRINT* pLayouts,
+            _Out_writes_opt_(NumSubresources) UINT* pNumRows,
+            _Out_writes_opt_(NumSubresources) UINT64* pRowSizeInBytes,
+            _Out_opt_ UINT64* pTotalBytes) override
+        {
+            m_device->GetCopyableFootprints(pResourceDesc, FirstSubresource, NumSubresources, BaseOffset, pLayouts, pNumRows, pRowSizeInBytes, pTotalBytes);
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateQueryHeap(_In_ const D3D12_QUERY_HEAP_DESC* pDesc, REFIID riid, _COM_Outptr_opt_ void** ppvHeap) override
+        {
+            return m_device->CreateQueryHeap(pDesc, riid, ppvHeap);
+        }
+
+        HRESULT STDMETHODCALLTYPE SetStablePowerState(BOOL Enable) override
+        {
+            return m_device->SetStablePowerState(Enable);
+        }
+
+        HRESULT STDMETHODCALLTYPE CreateCommandSignature(
+            _In_ const D3D12_COMMAND_SIGNATURE_DESC* pDesc,
+            _In_opt_ ID3D12RootSignature* pRootSignature,
+            REFIID riid,
+            _COM_Outptr_opt_ void** ppvCommandSignature) override
+        {
+            return m_device->CreateCommandSignature(pDesc, pRootSignature, riid, ppvCommandSignature);
+        }
+
+        void STDMETHODCALLTYPE GetResourceTiling(
+            _In_ ID3D12Resource* pTiledResource,
+            _Out_opt_ UINT* pNumTilesForEntireResource,
+            _Out_opt_ D3D12_PACKED_MIP_INFO* pPackedMipDesc,
+            _Out_opt_ D3D12_TILE_SHAPE* pStandardTileShapeForNonPackedMips,
+            _Inout_opt_ UINT* pNumSubresourceTilings,
+            _In_ UINT FirstSubresourceTilingToGet,
+            _Out_writes_(*pNumSubresourceTilings) D3D12_SUBRESOURCE_TILING* pSubresourceTilingsForNonPackedMips) override
+        {
+            m_device->GetResourceTiling(pTiledResource, pNumTilesForEntireResource, pPackedMipDesc,
+                pStandardTileShapeForNonPackedMips, pNumSubresourceTilings, FirstSubresourceTilingToGet, pSubresourceTilingsForNonPackedMips);
+        }
+
+#if defined(_MSC_VER) || !defined(_WIN32)
+        LUID STDMETHODCALLTYPE GetAdapterLuid() override
+        {
+            return m_device->GetAdapterLuid();
+        }
+#else
+        LUID* STDMETHODCALLTYPE GetAdapterLuid(LUID* RetVal) override
+        {
+            return m_device->GetAdapterLuid(RetVal);
+        }
+#endif
+
+    private:
+        explicit PipelineCachingDevice(_In_ ID3D12Device* device) noexcept :
+            m_refCount(1),
+            m_device(device)
+        {
+        }
+
+        ~PipelineCachingDevice() = default;
+
+        std::atomic<ULONG>                      m_refCount;
+        Microsoft::WRL::ComPtr<ID3D12Device>    m_device;
+    };
+#endif
+}
@@ -0,0 +1,783 @@
+//--------------------------------------------------------------------------------------
+// File: RecordingCommandList.h
+//
+// A stand-in for ID3D12GraphicsCommandList that records calls into a compact binary
+// stream instead of submitting them to a GPU, for counting state changes and draws
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include <wrl/client.h>
+
+namespace DX
+{
+    enum class RecordedCommand : uint16_t
+    {
+        Close = 0,
+        Reset,
+        ClearState,
+        DrawInstanced,
+        DrawIndexedInstanced,
+        Dispatch,
+        CopyBufferRegion,
+        CopyTextureRegion,
+        CopyResource,
+        CopyTiles,
+        ResolveSubresource,
+        IASetPrimitiveTopology,
+        RSSetViewports,
+        RSSetScissorRects,
+        OMSetBlendFactor,
+        OMSetStencilRef,
+        SetPipelineState,
+        ResourceBarrier,
+        ExecuteBundle,
+        SetDescriptorHeaps,
+        SetComputeRootSignature,
+        SetGraphicsRootSignature,
+        SetComputeRootDescriptorTable,
+        SetGraphicsRootDescriptorTable,
+        SetComputeRoot32BitConstant,
+        SetGraphicsRoot32BitConstant,
+        SetComputeRoot32BitConstants,
+        SetGraphicsRoot32BitConstants,
+        SetComputeRootConstantBufferView,
+        SetGraphicsRootConstantBufferView,
+        SetComputeRootShaderResourceView,
+        SetGraphicsRootShaderResourceView,
+        SetComputeRootUnorderedAccessView,
+        SetGraphicsRootUnorderedAccessView,
+        IASetIndexBuffer,
+        IASetVertexBuffers,
+        SOSetTargets,
+        OMSetRenderTargets,
+        ClearDepthStencilView,
+        ClearRenderTargetView,
+        ClearUnorderedAccessViewUint,
+        ClearUnorderedAccessViewFloat,
+        DiscardResource,
+        BeginQuery,
+        EndQuery,
+        ResolveQueryData,
+        SetPredication,
+        SetMarker,
+        BeginEvent,
+        EndEvent,
+        ExecuteIndirect,
+        Count
+    };
+
+    // Each command in the stream is a header followed by 'size' bytes of payload. The payload holds
+    // the arguments in order, unpadded, with interface pointers and CPU descriptor handles written as
+    // 64-bit identities. Arrays are written as their element count followed by the elements.
+    struct RecordedCommandHeader
+    {
+        RecordedCommand command;
+        uint16_t        reserved;
+        uint32_t        size;
+    };
+
+    struct RecordingStats
+    {
+        uint32_t counts[static_cast<size_t>(RecordedCommand::Count)];
+        uint32_t draws;                     // DrawInstanced, DrawIndexedInstanced and ExecuteIndirect
+        uint32_t pipelineChanges;           // SetPipelineState with a different pipeline state object
+        uint32_t rootSignatureChanges;      // Set*RootSignature with a different root signature
+        uint32_t rootParameterSets;         // Root descriptor tables, constants and views
+        uint32_t descriptorHeapChanges;     // SetDescriptorHeaps with different heaps
+        uint32_t redundantSets;             // Calls that set state to its current value
+        double   cpuTime;                   // Milliseconds from Reset to Close
+    };
+
+#if !defined(_GAMING_XBOX) && !defined(_XBOX_ONE)
+    // Implements the desktop ID3D12GraphicsCommandList, which the Xbox d3d12_x interfaces do not match
+    class RecordingCommandList final : public ID3D12GraphicsCommandList
+    {
+    public:
+        static constexpr size_t c_maxRootParameters = 64;
+        static constexpr size_t c_maxVertexBuffers = D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT;
+
+        // Creates a recording command list, open for recording, that reports 'device' from GetDevice.
+        static HRESULT Create(
+            _In_opt_ ID3D12Device* device,
+            D3D12_COMMAND_LIST_TYPE type,
+            _COM_Outptr_ RecordingCommandList** ppCommandList) noexcept
+        {
+            if (!ppCommandList)
+                return E_INVALIDARG;
+
+            *ppCommandList = new (std::nothrow) RecordingCommandList(device, type);
+            return (*ppCommandList) ? S_OK : E_OUTOFMEMORY;
+        }
+
+        RecordingCommandList(RecordingCommandList&&) = delete;
+        RecordingCommandList& operator= (RecordingCommandList&&) = delete;
+
+        RecordingCommandList(RecordingCommandList const&) = delete;
+        RecordingCommandList& operator= (RecordingCommandList const&) = delete;
+
+        const std::vector<uint8_t>& GetStream() const noexcept { return m_stream; }
+        const RecordingStats& GetStats() const noexcept { return m_stats; }
+        bool IsClosed() const noexcept { return m_closed; }
+
+        // Calls fn(command, payload, size) for each command in a recorded stream, and returns false if
+        // the stream is truncated.
+        template<typename Fn>
+        static bool ForEachCommand(const std::vector<uint8_t>& stream, Fn&& fn)
+        {
+            size_t offset = 0;
+            while (offset < stream.size())
+            {
+                RecordedCommandHeader header;
+                if (stream.size() - offset < sizeof(header))
+                    return false;
+
+                memcpy(&header, stream.data() + offset, sizeof(header));
+                offset += sizeof(header);
+                if (stream.size() - offset < header.size)
+                    return false;
+
+                fn(header.command, stream.data() + offset, size_t(header.size));
+                offset += header.size;
+            }
+            return true;
+        }
+
+        static const char* GetCommandName(RecordedCommand command) noexcept
+        {
+            static const char* s_names[] =
+            {
+                "Close", "Reset", "ClearState", "DrawInstanced", "DrawIndexedInstanced", "Dispatch",
+                "CopyBufferRegion", "CopyTextureRegion", "CopyResource", "CopyTiles", "ResolveSubresource",
+                "IASetPrimitiveTopology", "RSSetViewports", "RSSetScissorRects", "OMSetBlendFactor",
+                "OMSetStencilRef", "SetPipelineState", "ResourceBarrier", "ExecuteBundle", "SetDescriptorHeaps",
+                "SetComputeRootSignature", "SetGraphicsRootSignature", "SetComputeRootDescriptorTable",
+                "SetGraphicsRootDescriptorTable", "SetComputeRoot32BitConstant", "SetGraphicsRoot32BitConstant",
+                "SetComputeRoot32BitConstants", "SetGraphicsRoot32BitConstants", "SetComputeRootConstantBufferView",
+                "SetGraphicsRootConstantBufferView", "SetComputeRootShaderResourceView",
+                "SetGraphicsRootShaderResourceView", "SetComputeRootUnorderedAccessView",
+                "SetGraphicsRootUnorderedAccessView", "IASetIndexBuffer", "IASetVertexBuffers", "SOSetTargets",
+                "OMSetRenderTargets", "ClearDepthStencilView", "ClearRenderTargetView",
+                "ClearUnorderedAccessViewUint", "ClearUnorderedAccessViewFloat", "DiscardResource", "BeginQuery",
+                "EndQuery", "ResolveQueryData", "SetPredication", "SetMarker", "BeginEvent", "EndEvent",
+                "ExecuteIndirect",
+            };
+            static_assert(std::size(s_names) == static_cast<size_t>(RecordedCommand::Count), "Missing command name");
+
+            const auto index = static_cast<size_t>(command);
+            return (index < std::size(s_names)) ? s_names[index] : "Unknown";
+        }
+
+        // IUnknown
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, _COM_Outptr_ void** ppvObject) override
+        {
+            if (!ppvObject)
+                return E_POINTER;
+
+            if (riid == __uuidof(IUnknown)
+                || riid == __uuidof(ID3D12Object)
+                || riid == __uuidof(ID3D12DeviceChild)
+                || riid == __uuidof(ID3D12CommandList)
+                || riid == __uuidof(ID3D12GraphicsCommandList))
+            {
+                *ppvObject = static_cast<ID3D12GraphicsCommandList*>(this);
+                AddRef();
+                return S_OK;
+            }
+
+            *ppvObject = nullptr;
+            return E_NOINTERFACE;
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef() override
+        {
+            return ++m_refCount;
+        }
+
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            const ULONG count = --m_refCount;
+            if (!count)
+                delete this;
+            return count;
+        }
+
+        // ID3D12Object
+        HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID, _Inout_ UINT* pDataSize, _Out_writes_bytes_opt_(*pDataSize) void*) override
+        {
+            if (pDataSize)
+                *pDataSize = 0;
+            return DXGI_ERROR_NOT_FOUND;
+        }
+
+        HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID, UINT, _In_reads_bytes_opt_(DataSize) const void*) override { return S_OK; }
+        HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID, _In_opt_ const IUnknown*) override { return S_OK; }
+        HRESULT STDMETHODCALLTYPE SetName(_In_z_ LPCWSTR) override { return S_OK; }
+
+        // ID3D12DeviceChild
+        HRESULT STDMETHODCALLTYPE GetDevice(REFIID riid, _COM_Outptr_opt_ void** ppvDevice) override
+        {
+            if (!ppvDevice)
+                return E_POINTER;
+
+            if (!m_device)
+            {
+                *ppvDevice = nullptr;
+                return E_FAIL;
+            }
+
+            return m_device->QueryInterface(riid, ppvDevice);
+        }
+
+        // ID3D12CommandList
+        D3D12_COMMAND_LIST_TYPE STDMETHODCALLTYPE GetType() override { return m_type; }
+
+        // ID3D12GraphicsCommandList
+        HRESULT STDMETHODCALLTYPE Close() override
+        {
+            if (m_closed)
+                return E_FAIL;
+
+            Record(RecordedCommand::Close);
+            m_closed = true;
+            m_stats.cpuTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE Reset(_In_ ID3D12CommandAllocator* pAllocator, _In_opt_ ID3D12PipelineState* pInitialState) override
+        {
+            if (!m_closed)
+                return E_FAIL;
+
+            m_stream.clear();
+            m_stats = {};
+            m_closed = false;
+            m_start = std::chrono::steady_clock::now();
+            ResetState();
+
+            Record(RecordedCommand::Reset, Id(pAllocator), Id(pInitialState));
+            m_pipelineState = Id(pInitialState);
+            return S_OK;
+        }
+
+        void STDMETHODCALLTYPE ClearState(_In_opt_ ID3D12PipelineState* pPipelineState) override
+        {
+            Record(RecordedCommand::ClearState, Id(pPipelineState));
+            ResetState();
+            m_pipelineState = Id(pPipelineState);
+        }
+
+        void STDMETHODCALLTYPE DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation) override
+        {
+            Record(RecordedCommand::DrawInstanced, VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
+            ++m_stats.draws;
+        }
+
+        void STDMETHODCALLTYPE DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation) override
+        {
+            Record(RecordedCommand::DrawIndexedInstanced, IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
+            ++m_stats.draws;
+        }
+
+        void STDMETHODCALLTYPE Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ) override
+        {
+            Record(RecordedCommand::Dispatch, ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ);
+        }
+
+        void STDMETHODCALLTYPE CopyBufferRegion(_In_ ID3D12Resource* pDstBuffer, UINT64 DstOffset, _In_ ID3D12Resource* pSrcBuffer, UINT64 SrcOffset, UINT64 NumBytes) override
+        {
+            Record(RecordedCommand::CopyBufferRegion, Id(pDstBuffer), DstOffset, Id(pSrcBuffer), SrcOffset, NumBytes);
+        }
+
+        void STDMETHODCALLTYPE CopyTextureRegion(
+            _In_ const D3D12_TEXTURE_COPY_LOCATION* pDst, UINT DstX, UINT DstY, UINT DstZ,
+            _In_ const D3D12_TEXTURE_COPY_LOCATION* pSrc, _In_opt_ const D3D12_BOX* pSrcBox) override
+        {
+            const D3D12_BOX box = pSrcBox ? *pSrcBox : D3D12_BOX{};
+            Record(RecordedCommand::CopyTextureRegion,
+                CopyLocation(pDst), DstX, DstY, DstZ, CopyLocation(pSrc), static_cast<uint8_t>(pSrcBox != nullptr), box);
+        }
+
+        void STDMETHODCALLTYPE CopyResource(_In_ ID3D12Resource* pDstResource, _In_ ID3D12Resource* pSrcResource) override
+        {
+            Record(RecordedCommand::CopyResource, Id(pDstResource), Id(pSrcResource));
+        }
+
+        void STDMETHODCALLTYPE CopyTiles(
+            _In_ ID3D12Resource* pTiledResource,
+            _In_ const D3D12_TILED_RESOURCE_COORDINATE* pTileRegionStartCoordinate,
+            _In_ const D3D12_TILE_REGION_SIZE* pTileRegionSize,
+            _In_ ID3D12Resource* pBuffer, UINT64 BufferStartOffsetInBytes, D3D12_TILE_COPY_FLAGS Flags) override
+        {
+            Record(RecordedCommand::CopyTiles, Id(pTiledResource),
+                pTileRegionStartCoordinate ? *pTileRegionStartCoordinate : D3D12_TILED_RESOURCE_COORDINATE{},
+                pTileRegionSize ? *pTileRegionSize : D3D12_TILE_REGION_SIZE{},
+                Id(pBuffer), BufferStartOffsetInBytes, Flags);
+        }
+
+        void STDMETHODCALLTYPE ResolveSubresource(_In_ ID3D12Resource* pDstResource, UINT DstSubresource, _In_ ID3D12Resource* pSrcResource, UINT SrcSubresource, DXGI_FORMAT Format) override
+        {
+            Record(RecordedCommand::ResolveSubresource, Id(pDstResource), DstSubresource, Id(pSrcResource), SrcSubresource, Format);
+        }
+
+        void STDMETHODCALLTYPE IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY PrimitiveTopology) override
+        {
+            Record(RecordedCommand::IASetPrimitiveTopology, PrimitiveTopology);
+            Track(m_topology, PrimitiveTopology);
+        }
+
+        void STDMETHODCALLTYPE RSSetViewports(UINT NumViewports, _In_reads_(NumViewports) const D3D12_VIEWPORT* pViewports) override
+        {
+            RecordArray(RecordedCommand::RSSetViewports, pViewports, NumViewports);
+        }
+
+        void STDMETHODCALLTYPE RSSetScissorRects(UINT NumRects, _In_reads_(NumRects) const D3D12_RECT* pRects) override
+        {
+            RecordArray(RecordedCommand::RSSetScissorRects, pRects, NumRects);
+        }
+
+        void STDMETHODCALLTYPE OMSetBlendFactor(_In_reads_opt_(4) const FLOAT BlendFactor[4]) override
+        {
+            float factor[4] = { 1.f, 1.f, 1.f, 1.f };
+            if (BlendFactor)
+                memcpy(factor, BlendFactor, sizeof(factor));
+            Record(RecordedCommand::OMSetBlendFactor, factor);
+        }
+
+        void STDMETHODCALLTYPE OMSetStencilRef(UINT StencilRef) override
+        {
+            Record(RecordedCommand::OMSetStencilRef, StencilRef);
+        }
+
+        void STDMETHODCALLTYPE SetPipelineState(_In_ ID3D12PipelineState* pPipelineState) override
+        {
+            Record(RecordedCommand::SetPipelineState, Id(pPipelineState));
+            if (Track(m_pipelineState, Id(pPipelineState)))
+                ++m_stats.pipelineChanges;
+        }
+
+        void STDMETHODCALLTYPE ResourceBarrier(UINT NumBarriers, _In_reads_(NumBarriers) const D3D12_RESOURCE_BARRIER* pBarriers) override
+        {
+            RecordArray(RecordedCommand::ResourceBarrier, pBarriers, NumBarriers);
+        }
+
+        void STDMETHODCALLTYPE ExecuteBundle(_In_ ID3D12GraphicsCommandList* pCommandList) override
+        {
+            Record(RecordedCommand::ExecuteBundle, Id(pCommandList));
+        }
+
+        void STDMETHODCALLTYPE SetDescriptorHeaps(UINT NumDescriptorHeaps, _In_reads_(NumDescriptorHeaps) ID3D12DescriptorHeap* const* ppDescriptorHeaps) override
+        {
+            // A command list can have at most one CBV/SRV/UAV heap and one sampler heap bound
+            uint64_t heaps[2] = {};
+            const UINT count = ppDescriptorHeaps ? std::min<UINT>(NumDescriptorHeaps, UINT(std::size(heaps))) : 0;
+            for (UINT j = 0; j < count; ++j)
+                heaps[j] = Id(ppDescriptorHeaps[j]);
+
+            RecordArray(RecordedCommand::SetDescriptorHeaps, heaps, count);
+
+            std::sort(std::begin(heaps), std::end(heaps));
+            if (memcmp(heaps, m_descriptorHeaps, sizeof(heaps)) != 0)
+            {
+                memcpy(m_descriptorHeaps, heaps, sizeof(heaps));
+                ++m_stats.descriptorHeapChanges;
+            }
+            else
+            {
+                ++m_stats.redundantSets;
+            }
+        }
+
+        void STDMETHODCALLTYPE SetComputeRootSignature(_In_opt_ ID3D12RootSignature* pRootSignature) override
+        {
+            Record(RecordedCommand::SetComputeRootSignature, Id(pRootSignature));
+            SetRootSignature(m_compute, Id(pRootSignature));
+        }
+
+        void STDMETHODCALLTYPE SetGraphicsRootSignature(_In_opt_ ID3D12RootSignature* pRootSignature) override
+        {
+            Record(RecordedCommand::SetGraphicsRootSignature, Id(pRootSignature));
+            SetRootSignature(m_graphics, Id(pRootSignature));
+        }
+
+        void STDMETHODCALLTYPE SetComputeRootDescriptorTable(UINT RootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE BaseDescriptor) override
+        {
+            Record(RecordedCommand::SetComputeRootDescriptorTable, RootParameterIndex, BaseDescriptor.ptr);
+            SetRootParameter(m_compute, RootParameterIndex, BaseDescriptor.ptr);
+        }
+
+        void STDMETHODCALLTYPE SetGraphicsRootDescriptorTable(UINT RootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE BaseDescriptor) override
+        {
+            Record(RecordedCommand::SetGraphicsRootDescriptorTable, RootParameterIndex, BaseDescriptor.ptr);
+            SetRootParameter(m_graphics, RootParameterIndex, BaseDescriptor.ptr);
+        }
+
+        void STDMETHODCALLTYPE SetComputeRoot32BitConstant(UINT RootParameterIndex, UINT SrcData, UINT DestOffsetIn32BitValues) override
+        {
+            Record(RecordedCommand::SetComputeRoot32BitConstant, RootParameterIndex, SrcData, DestOffsetIn32BitValues);
+            ++m_stats.rootParameterSets;
+        }
+
+        void STDMETHODCALLTYPE SetGraphicsRoot32BitConstant(UINT RootParameterIndex, UINT SrcData, UINT DestOffsetIn32BitValues) override
+        {
+            Record(RecordedCommand::SetGraphicsRoot32BitConstant, RootParameterIndex, SrcData, DestOffsetIn32BitValues);
+            ++m_stats.rootParameterSets;
+        }
+
+        void STDMETHODCALLTYPE SetComputeRoot32BitConstants(UINT RootParameterIndex, UINT Num32BitValuesToSet, _In_reads_(Num32BitValuesToSet * sizeof(UINT)) const void* pSrcData, UINT DestOffsetIn32BitValues) override
+        {
+            RecordArray(RecordedCommand::SetComputeRoot32BitConstants, static_cast<const uint32_t*>(pSrcData), Num32BitValuesToSet, RootParameterIndex, DestOffsetIn32BitValues);
+            ++m_stats.rootParameterSets;
+        }
+
+        void STDMETHODCALLTYPE SetGraphicsRoot32BitConstants(UINT RootParameterIndex, UINT Num32BitValuesToSet, _In_reads_(Num32BitValuesToSet * sizeof(UINT)) const void* pSrcData, UINT DestOffsetIn32BitValues) override
+        {
+            RecordArray(RecordedCommand::SetGraphicsRoot32BitConstants, static_cast<const uint32_t*>(pSrcData), Num32BitValuesToSet, RootParameterIndex, DestOffsetIn32BitValues);
+            ++m_stats.rootParameterSets;
+        }
+
+        void STDMETHODCALLTYPE SetComputeRootConstantBufferView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation) override
+        {
+            Record(RecordedCommand::SetComputeRootConstantBufferView, RootParameterIndex, BufferLocation);
+            SetRootParameter(m_compute, RootParameterIndex, BufferLocation);
+        }
+
+        void STDMETHODCALLTYPE SetGraphicsRootConstantBufferView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation) override
+        {
+            Record(RecordedCommand::SetGraphicsRootConstantBufferView, RootParameterIndex, BufferLocation);
+            SetRootParameter(m_graphics, RootParameterIndex, BufferLocation);
+        }
+
+        void STDMETHODCALLTYPE SetComputeRootShaderResourceView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation) override
+        {
+            Record(RecordedCommand::SetComputeRootShaderResourceView, RootParameterIndex, BufferLocation);
+            SetRootParameter(m_compute, RootParameterIndex, BufferLocation);
+        }
+
+        void STDMETHODCALLTYPE SetGraphicsRootShaderResourceView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation) override
+        {
+            Record(RecordedCommand::SetGraphicsRootShaderResourceView, RootParameterIndex, BufferLocation);
+            SetRootParameter(m_graphics, RootParameterIndex, BufferLocation);
+        }
+
+        void STDMETHODCALLTYPE SetComputeRootUnorderedAccessView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation) override
+        {
+            Record(RecordedCommand::SetComputeRootUnorderedAccessView, RootParameterIndex, BufferLocation);
+            SetRootParameter(m_compute, RootParameterIndex, BufferLocation);
+        }
+
+        void STDMETHODCALLTYPE SetGraphicsRootUnorderedAccessView(UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation) override
+        {
+            Record(RecordedCommand::SetGraphicsRootUnorderedAccessView, RootParameterIndex, BufferLocation);
+            SetRootParameter(m_graphics, RootParameterIndex, BufferLocation);
+        }
+
+        void STDMETHODCALLTYPE IASetIndexBuffer(_In_opt_ const D3D12_INDEX_BUFFER_VIEW* pView) override
+        {
+            const D3D12_INDEX_BUFFER_VIEW view = pView ? *pView : D3D12_INDEX_BUFFER_VIEW{};
+            Record(RecordedCommand::IASetIndexBuffer, view);
+
+            if (memcmp(&view, &m_indexBuffer, sizeof(view)) == 0)
+            {
+                ++m_stats.redundantSets;
+            }
+            else
+            {
+                m_indexBuffer = view;
+            }
+        }
+
+        void STDMETHODCALLTYPE IASetVertexBuffers(UINT StartSlot, UINT NumViews, _In_reads_opt_(NumViews) const D3D12_VERTEX_BUFFER_VIEW* pViews) override
+        {
+            RecordArray(RecordedCommand::IASetVertexBuffers, pViews, pViews ? NumViews : 0, StartSlot);
+
+            bool changed = false;
+            for (UINT j = 0; j < NumViews && StartSlot + j < c_maxVertexBuffers; ++j)
+            {
+                const D3D12_VERTEX_BUFFER_VIEW view = pViews ? pViews[j] : D3D12_VERTEX_BUFFER_VIEW{};
+                if (memcmp(&view, &m_vertexBuffers[StartSlot + j], sizeof(view)) != 0)
+                {
+                    m_vertexBuffers[StartSlot + j] = view;
+                    changed = true;
+                }
+            }
+
+            if (!changed)
+                ++m_stats.redundantSets;
+        }
+
+        void STDMETHODCALLTYPE SOSetTargets(UINT StartSlot, UINT NumViews, _In_reads_opt_(NumViews) const D3D12_STREAM_OUTPUT_BUFFER_VIEW* pViews) override
+        {
+            RecordArray(RecordedCommand::SOSetTargets, pViews, pViews ? NumViews : 0, StartSlot);
+        }
+
+        void STDMETHODCALLTYPE OMSetRenderTargets(
+            UINT NumRenderTargetDescriptors,
+            _In_opt_ const D3D12_CPU_DESCRIPTOR_HANDLE* pRenderTargetDescriptors,
+            BOOL RTsSingleHandleToDescriptorRange,
+            _In_opt_ const D3D12_CPU_DESCRIPTOR_HANDLE* pDepthStencilDescriptor) override
+        {
+            uint64_t handles[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT] = {};
+            const UINT count = pRenderTargetDescriptors ? std::min<UINT>(NumRenderTargetDescriptors, D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT) : 0;
+            for (UINT j = 0; j < count; ++j)
+            {
+                handles[j] = RTsSingleHandleToDescriptorRange ? (pRenderTargetDescriptors->ptr + j) : pRenderTargetDescriptors[j].ptr;
+            }
+
+            RecordArray(RecordedCommand::OMSetRenderTargets, handles, count,
+                static_cast<uint64_t>(pDepthStencilDescriptor ? pDepthStencilDescriptor->ptr : 0));
+        }
+
+        void STDMETHODCALLTYPE ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView, D3D12_CLEAR_FLAGS ClearFlags, FLOAT Depth, UINT8 Stencil, UINT NumRects, _In_reads_(NumRects) const D3D12_RECT* pRects) override
+        {
+            RecordArray(RecordedCommand::ClearDepthStencilView, pRects, pRects ? NumRects : 0,
+                static_cast<uint64_t>(DepthStencilView.ptr), ClearFlags, Depth, Stencil);
+        }
+
+        void STDMETHODCALLTYPE ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE RenderTargetView, _In_ const FLOAT ColorRGBA[4], UINT NumRects, _In_reads_(NumRects) const D3D12_RECT* pRects) override
+        {
+            float color[4] = {};
+            if (ColorRGBA)
+                memcpy(color, ColorRGBA, sizeof(color));
+            RecordArray(RecordedCommand::ClearRenderTargetView, pRects, pRects ? NumRects : 0,
+                static_cast<uint64_t>(RenderTargetView.ptr), color);
+        }
+
+        void STDMETHODCALLTYPE ClearUnorderedAccessViewUint(
+            D3D12_GPU_DESCRIPTOR_HANDLE ViewGPUHandleInCurrentHeap, D3D12_CPU_DESCRIPTOR_HANDLE ViewCPUHandle,
+            _In_ ID3D12Resource* pResource, _In_ const UINT Values[4], UINT NumRects, _In_reads_(NumRects) const D3D12_RECT* pRects) override
+        {
+            uint32_t values[4] = {};
+            if (Values)
+                memcpy(values, Values, sizeof(values));
+            RecordArray(RecordedCommand::ClearUnorderedAccessViewUint, pRects, pRects ? NumRects : 0,
+                ViewGPUHandleInCurrentHeap.ptr, static_cast<uint64_t>(ViewCPUHandle.ptr), Id(pResource), values);
+        }
+
+        void STDMETHODCALLTYPE ClearUnorderedAccessViewFloat(
+            D3D12_GPU_DESCRIPTOR_HANDLE ViewGPUHandleInCurrentHeap, D3D12_CPU_DESCRIPTOR_HANDLE ViewCPUHandle,
+            _In_ ID3D12Resource* pResource, _In_ const FLOAT Values[4], UINT NumRects, _In_reads_(NumRects) const D3D12_RECT* pRects) override
+        {
+            float values[4] = {};
+            if (Values)
+                memcpy(values, Values, sizeof(values));
+            RecordArray(RecordedCommand::ClearUnorderedAccessViewFloat, pRects, pRects ? NumRects : 0,
+                ViewGPUHandleInCurrentHeap.ptr, static_cast<uint64_t>(ViewCPUHandle.ptr), Id(pResource), values);
+        }
+
+        void STDMETHODCALLTYPE DiscardResource(_In_ ID3D12Resource* pResource, _In_opt_ const D3D12_DISCARD_REGION* pRegion) override
+        {
+            Record(RecordedCommand::DiscardResource, Id(pResource),
+                pRegion ? pRegion->FirstSubresource : 0u, pRegion ? pRegion->NumSubresources : 0u);
+        }
+
+        void STDMETHODCALLTYPE BeginQuery(_In_ ID3D12QueryHeap* pQueryHeap, D3D12_QUERY_TYPE Type, UINT Index) override
+        {
+            Record(RecordedCommand::BeginQuery, Id(pQueryHeap), Type, Index);
+        }
+
+        void STDMETHODCALLTYPE EndQuery(_In_ ID3D12QueryHeap* pQueryHeap, D3D12_QUERY_TYPE Type, UINT Index) override
+        {
+            Record(RecordedCommand::EndQuery, Id(pQueryHeap), Type, Index);
+        }
+
+        void STDMETHODCALLTYPE ResolveQueryData(
+            _In_ ID3D12QueryHeap* pQueryHeap, D3D12_QUERY_TYPE Type, UINT StartIndex, UINT NumQueries,
+            _In_ ID3D12Resource* pDestinationBuffer, UINT64 AlignedDestinationBufferOffset) override
+        {
+            Record(RecordedCommand::ResolveQueryData, Id(pQueryHeap), Type, StartIndex, NumQueries, Id(pDestinationBuffer), AlignedDestinationBufferOffset);
+        }
+
+        void STDMETHODCALLTYPE SetPredication(_In_opt_ ID3D12Resource* pBuffer, UINT64 AlignedBufferOffset, D3D12_PREDICATION_OP Operation) override
+        {
+            Record(RecordedCommand::SetPredication, Id(pBuffer), AlignedBufferOffset, Operation);
+        }
+
+        void STDMETHODCALLTYPE SetMarker(UINT Metadata, _In_reads_bytes_opt_(Size) const void* pData, UINT Size) override
+        {
+            RecordArray(RecordedCommand::SetMarker, static_cast<const uint8_t*>(pData), pData ? Size : 0, Metadata);
+        }
+
+        void STDMETHODCALLTYPE BeginEvent(UINT Metadata, _In_reads_bytes_opt_(Size) const void* pData, UINT Size) override
+        {
+            RecordArray(RecordedCommand::BeginEvent, static_cast<const uint8_t*>(pData), pData ? Size : 0, Metadata);
+        }
+
+        void STDMETHODCALLTYPE EndEvent() override
+        {
+            Record(RecordedCommand::EndEvent);
+        }
+
+        void STDMETHODCALLTYPE ExecuteIndirect(
+            _In_ ID3D12CommandSignature* pCommandSignature, UINT MaxCommandCount,
+            _In_ ID3D12Resource* pArgumentBuffer, UINT64 ArgumentBufferOffset,
+            _In_opt_ ID3D12Resource* pCountBuffer, UINT64 CountBufferOffset) override
+        {
+            Record(RecordedCommand::ExecuteIndirect, Id(pCommandSignature), MaxCommandCount, Id(pArgumentBuffer), ArgumentBufferOffset, Id(pCountBuffer), CountBufferOffset);
+            ++m_stats.draws;
+        }
+
+    private:
+        struct RootState
+        {
+            uint64_t rootSignature;
+            uint64_t parameters[c_maxRootParameters];
+        };
+
+        RecordingCommandList(_In_opt_ ID3D12Device* device, D3D12_COMMAND_LIST_TYPE type) noexcept :
+            m_refCount(1),
+            m_device(device),
+            m_type(type),
+            m_closed(false),
+            m_start(std::chrono::steady_clock::now()),
+            m_stats{}
+        {
+            ResetState();
+        }
+
+        ~RecordingCommandList() = default;
+
+        static uint64_t Id(_In_opt_ const void* object) noexcept
+        {
+            return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(object));
+        }
+
+        struct CopyLocationRecord
+        {
+            uint64_t resource;
+            uint32_t type;
+            uint32_t subresourceIndex;
+            D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+        };
+
+        static CopyLocationRecord CopyLocation(_In_opt_ const D3D12_TEXTURE_COPY_LOCATION* location) noexcept
+        {
+            CopyLocationRecord result = {};
+            if (location)
+            {
+                result.resource = Id(location->pResource);
+                result.type = static_cast<uint32_t>(location->Type);
+                if (location->Type == D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT)
+                    result.footprint = location->PlacedFootprint;
+                else
+                    result.subresourceIndex = location->SubresourceIndex;
+            }
+            return result;
+        }
+
+        uint8_t* Append(RecordedCommand command, size_t size)
+        {
+            ++m_stats.counts[static_cast<size_t>(command)];
+
+            RecordedCommandHeader header = { command, 0, static_cast<uint32_t>(size) };
+            const size_t offset = m_stream.size();
+            m_stream.resize(offset + sizeof(header) + size);
+            memcpy(m_stream.data() + offset, &header, sizeof(header));
+            return m_stream.data() + offset + sizeof(header);
+        }
+
+        template<typename T>
+        static uint8_t* Write(uint8_t* dest, const T& value) noexcept
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be recorded");
+            memcpy(dest, &value, sizeof(T));
+            return dest + sizeof(T);
+        }
+
+        template<typename... Args>
+        void Record(RecordedCommand command, const Args&... args)
+        {
+            uint8_t* dest = Append(command, (size_t(0) + ... + sizeof(Args)));
+            ((dest = Write(dest, args)), ...);
+            (void)dest;
+        }
+
+        template<typename T, typename... Args>
+        void RecordArray(RecordedCommand command, _In_reads_opt_(count) const T* items, UINT count, const Args&... args)
+        {
+            if (!items)
+                count = 0;
+
+            uint8_t* dest = Append(command, (size_t(0) + ... + sizeof(Args)) + sizeof(uint32_t) + size_t(count) * sizeof(T));
+            ((dest = Write(dest, args)), ...);
+            dest = Write(dest, static_cast<uint32_t>(count));
+            if (count > 0)
+                memcpy(dest, items, size_t(count) * sizeof(T));
+        }
+
+        template<typename T>
+        bool Track(T& current, const T& value) noexcept
+        {
+            if (current == value)
+            {
+                ++m_stats.redundantSets;
+                return false;
+            }
+
+            current = value;
+            return true;
+        }
+
+        void SetRootSignature(RootState& state, uint64_t rootSignature) noexcept
+        {
+            // Changing the root signature invalidates all root parameters
+            if (Track(state.rootSignature, rootSignature))
+            {
+                ++m_stats.rootSignatureChanges;
+                std::fill(std::begin(state.parameters), std::end(state.parameters), UINT64_MAX);
+            }
+        }
+
+        void SetRootParameter(RootState& state, UINT index, uint64_t value) noexcept
+        {
+            ++m_stats.rootParameterSets;
+            if (index < c_maxRootParameters)
+                Track(state.parameters[index], value);
+        }
+
+        void ResetState() noexcept
+        {
+            m_pipelineState = 0;
+            m_topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+            m_indexBuffer = {};
+            memset(m_vertexBuffers, 0, sizeof(m_vertexBuffers));
+            memset(m_descriptorHeaps, 0, sizeof(m_descriptorHeaps));
+            m_graphics.rootSignature = m_compute.rootSignature = 0;
+            std::fill(std::begin(m_graphics.parameters), std::end(m_graphics.parameters), UINT64_MAX);
+            std::fill(std::begin(m_compute.parameters), std::end(m_compute.parameters), UINT64_MAX);
+        }
+
+        std::atomic<ULONG>                          m_refCount;
+        Microsoft::WRL::ComPtr<ID3D12Device>        m_device;
+        D3D12_COMMAND_LIST_TYPE                     m_type;
+        bool                                        m_closed;
+        std::chrono::steady_clock::time_point       m_start;
+
+        std::vector<uint8_t>                        m_stream;
+        RecordingStats                              m_stats;
+
+        // Current state, for counting changes and redundant sets
+        uint64_t                                    m_pipelineState;
+        D3D12_PRIMITIVE_TOPOLOGY                    m_topology;
+        D3D12_INDEX_BUFFER_VIEW                     m_indexBuffer;
+        D3D12_VERTEX_BUFFER_VIEW                    m_vertexBuffers[c_maxVertexBuffers];
+        uint64_t                                    m_descriptorHeaps[2];
+        RootState                                   m_graphics;
+        RootState                                   m_compute;
+    };
+#endif
+}
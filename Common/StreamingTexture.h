@@ -0,0 +1,366 @@
+//
+// StreamingTexture.h - DDS texture whose mip chain is uploaded over several frames, smallest first
+//
+
+#pragma once
+
+#include "UploadRing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+// Expects DDSTextureLoader.h to be included first.
+
+namespace DX
+{
+    // Loads a DDS file and creates its texture, but uploads none of it. Each Update then copies
+    // the next mip levels, from the smallest up, through an UploadRing within a byte budget. A
+    // level larger than what is left of the budget is copied in bands of rows across several
+    // Updates. The shader resource view clamps the minimum LOD to the most detailed level that is
+    // fully resident, so the texture can be drawn as soon as the smallest level is.
+    class StreamingTexture
+    {
+    public:
+        struct Statistics
+        {
+            double  timeToFirstMip;         // Milliseconds from Create to recording the smallest level, or zero
+            double  timeToFullyResident;    // Milliseconds from Create to recording the top level, or zero
+            UINT64  bytesUploaded;
+            UINT64  peakUpdateBytes;
+            UINT    updates;                // Updates that uploaded data
+            UINT    updatesOverBudget;      // Updates that exceeded the budget to copy a single row or volume level
+        };
+
+        StreamingTexture() noexcept :
+            m_device(nullptr),
+            m_desc{},
+            m_isCubeMap(false),
+            m_arraySize(0),
+            m_residentMip(0),
+            m_nextSlice(0),
+            m_nextRow(0),
+            m_state(D3D12_RESOURCE_STATE_COPY_DEST),
+            m_stats{}
+        {
+        }
+
+        StreamingTexture(StreamingTexture&&) = default;
+        StreamingTexture& operator= (StreamingTexture&&) = default;
+
+        StreamingTexture(StreamingTexture const&) = delete;
+        StreamingTexture& operator= (StreamingTexture const&) = delete;
+
+        void Create(
+            _In_ ID3D12Device* device,
+            _In_z_ const wchar_t* fileName,
+            DirectX::DDS_LOADER_FLAGS loadFlags = DirectX::DDS_LOADER_DEFAULT)
+        {
+            Release();
+
+            m_start = std::chrono::steady_clock::now();
+
+            ThrowIfFailed(DirectX::LoadDDSTextureFromFileEx(device, fileName,
+                0, D3D12_RESOURCE_FLAG_NONE, loadFlags,
+                m_texture.ReleaseAndGetAddressOf(), m_ddsData, m_subresources,
+                nullptr, &m_isCubeMap));
+
+        #if defined(_MSC_VER) || !defined(_WIN32)
+            m_desc = m_texture->GetDesc();
+        #else
+            std::ignore = m_texture->GetDesc(&m_desc);
+        #endif
+
+            m_device = device;
+            m_arraySize = (m_desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D) ? 1u : m_desc.DepthOrArraySize;
+            m_residentMip = m_desc.MipLevels;
+            m_state = D3D12_RESOURCE_STATE_COPY_DEST;
+        }
+
+        void Release() noexcept
+        {
+            m_texture.Reset();
+            m_ddsData.reset();
+            m_subresources.clear();
+            m_device = nullptr;
+            m_desc = {};
+            m_isCubeMap = false;
+            m_arraySize = m_residentMip = m_nextSlice = m_nextRow = 0;
+            m_stats = {};
+        }
+
+        // Records the copies for the next levels, up to 'budget' bytes of texel data or all that
+        // is left if it is zero, and leaves the texture in the pixel shader resource state.
+        // Returns true if the resident mip changed, so shader resource views need creating again.
+        bool Update(_In_ ID3D12GraphicsCommandList* commandList, UploadRing& ring, UINT64 budget)
+        {
+            if (!m_texture || IsFullyResident())
+                return false;
+
+            if (!budget)
+                budget = UINT64(-1);
+
+            const UINT previousMip = m_residentMip;
+            UINT64 bytes = 0;
+
+            if (m_state != D3D12_RESOURCE_STATE_COPY_DEST)
+            {
+                Transition(commandList, m_state, D3D12_RESOURCE_STATE_COPY_DEST);
+            }
+
+            if (GetCopyablePlaneCount(m_desc.Format) > 1)
+            {
+                // Planes are separate subresources, so upload everything at once
+                ring.Upload(commandList, m_texture.Get(), 0, static_cast<UINT>(m_subresources.size()), m_subresources.data());
+                for (const auto& it : m_subresources)
+                {
+                    bytes += UINT64(it.SlicePitch);
+                }
+                m_residentMip = 0;
+            }
+
+            while (m_residentMip > 0 && bytes < budget)
+            {
+                const UINT level = m_residentMip - 1;
+
+                D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout;
+                UINT numRows;
+                UINT64 rowSize;
+                GetFootprint(level, layout, numRows, rowSize);
+
+                for (; m_nextSlice < m_arraySize && bytes < budget; ++m_nextSlice, m_nextRow = 0)
+                {
+                    const UINT subresource = level + m_nextSlice * m_desc.MipLevels;
+                    const auto& src = m_subresources[subresource];
+
+                    if (layout.Footprint.Depth > 1)
+                    {
+                        // Volume levels are copied whole
+                        const UINT64 size = rowSize * numRows * layout.Footprint.Depth;
+                        if (bytes > 0 && bytes + size > budget)
+                            break;
+
+                        ring.Upload(commandList, m_texture.Get(), subresource, 1, &src);
+                        bytes += size;
+                        continue;
+                    }
+
+                    const UINT rowsLeft = numRows - m_nextRow;
+                    UINT rows = static_cast<UINT>(std::min<UINT64>(rowsLeft, (budget - bytes) / rowSize));
+                    if (!rows)
+                    {
+                        if (bytes > 0)
+                            break;
+
+                        rows = 1;
+                    }
+
+                    CopyRows(commandList, ring, subresource, layout, numRows, m_nextRow, rows, rowSize, src);
+                    bytes += rowSize * rows;
+
+                    m_nextRow += rows;
+                    if (m_nextRow < numRows)
+                        break;
+                }
+
+                if (m_nextSlice < m_arraySize)
+                    break;
+
+                m_residentMip = level;
+                m_nextSlice = 0;
+            }
+
+            Transition(commandList, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+            m_state = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+
+            const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+            if (previousMip == m_desc.MipLevels && m_residentMip < previousMip)
+            {
+                m_stats.timeToFirstMip = elapsed;
+            }
+
+            ++m_stats.updates;
+            m_stats.bytesUploaded += bytes;
+            m_stats.peakUpdateBytes = std::max(m_stats.peakUpdateBytes, bytes);
+            if (bytes > budget)
+            {
+                ++m_stats.updatesOverBudget;
+            }
+
+            if (IsFullyResident())
+            {
+                // The data is staged in the ring by now
+                m_stats.timeToFullyResident = elapsed;
+                m_ddsData.reset();
+                m_subresources.clear();
+            }
+
+            return m_residentMip != previousMip;
+        }
+
+        // The view clamps the minimum LOD to the resident mip. It must be created again after
+        // Update returns true, into a descriptor the GPU is no longer using.
+        void CreateShaderResourceView(_In_ ID3D12Device* device, D3D12_CPU_DESCRIPTOR_HANDLE srvDescriptor) const
+        {
+            if (!m_texture)
+            {
+                throw std::logic_error("StreamingTexture is not created");
+            }
+
+            D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+            srvDesc.Format = m_desc.Format;
+            srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+
+            const UINT mipLevels = m_desc.MipLevels;
+            const float minLOD = static_cast<float>(std::min(m_residentMip, mipLevels - 1));
+
+            switch (m_desc.Dimension)
+            {
+            case D3D12_RESOURCE_DIMENSION_TEXTURE1D:
+                if (m_arraySize > 1)
+                {
+                    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE1DARRAY;
+                    srvDesc.Texture1DArray.MipLevels = mipLevels;
+                    srvDesc.Texture1DArray.ArraySize = m_arraySize;
+                    srvDesc.Texture1DArray.ResourceMinLODClamp = minLOD;
+                }
+                else
+                {
+                    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE1D;
+                    srvDesc.Texture1D.MipLevels = mipLevels;
+                    srvDesc.Texture1D.ResourceMinLODClamp = minLOD;
+                }
+                break;
+
+            case D3D12_RESOURCE_DIMENSION_TEXTURE2D:
+                if (m_isCubeMap)
+                {
+                    if (m_arraySize > 6)
+                    {
+                        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBEARRAY;
+                        srvDesc.TextureCubeArray.MipLevels = mipLevels;
+                        srvDesc.TextureCubeArray.NumCubes = m_arraySize / 6;
+                        srvDesc.TextureCubeArray.ResourceMinLODClamp = minLOD;
+                    }
+                    else
+                    {
+                        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+                        srvDesc.TextureCube.MipLevels = mipLevels;
+                        srvDesc.TextureCube.ResourceMinLODClamp = minLOD;
+                    }
+                }
+                else if (m_arraySize > 1)
+                {
+                    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+                    srvDesc.Texture2DArray.MipLevels = mipLevels;
+                    srvDesc.Texture2DArray.ArraySize = m_arraySize;
+                    srvDesc.Texture2DArray.ResourceMinLODClamp = minLOD;
+                }
+                else
+                {
+                    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+                    srvDesc.Texture2D.MipLevels = mipLevels;
+                    srvDesc.Texture2D.ResourceMinLODClamp = minLOD;
+                }
+                break;
+
+            case D3D12_RESOURCE_DIMENSION_TEXTURE3D:
+                srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE3D;
+                srvDesc.Texture3D.MipLevels = mipLevels;
+                srvDesc.Texture3D.ResourceMinLODClamp = minLOD;
+                break;
+
+            default:
+                throw std::invalid_argument("StreamingTexture only supports textures");
+            }
+
+            device->CreateShaderResourceView(m_texture.Get(), &srvDesc, srvDescriptor);
+        }
+
+        ID3D12Resource* GetResource() const noexcept { return m_texture.Get(); }
+        UINT GetResidentMip() const noexcept { return m_residentMip; }
+        bool IsFullyResident() const noexcept { return m_texture && !m_residentMip; }
+
+        Statistics GetStatistics() const noexcept { return m_stats; }
+
+    private:
+        void Transition(_In_ ID3D12GraphicsCommandList* commandList, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after) const
+        {
+            const auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_texture.Get(), before, after);
+            commandList->ResourceBarrier(1, &barrier);
+        }
+
+        void GetFootprint(UINT level, D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout, UINT& numRows, UINT64& rowSize) const
+        {
+            UINT64 totalBytes = 0;
+            if (FAILED(GetCopyableFootprints(m_desc, level, 1, 0, &layout, &numRows, &rowSize, &totalBytes)))
+            {
+                m_device->GetCopyableFootprints(&m_desc, level, 1, 0, &layout, &numRows, &rowSize, &totalBytes);
+            }
+
+            if (totalBytes == UINT64(-1) || !numRows || !rowSize || rowSize > SIZE_T(-1))
+            {
+                throw std::invalid_argument("StreamingTexture cannot upload this texture");
+            }
+        }
+
+        // Copies rows [firstRow, firstRow + rows) of a 2D subresource, where a row is one row of
+        // blocks for block-compressed formats.
+        void CopyRows(
+            _In_ ID3D12GraphicsCommandList* commandList,
+            UploadRing& ring,
+            UINT subresource,
+            const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout,
+            UINT numRows,
+            UINT firstRow,
+            UINT rows,
+            UINT64 rowSize,
+            const D3D12_SUBRESOURCE_DATA& src) const
+        {
+            const UINT rowHeight = layout.Footprint.Height / numRows;
+            const UINT rowPitch = layout.Footprint.RowPitch;
+
+            const auto alloc = ring.Allocate(UINT64(rowPitch) * rows);
+
+            const Internal::StagingCopy copy = {
+                alloc.memory,
+                static_cast<const uint8_t*>(src.pData) + size_t(src.RowPitch) * firstRow,
+                rowPitch,
+                static_cast<size_t>(src.RowPitch),
+                static_cast<size_t>(rowSize),
+                rows
+            };
+            Internal::CopyRows(copy);
+            Internal::StreamFence();
+
+            D3D12_PLACED_SUBRESOURCE_FOOTPRINT band = layout;
+            band.Offset = alloc.offset;
+            band.Footprint.Height = rows * rowHeight;
+
+            const CD3DX12_TEXTURE_COPY_LOCATION dst(m_texture.Get(), subresource);
+            const CD3DX12_TEXTURE_COPY_LOCATION srcLocation(alloc.resource, band);
+            commandList->CopyTextureRegion(&dst, 0, firstRow * rowHeight, 0, &srcLocation, nullptr);
+        }
+
+        ID3D12Device*                                   m_device;
+        Microsoft::WRL::ComPtr<ID3D12Resource>          m_texture;
+        std::unique_ptr<uint8_t[]>                      m_ddsData;
+        std::vector<D3D12_SUBRESOURCE_DATA>             m_subresources;
+        D3D12_RESOURCE_DESC                             m_desc;
+        bool                                            m_isCubeMap;
+        UINT                                            m_arraySize;
+
+        // Levels from m_residentMip down are uploaded; the next level is done up to this slice and row.
+        UINT                                            m_residentMip;
+        UINT                                            m_nextSlice;
+        UINT                                            m_nextRow;
+        D3D12_RESOURCE_STATES                           m_state;
+
+        std::chrono::steady_clock::time_point           m_start;
+        Statistics                                      m_stats;
+    };
+}
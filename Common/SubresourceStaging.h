@@ -0,0 +1,294 @@
+//--------------------------------------------------------------------------------------
+// File: SubresourceStaging.h
+//
+// Helpers for copying subresource data into an upload buffer laid out by
+// GetCopyableFootprints, as UpdateSubresources does, but merging contiguous rows into
+// single copies, using non-temporal stores, and optionally across several threads
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// Expects d3d12.h and d3dx12.h to be included first.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define DX_STAGING_STREAM_STORES
+#endif
+
+namespace DX
+{
+    // Copies are split into pieces of about this size to share them between threads.
+    constexpr size_t c_stagingChunkSize = 256 * 1024;
+
+    // Below this many bytes in total, the cost of starting threads outweighs the copy.
+    constexpr size_t c_minParallelStagingBytes = 4 * 1024 * 1024;
+
+    // Copies smaller than this go through memcpy, which is as good for data that fits in cache.
+    constexpr size_t c_minStreamingCopy = 4096;
+
+    namespace Internal
+    {
+        // Copies 'size' bytes with 16-byte non-temporal stores, which write whole lines to
+        // write-combined upload heap memory without reading it into the cache first. Callers
+        // must end with StreamFence.
+        inline void StreamCopy(_Out_writes_bytes_(size) void* dest, _In_reads_bytes_(size) const void* src, size_t size) noexcept
+        {
+        #ifdef DX_STAGING_STREAM_STORES
+            if (size < c_minStreamingCopy)
+            {
+                memcpy(dest, src, size);
+                return;
+            }
+
+            auto d = static_cast<uint8_t*>(dest);
+            auto s = static_cast<const uint8_t*>(src);
+
+            const size_t head = (16 - (reinterpret_cast<uintptr_t>(d) & 15)) & 15;
+            memcpy(d, s, head);
+            d += head;
+            s += head;
+            size -= head;
+
+            const size_t blocks = size / 64;
+            for (size_t j = 0; j < blocks; ++j)
+            {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+                const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+                const __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+                _mm_stream_si128(reinterpret_cast<__m128i*>(d), a);
+                _mm_stream_si128(reinterpret_cast<__m128i*>(d + 16), b);
+                _mm_stream_si128(reinterpret_cast<__m128i*>(d + 32), c);
+                _mm_stream_si128(reinterpret_cast<__m128i*>(d + 48), e);
+                d += 64;
+                s += 64;
+            }
+
+            memcpy(d, s, size & 63);
+        #else
+            memcpy(dest, src, size);
+        #endif
+        }
+
+        // Streaming stores are weakly ordered, so make them visible before the buffer is unmapped or used.
+        inline void StreamFence() noexcept
+        {
+        #ifdef DX_STAGING_STREAM_STORES
+            _mm_sfence();
+        #endif
+        }
+
+        // 'rows' rows of 'rowSize' bytes, pitched in both source and destination
+        struct StagingCopy
+        {
+            uint8_t*        dest;
+            const uint8_t*  src;
+            size_t          destPitch;
+            size_t          srcPitch;
+            size_t          rowSize;
+            size_t          rows;
+        };
+
+        inline void CopyRows(const StagingCopy& copy) noexcept
+        {
+            for (size_t y = 0; y < copy.rows; ++y)
+            {
+                StreamCopy(copy.dest + copy.destPitch * y, copy.src + copy.srcPitch * y, copy.rowSize);
+            }
+        }
+
+        // Adds the copies for 'rows' rows, in pieces of about c_stagingChunkSize bytes. Contiguous
+        // rows are merged, and then split by bytes rather than rows.
+        inline void AddCopies(std::vector<StagingCopy>& copies, const StagingCopy& rows)
+        {
+            if (rows.destPitch == rows.rowSize && rows.srcPitch == rows.rowSize)
+            {
+                const size_t size = rows.rowSize * rows.rows;
+                for (size_t offset = 0; offset < size; offset += c_stagingChunkSize)
+                {
+                    const size_t chunk = std::min(c_stagingChunkSize, size - offset);
+                    copies.push_back({ rows.dest + offset, rows.src + offset, chunk, chunk, chunk, 1 });
+                }
+                return;
+            }
+
+            const size_t rowsPerChunk = std::max<size_t>(1, c_stagingChunkSize / std::max<size_t>(1, rows.rowSize));
+            for (size_t y = 0; y < rows.rows; y += rowsPerChunk)
+            {
+                StagingCopy copy = rows;
+                copy.dest += rows.destPitch * y;
+                copy.src += rows.srcPitch * y;
+                copy.rows = std::min(rowsPerChunk, rows.rows - y);
+                copies.push_back(copy);
+            }
+        }
+    }
+
+    // Copies each subresource into 'dest', the mapped upload buffer that 'layouts' describes, as
+    // MemcpySubresource does. Rows are merged into one copy where both row pitches equal the row
+    // size, and whole subresources where the slice pitches match as well. Uses up to
+    // 'threadCount' threads including the calling one, or one per core if it is zero.
+    inline void StageSubresources(
+        _In_ uint8_t* dest,
+        UINT numSubresources,
+        _In_reads_(numSubresources) const D3D12_PLACED_SUBRESOURCE_FOOTPRINT* layouts,
+        _In_reads_(numSubresources) const UINT* numRows,
+        _In_reads_(numSubresources) const UINT64* rowSizesInBytes,
+        _In_reads_(numSubresources) const D3D12_SUBRESOURCE_DATA* srcData,
+        unsigned int threadCount = 1)
+    {
+        using Internal::StagingCopy;
+
+        std::vector<StagingCopy> copies;
+        size_t totalBytes = 0;
+
+        for (UINT i = 0; i < numSubresources; ++i)
+        {
+            const auto rowSize = static_cast<size_t>(rowSizesInBytes[i]);
+            const size_t destRowPitch = layouts[i].Footprint.RowPitch;
+            const size_t destSlicePitch = destRowPitch * numRows[i];
+            const auto srcRowPitch = static_cast<size_t>(srcData[i].RowPitch);
+            const auto srcSlicePitch = static_cast<size_t>(srcData[i].SlicePitch);
+            const size_t depth = layouts[i].Footprint.Depth;
+
+            totalBytes += rowSize * numRows[i] * depth;
+
+            StagingCopy slice = {};
+            slice.dest = dest + layouts[i].Offset;
+            slice.src = static_cast<const uint8_t*>(srcData[i].pData);
+            slice.destPitch = destRowPitch;
+            slice.srcPitch = srcRowPitch;
+            slice.rowSize = rowSize;
+            slice.rows = numRows[i];
+
+            if (destRowPitch == rowSize && srcRowPitch == rowSize && srcSlicePitch == destSlicePitch)
+            {
+                // The whole subresource is contiguous in both
+                slice.rows *= depth;
+                Internal::AddCopies(copies, slice);
+                continue;
+            }
+
+            for (size_t z = 0; z < depth; ++z)
+            {
+                StagingCopy sliceZ = slice;
+                sliceZ.dest += destSlicePitch * z;
+                sliceZ.src += srcSlicePitch * z;
+                Internal::AddCopies(copies, sliceZ);
+            }
+        }
+
+        if (!threadCount)
+        {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        const size_t workers = (totalBytes < c_minParallelStagingBytes) ? 1 : std::min<size_t>(threadCount, copies.size());
+        if (workers <= 1)
+        {
+            for (const auto& it : copies)
+                Internal::CopyRows(it);
+            Internal::StreamFence();
+            return;
+        }
+
+        std::atomic<size_t> next(0);
+        auto worker = [&]()
+            {
+                for (size_t j = next++; j < copies.size(); j = next++)
+                {
+                    Internal::CopyRows(copies[j]);
+                }
+                Internal::StreamFence();
+            };
+
+        std::vector<std::thread> threads;
+        threads.reserve(workers - 1);
+        for (size_t j = 1; j < workers; ++j)
+            threads.emplace_back(worker);
+
+        worker();
+
+        for (auto& it : threads)
+            it.join();
+    }
+
+    // As UpdateSubresources in d3dx12.h with all arrays populated, but staging the data with
+    // StageSubresources. Returns the required size, or zero if the arguments are invalid or the
+    // intermediate buffer cannot be mapped.
+    inline UINT64 UpdateSubresourcesStaged(
+        _In_ ID3D12GraphicsCommandList* commandList,
+        _In_ ID3D12Resource* destinationResource,
+        _In_ ID3D12Resource* intermediate,
+        UINT firstSubresource,
+        UINT numSubresources,
+        UINT64 requiredSize,
+        _In_reads_(numSubresources) const D3D12_PLACED_SUBRESOURCE_FOOTPRINT* layouts,
+        _In_reads_(numSubresources) const UINT* numRows,
+        _In_reads_(numSubresources) const UINT64* rowSizesInBytes,
+        _In_reads_(numSubresources) const D3D12_SUBRESOURCE_DATA* srcData,
+        unsigned int threadCount = 1)
+    {
+    #if defined(_MSC_VER) || !defined(_WIN32)
+        const auto intermediateDesc = intermediate->GetDesc();
+        const auto destinationDesc = destinationResource->GetDesc();
+    #else
+        D3D12_RESOURCE_DESC tmpDesc1, tmpDesc2;
+        const auto& intermediateDesc = *intermediate->GetDesc(&tmpDesc1);
+        const auto& destinationDesc = *destinationResource->GetDesc(&tmpDesc2);
+    #endif
+        if (!numSubresources
+            || intermediateDesc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER
+            || intermediateDesc.Width < requiredSize + layouts[0].Offset
+            || requiredSize > SIZE_T(-1)
+            || (destinationDesc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER
+                && (firstSubresource != 0 || numSubresources != 1)))
+        {
+            return 0;
+        }
+
+        for (UINT i = 0; i < numSubresources; ++i)
+        {
+            if (rowSizesInBytes[i] > SIZE_T(-1))
+                return 0;
+        }
+
+        uint8_t* data = nullptr;
+        if (FAILED(intermediate->Map(0, nullptr, reinterpret_cast<void**>(&data))))
+        {
+            return 0;
+        }
+
+        StageSubresources(data, numSubresources, layouts, numRows, rowSizesInBytes, srcData, threadCount);
+
+        intermediate->Unmap(0, nullptr);
+
+        if (destinationDesc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+        {
+            commandList->CopyBufferRegion(
+                destinationResource, 0, intermediate, layouts[0].Offset, layouts[0].Footprint.Width);
+        }
+        else
+        {
+            for (UINT i = 0; i < numSubresources; ++i)
+            {
+                const CD3DX12_TEXTURE_COPY_LOCATION dst(destinationResource, i + firstSubresource);
+                const CD3DX12_TEXTURE_COPY_LOCATION src(intermediate, layouts[i]);
+                commandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+            }
+        }
+
+        return requiredSize;
+    }
+}
@@ -0,0 +1,330 @@
+//
+// UploadRing.h - Persistent, fence-tracked upload buffer for streaming uploads
+//
+
+#pragma once
+
+#include "CopyableFootprints.h"
+#include "SubresourceStaging.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#ifndef IID_GRAPHICS_PPV_ARGS
+#define IID_GRAPHICS_PPV_ARGS(x) IID_PPV_ARGS(x)
+#endif
+
+namespace DX
+{
+    // Sub-allocates upload memory from one mapped buffer that lives as long as the ring. Space
+    // used since the last Commit is tagged with a fence value there, and reclaimed once the GPU
+    // has passed it. When the ring is full, Allocate waits for the oldest committed space, and
+    // requests that cannot fit in the ring get a dedicated upload resource that is released
+    // the same way.
+    class UploadRing
+    {
+    public:
+        struct Allocation
+        {
+            ID3D12Resource*     resource;
+            UINT64              offset;
+            uint8_t*            memory;
+        };
+
+        struct Statistics
+        {
+            UINT64  capacity;
+            UINT64  inUse;                  // Bytes allocated and not yet reclaimed, including alignment and wrap padding
+            UINT64  peakInUse;
+            UINT64  stalls;                 // Times Allocate waited on the GPU for space
+            UINT64  dedicatedAllocations;
+            UINT64  dedicatedBytes;
+        };
+
+        UploadRing() noexcept :
+            m_device(nullptr),
+            m_memory(nullptr),
+            m_capacity(0),
+            m_head(0),
+            m_tail(0),
+            m_fenceValue(0),
+            m_stats{}
+        {
+        }
+
+        UploadRing(UploadRing&&) = default;
+        UploadRing& operator= (UploadRing&&) = default;
+
+        UploadRing(UploadRing const&) = delete;
+        UploadRing& operator= (UploadRing const&) = delete;
+
+        // The size is rounded up to a multiple of 64 KB.
+        void Create(_In_ ID3D12Device* device, UINT64 size)
+        {
+            Release();
+
+            m_capacity = Internal::AlignFootprint(std::max<UINT64>(size, 1), D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+            const CD3DX12_HEAP_PROPERTIES uploadHeapProperties(D3D12_HEAP_TYPE_UPLOAD);
+            const auto desc = CD3DX12_RESOURCE_DESC::Buffer(m_capacity);
+
+            ThrowIfFailed(device->CreateCommittedResource(
+                &uploadHeapProperties,
+                D3D12_HEAP_FLAG_NONE,
+                &desc,
+                D3D12_RESOURCE_STATE_GENERIC_READ,
+                nullptr,
+                IID_GRAPHICS_PPV_ARGS(m_buffer.ReleaseAndGetAddressOf())));
+
+            m_buffer->SetName(L"UploadRing");
+
+            ThrowIfFailed(m_buffer->Map(0, nullptr, reinterpret_cast<void**>(&m_memory)));
+
+            ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_GRAPHICS_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
+
+            m_fence->SetName(L"UploadRing");
+
+            m_fenceEvent.Attach(CreateEventEx(nullptr, nullptr, 0, EVENT_MODIFY_STATE | SYNCHRONIZE));
+            if (!m_fenceEvent.IsValid())
+            {
+                throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "CreateEventEx");
+            }
+
+            m_device = device;
+            m_stats.capacity = m_capacity;
+        }
+
+        // The GPU must be finished with all committed space.
+        void Release() noexcept
+        {
+            m_frames.clear();
+            m_dedicated.clear();
+            m_buffer.Reset();
+            m_fence.Reset();
+            m_device = nullptr;
+            m_memory = nullptr;
+            m_capacity = m_head = m_tail = 0;
+            m_fenceValue = 0;
+            m_stats = {};
+        }
+
+        Allocation Allocate(UINT64 size, UINT64 alignment = D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT)
+        {
+            if (!m_buffer)
+            {
+                throw std::logic_error("UploadRing is not created");
+            }
+
+            if (!alignment || (alignment & (alignment - 1)) || alignment > D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT)
+            {
+                throw std::invalid_argument("UploadRing alignment must be a power of 2 up to 64 KB");
+            }
+
+            size = std::max<UINT64>(size, 1);
+            if (size > m_capacity)
+            {
+                return AllocateDedicated(size);
+            }
+
+            for (;;)
+            {
+                UINT64 start = Internal::AlignFootprint(m_head, alignment);
+                if ((start % m_capacity) + size > m_capacity)
+                {
+                    // Skip the end of the buffer rather than split the allocation
+                    start = (start / m_capacity + 1) * m_capacity;
+                }
+
+                if (start + size - m_tail <= m_capacity)
+                {
+                    m_head = start + size;
+                    m_stats.inUse = m_head - m_tail;
+                    m_stats.peakInUse = std::max(m_stats.peakInUse, m_stats.inUse);
+
+                    const UINT64 offset = start % m_capacity;
+                    return { m_buffer.Get(), offset, m_memory + offset };
+                }
+
+                if (!Reclaim(true))
+                {
+                    // The ring is full of space that is not committed yet, so nothing can be waited on
+                    return AllocateDedicated(size);
+                }
+            }
+        }
+
+        // Stages the subresources and records the copies into 'destination', which must be in
+        // the COPY_DEST state. Footprints come from the resource description, falling back to
+        // the device for formats DX::GetCopyableFootprints does not lay out.
+        void Upload(
+            _In_ ID3D12GraphicsCommandList* commandList,
+            _In_ ID3D12Resource* destination,
+            UINT firstSubresource,
+            UINT numSubresources,
+            _In_reads_(numSubresources) const D3D12_SUBRESOURCE_DATA* srcData,
+            unsigned int threadCount = 1)
+        {
+            if (!numSubresources)
+                return;
+
+        #if defined(_MSC_VER) || !defined(_WIN32)
+            const auto desc = destination->GetDesc();
+        #else
+            D3D12_RESOURCE_DESC tmpDesc;
+            const auto& desc = *destination->GetDesc(&tmpDesc);
+        #endif
+
+            m_layouts.resize(numSubresources);
+            m_numRows.resize(numSubresources);
+            m_rowSizes.resize(numSubresources);
+
+            UINT64 requiredSize = 0;
+            if (FAILED(GetCopyableFootprints(desc, firstSubresource, numSubresources, 0,
+                m_layouts.data(), m_numRows.data(), m_rowSizes.data(), &requiredSize)))
+            {
+                m_device->GetCopyableFootprints(&desc, firstSubresource, numSubresources, 0,
+                    m_layouts.data(), m_numRows.data(), m_rowSizes.data(), &requiredSize);
+            }
+
+            if (requiredSize == UINT64(-1) || requiredSize > SIZE_T(-1))
+            {
+                throw std::invalid_argument("UploadRing cannot upload this resource");
+            }
+
+            const Allocation alloc = Allocate(requiredSize);
+
+            StageSubresources(alloc.memory, numSubresources, m_layouts.data(), m_numRows.data(), m_rowSizes.data(), srcData, threadCount);
+
+            if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+            {
+                commandList->CopyBufferRegion(destination, 0, alloc.resource, alloc.offset, m_layouts[0].Footprint.Width);
+                return;
+            }
+
+            for (UINT i = 0; i < numSubresources; ++i)
+            {
+                m_layouts[i].Offset += alloc.offset;
+
+                const CD3DX12_TEXTURE_COPY_LOCATION dst(destination, firstSubresource + i);
+                const CD3DX12_TEXTURE_COPY_LOCATION src(alloc.resource, m_layouts[i]);
+                commandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+            }
+        }
+
+        // Call after submitting the command lists that read this frame's allocations.
+        void Commit(_In_ ID3D12CommandQueue* commandQueue)
+        {
+            if (!m_buffer)
+                return;
+
+            const UINT64 committed = m_frames.empty() ? m_tail : m_frames.back().end;
+            if (m_head != committed || !m_dedicated.empty())
+            {
+                ThrowIfFailed(commandQueue->Signal(m_fence.Get(), ++m_fenceValue));
+
+                m_frames.push_back({ m_fenceValue, m_head, std::move(m_dedicated) });
+                m_dedicated.clear();
+            }
+
+            Reclaim(false);
+        }
+
+        Statistics GetStatistics() const noexcept { return m_stats; }
+
+        void ResetStatistics() noexcept
+        {
+            m_stats.peakInUse = m_stats.inUse;
+            m_stats.stalls = 0;
+            m_stats.dedicatedAllocations = 0;
+            m_stats.dedicatedBytes = 0;
+        }
+
+    private:
+        struct Frame
+        {
+            UINT64                                              fenceValue;
+            UINT64                                              end;
+            std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> dedicated;
+        };
+
+        // Retires the frames the GPU has finished. If 'wait' is set and none have finished, waits
+        // for the oldest. Returns false if there were no committed frames.
+        bool Reclaim(bool wait)
+        {
+            if (m_frames.empty())
+                return false;
+
+            UINT64 completed = m_fence->GetCompletedValue();
+            if (wait && completed < m_frames.front().fenceValue)
+            {
+                ThrowIfFailed(m_fence->SetEventOnCompletion(m_frames.front().fenceValue, m_fenceEvent.Get()));
+                std::ignore = WaitForSingleObjectEx(m_fenceEvent.Get(), INFINITE, FALSE);
+                ++m_stats.stalls;
+                completed = m_fence->GetCompletedValue();
+            }
+
+            while (!m_frames.empty() && m_frames.front().fenceValue <= completed)
+            {
+                m_tail = m_frames.front().end;
+                m_frames.pop_front();
+            }
+
+            m_stats.inUse = m_head - m_tail;
+            return true;
+        }
+
+        Allocation AllocateDedicated(UINT64 size)
+        {
+            const CD3DX12_HEAP_PROPERTIES uploadHeapProperties(D3D12_HEAP_TYPE_UPLOAD);
+            const auto desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+            Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+            ThrowIfFailed(m_device->CreateCommittedResource(
+                &uploadHeapProperties,
+                D3D12_HEAP_FLAG_NONE,
+                &desc,
+                D3D12_RESOURCE_STATE_GENERIC_READ,
+                nullptr,
+                IID_GRAPHICS_PPV_ARGS(resource.GetAddressOf())));
+
+            resource->SetName(L"UploadRing (dedicated)");
+
+            uint8_t* memory = nullptr;
+            ThrowIfFailed(resource->Map(0, nullptr, reinterpret_cast<void**>(&memory)));
+
+            ++m_stats.dedicatedAllocations;
+            m_stats.dedicatedBytes += size;
+
+            m_dedicated.emplace_back(resource);
+            return { resource.Get(), 0, memory };
+        }
+
+        ID3D12Device*                                           m_device;
+        Microsoft::WRL::ComPtr<ID3D12Resource>                  m_buffer;
+        uint8_t*                                                m_memory;
+        UINT64                                                  m_capacity;
+
+        // Running byte positions; the offset in the buffer is the position modulo the capacity.
+        UINT64                                                  m_head;
+        UINT64                                                  m_tail;
+
+        Microsoft::WRL::ComPtr<ID3D12Fence>                     m_fence;
+        Microsoft::WRL::Wrappers::Event                         m_fenceEvent;
+        UINT64                                                  m_fenceValue;
+
+        std::deque<Frame>                                       m_frames;
+        std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>>     m_dedicated;
+
+        std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT>         m_layouts;
+        std::vector<UINT>                                       m_numRows;
+        std::vector<UINT64>                                     m_rowSizes;
+
+        Statistics                                              m_stats;
+    };
+}
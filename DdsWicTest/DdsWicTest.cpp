@@ -52,6 +52,7 @@ extern bool Test04(_In_ ID3D12Device* pDevice);
 extern bool Test05(_In_ ID3D12Device* pDevice);
 extern bool Test06(_In_ ID3D12Device* pDevice);
 extern bool Test07(_In_ ID3D12Device* pDevice);
+extern bool Test08(_In_ ID3D12Device* pDevice);
 
 TestInfo g_Tests[] =
 {
@@ -62,6 +63,7 @@ TestInfo g_Tests[] =
     { "ScreenGrab (DDS)", Test05 },
     { "ScreenGrab (WIC)", Test06 },
     { "Fuzzing (DDS)", Test07 },
+    { "CopyableFootprints", Test08 },
 };
 
 using Microsoft::WRL::ComPtr;
@@ -67,6 +67,9 @@ namespace Microsoft
 #include "d3dx12.h"
 #endif
 
+#include "CopyableFootprints.h"
+
+#include <algorithm>
 #include <cstdio>
 #include <cstdint>
 #include <cwchar>
@@ -1797,4 +1800,190 @@ bool Test07(_In_ ID3D12Device* pDevice)
     printf(" %zu images tested ", ncount);
 
     return success;
-}
\ No newline at end of file
+}
+
+//-------------------------------------------------------------------------------------
+// CopyableFootprints
+bool Test08(_In_ ID3D12Device* pDevice)
+{
+    bool success = true;
+
+    std::vector<D3D12_RESOURCE_DESC> descs;
+    descs.reserve(std::size(g_TestMedia) + 16);
+
+    for (const auto& it : g_TestMedia)
+    {
+        descs.emplace_back(D3D12_RESOURCE_DESC{
+            it.dimension,
+            0,
+            it.width, it.height,
+            it.depthOrArray,
+            it.mipLevels,
+            it.format, { 1, 0 },
+            D3D12_TEXTURE_LAYOUT_UNKNOWN,
+            D3D12_RESOURCE_FLAG_NONE });
+    }
+
+    // Planar and packed formats not covered by the media
+    descs.emplace_back(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_NV12, 256, 128, 1, 1));
+    descs.emplace_back(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_NV12, 202, 98, 2, 1));
+    descs.emplace_back(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_P010, 1280, 720, 1, 1));
+    descs.emplace_back(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_P016, 640, 360, 1, 1));
+    descs.emplace_back(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_NV11, 256, 64, 1, 1));
+    descs.emplace_back(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_420_OPAQUE, 64, 64, 1, 1));
+    descs.emplace_back(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_Y210, 130, 32, 1, 1));
+    descs.emplace_back(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D24_UNORM_S8_UINT, 1280, 720, 1, 1));
+    descs.emplace_back(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT_S8X24_UINT, 333, 77, 3, 4));
+    descs.emplace_back(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_BC1_UNORM, 260, 36, 4, 0));
+    descs.emplace_back(CD3DX12_RESOURCE_DESC::Tex3D(DXGI_FORMAT_BC7_UNORM, 64, 32, 20, 0));
+    descs.emplace_back(CD3DX12_RESOURCE_DESC::Tex1D(DXGI_FORMAT_R32G32B32_FLOAT, 1000, 3, 0));
+    descs.emplace_back(CD3DX12_RESOURCE_DESC::Buffer(1000));
+
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> expectedLayouts, layouts;
+    std::vector<UINT> expectedRows, rows;
+    std::vector<UINT64> expectedRowSizes, rowSizes;
+
+    size_t ncount = 0;
+    size_t nskipped = 0;
+
+    for (size_t index = 0; index < descs.size(); ++index)
+    {
+        const auto& desc = descs[index];
+
+        UINT planes = D3D12GetFormatPlaneCount(pDevice, desc.Format);
+        if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+        {
+            planes = 1;
+        }
+        else if (planes != DX::GetCopyablePlaneCount(desc.Format))
+        {
+            success = false;
+            printf("ERROR: Unexpected plane count for format %d (%u...%u)\n", desc.Format, DX::GetCopyablePlaneCount(desc.Format), planes);
+            continue;
+        }
+
+        UINT mipLevels = desc.MipLevels;
+        if (!mipLevels)
+        {
+            // The device needs the count of a full chain
+            UINT64 size = std::max<UINT64>(desc.Width, desc.Height);
+            if (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D)
+                size = std::max<UINT64>(size, desc.DepthOrArraySize);
+            for (mipLevels = 1; size > 1; size >>= 1)
+                ++mipLevels;
+        }
+
+        const UINT numSubresources = (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER) ? 1u
+            : mipLevels * planes * ((desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D) ? 1u : desc.DepthOrArraySize);
+
+        auto deviceDesc = desc;
+        deviceDesc.MipLevels = static_cast<UINT16>(mipLevels);
+
+        // Whole resource from offset zero, as GetRequiredIntermediateSize does, then a range at an offset
+        const UINT firsts[] = { 0u, numSubresources / 2 };
+        for (size_t j = 0; j < std::size(firsts) && (!j || firsts[j]); ++j)
+        {
+            const UINT first = firsts[j];
+            const UINT count = numSubresources - first;
+            const UINT64 baseOffset = first ? 4 * D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT : 0;
+
+            expectedLayouts.resize(count);
+            expectedRows.resize(count);
+            expectedRowSizes.resize(count);
+            UINT64 expectedTotal = 0;
+            pDevice->GetCopyableFootprints(&deviceDesc, first, count, baseOffset,
+                expectedLayouts.data(), expectedRows.data(), expectedRowSizes.data(), &expectedTotal);
+
+            if (expectedTotal == UINT64(-1))
+            {
+                // Not a valid resource for this device
+                ++nskipped;
+                break;
+            }
+
+            layouts.resize(count);
+            rows.resize(count);
+            rowSizes.resize(count);
+            UINT64 total = 0;
+            HRESULT hr = DX::GetCopyableFootprints(desc, first, count, baseOffset,
+                layouts.data(), rows.data(), rowSizes.data(), &total);
+            if (FAILED(hr))
+            {
+                success = false;
+                printf("ERROR: GetCopyableFootprints failed (HRESULT %08X) for ", static_cast<unsigned int>(hr));
+                printdesc(desc);
+                break;
+            }
+
+            if (total != expectedTotal)
+            {
+                success = false;
+                printf("ERROR: Unexpected total size %llu (expected %llu) from %u for ", total, expectedTotal, first);
+                printdesc(desc);
+            }
+
+            if (!first && DX::GetRequiredIntermediateSize(desc, 0, count) != expectedTotal)
+            {
+                success = false;
+                printf("ERROR: Unexpected required intermediate size for ");
+                printdesc(desc);
+            }
+
+            for (UINT i = 0; i < count; ++i)
+            {
+                const auto& a = layouts[i];
+                const auto& b = expectedLayouts[i];
+                if (a.Offset != b.Offset
+                    || a.Footprint.Format != b.Footprint.Format
+                    || a.Footprint.Width != b.Footprint.Width
+                    || a.Footprint.Height != b.Footprint.Height
+                    || a.Footprint.Depth != b.Footprint.Depth
+                    || a.Footprint.RowPitch != b.Footprint.RowPitch
+                    || rows[i] != expectedRows[i]
+                    || rowSizes[i] != expectedRowSizes[i])
+                {
+                    success = false;
+                    printf("ERROR: Unexpected footprint for subresource %u:\n"
+                        "\toffset %llu format %d %ux%ux%u pitch %u rows %u row size %llu\n"
+                        "\texpected offset %llu format %d %ux%ux%u pitch %u rows %u row size %llu\n\tfor ",
+                        first + i,
+                        a.Offset, a.Footprint.Format, a.Footprint.Width, a.Footprint.Height, a.Footprint.Depth, a.Footprint.RowPitch, rows[i], rowSizes[i],
+                        b.Offset, b.Footprint.Format, b.Footprint.Width, b.Footprint.Height, b.Footprint.Depth, b.Footprint.RowPitch, expectedRows[i], expectedRowSizes[i]);
+                    printdesc(desc);
+                    break;
+                }
+            }
+        }
+
+        ++ncount;
+    }
+
+    // invalid args
+    {
+        UINT64 total = 0;
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout = {};
+        HRESULT hr = DX::GetCopyableFootprints(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, 64, 64, 1, 1), 1, 1, 0, &layout, nullptr, nullptr, &total);
+        if (hr != E_INVALIDARG || total != UINT64(-1) || layout.Offset != UINT64(-1))
+        {
+            success = false;
+            printf("ERROR: Expected failure for subresource out of range (HRESULT %08X)\n", static_cast<unsigned int>(hr));
+        }
+
+        hr = DX::GetCopyableFootprints(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_UNKNOWN, 64, 64, 1, 1), 0, 1, 0, nullptr, nullptr, nullptr, &total);
+        if (hr != E_INVALIDARG)
+        {
+            success = false;
+            printf("ERROR: Expected failure for unknown format (HRESULT %08X)\n", static_cast<unsigned int>(hr));
+        }
+
+        if (DX::GetRequiredIntermediateSize(CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, 0, 64, 1, 1), 0, 1) != 0)
+        {
+            success = false;
+            printf("ERROR: Expected no size for empty texture\n");
+        }
+    }
+
+    printf(" %zu resources tested, %zu not valid for the device ", ncount, nskipped);
+
+    return success;
+}
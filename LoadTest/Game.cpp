@@ -41,6 +41,12 @@ namespace
 {
     constexpr float dist = 10.f;
 
+    // A few frames of the streamed logo's mip chain, with room to spare
+    constexpr UINT64 c_uploadRingSize = 1024 * 1024;
+
+    // Streams the 512 x 256 earth texture's top level over eight frames
+    constexpr UINT64 c_streamingBudget = 64 * 1024;
+
 #ifdef GAMMA_CORRECT_RENDERING
     const XMVECTORF32 c_clearColor = { { { 0.127437726f, 0.300543845f, 0.846873462f, 1.f } } };
 #else
@@ -240,6 +246,28 @@ void Game::Render()
         m_firstFrame = false;
     }
 
+    // Stream the logo through the upload ring; it is kept in the copy destination state between frames
+    m_uploadRing.Upload(commandList, m_streamed.Get(),
+        0, static_cast<UINT>(m_streamedSubresources.size()), m_streamedSubresources.data());
+
+    TransitionResource(commandList, m_streamed.Get(),
+        D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+    if (m_streamedMips.Update(commandList, m_uploadRing, c_streamingBudget) && m_streamedMips.IsFullyResident())
+    {
+        const auto stats = m_streamedMips.GetStatistics();
+
+        char buff[256] = {};
+        sprintf_s(buff, "StreamingTexture: first mip %.2f ms, fully resident %.2f ms over %u frames, %llu bytes (%llu peak per frame, budget %llu), %u frames over budget\n",
+            stats.timeToFirstMip, stats.timeToFullyResident, stats.updates,
+            stats.bytesUploaded, stats.peakUpdateBytes, c_streamingBudget, stats.updatesOverBudget);
+        OutputDebugStringA(buff);
+    }
+
+    // Rewritten each frame, as the other frames' views may hold an older minimum LOD
+    const size_t streamedMipsView = Descriptors::StreamedMips + m_deviceResources->GetCurrentFrameIndex();
+    m_streamedMips.CreateShaderResourceView(m_deviceResources->GetD3DDevice(), m_resourceDescriptors->GetCpuHandle(streamedMipsView));
+
     // Set the descriptor heaps
     ID3D12DescriptorHeap* heaps[] = { m_resourceDescriptors->Heap(), m_states->Heap() };
     commandList->SetDescriptorHeaps(static_cast<UINT>(std::size(heaps)), heaps);
@@ -288,6 +316,23 @@ void Game::Render()
     m_effect->Apply(commandList);
     m_cube->Draw(commandList);
 
+    // Cubes 7 and 8 are in the middle column, leaving the original six as they were
+    world = XMMatrixRotationY(t) * XMMatrixTranslation(0, 0, (dist / 2.f) + dist * sin(t));
+    m_effect->SetWorld(world);
+    m_effect->SetTexture(m_resourceDescriptors->GetGpuHandle(streamedMipsView), m_states->LinearClamp());
+    m_effect->Apply(commandList);
+    m_cube->Draw(commandList);
+
+    // Cube 8
+    world = XMMatrixRotationY(-t) * XMMatrixTranslation(0, -2.1f, (dist / 2.f) + dist * sin(t));
+    m_effect->SetWorld(world);
+    m_effect->SetTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::Streamed), m_states->LinearClamp());
+    m_effect->Apply(commandList);
+    m_cube->Draw(commandList);
+
+    TransitionResource(commandList, m_streamed.Get(),
+        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
+
     PIXEndEvent(commandList);
 
     if (m_frame == 10)
@@ -299,6 +344,7 @@ void Game::Render()
     PIXBeginEvent(m_deviceResources->GetCommandQueue(), PIX_COLOR_DEFAULT, L"Present");
     m_deviceResources->Present();
     m_graphicsMemory->Commit(m_deviceResources->GetCommandQueue());
+    m_uploadRing.Commit(m_deviceResources->GetCommandQueue());
 
     // Sample stats to update peak values
     std::ignore = m_graphicsMemory->GetStatistics();
@@ -309,6 +355,15 @@ void Game::Render()
     {
         // We take the shot here to cope with lost device
 
+        {
+            const auto stats = m_uploadRing.GetStatistics();
+
+            char buff[256] = {};
+            sprintf_s(buff, "UploadRing: %llu of %llu bytes in use (%llu peak), %llu stalls, %llu dedicated (%llu bytes)\n",
+                stats.inUse, stats.capacity, stats.peakInUse, stats.stalls, stats.dedicatedAllocations, stats.dedicatedBytes);
+            OutputDebugStringA(buff);
+        }
+
         OutputDebugStringA("******** SCREENSHOT TEST BEGIN *************\n");
 
         bool success = true;
@@ -640,6 +695,9 @@ void Game::CreateDeviceDependentResources()
         // TODO - DefaultDesc
         // TODO - WriteDescriptors x3
 
+        if (m_deviceResources->GetBackBufferCount() > c_streamedMipsViews)
+            throw std::runtime_error("Too many back buffers for the streamed mips views");
+
         m_resourceDescriptors = std::make_unique<DescriptorHeap>(device,
             Descriptors::Count);
 
@@ -774,6 +832,19 @@ void Game::CreateDeviceDependentResources()
 
         CreateShaderResourceView(device, m_dxlogo2.Get(), m_resourceDescriptors->GetCpuHandle(Descriptors::DirectXLogo_BC1));
 
+        // Same image, loaded without an upload batch, to stream through the ring every frame
+        DX::ThrowIfFailed(LoadDDSTextureFromFileEx(device, strFilePath,
+            0, D3D12_RESOURCE_FLAG_NONE, DDS_LOADER_FORCE_SRGB,
+            m_streamed.ReleaseAndGetAddressOf(), m_streamedData, m_streamedSubresources));
+
+        m_uploadRing.Create(device, c_uploadRingSize);
+
+        CreateShaderResourceView(device, m_streamed.Get(), m_resourceDescriptors->GetCpuHandle(Descriptors::Streamed));
+
+        // Earth again, with nothing uploaded until Render streams in its mips
+        DX::FindMediaFile(strFilePath, MAX_PATH, L"earth_A2B10G10R10.dds", s_searchFolders);
+        m_streamedMips.Create(device, strFilePath);
+
         // Windows 95 logo
         DX::FindMediaFile(strFilePath, MAX_PATH, L"win95.bmp", s_searchFolders);
         DX::ThrowIfFailed(CreateWICTextureFromFile(device, resourceUpload, strFilePath,
@@ -1102,6 +1173,12 @@ void Game::OnDeviceLost()
     m_copyTest.Reset();
     m_computeTest.Reset();
 
+    m_uploadRing.Release();
+    m_streamed.Reset();
+    m_streamedData.reset();
+    m_streamedSubresources.clear();
+    m_streamedMips.Release();
+
     m_screenshot.Reset();
 
     m_cube.reset();
@@ -12,6 +12,8 @@
 
 #include "DirectXTKTest.h"
 #include "StepTimer.h"
+#include "StreamingTexture.h"
+#include "UploadRing.h"
 
 constexpr uint32_t c_testTimeout = 10000;
 
@@ -169,6 +171,19 @@ private:
     Microsoft::WRL::ComPtr<ID3D12CommandQueue>      m_computeQueue;
     Microsoft::WRL::ComPtr<ID3D12Resource>          m_computeTest;
 
+    // Re-uploaded every frame through the ring rather than a ResourceUploadBatch
+    DX::UploadRing                                  m_uploadRing;
+    Microsoft::WRL::ComPtr<ID3D12Resource>          m_streamed;
+    std::unique_ptr<uint8_t[]>                      m_streamedData;
+    std::vector<D3D12_SUBRESOURCE_DATA>             m_streamedSubresources;
+
+    // Mips uploaded smallest first within c_streamingBudget bytes per frame
+    DX::StreamingTexture                            m_streamedMips;
+
+    // One view per back buffer, as the minimum LOD changes while frames are in flight. DeviceResources
+    // allows at most three back buffers.
+    static constexpr UINT c_streamedMipsViews = 3;
+
     enum Descriptors
     {
         Earth,
@@ -178,7 +193,9 @@ private:
         Windows95,
         Windows95_sRGB,
         Win95_UAV,
-        Count
+        Streamed,
+        StreamedMips,
+        Count = StreamedMips + c_streamedMipsViews
     };
 
     enum RTDescriptors
@@ -0,0 +1,441 @@
+//--------------------------------------------------------------------------------------
+// File: DrawList.h
+//
+// Code for gathering the visible parts of many models into sort keys and submitting
+// them in state order
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=324981
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "Effects.h"
+#include "Model.h"
+
+#include "FrustumCull.h"
+#include "RecordingCommandList.h"
+
+namespace DX
+{
+    struct DrawKey
+    {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    // Stable LSD radix sort by key, eight bits per pass. Passes where every key has the same digit
+    // are skipped, which is common as most keys in a frame share their high bits.
+    inline void RadixSortKeys(std::vector<DrawKey>& keys, std::vector<DrawKey>& scratch)
+    {
+        const size_t count = keys.size();
+        scratch.resize(count);
+        if (count < 2)
+            return;
+
+        size_t histogram[8][256] = {};
+        for (const auto& it : keys)
+        {
+            for (size_t pass = 0; pass < 8; ++pass)
+            {
+                ++histogram[pass][(it.key >> (pass * 8)) & 0xFF];
+            }
+        }
+
+        DrawKey* src = keys.data();
+        DrawKey* dst = scratch.data();
+        for (size_t pass = 0; pass < 8; ++pass)
+        {
+            const size_t shift = pass * 8;
+            size_t* offsets = histogram[pass];
+            if (offsets[(src[0].key >> shift) & 0xFF] == count)
+                continue;
+
+            size_t total = 0;
+            for (size_t j = 0; j < 256; ++j)
+            {
+                const size_t n = offsets[j];
+                offsets[j] = total;
+                total += n;
+            }
+
+            for (size_t j = 0; j < count; ++j)
+            {
+                dst[offsets[(src[j].key >> shift) & 0xFF]++] = src[j];
+            }
+
+            std::swap(src, dst);
+        }
+
+        if (src != keys.data())
+        {
+            keys.swap(scratch);
+        }
+    }
+
+    struct DrawListStats
+    {
+        uint32_t draws;
+        uint32_t effectApplies;
+        uint32_t vertexBufferSets;
+        uint32_t indexBufferSets;
+        uint32_t topologySets;
+        uint32_t bindsSaved;        // Effect applies and input assembler sets skipped, compared to Model::Draw
+    };
+
+#if !defined(_GAMING_XBOX) && !defined(_XBOX_ONE)
+    // Collects the mesh parts of many models, culls them by mesh bounds, and submits them sorted by
+    // pass, root signature, pipeline state, texture set, effect, transform, and depth. Opaque parts
+    // come first, and depth only orders them front to back among parts with the same state and
+    // transform; alpha parts follow, sorted back to front across all states. Runs of parts that
+    // share an effect and transform apply the effect once, and vertex buffer, index buffer, and
+    // topology are only set when they change.
+    //
+    // The state of each effect is found by Prepare, by applying it to a RecordingCommandList, and
+    // cached by address. Call ClearCache when effects are released or their textures are changed,
+    // then Prepare again. Effects shared by several models must not need per-model settings other
+    // than the world matrix.
+    class DrawList
+    {
+    public:
+        DrawList() = default;
+
+        DrawList(DrawList&&) = default;
+        DrawList& operator= (DrawList&&) = default;
+
+        DrawList(DrawList const&) = delete;
+        DrawList& operator= (DrawList const&) = delete;
+
+        // Starts a new frame, clearing the models added for the last one.
+        void XM_CALLCONV Begin(DirectX::FXMMATRIX view, DirectX::CXMMATRIX projection)
+        {
+            DirectX::XMStoreFloat4x4(&m_view, view);
+            DirectX::XMStoreFloat4x4(&m_projection, projection);
+
+            m_culler.Clear();
+            m_meshes.clear();
+            m_transforms.clear();
+        }
+
+        // Checks that every part of 'model' has an effect and buffers, and finds the state of any
+        // effects not seen before. Call once a model's effects are created, not every frame.
+        HRESULT Prepare(
+            const DirectX::Model& model,
+            const DirectX::Model::EffectCollection& effects)
+        {
+            for (const auto& mesh : model.meshes)
+            {
+                if (!mesh)
+                    return E_INVALIDARG;
+
+                for (const auto* parts : { &mesh->opaqueMeshParts, &mesh->alphaMeshParts })
+                {
+                    for (const auto& part : *parts)
+                    {
+                        if (!part || part->partIndex >= effects.size() || !effects[part->partIndex])
+                            return E_INVALIDARG;
+
+                        if (!part->indexBufferSize || !part->vertexBufferSize
+                            || (!part->staticIndexBuffer && !part->indexBuffer)
+                            || (!part->staticVertexBuffer && !part->vertexBuffer))
+                            return E_UNEXPECTED;
+                    }
+                }
+            }
+
+            for (const auto& effect : effects)
+            {
+                if (effect && m_effectStates.find(effect.get()) == m_effectStates.end())
+                {
+                    HRESULT hr = ProbeEffect(effect.get());
+                    if (FAILED(hr))
+                        return hr;
+                }
+            }
+
+            return S_OK;
+        }
+
+        // Adds the meshes of 'model' drawn with 'effects', indexed by part as for Model::Draw, and
+        // transformed by 'world'. The model and effects must have passed Prepare.
+        void XM_CALLCONV AddModel(
+            const DirectX::Model& model,
+            const DirectX::Model::EffectCollection& effects,
+            DirectX::FXMMATRIX world)
+        {
+            using namespace DirectX;
+
+            const auto transform = static_cast<uint32_t>(m_transforms.size());
+            m_transforms.emplace_back();
+            XMStoreFloat4x4(&m_transforms.back(), world);
+
+            m_culler.AddModel(model, world);
+
+            const XMMATRIX worldView = XMMatrixMultiply(world, XMLoadFloat4x4(&m_view));
+            for (const auto& mesh : model.meshes)
+            {
+                // Distance from the eye, which does not depend on the handedness of the view
+                const XMVECTOR center = XMVector3Transform(XMLoadFloat3(&mesh->boundingSphere.Center), worldView);
+                m_meshes.push_back({ mesh.get(), &effects, transform, XMVectorGetX(XMVector3Length(center)) });
+            }
+        }
+
+        // Culls, sorts, and draws everything added since Begin.
+        DrawListStats Submit(_In_ ID3D12GraphicsCommandList* commandList)
+        {
+            using namespace DirectX;
+
+            DrawListStats stats = {};
+
+            const XMMATRIX view = XMLoadFloat4x4(&m_view);
+            const XMMATRIX projection = XMLoadFloat4x4(&m_projection);
+            m_culler.Cull(XMMatrixMultiply(view, projection), m_visible);
+
+            m_items.clear();
+            m_keys.clear();
+            for (const auto index : m_visible)
+            {
+                const auto& mesh = m_meshes[index];
+                for (const auto& part : mesh.mesh->opaqueMeshParts)
+                {
+                    AddPart(part.get(), mesh, false);
+                }
+                for (const auto& part : mesh.mesh->alphaMeshParts)
+                {
+                    AddPart(part.get(), mesh, true);
+                }
+            }
+
+            RadixSortKeys(m_keys, m_scratch);
+
+            const IEffect* currentEffect = nullptr;
+            uint32_t currentTransform = UINT32_MAX;
+            D3D12_VERTEX_BUFFER_VIEW currentVertexBuffer = {};
+            D3D12_INDEX_BUFFER_VIEW currentIndexBuffer = {};
+            D3D_PRIMITIVE_TOPOLOGY currentTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+
+            for (const auto& key : m_keys)
+            {
+                const auto& item = m_items[key.index];
+                auto part = item.part;
+
+                if (item.effect != currentEffect || item.transform != currentTransform)
+                {
+                    auto imatrices = dynamic_cast<IEffectMatrices*>(item.effect);
+                    if (imatrices)
+                        imatrices->SetMatrices(XMLoadFloat4x4(&m_transforms[item.transform]), view, projection);
+
+                    item.effect->Apply(commandList);
+                    ++stats.effectApplies;
+
+                    currentEffect = item.effect;
+                    currentTransform = item.transform;
+                }
+
+                // Matches ModelMeshPart::Draw
+                D3D12_VERTEX_BUFFER_VIEW vbv;
+                vbv.BufferLocation = part->staticVertexBuffer ? part->staticVertexBuffer->GetGPUVirtualAddress() : part->vertexBuffer.GpuAddress();
+                vbv.StrideInBytes = part->vertexStride;
+                vbv.SizeInBytes = part->vertexBufferSize;
+                if (memcmp(&vbv, &currentVertexBuffer, sizeof(vbv)) != 0)
+                {
+                    commandList->IASetVertexBuffers(0, 1, &vbv);
+                    currentVertexBuffer = vbv;
+                    ++stats.vertexBufferSets;
+                }
+
+                D3D12_INDEX_BUFFER_VIEW ibv;
+                ibv.BufferLocation = part->staticIndexBuffer ? part->staticIndexBuffer->GetGPUVirtualAddress() : part->indexBuffer.GpuAddress();
+                ibv.SizeInBytes = part->indexBufferSize;
+                ibv.Format = part->indexFormat;
+                if (memcmp(&ibv, &currentIndexBuffer, sizeof(ibv)) != 0)
+                {
+                    commandList->IASetIndexBuffer(&ibv);
+                    currentIndexBuffer = ibv;
+                    ++stats.indexBufferSets;
+                }
+
+                if (part->primitiveType != currentTopology)
+                {
+                    commandList->IASetPrimitiveTopology(part->primitiveType);
+                    currentTopology = part->primitiveType;
+                    ++stats.topologySets;
+                }
+
+                commandList->DrawIndexedInstanced(part->indexCount, 1, part->startIndex, part->vertexOffset, 0);
+                ++stats.draws;
+            }
+
+            // Model::Draw applies the effect and sets all three input assembler states for every part
+            stats.bindsSaved = stats.draws * 4
+                - (stats.effectApplies + stats.vertexBufferSets + stats.indexBufferSets + stats.topologySets);
+
+            return stats;
+        }
+
+        // Forgets the state found for each effect.
+        void ClearCache() noexcept
+        {
+            m_effectStates.clear();
+            m_rootSignatureIds.clear();
+            m_pipelineIds.clear();
+            m_textureSetIds.clear();
+        }
+
+        size_t size() const noexcept { return m_meshes.size(); }
+
+    private:
+        struct EffectState
+        {
+            uint32_t rootSignature;
+            uint32_t pipeline;
+            uint32_t textures;
+            uint32_t effect;
+        };
+
+        struct MeshEntry
+        {
+            const DirectX::ModelMesh*                   mesh;
+            const DirectX::Model::EffectCollection*     effects;
+            uint32_t                                    transform;
+            float                                       depth;
+        };
+
+        struct DrawItem
+        {
+            const DirectX::ModelMeshPart*   part;
+            DirectX::IEffect*               effect;
+            uint32_t                        transform;
+        };
+
+        static uint32_t Intern(std::unordered_map<uint64_t, uint32_t>& ids, uint64_t value)
+        {
+            return ids.emplace(value, static_cast<uint32_t>(ids.size())).first->second;
+        }
+
+        // Records the effect's Apply and reads back the root signature, pipeline state, and descriptor
+        // tables it sets. Root constant buffer views change with every Apply, so are ignored.
+        HRESULT ProbeEffect(_In_ DirectX::IEffect* effect)
+        {
+            HRESULT hr = m_probe
+                ? m_probe->Reset(nullptr, nullptr)
+                : RecordingCommandList::Create(nullptr, D3D12_COMMAND_LIST_TYPE_DIRECT, m_probe.ReleaseAndGetAddressOf());
+            if (FAILED(hr))
+                return hr;
+
+            effect->Apply(m_probe.Get());
+
+            hr = m_probe->Close();
+            if (FAILED(hr))
+                return hr;
+
+            uint64_t rootSignature = 0;
+            uint64_t pipeline = 0;
+            uint64_t textures = 14695981039346656037ull;
+            RecordingCommandList::ForEachCommand(m_probe->GetStream(),
+                [&](RecordedCommand command, const uint8_t* payload, size_t size) noexcept
+                {
+                    switch (command)
+                    {
+                    case RecordedCommand::SetGraphicsRootSignature:
+                        if (size >= sizeof(uint64_t))
+                            memcpy(&rootSignature, payload, sizeof(uint64_t));
+                        break;
+
+                    case RecordedCommand::SetPipelineState:
+                        if (size >= sizeof(uint64_t))
+                            memcpy(&pipeline, payload, sizeof(uint64_t));
+                        break;
+
+                    case RecordedCommand::SetGraphicsRootDescriptorTable:
+                        // FNV-1a of the root parameter index and descriptor handle
+                        for (size_t j = 0; j < size; ++j)
+                        {
+                            textures = (textures ^ payload[j]) * 1099511628211ull;
+                        }
+                        break;
+
+                    default:
+                        break;
+                    }
+                });
+
+            EffectState state;
+            state.rootSignature = Intern(m_rootSignatureIds, rootSignature);
+            state.pipeline = Intern(m_pipelineIds, pipeline);
+            state.textures = Intern(m_textureSetIds, textures);
+            state.effect = static_cast<uint32_t>(m_effectStates.size());
+            m_effectStates.emplace(effect, state);
+
+            return S_OK;
+        }
+
+        // Key fields, from the most significant bit: pass (1), root signature (5), pipeline (10),
+        // texture set (10), effect (12), transform (10), and depth (16) for opaque parts. Alpha parts
+        // put the inverted depth after the pass. Ids that overflow their field only cost grouping,
+        // as submission compares the effects and transforms themselves.
+        static uint64_t MakeKey(const EffectState& state, uint32_t transform, float depth, bool alpha) noexcept
+        {
+            // Non-negative floats sort as integers, so the top bits are a coarse depth
+            uint32_t bits = 0;
+            depth = (depth > 0.f) ? depth : 0.f;
+            memcpy(&bits, &depth, sizeof(bits));
+            const uint64_t depthKey = bits >> 15;
+
+            const uint64_t stateKey = (uint64_t(state.rootSignature & 0x1F) << 42)
+                | (uint64_t(state.pipeline & 0x3FF) << 32)
+                | (uint64_t(state.textures & 0x3FF) << 22)
+                | (uint64_t(state.effect & 0xFFF) << 10)
+                | uint64_t(transform & 0x3FF);
+
+            if (!alpha)
+                return (stateKey << 16) | depthKey;
+
+            return (uint64_t(1) << 63) | ((0xFFFF - depthKey) << 47) | stateKey;
+        }
+
+        void AddPart(_In_ const DirectX::ModelMeshPart* part, const MeshEntry& mesh, bool alpha)
+        {
+            auto effect = (*mesh.effects)[part->partIndex].get();
+
+            const auto index = static_cast<uint32_t>(m_items.size());
+            m_items.push_back({ part, effect, mesh.transform });
+            // An effect missed by Prepare still draws correctly, it just does not group by state
+            auto it = m_effectStates.find(effect);
+            assert(it != m_effectStates.end());
+            const EffectState state = (it != m_effectStates.end()) ? it->second : EffectState{};
+
+            m_keys.push_back({ MakeKey(state, mesh.transform, mesh.depth, alpha), index });
+        }
+
+        DirectX::XMFLOAT4X4                             m_view = {};
+        DirectX::XMFLOAT4X4                             m_projection = {};
+
+        FrustumCuller                                   m_culler;
+        std::vector<MeshEntry>                          m_meshes;
+        std::vector<DirectX::XMFLOAT4X4>                m_transforms;
+
+        std::vector<uint32_t>                           m_visible;
+        std::vector<DrawItem>                           m_items;
+        std::vector<DrawKey>                            m_keys;
+        std::vector<DrawKey>                            m_scratch;
+
+        Microsoft::WRL::ComPtr<RecordingCommandList>    m_probe;
+        std::unordered_map<const DirectX::IEffect*, EffectState> m_effectStates;
+        std::unordered_map<uint64_t, uint32_t>          m_rootSignatureIds;
+        std::unordered_map<uint64_t, uint32_t>          m_pipelineIds;
+        std::unordered_map<uint64_t, uint32_t>          m_textureSetIds;
+    };
+#endif
+}
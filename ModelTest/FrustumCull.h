@@ -0,0 +1,271 @@
+//--------------------------------------------------------------------------------------
+// File: FrustumCull.h
+//
+// Code for culling many bounding spheres against a view frustum four at a time
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=324981
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+#include "Model.h"
+
+namespace DX
+{
+    // World-space bounding spheres stored as structure-of-arrays, so that each XMVECTOR load reads the
+    // same component of four spheres. The arrays are padded to a multiple of four with spheres that
+    // are never visible.
+    class FrustumCuller
+    {
+    public:
+        static constexpr size_t c_minParallelGroups = 4096;
+
+        FrustumCuller() = default;
+
+        FrustumCuller(FrustumCuller&&) = default;
+        FrustumCuller& operator= (FrustumCuller&&) = default;
+
+        FrustumCuller(FrustumCuller const&) = default;
+        FrustumCuller& operator= (FrustumCuller const&) = default;
+
+        void Clear() noexcept
+        {
+            m_x.clear();
+            m_y.clear();
+            m_z.clear();
+            m_radius.clear();
+            m_count = 0;
+        }
+
+        void Reserve(size_t count)
+        {
+            const size_t padded = (count + 3) & ~size_t(3);
+            m_x.reserve(padded);
+            m_y.reserve(padded);
+            m_z.reserve(padded);
+            m_radius.reserve(padded);
+        }
+
+        size_t size() const noexcept { return m_count; }
+
+        // Adds a bounding sphere in world space and returns its index.
+        size_t Add(const DirectX::BoundingSphere& sphere)
+        {
+            if (!(m_count & 3))
+            {
+                m_x.resize(m_count + 4, 0.f);
+                m_y.resize(m_count + 4, 0.f);
+                m_z.resize(m_count + 4, 0.f);
+                m_radius.resize(m_count + 4, -FLT_MAX);
+            }
+
+            m_x[m_count] = sphere.Center.x;
+            m_y[m_count] = sphere.Center.y;
+            m_z[m_count] = sphere.Center.z;
+            m_radius[m_count] = sphere.Radius;
+            return m_count++;
+        }
+
+        // Adds the bounding sphere of each mesh transformed by 'world', in the order of model.meshes,
+        // and returns the index of the first.
+        size_t XM_CALLCONV AddModel(const DirectX::Model& model, DirectX::FXMMATRIX world)
+        {
+            const size_t first = m_count;
+            Grow(m_count + model.meshes.size());
+            for (const auto& mesh : model.meshes)
+            {
+                DirectX::BoundingSphere sphere;
+                mesh->boundingSphere.Transform(sphere, world);
+                Add(sphere);
+            }
+            return first;
+        }
+
+        // Adds a sphere for each instance of 'local', transformed by the instance transform and then
+        // 'world' as for ModelMeshPart::DrawInstanced, and returns the index of the first.
+        size_t XM_CALLCONV AddInstances(
+            const DirectX::BoundingSphere& local,
+            _In_reads_(count) const DirectX::XMFLOAT3X4* transforms, size_t count,
+            DirectX::FXMMATRIX world)
+        {
+            const size_t first = m_count;
+            Grow(m_count + count);
+            for (size_t j = 0; j < count; ++j)
+            {
+                const DirectX::XMMATRIX m = DirectX::XMMatrixMultiply(DirectX::XMLoadFloat3x4(&transforms[j]), world);
+
+                DirectX::BoundingSphere sphere;
+                local.Transform(sphere, m);
+                Add(sphere);
+            }
+            return first;
+        }
+
+        // Tests every sphere against the frustum of 'viewProjection' and writes the indices of those
+        // that may be visible to 'visible', in order. Large sets are split across 'threadCount'
+        // threads, or one per core if it is zero.
+        size_t XM_CALLCONV Cull(DirectX::FXMMATRIX viewProjection, std::vector<uint32_t>& visible, unsigned int threadCount = 0) const
+        {
+            using namespace DirectX;
+
+            visible.clear();
+
+            const size_t groups = m_x.size() / 4;
+            if (!groups)
+                return 0;
+
+            // Clip planes of a D3D projection, with each component splatted for the SoA tests
+            const XMMATRIX t = XMMatrixTranspose(viewProjection);
+            const XMVECTOR planes[6] =
+            {
+                XMVectorAdd(t.r[3], t.r[0]),
+                XMVectorSubtract(t.r[3], t.r[0]),
+                XMVectorAdd(t.r[3], t.r[1]),
+                XMVectorSubtract(t.r[3], t.r[1]),
+                t.r[2],
+                XMVectorSubtract(t.r[3], t.r[2]),
+            };
+
+            Planes splat = {};
+            for (size_t p = 0; p < 6; ++p)
+            {
+                // An infinite far plane has no normal, so it is replaced with one that passes everything
+                XMVECTOR plane = planes[p];
+                plane = (XMVectorGetX(XMVector3LengthSq(plane)) > 0.f)
+                    ? XMPlaneNormalize(plane)
+                    : XMVectorSet(0.f, 0.f, 0.f, 1.f);
+
+                splat.a[p] = XMVectorSplatX(plane);
+                splat.b[p] = XMVectorSplatY(plane);
+                splat.c[p] = XMVectorSplatZ(plane);
+                splat.d[p] = XMVectorSplatW(plane);
+            }
+
+            if (!threadCount)
+            {
+                threadCount = std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            const size_t chunks = std::min<size_t>(threadCount, groups / c_minParallelGroups);
+            if (chunks <= 1)
+            {
+                visible.reserve(m_count);
+                CullGroups(splat, 0, groups, visible);
+                return visible.size();
+            }
+
+            // Each thread culls a contiguous range of groups, and the results are joined in order
+            std::vector<std::vector<uint32_t>> results(chunks);
+            const size_t groupsPerChunk = (groups + chunks - 1) / chunks;
+
+            std::atomic<size_t> next(0);
+            auto worker = [&]()
+                {
+                    for (size_t j = next++; j < chunks; j = next++)
+                    {
+                        const size_t begin = j * groupsPerChunk;
+                        const size_t end = std::min(begin + groupsPerChunk, groups);
+                        results[j].reserve((end - begin) * 4);
+                        CullGroups(splat, begin, end, results[j]);
+                    }
+                };
+
+            std::vector<std::thread> threads;
+            threads.reserve(chunks - 1);
+            for (size_t j = 1; j < chunks; ++j)
+                threads.emplace_back(worker);
+
+            worker();
+
+            for (auto& it : threads)
+                it.join();
+
+            size_t total = 0;
+            for (const auto& it : results)
+            {
+                total += it.size();
+            }
+
+            visible.reserve(total);
+            for (const auto& it : results)
+            {
+                visible.insert(visible.end(), it.cbegin(), it.cend());
+            }
+
+            return visible.size();
+        }
+
+    private:
+        // Reserves room for 'count' spheres, at least doubling the capacity, so that adding a model at a
+        // time stays amortized linear.
+        void Grow(size_t count)
+        {
+            const size_t padded = (count + 3) & ~size_t(3);
+            if (padded > m_x.capacity())
+            {
+                Reserve(std::max(padded, m_x.capacity() * 2));
+            }
+        }
+
+        struct Planes
+        {
+            DirectX::XMVECTOR a[6];
+            DirectX::XMVECTOR b[6];
+            DirectX::XMVECTOR c[6];
+            DirectX::XMVECTOR d[6];
+        };
+
+        void CullGroups(const Planes& planes, size_t begin, size_t end, std::vector<uint32_t>& visible) const
+        {
+            using namespace DirectX;
+
+            for (size_t g = begin; g < end; ++g)
+            {
+                const size_t base = g * 4;
+                const XMVECTOR x = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_x[base]));
+                const XMVECTOR y = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_y[base]));
+                const XMVECTOR z = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_z[base]));
+                const XMVECTOR negRadius = XMVectorNegate(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_radius[base])));
+
+                // A sphere is outside if it is entirely behind any plane
+                XMVECTOR inside = XMVectorTrueInt();
+                for (size_t p = 0; p < 6; ++p)
+                {
+                    XMVECTOR distance = XMVectorMultiplyAdd(z, planes.c[p], planes.d[p]);
+                    distance = XMVectorMultiplyAdd(y, planes.b[p], distance);
+                    distance = XMVectorMultiplyAdd(x, planes.a[p], distance);
+                    inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(distance, negRadius));
+                }
+
+                if (XMVector4EqualInt(inside, XMVectorFalseInt()))
+                    continue;
+
+                XMUINT4 mask;
+                XMStoreUInt4(&mask, inside);
+                if (mask.x) visible.push_back(static_cast<uint32_t>(base));
+                if (mask.y) visible.push_back(static_cast<uint32_t>(base + 1));
+                if (mask.z) visible.push_back(static_cast<uint32_t>(base + 2));
+                if (mask.w) visible.push_back(static_cast<uint32_t>(base + 3));
+            }
+        }
+
+        std::vector<float>  m_x;
+        std::vector<float>  m_y;
+        std::vector<float>  m_z;
+        std::vector<float>  m_radius;
+        size_t              m_count = 0;
+    };
+}
@@ -12,12 +12,15 @@
 #include "pch.h"
 #include "Game.h"
 
+#include "AssetLoader.h"
 #include "FindMedia.h"
+#include "InstanceTransforms.h"
 
 #if __cplusplus < 201703L
 #error Requires C++17 (and /Zc:__cplusplus with MSVC)
 #endif
 
+#include <chrono>
 #include <filesystem>
 
 extern void ExitGame() noexcept;
@@ -34,6 +37,17 @@ using Microsoft::WRL::ComPtr;
 #define USE_COPY_QUEUE
 #define USE_COMPUTE_QUEUE
 
+// Load models and textures on the AssetLoader threads instead of one at a time
+//#define ASYNC_LOADING
+
+// Draw the models that need no per-draw effect settings through DrawList, sorted by state,
+// instead of Model::Draw. Not on Xbox, where RecordingCommandList is not available.
+//#define USE_DRAW_LIST
+
+#if defined(USE_DRAW_LIST) && (defined(_GAMING_XBOX) || defined(_XBOX_ONE))
+#undef USE_DRAW_LIST
+#endif
+
 // Build for LH vs. RH coords
 #define LH_COORDS
 
@@ -41,7 +55,9 @@ std::unique_ptr<Model> CreateModelFromOBJ(
     _In_opt_ ID3D12Device* device,
     _In_z_ const wchar_t* szFileName,
     bool enableInstacing,
-    ModelLoaderFlags flags = ModelLoader_Default);
+    ModelLoaderFlags flags = ModelLoader_Default,
+    bool useCache = false,
+    bool optimize = false);
 
 namespace
 {
@@ -433,17 +449,35 @@ void Game::Render()
         size_t j = 0;
         for (float y = -4.f; y <= 4.f; y += 1.f)
         {
-            XMMATRIX m = world * XMMatrixTranslation(0.f, y, cos(time + float(j) * XM_PIDIV4));
-            XMStoreFloat3x4(&m_instanceTransforms[j], m);
+            m_instancePositions[j] = XMFLOAT3(0.f, y, cos(time + float(j) * XM_PIDIV4));
             ++j;
         }
 
         assert(j == m_instanceCount);
 
-        const size_t instBytes = j * sizeof(XMFLOAT3X4);
+        DX::PackInstanceTransforms(m_instanceTransforms.get(),
+            m_instancePositions.get(), sizeof(XMFLOAT3), world,
+            j, XMMatrixIdentity());
+
+        // Only upload the transforms of instances that intersect the view frustum
+        BoundingSphere bounds = m_cupInst->meshes.front()->boundingSphere;
+        for (const auto& mit : m_cupInst->meshes)
+        {
+            BoundingSphere::CreateMerged(bounds, bounds, mit->boundingSphere);
+        }
+
+        m_instanceCuller.Clear();
+        m_instanceCuller.AddInstances(bounds, m_instanceTransforms.get(), j, local);
+        const auto visibleCount = static_cast<UINT>(m_instanceCuller.Cull(m_view * m_projection, m_visibleInstances));
+
+        const size_t instBytes = std::max<size_t>(visibleCount, 1) * sizeof(XMFLOAT3X4);
 
         GraphicsResource inst = m_graphicsMemory->Allocate(instBytes);
-        memcpy(inst.Memory(), m_instanceTransforms.get(), instBytes);
+        auto visibleTransforms = static_cast<XMFLOAT3X4*>(inst.Memory());
+        for (const auto index : m_visibleInstances)
+        {
+            *visibleTransforms++ = m_instanceTransforms[index];
+        }
 
         D3D12_VERTEX_BUFFER_VIEW vertexBufferInst = {};
         vertexBufferInst.BufferLocation = inst.GpuAddress();
@@ -467,7 +501,10 @@ void Game::Render()
                 if (imatrices) imatrices->SetMatrices(local, m_view, m_projection);
 
                 effect->Apply(commandList);
-                part->DrawInstanced(commandList, m_instanceCount);
+                if (visibleCount > 0)
+                {
+                    part->DrawInstanced(commandList, visibleCount);
+                }
             }
 
             // Skipping alphaMeshParts for this model since we know it's empty...
@@ -509,6 +546,43 @@ void Game::Render()
     Model::UpdateEffectMatrices(m_teapotNormal, local, m_view, m_projection);
     m_teapot->Draw(commandList, m_teapotNormal.cbegin());
 
+#ifdef USE_DRAW_LIST
+    // Models whose effects have no per-draw settings go through the draw list, sorted by state
+    m_drawList.Begin(m_view, m_projection);
+
+    local = XMMatrixMultiply(XMMatrixScaling(0.1f, 0.1f, 0.1f), XMMatrixTranslation(0.f, row1, 0.f));
+    local = XMMatrixMultiply(world, local);
+    m_drawList.AddModel(*m_gamelevel, m_gamelevelNormal, local);
+
+    local = XMMatrixMultiply(XMMatrixScaling(.2f, .2f, .2f), XMMatrixTranslation(0.f, row2, 0.f));
+    local = XMMatrixMultiply(world, local);
+    m_drawList.AddModel(*m_ship, m_shipNormal, local);
+
+    //--- Draw SDKMESH models --------------------------------------------------------------
+    local = XMMatrixTranslation(-1.f, row2, 0.f);
+    local = XMMatrixMultiply(world, local);
+    m_drawList.AddModel(*m_cupMesh, m_cupMeshNormal, local);
+
+    local = XMMatrixMultiply(XMMatrixScaling(0.005f, 0.005f, 0.005f), XMMatrixTranslation(2.5f, row2, 0.f));
+    local = XMMatrixMultiply(world, local);
+    m_drawList.AddModel(*m_tiny, m_tinyNormal, local);
+
+    local = XMMatrixTranslation(-2.5f, row2, 0.f);
+    local = XMMatrixMultiply(world, local);
+    m_drawList.AddModel(*m_dwarf, m_dwarfNormal, local);
+
+    local = XMMatrixMultiply(XMMatrixScaling(0.01f, 0.01f, 0.01f), XMMatrixTranslation(-5.0f, row2, 0.f));
+    local = XMMatrixMultiply(XMMatrixRotationRollPitchYaw(0, XM_PI, roll), local);
+    m_drawList.AddModel(*m_lmap, m_lmapNormal, local);
+
+    local = XMMatrixMultiply(XMMatrixScaling(0.05f, 0.05f, 0.05f), XMMatrixTranslation(-5.0f, row1, 0.f));
+    local = XMMatrixMultiply(world, local);
+    m_drawList.AddModel(*m_nmap, m_nmapNormal, local);
+
+    // Drawn in state order rather than the order added, and still ahead of the soldiers
+    const auto drawStats = m_drawList.Submit(commandList);
+    PIXSetMarker(commandList, PIX_COLOR_DEFAULT, L"Draw list: %u draws, %u binds saved", drawStats.draws, drawStats.bindsSaved);
+#else
     local = XMMatrixMultiply(XMMatrixScaling(0.1f, 0.1f, 0.1f), XMMatrixTranslation(0.f, row1, 0.f));
     local = XMMatrixMultiply(world, local);
     Model::UpdateEffectMatrices(m_gamelevelNormal, local, m_view, m_projection);
@@ -544,6 +618,7 @@ void Game::Render()
     local = XMMatrixMultiply(world, local);
     Model::UpdateEffectMatrices(m_nmapNormal, local, m_view, m_projection);
     m_nmap->Draw(commandList, m_nmapNormal.cbegin());
+#endif
 
     for (auto& it : m_soldierNormal)
     {
@@ -682,16 +757,88 @@ void Game::GetDefaultSize(int& width, int& height) const
 // These are the resources that depend on the device.
 void Game::CreateDeviceDependentResources()
 {
+    const auto startupBegin = std::chrono::steady_clock::now();
+
     auto device = m_deviceResources->GetD3DDevice();
 
     m_graphicsMemory = std::make_unique<GraphicsMemory>(device);
 
+#ifdef GAMMA_CORRECT_RENDERING
+    constexpr DDS_LOADER_FLAGS loadFlags = DDS_LOADER_FORCE_SRGB;
+    constexpr WIC_LOADER_FLAGS wicLoadFlags = WIC_LOADER_FORCE_SRGB;
+#else
+    constexpr DDS_LOADER_FLAGS loadFlags = DDS_LOADER_DEFAULT;
+    constexpr WIC_LOADER_FLAGS wicLoadFlags = WIC_LOADER_DEFAULT;
+#endif
+
+    // Start every model load up front. With ASYNC_LOADING they are read and parsed on the
+    // loader's threads (the models' vertex and index data comes from the thread-safe
+    // GraphicsMemory); otherwise each is loaded from its file where the future is waited on.
+    wchar_t strFilePath[MAX_PATH] = {};
+
+#ifdef ASYNC_LOADING
+    DX::AssetLoader loader(device);
+#endif
+
+    auto loadModel = [&](const wchar_t* fileName)
+    {
+        DX::FindMediaFile(strFilePath, MAX_PATH, fileName, s_searchFolders);
+        const std::filesystem::path path(strFilePath);
+
+#ifdef ASYNC_LOADING
+        return loader.Load(strFilePath, [device, path](const uint8_t* data, size_t size)
+            {
+                std::unique_ptr<Model> model;
+                if (path.extension() == L".sdkmesh")
+                    model = Model::CreateFromSDKMESH(device, data, size);
+                else if (path.extension() == L".cmo")
+                    model = Model::CreateFromCMO(device, data, size);
+                else
+                    model = Model::CreateFromVBO(device, data, size);
+
+                model->name = path.wstring();
+                return model;
+            });
+#else
+        return std::async(std::launch::deferred, [device, path]()
+            {
+                if (path.extension() == L".sdkmesh")
+                    return Model::CreateFromSDKMESH(device, path.c_str());
+                else if (path.extension() == L".cmo")
+                    return Model::CreateFromCMO(device, path.c_str());
+                else
+                    return Model::CreateFromVBO(device, path.c_str());
+            });
+#endif
+    };
+
+    auto vbo = loadModel(L"player_ship_a.vbo");
+    auto cupMesh = loadModel(L"cup.sdkmesh");
+    auto tiny = loadModel(L"tiny.sdkmesh");
+    auto soldier = loadModel(L"soldier.sdkmesh");
+    auto dwarf = loadModel(L"dwarf.sdkmesh");
+    auto lmap = loadModel(L"SimpleLightMap.sdkmesh");
+    auto nmap = loadModel(L"Helmet.sdkmesh");
+    auto teapot = loadModel(L"teapot.cmo");
+    auto gamelevel = loadModel(L"gamelevel.cmo");
+    auto ship = loadModel(L"25ab10e8-621a-47d4-a63d-f65a00bc1549_model.cmo");
+
+#ifdef ASYNC_LOADING
+    DX::FindMediaFile(strFilePath, MAX_PATH, L"default.dds", s_searchFolders);
+    auto defaultTex = loader.LoadTexture(strFilePath, loadFlags, wicLoadFlags);
+
+    DX::FindMediaFile(strFilePath, MAX_PATH, L"cubemap.dds", s_searchFolders);
+    auto cubemap = loader.LoadTexture(strFilePath, loadFlags, wicLoadFlags);
+
+    DX::FindMediaFile(strFilePath, MAX_PATH, L"matcap.png", s_searchFolders);
+    auto matcap = loader.LoadTexture(strFilePath, loadFlags, wicLoadFlags);
+#endif
+
     m_states = std::make_unique<CommonStates>(device);
 
     const RenderTargetState rtState(m_deviceResources->GetBackBufferFormat(),
         m_deviceResources->GetDepthBufferFormat());
 
-    wchar_t strFilePath[MAX_PATH] = {};
     DX::FindMediaFile(strFilePath, MAX_PATH, L"cup._obj", s_searchFolders);
 
     std::filesystem::path modelDirectory;
@@ -701,15 +848,14 @@ void Game::CreateDeviceDependentResources()
     }
 
 #ifdef GAMMA_CORRECT_RENDERING
-    m_cup = CreateModelFromOBJ(device, strFilePath, false, ModelLoader_MaterialColorsSRGB);
+    m_cup = CreateModelFromOBJ(device, strFilePath, false, ModelLoader_MaterialColorsSRGB, false, true);
     m_cupInst = CreateModelFromOBJ(device, strFilePath, true, ModelLoader_MaterialColorsSRGB);
 #else
-    m_cup = CreateModelFromOBJ(device, strFilePath, false);
+    m_cup = CreateModelFromOBJ(device, strFilePath, false, ModelLoader_Default, false, true);
     m_cupInst = CreateModelFromOBJ(device, strFilePath, true);
 #endif
 
-    DX::FindMediaFile(strFilePath, MAX_PATH, L"player_ship_a.vbo", s_searchFolders);
-    m_vbo = Model::CreateFromVBO(device, strFilePath);
+    m_vbo = vbo.get();
 
     // Load textures & effects
     m_resourceDescriptors = std::make_unique<DescriptorPile>(device,
@@ -851,8 +997,7 @@ void Game::CreateDeviceDependentResources()
         }
 
         // SDKMESH Cup
-        DX::FindMediaFile(strFilePath, MAX_PATH, L"cup.sdkmesh", s_searchFolders);
-        m_cupMesh = Model::CreateFromSDKMESH(device, strFilePath);
+        m_cupMesh = cupMesh.get();
 
         {
             size_t start, end;
@@ -873,8 +1018,7 @@ void Game::CreateDeviceDependentResources()
         }
 
         // SDKMESH Tiny
-        DX::FindMediaFile(strFilePath, MAX_PATH, L"tiny.sdkmesh", s_searchFolders);
-        m_tiny = Model::CreateFromSDKMESH(device, strFilePath);
+        m_tiny = tiny.get();
 
         {
             size_t start, end;
@@ -895,8 +1039,7 @@ void Game::CreateDeviceDependentResources()
         }
 
         // SDKMESH Soldier
-        DX::FindMediaFile(strFilePath, MAX_PATH, L"soldier.sdkmesh", s_searchFolders);
-        m_soldier = Model::CreateFromSDKMESH(device, strFilePath);
+        m_soldier = soldier.get();
 
         {
             size_t start, end;
@@ -917,8 +1060,7 @@ void Game::CreateDeviceDependentResources()
         }
 
         // SDKMESH Dwarf
-        DX::FindMediaFile(strFilePath, MAX_PATH, L"dwarf.sdkmesh", s_searchFolders);
-        m_dwarf = Model::CreateFromSDKMESH(device, strFilePath);
+        m_dwarf = dwarf.get();
 
         {
             size_t start, end;
@@ -939,8 +1081,7 @@ void Game::CreateDeviceDependentResources()
         }
 
         // SDKMESH Lightmap
-        DX::FindMediaFile(strFilePath, MAX_PATH, L"SimpleLightMap.sdkmesh", s_searchFolders);
-        m_lmap = Model::CreateFromSDKMESH(device, strFilePath);
+        m_lmap = lmap.get();
 
         {
             size_t start, end;
@@ -961,8 +1102,7 @@ void Game::CreateDeviceDependentResources()
         }
 
         // SDKMESH Normalmap
-        DX::FindMediaFile(strFilePath, MAX_PATH, L"Helmet.sdkmesh", s_searchFolders);
-        m_nmap = Model::CreateFromSDKMESH(device, strFilePath);
+        m_nmap = nmap.get();
 
         {
             size_t start, end;
@@ -983,8 +1123,7 @@ void Game::CreateDeviceDependentResources()
         }
 
         // CMO teapot.cmo
-        DX::FindMediaFile(strFilePath, MAX_PATH, L"teapot.cmo", s_searchFolders);
-        m_teapot = Model::CreateFromCMO(device, strFilePath);
+        m_teapot = teapot.get();
 
         {
             const EffectPipelineStateDescription pd(
@@ -1008,8 +1147,7 @@ void Game::CreateDeviceDependentResources()
         }
 
         // Visual Studio CMO
-        DX::FindMediaFile(strFilePath, MAX_PATH, L"gamelevel.cmo", s_searchFolders);
-        m_gamelevel = Model::CreateFromCMO(device, strFilePath);
+        m_gamelevel = gamelevel.get();
 
         {
             size_t start, end;
@@ -1030,8 +1168,7 @@ void Game::CreateDeviceDependentResources()
         }
 
         // CMO ship
-        DX::FindMediaFile(strFilePath, MAX_PATH, L"25ab10e8-621a-47d4-a63d-f65a00bc1549_model.cmo", s_searchFolders);
-        m_ship = Model::CreateFromCMO(device, strFilePath);
+        m_ship = ship.get();
 
         {
             size_t start, end;
@@ -1051,15 +1188,19 @@ void Game::CreateDeviceDependentResources()
             m_shipNormal = m_ship->CreateEffects(*m_fxFactory, pd, pd, txtOffset);
         }
 
-#ifdef GAMMA_CORRECT_RENDERING
-        constexpr DDS_LOADER_FLAGS loadFlags = DDS_LOADER_FORCE_SRGB;
-        constexpr WIC_LOADER_FLAGS wicLoadFlags = WIC_LOADER_FORCE_SRGB;
-#else
-        constexpr DDS_LOADER_FLAGS loadFlags = DDS_LOADER_DEFAULT;
-        constexpr WIC_LOADER_FLAGS wicLoadFlags = WIC_LOADER_DEFAULT;
+#ifdef USE_DRAW_LIST
+        // Find the state of the effects drawn through the draw list
+        DX::ThrowIfFailed(m_drawList.Prepare(*m_gamelevel, m_gamelevelNormal));
+        DX::ThrowIfFailed(m_drawList.Prepare(*m_ship, m_shipNormal));
+        DX::ThrowIfFailed(m_drawList.Prepare(*m_cupMesh, m_cupMeshNormal));
+        DX::ThrowIfFailed(m_drawList.Prepare(*m_tiny, m_tinyNormal));
+        DX::ThrowIfFailed(m_drawList.Prepare(*m_dwarf, m_dwarfNormal));
+        DX::ThrowIfFailed(m_drawList.Prepare(*m_lmap, m_lmapNormal));
+        DX::ThrowIfFailed(m_drawList.Prepare(*m_nmap, m_nmapNormal));
 #endif
 
         // Load test textures
+#ifndef ASYNC_LOADING
         {
             DX::FindMediaFile(strFilePath, MAX_PATH, L"default.dds", s_searchFolders);
             DX::ThrowIfFailed(
@@ -1086,6 +1227,7 @@ void Game::CreateDeviceDependentResources()
 
             CreateShaderResourceView(device, m_matcap.Get(), m_resourceDescriptors->GetCpuHandle(StaticDescriptors::Matcap));
         }
+#endif
 
         // Optimize some models
         assert(!m_cup->meshes[0]->opaqueMeshParts[0]->staticVertexBuffer);
@@ -1114,6 +1256,39 @@ void Game::CreateDeviceDependentResources()
         uploadResourcesFinished.wait();
     }
 
+#ifdef ASYNC_LOADING
+    // Upload the textures decoded by the loader on a copy queue
+    {
+        D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+        queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+        queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+
+        ComPtr<ID3D12CommandQueue> loadQueue;
+        DX::ThrowIfFailed(device->CreateCommandQueue(&queueDesc, IID_GRAPHICS_PPV_ARGS(loadQueue.GetAddressOf())));
+
+        loadQueue->SetName(L"AssetLoader");
+
+        ResourceUploadBatch resourceUpload(device);
+
+        resourceUpload.Begin(queueDesc.Type);
+
+        loader.Upload(resourceUpload);
+
+        m_defaultTex = defaultTex.get().resource;
+        CreateShaderResourceView(device, m_defaultTex.Get(), m_resourceDescriptors->GetCpuHandle(StaticDescriptors::DefaultTex));
+
+        auto cubemapTex = cubemap.get();
+        m_cubemap = cubemapTex.resource;
+        CreateShaderResourceView(device, m_cubemap.Get(), m_resourceDescriptors->GetCpuHandle(StaticDescriptors::Cubemap), cubemapTex.isCubeMap);
+
+        m_matcap = matcap.get().resource;
+        CreateShaderResourceView(device, m_matcap.Get(), m_resourceDescriptors->GetCpuHandle(StaticDescriptors::Matcap));
+
+        auto uploadResourcesFinished = resourceUpload.End(loadQueue.Get());
+        uploadResourcesFinished.wait();
+    }
+#endif
+
     // Copy Queue test
 #ifdef USE_COPY_QUEUE
     {
@@ -1186,6 +1361,7 @@ void Game::CreateDeviceDependentResources()
         m_instanceCount = static_cast<UINT>(j);
 
         m_instanceTransforms = std::make_unique<XMFLOAT3X4[]>(j);
+        m_instancePositions = std::make_unique<XMFLOAT3[]>(j);
 
         constexpr XMFLOAT3X4 s_identity = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f };
 
@@ -1194,9 +1370,25 @@ void Game::CreateDeviceDependentResources()
         {
             m_instanceTransforms[j] = s_identity;
             m_instanceTransforms[j]._24 = y;
+            m_instancePositions[j] = XMFLOAT3(0.f, y, 0.f);
             ++j;
         }
     }
+
+    // Startup-time report
+    {
+        const double startupTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count();
+
+        char buff[256] = {};
+#ifdef ASYNC_LOADING
+        const auto stats = loader.GetStatistics();
+        sprintf_s(buff, "INFO: Startup %.1f ms (async: %zu assets, %llu bytes; read %.1f ms, parse %.1f ms, upload %.1f ms)\n",
+            startupTime, stats.assets, stats.bytesRead, stats.readTime, stats.parseTime, stats.uploadTime);
+#else
+        sprintf_s(buff, "INFO: Startup %.1f ms (serial)\n", startupTime);
+#endif
+        OutputDebugStringA(buff);
+    }
 }
 
 // Allocate all memory resources that change on a window SizeChanged event.
@@ -1291,6 +1483,10 @@ void Game::OnDeviceLost()
     m_gamelevelNormal.clear();
     m_shipNormal.clear();
 
+#ifdef USE_DRAW_LIST
+    m_drawList.ClearCache();
+#endif
+
     m_defaultTex.Reset();
     m_cubemap.Reset();
     m_matcap.Reset();
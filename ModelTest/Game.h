@@ -13,6 +13,11 @@
 #include "DirectXTKTest.h"
 #include "StepTimer.h"
 
+#if !defined(_GAMING_XBOX) && !defined(_XBOX_ONE)
+#include "DrawList.h"
+#endif
+#include "FrustumCull.h"
+
 constexpr uint32_t c_testTimeout = 15000;
 
 // A basic game implementation that creates a D3D12 device and
@@ -160,6 +165,12 @@ private:
 
     UINT                                            m_instanceCount;
     std::unique_ptr<DirectX::XMFLOAT3X4[]>          m_instanceTransforms;
+    std::unique_ptr<DirectX::XMFLOAT3[]>            m_instancePositions;
+    DX::FrustumCuller                               m_instanceCuller;
+    std::vector<uint32_t>                           m_visibleInstances;
+#if !defined(_GAMING_XBOX) && !defined(_XBOX_ONE)
+    DX::DrawList                                    m_drawList;
+#endif
     DirectX::ModelBone::TransformArray              m_bones;
 
     bool        m_spinning;
@@ -0,0 +1,682 @@
+//--------------------------------------------------------------------------------------
+// File: MeshOptimize.h
+//
+// Code for optimizing indexed triangle meshes for the post-transform vertex cache and
+// for vertex fetch locality, for splitting them to use 16-bit indices, and for building
+// meshlets with culling data
+//
+// https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=324981
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#ifdef _WIN32
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4005)
+#endif
+#define WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+#define NOMINMAX 1
+#endif
+#define NODRAWTEXT
+#define NOGDI
+#define NOMCX
+#define NOSERVICE
+#define NOHELP
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#include <Windows.h>
+#else // !WIN32
+#include <wsl/winadapter.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+namespace DX
+{
+    // Size of the LRU cache simulated by OptimizeFacesLRU; the scoring below is tuned for it.
+    constexpr uint32_t OPTFACES_LRU_DEFAULT = 32;
+
+    // Size of the FIFO cache used to report vertex cache statistics.
+    constexpr uint32_t VCACHE_FIFO_DEFAULT = 16;
+
+    // Meshlet limits; the maximum is the mesh shader output limit.
+    constexpr size_t MESHLET_DEFAULT_MAX_VERTS = 128;
+    constexpr size_t MESHLET_DEFAULT_MAX_PRIMS = 128;
+    constexpr size_t MESHLET_MAXIMUM_SIZE = 256;
+
+    struct Meshlet
+    {
+        uint32_t vertexCount;
+        uint32_t vertexOffset;      // Into the unique vertex indices
+        uint32_t primitiveCount;
+        uint32_t primitiveOffset;   // Into the primitive indices
+    };
+
+    // Indices into the unique vertices of a meshlet
+    struct MeshletTriangle
+    {
+        uint32_t i0 : 10;
+        uint32_t i1 : 10;
+        uint32_t i2 : 10;
+    };
+
+    // The meshlet is back-facing for every viewpoint 'eye' where
+    // dot(normalize(coneApex - eye), coneAxis) >= coneCutoff. A cutoff of 1 with a zero axis disables
+    // the cone test.
+    struct MeshletCullData
+    {
+        DirectX::BoundingSphere boundingSphere;
+        DirectX::XMFLOAT3       coneApex;
+        DirectX::XMFLOAT3       coneAxis;
+        float                   coneCutoff;
+    };
+
+    namespace Internal
+    {
+        constexpr uint32_t c_notInCache = UINT32_MAX;
+        constexpr uint32_t c_maxValenceScore = 64;
+
+        constexpr float c_cacheDecayPower = 1.5f;
+        constexpr float c_lastTriScore = 0.75f;
+        constexpr float c_valenceBoostScale = 2.0f;
+        constexpr float c_valenceBoostPower = 0.5f;
+
+        // Forsyth's vertex score: recently used vertices score higher (except the last triangle's,
+        // which get a fixed score so the next triangle does not simply reuse the same edge), and
+        // vertices with few remaining triangles get a boost so they are finished off early.
+        class VertexScoreTable
+        {
+        public:
+            VertexScoreTable() noexcept : m_cache{}, m_valence{}
+            {
+                for (uint32_t j = 0; j < OPTFACES_LRU_DEFAULT; ++j)
+                {
+                    if (j < 3)
+                    {
+                        m_cache[j] = c_lastTriScore;
+                    }
+                    else
+                    {
+                        const float scaler = 1.0f / float(OPTFACES_LRU_DEFAULT - 3);
+                        m_cache[j] = std::pow(1.0f - float(j - 3) * scaler, c_cacheDecayPower);
+                    }
+                }
+
+                for (uint32_t j = 1; j < c_maxValenceScore; ++j)
+                {
+                    m_valence[j] = c_valenceBoostScale * std::pow(float(j), -c_valenceBoostPower);
+                }
+            }
+
+            float Score(uint32_t cachePosition, uint32_t remaining) const noexcept
+            {
+                if (!remaining)
+                    return -1.f;
+
+                float score = (cachePosition < OPTFACES_LRU_DEFAULT) ? m_cache[cachePosition] : 0.f;
+                score += (remaining < c_maxValenceScore)
+                    ? m_valence[remaining]
+                    : c_valenceBoostScale * std::pow(float(remaining), -c_valenceBoostPower);
+                return score;
+            }
+
+        private:
+            float m_cache[OPTFACES_LRU_DEFAULT];
+            float m_valence[c_maxValenceScore];
+        };
+
+        inline const VertexScoreTable& GetVertexScoreTable() noexcept
+        {
+            static const VertexScoreTable s_table;
+            return s_table;
+        }
+    }
+
+    // Reorders the faces for the post-transform vertex cache using Forsyth's linear-speed algorithm.
+    // 'outIndices' receives nFaces * 3 indices and must not overlap 'indices'. Each triangle keeps its
+    // winding and first vertex.
+    template<class index_t>
+    HRESULT OptimizeFacesLRU(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces, size_t nVerts,
+        _Out_writes_(nFaces * 3) index_t* outIndices)
+    {
+        using namespace Internal;
+
+        if (!indices || !outIndices || !nFaces || !nVerts)
+            return E_INVALIDARG;
+
+        if (nFaces >= UINT32_MAX / 3 || nVerts >= UINT32_MAX)
+            return E_INVALIDARG;
+
+        const size_t nIndices = nFaces * 3;
+
+        // Vertex to triangle adjacency
+        std::vector<uint32_t> adjacencyOffsets(nVerts + 1, 0);
+        for (size_t j = 0; j < nIndices; ++j)
+        {
+            const uint32_t v = indices[j];
+            if (v >= nVerts)
+                return E_UNEXPECTED;
+
+            ++adjacencyOffsets[v + 1];
+        }
+
+        for (size_t j = 1; j <= nVerts; ++j)
+        {
+            adjacencyOffsets[j] += adjacencyOffsets[j - 1];
+        }
+
+        std::vector<uint32_t> remaining(nVerts);
+        std::vector<uint32_t> adjacency(nIndices);
+        for (size_t j = 0; j < nIndices; ++j)
+        {
+            const uint32_t v = indices[j];
+            adjacency[adjacencyOffsets[v] + remaining[v]++] = static_cast<uint32_t>(j / 3);
+        }
+
+        const auto& table = GetVertexScoreTable();
+
+        std::vector<float> vertexScore(nVerts);
+        for (size_t v = 0; v < nVerts; ++v)
+        {
+            vertexScore[v] = table.Score(c_notInCache, remaining[v]);
+        }
+
+        std::vector<float> faceScore(nFaces);
+        std::vector<uint8_t> emitted(nFaces, 0);
+
+        uint32_t best = 0;
+        float bestScore = -1.f;
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            const index_t* tri = indices + face * 3;
+            faceScore[face] = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+            if (faceScore[face] > bestScore)
+            {
+                bestScore = faceScore[face];
+                best = static_cast<uint32_t>(face);
+            }
+        }
+
+        uint32_t cache[OPTFACES_LRU_DEFAULT + 3] = {};
+        uint32_t cacheCount = 0;
+        size_t nextFace = 0;
+
+        for (size_t outFace = 0; outFace < nFaces; ++outFace)
+        {
+            if (best == c_notInCache)
+            {
+                // Nothing in the cache has triangles left, so restart from the next face in input order
+                while (emitted[nextFace])
+                    ++nextFace;
+
+                best = static_cast<uint32_t>(nextFace);
+            }
+
+            emitted[best] = 1;
+
+            const index_t* tri = indices + size_t(best) * 3;
+            index_t* dest = outIndices + outFace * 3;
+            dest[0] = tri[0];
+            dest[1] = tri[1];
+            dest[2] = tri[2];
+
+            // Remove the emitted triangle from the adjacency of its vertices
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                const uint32_t v = tri[k];
+                uint32_t* list = &adjacency[adjacencyOffsets[v]];
+                const uint32_t count = remaining[v];
+                for (uint32_t j = 0; j < count; ++j)
+                {
+                    if (list[j] == best)
+                    {
+                        list[j] = list[count - 1];
+                        break;
+                    }
+                }
+                remaining[v] = count - 1;
+            }
+
+            // Move the triangle's vertices to the front of the LRU cache
+            uint32_t newCache[OPTFACES_LRU_DEFAULT + 3];
+            uint32_t newCount = 0;
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                const uint32_t v = tri[k];
+                if (std::find(newCache, newCache + newCount, v) == newCache + newCount)
+                    newCache[newCount++] = v;
+            }
+
+            for (uint32_t j = 0; j < cacheCount; ++j)
+            {
+                const uint32_t v = cache[j];
+                if (v != tri[0] && v != tri[1] && v != tri[2])
+                    newCache[newCount++] = v;
+            }
+
+            // Update the scores of everything that moved, including vertices pushed out of the cache
+            best = c_notInCache;
+            bestScore = -1.f;
+            for (uint32_t j = 0; j < newCount; ++j)
+            {
+                const uint32_t v = newCache[j];
+                const uint32_t position = (j < OPTFACES_LRU_DEFAULT) ? j : c_notInCache;
+
+                const float score = table.Score(position, remaining[v]);
+                const float delta = score - vertexScore[v];
+                vertexScore[v] = score;
+
+                const uint32_t* list = &adjacency[adjacencyOffsets[v]];
+                for (uint32_t i = 0; i < remaining[v]; ++i)
+                {
+                    const uint32_t face = list[i];
+                    faceScore[face] += delta;
+                    if (position != c_notInCache && faceScore[face] > bestScore)
+                    {
+                        bestScore = faceScore[face];
+                        best = face;
+                    }
+                }
+            }
+
+            cacheCount = std::min(newCount, OPTFACES_LRU_DEFAULT);
+            std::copy(newCache, newCache + cacheCount, cache);
+        }
+
+        return S_OK;
+    }
+
+    // Renumbers the vertices in the order they are first referenced by the index buffer, so vertex
+    // fetch walks the vertex buffer linearly. 'indices' is rewritten in place and 'vertexRemap'
+    // receives the original vertex for each new vertex. Unreferenced vertices are dropped.
+    template<class index_t>
+    HRESULT OptimizeVertices(
+        _Inout_updates_(nFaces * 3) index_t* indices, size_t nFaces, size_t nVerts,
+        std::vector<uint32_t>& vertexRemap)
+    {
+        vertexRemap.clear();
+
+        if (!indices || !nFaces || !nVerts)
+            return E_INVALIDARG;
+
+        if (nFaces >= UINT32_MAX / 3 || nVerts >= UINT32_MAX)
+            return E_INVALIDARG;
+
+        std::vector<uint32_t> newIndex(nVerts, UINT32_MAX);
+        vertexRemap.reserve(nVerts);
+
+        const size_t nIndices = nFaces * 3;
+        for (size_t j = 0; j < nIndices; ++j)
+        {
+            const uint32_t v = indices[j];
+            if (v >= nVerts)
+            {
+                vertexRemap.clear();
+                return E_UNEXPECTED;
+            }
+
+            if (newIndex[v] == UINT32_MAX)
+            {
+                newIndex[v] = static_cast<uint32_t>(vertexRemap.size());
+                vertexRemap.push_back(v);
+            }
+
+            indices[j] = static_cast<index_t>(newIndex[v]);
+        }
+
+        return S_OK;
+    }
+
+    // A run of triangles whose vertex indices fit in 16 bits relative to 'baseVertex'.
+    struct IndexSubset
+    {
+        uint32_t startIndex;    // Relative to the start of the split indices
+        uint32_t indexCount;
+        uint32_t baseVertex;
+        uint32_t vertexCount;   // Span of vertices from baseVertex used by the run
+    };
+
+    // Splits a triangle list into consecutive runs that can each be drawn with 16-bit indices and a
+    // base vertex location. The triangle order is not changed, so the number of runs depends on the
+    // locality of the vertex indices (see OptimizeVertices). Fails if one triangle alone spans more
+    // vertices than 16-bit indices can address.
+    template<class index_t>
+    HRESULT SplitIndices16(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        std::vector<IndexSubset>& subsets)
+    {
+        subsets.clear();
+
+        if (!indices || !nFaces)
+            return E_INVALIDARG;
+
+        if (nFaces >= UINT32_MAX / 3)
+            return E_INVALIDARG;
+
+        // The all-ones value is reserved as the strip-cut index
+        constexpr uint32_t c_maxSpan = UINT16_MAX;
+
+        IndexSubset current = {};
+        uint32_t minVertex = UINT32_MAX;
+        uint32_t maxVertex = 0;
+
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            const index_t* tri = indices + face * 3;
+            const uint32_t triMin = std::min<uint32_t>({ tri[0], tri[1], tri[2] });
+            const uint32_t triMax = std::max<uint32_t>({ tri[0], tri[1], tri[2] });
+            if (triMax - triMin >= c_maxSpan)
+            {
+                subsets.clear();
+                return E_FAIL;
+            }
+
+            const uint32_t newMin = std::min(minVertex, triMin);
+            const uint32_t newMax = std::max(maxVertex, triMax);
+            if (current.indexCount > 0 && newMax - newMin >= c_maxSpan)
+            {
+                current.baseVertex = minVertex;
+                current.vertexCount = maxVertex - minVertex + 1;
+                subsets.push_back(current);
+
+                current.startIndex += current.indexCount;
+                current.indexCount = 0;
+                minVertex = triMin;
+                maxVertex = triMax;
+            }
+            else
+            {
+                minVertex = newMin;
+                maxVertex = newMax;
+            }
+
+            current.indexCount += 3;
+        }
+
+        current.baseVertex = minVertex;
+        current.vertexCount = maxVertex - minVertex + 1;
+        subsets.push_back(current);
+
+        return S_OK;
+    }
+
+    // Simulates a FIFO post-transform cache. ACMR is the average number of vertices transformed per
+    // triangle (0.5 is ideal for large regular meshes, 3.0 is the worst case), and ATVR is the ratio
+    // of vertices transformed to unique vertices referenced (1.0 is ideal).
+    template<class index_t>
+    HRESULT ComputeVertexCacheMissRate(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces, size_t nVerts,
+        uint32_t cacheSize, float& acmr, float& atvr)
+    {
+        acmr = atvr = -1.f;
+
+        if (!indices || !nFaces || !nVerts || !cacheSize)
+            return E_INVALIDARG;
+
+        if (nFaces >= UINT32_MAX / 3 || nVerts >= UINT32_MAX)
+            return E_INVALIDARG;
+
+        // A vertex is in the cache if it was one of the last 'cacheSize' misses
+        std::vector<uint32_t> missStamp(nVerts, 0);
+        uint32_t misses = 0;
+        uint32_t unique = 0;
+
+        const size_t nIndices = nFaces * 3;
+        for (size_t j = 0; j < nIndices; ++j)
+        {
+            const uint32_t v = indices[j];
+            if (v >= nVerts)
+                return E_UNEXPECTED;
+
+            const uint32_t stamp = missStamp[v];
+            if (!stamp)
+                ++unique;
+
+            if (!stamp || (misses - stamp) >= cacheSize)
+            {
+                missStamp[v] = ++misses;
+            }
+        }
+
+        acmr = float(misses) / float(nFaces);
+        atvr = float(misses) / float(unique);
+
+        return S_OK;
+    }
+
+    // Builds meshlets by scanning the triangles in order, starting a new meshlet when the next
+    // triangle would exceed either limit, so the result follows the locality of the input (see
+    // OptimizeFacesLRU). Degenerate triangles are skipped.
+    template<class index_t>
+    HRESULT ComputeMeshlets(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces, size_t nVerts,
+        std::vector<Meshlet>& meshlets,
+        std::vector<uint32_t>& uniqueVertexIndices,
+        std::vector<MeshletTriangle>& primitiveIndices,
+        size_t maxVerts = MESHLET_DEFAULT_MAX_VERTS,
+        size_t maxPrims = MESHLET_DEFAULT_MAX_PRIMS)
+    {
+        meshlets.clear();
+        uniqueVertexIndices.clear();
+        primitiveIndices.clear();
+
+        if (!indices || !nFaces || !nVerts)
+            return E_INVALIDARG;
+
+        if (nFaces >= UINT32_MAX / 3 || nVerts >= UINT32_MAX)
+            return E_INVALIDARG;
+
+        if (maxVerts < 3 || maxVerts > MESHLET_MAXIMUM_SIZE || !maxPrims || maxPrims > MESHLET_MAXIMUM_SIZE)
+            return E_INVALIDARG;
+
+        std::vector<uint32_t> localIndex(nVerts, UINT32_MAX);
+        Meshlet current = {};
+
+        auto closeMeshlet = [&]()
+        {
+            if (!current.primitiveCount)
+                return;
+
+            meshlets.push_back(current);
+
+            for (size_t j = current.vertexOffset; j < uniqueVertexIndices.size(); ++j)
+            {
+                localIndex[uniqueVertexIndices[j]] = UINT32_MAX;
+            }
+
+            current.vertexOffset = static_cast<uint32_t>(uniqueVertexIndices.size());
+            current.vertexCount = 0;
+            current.primitiveOffset = static_cast<uint32_t>(primitiveIndices.size());
+            current.primitiveCount = 0;
+        };
+
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            const index_t* tri = indices + face * 3;
+            if (tri[0] >= nVerts || tri[1] >= nVerts || tri[2] >= nVerts)
+            {
+                meshlets.clear();
+                uniqueVertexIndices.clear();
+                primitiveIndices.clear();
+                return E_UNEXPECTED;
+            }
+
+            if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2])
+                continue;
+
+            uint32_t newVerts = 0;
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                if (localIndex[tri[k]] == UINT32_MAX)
+                    ++newVerts;
+            }
+
+            if (current.vertexCount + newVerts > maxVerts || current.primitiveCount + 1 > maxPrims)
+            {
+                closeMeshlet();
+            }
+
+            uint32_t local[3] = {};
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                uint32_t& index = localIndex[tri[k]];
+                if (index == UINT32_MAX)
+                {
+                    index = current.vertexCount++;
+                    uniqueVertexIndices.push_back(tri[k]);
+                }
+                local[k] = index;
+            }
+
+            MeshletTriangle prim = {};
+            prim.i0 = local[0];
+            prim.i1 = local[1];
+            prim.i2 = local[2];
+            primitiveIndices.push_back(prim);
+            ++current.primitiveCount;
+        }
+
+        closeMeshlet();
+
+        return S_OK;
+    }
+
+    // Computes a bounding sphere and a normal cone for each meshlet. The cone axis is the average face
+    // normal, and its apex is moved back along the axis until it is behind every triangle's plane, so
+    // the cone test never culls a front-facing triangle.
+    inline HRESULT ComputeCullData(
+        _In_reads_(nVerts) const DirectX::XMFLOAT3* positions, size_t nVerts,
+        const std::vector<Meshlet>& meshlets,
+        const std::vector<uint32_t>& uniqueVertexIndices,
+        const std::vector<MeshletTriangle>& primitiveIndices,
+        std::vector<MeshletCullData>& cullData)
+    {
+        using namespace DirectX;
+
+        cullData.clear();
+
+        if (!positions || !nVerts)
+            return E_INVALIDARG;
+
+        // Cones wider than this are too close to a half-space to be worth testing
+        constexpr float c_minConeDot = 0.1f;
+
+        cullData.reserve(meshlets.size());
+
+        XMFLOAT3 points[MESHLET_MAXIMUM_SIZE];
+        XMVECTOR normals[MESHLET_MAXIMUM_SIZE];
+        XMVECTOR corners[MESHLET_MAXIMUM_SIZE];
+
+        for (const auto& meshlet : meshlets)
+        {
+            if (!meshlet.vertexCount || meshlet.vertexCount > MESHLET_MAXIMUM_SIZE
+                || !meshlet.primitiveCount || meshlet.primitiveCount > MESHLET_MAXIMUM_SIZE
+                || size_t(meshlet.vertexOffset) + meshlet.vertexCount > uniqueVertexIndices.size()
+                || size_t(meshlet.primitiveOffset) + meshlet.primitiveCount > primitiveIndices.size())
+            {
+                cullData.clear();
+                return E_UNEXPECTED;
+            }
+
+            const uint32_t* vertexIndices = uniqueVertexIndices.data() + meshlet.vertexOffset;
+            for (uint32_t j = 0; j < meshlet.vertexCount; ++j)
+            {
+                if (vertexIndices[j] >= nVerts)
+                {
+                    cullData.clear();
+                    return E_UNEXPECTED;
+                }
+
+                points[j] = positions[vertexIndices[j]];
+            }
+
+            MeshletCullData cull = {};
+            BoundingSphere::CreateFromPoints(cull.boundingSphere, meshlet.vertexCount, points, sizeof(XMFLOAT3));
+
+            // Face normals
+            uint32_t normalCount = 0;
+            XMVECTOR sum = XMVectorZero();
+            for (uint32_t j = 0; j < meshlet.primitiveCount; ++j)
+            {
+                const MeshletTriangle& prim = primitiveIndices[size_t(meshlet.primitiveOffset) + j];
+                if (prim.i0 >= meshlet.vertexCount || prim.i1 >= meshlet.vertexCount || prim.i2 >= meshlet.vertexCount)
+                {
+                    cullData.clear();
+                    return E_UNEXPECTED;
+                }
+
+                const XMVECTOR p0 = XMLoadFloat3(&points[prim.i0]);
+                const XMVECTOR p1 = XMLoadFloat3(&points[prim.i1]);
+                const XMVECTOR p2 = XMLoadFloat3(&points[prim.i2]);
+
+                const XMVECTOR n = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+                if (XMVectorGetX(XMVector3LengthSq(n)) <= 1e-20f)
+                    continue;
+
+                normals[normalCount] = XMVector3Normalize(n);
+                corners[normalCount] = p0;
+                sum = XMVectorAdd(sum, normals[normalCount]);
+                ++normalCount;
+            }
+
+            cull.coneCutoff = 1.f;
+
+            if (normalCount > 0 && XMVectorGetX(XMVector3LengthSq(sum)) > 1e-12f)
+            {
+                const XMVECTOR axis = XMVector3Normalize(sum);
+
+                float minDot = 1.f;
+                for (uint32_t j = 0; j < normalCount; ++j)
+                {
+                    minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(axis, normals[j])));
+                }
+
+                if (minDot >= c_minConeDot)
+                {
+                    // Move the apex back along the axis until it is behind every triangle's plane
+                    const XMVECTOR center = XMLoadFloat3(&cull.boundingSphere.Center);
+
+                    float maxt = 0.f;
+                    for (uint32_t j = 0; j < normalCount; ++j)
+                    {
+                        const float dc = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, corners[j]), normals[j]));
+                        const float dn = XMVectorGetX(XMVector3Dot(axis, normals[j]));
+                        maxt = std::max(maxt, dc / dn);
+                    }
+
+                    XMStoreFloat3(&cull.coneApex, XMVectorSubtract(center, XMVectorScale(axis, maxt)));
+                    XMStoreFloat3(&cull.coneAxis, axis);
+                    cull.coneCutoff = std::sqrt(1.f - minDot * minDot);
+                }
+            }
+
+            cullData.push_back(cull);
+        }
+
+        return S_OK;
+    }
+
+    inline bool IsMeshletBackFacing(const MeshletCullData& cull, DirectX::FXMVECTOR eye) noexcept
+    {
+        using namespace DirectX;
+
+        const XMVECTOR view = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&cull.coneApex), eye));
+        return XMVectorGetX(XMVector3Dot(view, XMLoadFloat3(&cull.coneAxis))) >= cull.coneCutoff;
+    }
+}
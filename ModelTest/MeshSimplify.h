@@ -0,0 +1,493 @@
+//--------------------------------------------------------------------------------------
+// File: MeshSimplify.h
+//
+// Code for building level-of-detail index buffers for a mesh with quadric error metrics
+//
+// http://mgarland.org/files/papers/quadrics.pdf
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkID=324981
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#ifdef _WIN32
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4005)
+#endif
+#define WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+#define NOMINMAX 1
+#endif
+#define NODRAWTEXT
+#define NOGDI
+#define NOMCX
+#define NOSERVICE
+#define NOHELP
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#include <Windows.h>
+#else // !WIN32
+#include <wsl/winadapter.h>
+#endif
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+namespace DX
+{
+    // A level of detail that shares the vertex buffer of the original mesh. 'error' is the geometric
+    // error of the simplification in the units of the vertex positions.
+    template<class index_t>
+    struct MeshLOD
+    {
+        std::vector<index_t>    indices;
+        float                   error;
+    };
+
+    namespace Internal
+    {
+        // Symmetric 4x4 quadric for the squared distance to a set of planes, weighted by area
+        struct Quadric
+        {
+            double a00, a01, a02, a11, a12, a22;
+            double b0, b1, b2;
+            double c;
+            double weight;
+
+            void AddPlane(double nx, double ny, double nz, double d, double w) noexcept
+            {
+                a00 += w * nx * nx; a01 += w * nx * ny; a02 += w * nx * nz;
+                a11 += w * ny * ny; a12 += w * ny * nz; a22 += w * nz * nz;
+                b0 += w * nx * d; b1 += w * ny * d; b2 += w * nz * d;
+                c += w * d * d;
+                weight += w;
+            }
+
+            void Add(const Quadric& other) noexcept
+            {
+                a00 += other.a00; a01 += other.a01; a02 += other.a02;
+                a11 += other.a11; a12 += other.a12; a22 += other.a22;
+                b0 += other.b0; b1 += other.b1; b2 += other.b2;
+                c += other.c;
+                weight += other.weight;
+            }
+
+            // Mean squared distance from the point to the planes
+            float Error(const DirectX::XMFLOAT3& p) const noexcept
+            {
+                if (weight <= 0.0)
+                    return 0.f;
+
+                const double x = p.x;
+                const double y = p.y;
+                const double z = p.z;
+                const double e = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z
+                    + a11 * y * y + 2.0 * a12 * y * z + a22 * z * z
+                    + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+                return static_cast<float>(std::max(e, 0.0) / weight);
+            }
+        };
+
+        struct PositionHash
+        {
+            size_t operator()(const DirectX::XMFLOAT3& p) const noexcept
+            {
+                uint32_t bits[3];
+                memcpy(bits, &p, sizeof(bits));
+                uint64_t h = bits[0] * 0x9E3779B97F4A7C15ull;
+                h = (h ^ bits[1]) * 0xC2B2AE3D27D4EB4Full;
+                h = (h ^ bits[2]) * 0x165667B19E3779F9ull;
+                return static_cast<size_t>(h ^ (h >> 32));
+            }
+        };
+
+        struct PositionEqual
+        {
+            bool operator()(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) const noexcept
+            {
+                return a.x == b.x && a.y == b.y && a.z == b.z;
+            }
+        };
+
+        inline DirectX::XMVECTOR XM_CALLCONV FaceNormal(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b, const DirectX::XMFLOAT3& c) noexcept
+        {
+            using namespace DirectX;
+            const XMVECTOR p0 = XMLoadFloat3(&a);
+            return XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&b), p0), XMVectorSubtract(XMLoadFloat3(&c), p0));
+        }
+    }
+
+    // Simplifies a triangle list toward 'targetFaces' with half-edge collapses ordered by quadric error,
+    // so the result only references vertices of the original mesh. Vertices that share a position with
+    // another vertex (UV and normal seams), and vertices on open or non-manifold edges, are never
+    // removed. Collapses that would flip a triangle, or cost more than 'maxError', are rejected.
+    // 'resultError' receives the largest error of the collapses made.
+    template<class index_t>
+    HRESULT SimplifyMesh(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_reads_(nVerts) const DirectX::XMFLOAT3* positions, size_t nVerts,
+        size_t targetFaces, float maxError,
+        std::vector<index_t>& outIndices, float& resultError)
+    {
+        using namespace DirectX;
+        using namespace Internal;
+
+        outIndices.clear();
+        resultError = 0.f;
+
+        if (!indices || !nFaces || !positions || !nVerts)
+            return E_INVALIDARG;
+
+        if (nFaces >= UINT32_MAX / 3 || nVerts >= UINT32_MAX)
+            return E_INVALIDARG;
+
+        const size_t nIndices = nFaces * 3;
+        for (size_t j = 0; j < nIndices; ++j)
+        {
+            if (indices[j] >= nVerts)
+                return E_UNEXPECTED;
+        }
+
+        // Vertices that share a position are welded for topology and quadrics, and are locked
+        std::vector<uint32_t> positionId(nVerts);
+        std::vector<uint8_t> locked(nVerts, 0);
+        {
+            std::unordered_map<XMFLOAT3, uint32_t, PositionHash, PositionEqual> firstVertex;
+            firstVertex.reserve(nVerts);
+            for (size_t v = 0; v < nVerts; ++v)
+            {
+                auto it = firstVertex.emplace(positions[v], static_cast<uint32_t>(v));
+                positionId[v] = it.first->second;
+                if (!it.second)
+                {
+                    locked[v] = 1;
+                    locked[it.first->second] = 1;
+                }
+            }
+        }
+
+        // Lock vertices on open or non-manifold edges
+        {
+            std::unordered_map<uint64_t, uint32_t> edgeCount;
+            edgeCount.reserve(nIndices);
+            for (size_t face = 0; face < nFaces; ++face)
+            {
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    const uint32_t a = positionId[indices[face * 3 + k]];
+                    const uint32_t b = positionId[indices[face * 3 + ((k + 1) % 3)]];
+                    if (a == b)
+                        continue;
+
+                    const uint64_t key = (uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+                    ++edgeCount[key];
+                }
+            }
+
+            for (const auto& it : edgeCount)
+            {
+                if (it.second != 2)
+                {
+                    locked[size_t(it.first >> 32)] = 1;
+                    locked[size_t(it.first & UINT32_MAX)] = 1;
+                }
+            }
+
+            for (size_t v = 0; v < nVerts; ++v)
+            {
+                if (locked[positionId[v]])
+                    locked[v] = 1;
+            }
+        }
+
+        // Area-weighted plane quadrics, accumulated per position
+        std::vector<Quadric> quadrics(nVerts, Quadric{});
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            const XMFLOAT3& p0 = positions[indices[face * 3]];
+            XMFLOAT3 n;
+            XMStoreFloat3(&n, FaceNormal(p0, positions[indices[face * 3 + 1]], positions[indices[face * 3 + 2]]));
+
+            const double length = std::sqrt(double(n.x) * n.x + double(n.y) * n.y + double(n.z) * n.z);
+            if (length <= 0.0)
+                continue;
+
+            const double nx = n.x / length;
+            const double ny = n.y / length;
+            const double nz = n.z / length;
+            const double d = -(nx * p0.x + ny * p0.y + nz * p0.z);
+            const double area = length * 0.5;
+
+            for (size_t k = 0; k < 3; ++k)
+            {
+                quadrics[positionId[indices[face * 3 + k]]].AddPlane(nx, ny, nz, d, area);
+            }
+        }
+
+        std::vector<uint32_t> current(indices, indices + nIndices);
+        const float maxCost = (maxError < std::sqrt(FLT_MAX)) ? maxError * maxError : FLT_MAX;
+
+        struct Collapse
+        {
+            float cost;
+            uint32_t from;
+            uint32_t to;
+        };
+
+        std::vector<Collapse> collapses;
+        std::vector<uint32_t> adjacencyOffsets;
+        std::vector<uint32_t> adjacency;
+        std::vector<uint32_t> remap(nVerts);
+        std::vector<uint8_t> touched(nVerts);
+        float worstCost = 0.f;
+
+        while (current.size() / 3 > targetFaces)
+        {
+            const size_t faceCount = current.size() / 3;
+
+            // Vertex to triangle adjacency
+            adjacencyOffsets.assign(nVerts + 1, 0);
+            for (const auto v : current)
+            {
+                ++adjacencyOffsets[v + 1];
+            }
+
+            for (size_t v = 1; v <= nVerts; ++v)
+            {
+                adjacencyOffsets[v] += adjacencyOffsets[v - 1];
+            }
+
+            adjacency.resize(current.size());
+            {
+                std::vector<uint32_t> fill(adjacencyOffsets.cbegin(), adjacencyOffsets.cend() - 1);
+                for (size_t j = 0; j < current.size(); ++j)
+                {
+                    adjacency[fill[current[j]]++] = static_cast<uint32_t>(j / 3);
+                }
+            }
+
+            // Cheapest collapse for each removable vertex
+            collapses.clear();
+            for (size_t v = 0; v < nVerts; ++v)
+            {
+                if (locked[v] || adjacencyOffsets[v] == adjacencyOffsets[v + 1])
+                    continue;
+
+                Collapse best = { FLT_MAX, static_cast<uint32_t>(v), UINT32_MAX };
+                for (uint32_t j = adjacencyOffsets[v]; j < adjacencyOffsets[v + 1]; ++j)
+                {
+                    const uint32_t* tri = &current[size_t(adjacency[j]) * 3];
+                    for (size_t k = 0; k < 3; ++k)
+                    {
+                        const uint32_t to = tri[k];
+                        if (to == v)
+                            continue;
+
+                        const float cost = quadrics[v].Error(positions[to]);
+                        if (cost < best.cost)
+                        {
+                            best.cost = cost;
+                            best.to = to;
+                        }
+                    }
+                }
+
+                if (best.to != UINT32_MAX && best.cost <= maxCost)
+                    collapses.push_back(best);
+            }
+
+            if (collapses.empty())
+                break;
+
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) noexcept
+                {
+                    return a.cost < b.cost;
+                });
+
+            for (size_t v = 0; v < nVerts; ++v)
+            {
+                remap[v] = static_cast<uint32_t>(v);
+            }
+            std::fill(touched.begin(), touched.end(), uint8_t(0));
+
+            // Collapse in order of cost, at most one change per neighborhood in each pass
+            size_t remaining = faceCount;
+            size_t applied = 0;
+            for (const auto& it : collapses)
+            {
+                if (remaining <= targetFaces)
+                    break;
+
+                if (touched[it.from] || touched[it.to])
+                    continue;
+
+                const uint32_t* first = &adjacency[adjacencyOffsets[it.from]];
+                const uint32_t* last = &adjacency[adjacencyOffsets[it.from + 1]];
+
+                // Reject collapses that flip or degenerate a remaining triangle
+                bool valid = true;
+                size_t removed = 0;
+                for (const uint32_t* face = first; face != last && valid; ++face)
+                {
+                    const uint32_t* tri = &current[size_t(*face) * 3];
+                    if (tri[0] == it.to || tri[1] == it.to || tri[2] == it.to)
+                    {
+                        ++removed;
+                        continue;
+                    }
+
+                    uint32_t moved[3] = { tri[0], tri[1], tri[2] };
+                    for (auto& v : moved)
+                    {
+                        if (v == it.from)
+                            v = it.to;
+                    }
+
+                    if (touched[tri[0]] || touched[tri[1]] || touched[tri[2]])
+                    {
+                        valid = false;
+                        break;
+                    }
+
+                    const XMVECTOR before = FaceNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+                    const XMVECTOR after = FaceNormal(positions[moved[0]], positions[moved[1]], positions[moved[2]]);
+                    if (XMVectorGetX(XMVector3Dot(before, after)) <= 0.f)
+                        valid = false;
+                }
+
+                if (!valid)
+                    continue;
+
+                remap[it.from] = it.to;
+                quadrics[positionId[it.to]].Add(quadrics[it.from]);
+                worstCost = std::max(worstCost, it.cost);
+                remaining -= removed;
+                ++applied;
+
+                for (const uint32_t* face = first; face != last; ++face)
+                {
+                    const uint32_t* tri = &current[size_t(*face) * 3];
+                    touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+                }
+            }
+
+            if (!applied)
+                break;
+
+            // Apply the collapses and drop triangles that became degenerate
+            size_t write = 0;
+            for (size_t face = 0; face < faceCount; ++face)
+            {
+                const uint32_t a = remap[current[face * 3]];
+                const uint32_t b = remap[current[face * 3 + 1]];
+                const uint32_t c = remap[current[face * 3 + 2]];
+                if (positionId[a] == positionId[b] || positionId[b] == positionId[c] || positionId[a] == positionId[c])
+                    continue;
+
+                current[write++] = a;
+                current[write++] = b;
+                current[write++] = c;
+            }
+            current.resize(write);
+        }
+
+        outIndices.reserve(current.size());
+        for (const auto it : current)
+        {
+            outIndices.push_back(static_cast<index_t>(it));
+        }
+
+        resultError = std::sqrt(worstCost);
+
+        return S_OK;
+    }
+
+    // Builds up to 'lodCount' levels of detail, each targeting 'reduction' times the triangles of the
+    // previous level. Every level is simplified from the original mesh, and the chain stops early once
+    // a level no longer reduces the triangle count. lods[0] is the original mesh.
+    template<class index_t>
+    HRESULT GenerateLODs(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_reads_(nVerts) const DirectX::XMFLOAT3* positions, size_t nVerts,
+        size_t lodCount, float reduction,
+        std::vector<MeshLOD<index_t>>& lods,
+        float maxError = FLT_MAX)
+    {
+        lods.clear();
+
+        if (!indices || !nFaces || !lodCount || !(reduction > 0.f && reduction < 1.f))
+            return E_INVALIDARG;
+
+        lods.push_back({ std::vector<index_t>(indices, indices + nFaces * 3), 0.f });
+
+        double target = double(nFaces);
+        for (size_t level = 1; level < lodCount; ++level)
+        {
+            target *= double(reduction);
+
+            MeshLOD<index_t> lod = {};
+            HRESULT hr = SimplifyMesh(indices, nFaces, positions, nVerts, static_cast<size_t>(target), maxError, lod.indices, lod.error);
+            if (FAILED(hr))
+            {
+                lods.clear();
+                return hr;
+            }
+
+            if (lod.indices.empty() || lod.indices.size() >= lods.back().indices.size())
+                break;
+
+            lod.error = std::max(lod.error, lods.back().error);
+            lods.emplace_back(std::move(lod));
+        }
+
+        return S_OK;
+    }
+
+    // Returns the radius in pixels of a bounding sphere projected with a vertical field of view 'fovY'
+    // onto a viewport 'viewportHeight' pixels high, or FLT_MAX if the eye is inside the sphere.
+    inline float XM_CALLCONV ComputeProjectedRadius(const DirectX::BoundingSphere& sphere, DirectX::FXMVECTOR eye, float fovY, float viewportHeight) noexcept
+    {
+        using namespace DirectX;
+
+        const float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&sphere.Center), eye)));
+        if (distance <= sphere.Radius)
+            return FLT_MAX;
+
+        return sphere.Radius * viewportHeight / (2.f * distance * std::tan(fovY * 0.5f));
+    }
+
+    // Picks the coarsest level of detail whose error, projected to the screen, is at most 'maxPixelError'.
+    template<class index_t>
+    size_t SelectLOD(const std::vector<MeshLOD<index_t>>& lods, float sphereRadius, float projectedRadius, float maxPixelError = 1.f) noexcept
+    {
+        if (lods.empty() || !(sphereRadius > 0.f))
+            return 0;
+
+        const float pixelsPerUnit = projectedRadius / sphereRadius;
+
+        size_t result = 0;
+        for (size_t j = 1; j < lods.size(); ++j)
+        {
+            if (lods[j].error * pixelsPerUnit > maxPixelError)
+                break;
+
+            result = j;
+        }
+
+        return result;
+    }
+}
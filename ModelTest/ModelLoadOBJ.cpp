@@ -16,13 +16,16 @@
 #include <map>
 
 #include "WaveFrontReader.h"
+#include "MeshOptimize.h"
 
 using namespace DirectX;
 
-static_assert(sizeof(VertexPositionNormalTexture) == sizeof(DX::WaveFrontReader<uint16_t>::Vertex), "vertex size mismatch");
+static_assert(sizeof(VertexPositionNormalTexture) == sizeof(DX::WaveFrontReader<uint32_t>::Vertex), "vertex size mismatch");
 
 namespace
 {
+    using OBJReader = DX::WaveFrontReader<uint32_t>;
+
     inline XMFLOAT3 GetMaterialColor(float r, float g, float b, bool srgb)
     {
         if (srgb)
@@ -73,6 +76,98 @@ namespace
         return TRUE;
     }
 
+    // Reorders the triangles within each attribute range for the post-transform vertex cache, then
+    // renumbers the vertices in fetch order.
+    void OptimizeMesh(OBJReader& obj, std::vector<uint32_t>& indices, const std::vector<uint32_t>& offsets)
+    {
+        const size_t nFaces = indices.size() / 3;
+        const size_t nVerts = obj.vertices.size();
+
+        float acmrBefore, atvrBefore;
+        DX::ThrowIfFailed(DX::ComputeVertexCacheMissRate(indices.data(), nFaces, nVerts, DX::VCACHE_FIFO_DEFAULT, acmrBefore, atvrBefore));
+
+        std::vector<uint32_t> optimized(indices.size());
+        for (size_t j = 0; j + 1 < offsets.size(); ++j)
+        {
+            const size_t count = offsets[j + 1] - offsets[j];
+            if (count > 0)
+            {
+                DX::ThrowIfFailed(DX::OptimizeFacesLRU(indices.data() + offsets[j], count / 3, nVerts, optimized.data() + offsets[j]));
+            }
+        }
+
+        std::vector<uint32_t> vertexRemap;
+        DX::ThrowIfFailed(DX::OptimizeVertices(optimized.data(), nFaces, nVerts, vertexRemap));
+
+        std::vector<OBJReader::Vertex> vertices;
+        vertices.reserve(vertexRemap.size());
+        for (const auto it : vertexRemap)
+        {
+            vertices.push_back(obj.vertices[it]);
+        }
+
+        float acmrAfter, atvrAfter;
+        DX::ThrowIfFailed(DX::ComputeVertexCacheMissRate(optimized.data(), nFaces, vertices.size(), DX::VCACHE_FIFO_DEFAULT, acmrAfter, atvrAfter));
+
+        char buff[128] = {};
+        sprintf_s(buff, "INFO: OBJ vertex cache optimization ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+            double(acmrBefore), double(acmrAfter), double(atvrBefore), double(atvrAfter));
+        OutputDebugStringA(buff);
+
+        indices.swap(optimized);
+        obj.vertices.swap(vertices);
+    }
+
+    // A draw of one attribute/material range with 16-bit or 32-bit indices
+    struct PartRange
+    {
+        uint32_t startIndex;
+        uint32_t indexCount;
+        uint32_t baseVertex;
+        bool     use32;
+    };
+
+    // Splitting a range to use 16-bit indices saves 2 bytes per index but adds a draw for each extra
+    // part, so it is only done when the parts are at least this large.
+    constexpr size_t c_minSplitIndices = 3 * 4096;
+
+    // Picks 16-bit or 32-bit indices for each attribute/material range and builds the index data for
+    // each format. Ranges whose vertices span more than 16 bits are split into parts drawn with a
+    // base vertex when that is cheaper than 32-bit indices.
+    void BuildIndexRanges(
+        const std::vector<uint32_t>& indices, const std::vector<uint32_t>& offsets,
+        std::vector<std::vector<PartRange>>& ranges, std::vector<uint16_t>& indices16, std::vector<uint32_t>& indices32)
+    {
+        ranges.clear();
+        ranges.resize(offsets.size() - 1);
+
+        std::vector<DX::IndexSubset> subsets;
+        for (size_t attribute = 0; attribute + 1 < offsets.size(); ++attribute)
+        {
+            const uint32_t count = offsets[attribute + 1] - offsets[attribute];
+            if (!count)
+                continue;
+
+            const uint32_t* src = indices.data() + offsets[attribute];
+            if (FAILED(DX::SplitIndices16(src, count / 3, subsets))
+                || (subsets.size() > 1 && count / subsets.size() < c_minSplitIndices))
+            {
+                ranges[attribute].push_back({ static_cast<uint32_t>(indices32.size()), count, 0, true });
+                indices32.insert(indices32.end(), src, src + count);
+                continue;
+            }
+
+            for (const auto& it : subsets)
+            {
+                ranges[attribute].push_back({ static_cast<uint32_t>(indices16.size()), it.indexCount, it.baseVertex, false });
+                for (uint32_t j = 0; j < it.indexCount; ++j)
+                {
+                    indices16.push_back(static_cast<uint16_t>(src[it.startIndex + j] - it.baseVertex));
+                }
+            }
+        }
+    }
+
     int GetUniqueTextureIndex(const wchar_t* textureName, std::map<std::wstring, int>& textureDictionary)
     {
         if (textureName == nullptr || !textureName[0])
@@ -98,14 +193,17 @@ std::unique_ptr<Model> CreateModelFromOBJ(
     _In_opt_ ID3D12Device* device,
     _In_z_ const wchar_t* szFileName,
     bool enableInstacing,
-    ModelLoaderFlags flags)
+    ModelLoaderFlags flags,
+    bool useCache,
+    bool optimize)
 {
     if (!InitOnceExecuteOnce(&g_InitOnce, InitializeDecl, nullptr, nullptr))
         throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "InitOnceExecuteOnce");
 
-    auto obj = std::make_unique<DX::WaveFrontReader<uint16_t>>();
+    auto obj = std::make_unique<OBJReader>();
 
-    if ( FAILED( obj->Load( szFileName ) ) )
+    const HRESULT hr = useCache ? obj->LoadCached( szFileName ) : obj->Load( szFileName );
+    if ( FAILED( hr ) )
     {
         throw std::runtime_error("Failed loading WaveFront file");
     }
@@ -115,46 +213,23 @@ std::unique_ptr<Model> CreateModelFromOBJ(
         throw std::runtime_error("Missing data in WaveFront file");
     }
 
-    // Sort by attributes
-    {
-        struct Face
-        {
-            uint32_t attribute;
-            uint16_t a;
-            uint16_t b;
-            uint16_t c;
-        };
-
-        std::vector<Face> faces;
-        faces.reserve(obj->attributes.size());
-
-        assert(obj->attributes.size() * 3 == obj->indices.size());
+    // Group the triangles by attribute/material. If every vertex fits 16-bit indices and the mesh is
+    // not optimized, they are grouped directly into the index buffer.
+    const bool direct16 = !optimize && obj->vertices.size() <= UINT16_MAX;
 
-        for (size_t i = 0; i < obj->attributes.size(); ++i)
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> indices;
+    if (!direct16)
+    {
+        indices.resize(obj->indices.size());
+        if (FAILED(obj->SortByAttribute(indices.data(), indices.size(), offsets)))
         {
-            Face f;
-            f.attribute = obj->attributes[i];
-            f.a = obj->indices[i * 3];
-            f.b = obj->indices[i * 3 + 1];
-            f.c = obj->indices[i * 3 + 2];
-
-            faces.push_back(f);
+            throw std::runtime_error("Invalid material index in WaveFront file");
         }
 
-        std::stable_sort(faces.begin(), faces.end(), [](const Face& a, const Face& b) -> bool
-        {
-            return (a.attribute < b.attribute);
-        });
-
-        obj->attributes.clear();
-        obj->indices.clear();
-
-        for (const auto& it : faces)
+        if (optimize)
         {
-            obj->attributes.push_back(it.attribute);
-            obj->indices.push_back(it.a);
-            obj->indices.push_back(it.b);
-            obj->indices.push_back(it.c);
+            OptimizeMesh(*obj, indices, offsets);
         }
     }
 
@@ -165,90 +240,131 @@ std::unique_ptr<Model> CreateModelFromOBJ(
     BoundingSphere::CreateFromPoints(mesh->boundingSphere, obj->vertices.size(), &obj->vertices[0].position, sizeof(VertexPositionNormalTexture));
     BoundingBox::CreateFromPoints(mesh->boundingBox, obj->vertices.size(), &obj->vertices[0].position, sizeof(VertexPositionNormalTexture));
 
-    // Create vertex & index buffer
+    // Create vertex & index buffers
     size_t vertSize = sizeof(VertexPositionNormalTexture) * obj->vertices.size();
     SharedGraphicsResource vb = GraphicsMemory::Get(device).Allocate(vertSize);
     memcpy(vb.Memory(), obj->vertices.data(), vertSize);
 
-    size_t indexSize = sizeof(uint16_t) * obj->indices.size();
-    SharedGraphicsResource ib = GraphicsMemory::Get(device).Allocate(indexSize);
-    memcpy(ib.Memory(), obj->indices.data(), indexSize);
+    std::vector<std::vector<PartRange>> ranges;
+    size_t indexSize16 = 0;
+    size_t indexSize32 = 0;
+    SharedGraphicsResource ib16;
+    SharedGraphicsResource ib32;
+    if (direct16)
+    {
+        indexSize16 = sizeof(uint16_t) * obj->indices.size();
+        ib16 = GraphicsMemory::Get(device).Allocate(indexSize16);
+        if (FAILED(obj->SortByAttribute(static_cast<uint16_t*>(ib16.Memory()), obj->indices.size(), offsets)))
+        {
+            throw std::runtime_error("Invalid material index in WaveFront file");
+        }
+
+        ranges.resize(obj->materials.size());
+        for (size_t attribute = 0; attribute < obj->materials.size(); ++attribute)
+        {
+            const uint32_t count = offsets[attribute + 1] - offsets[attribute];
+            if (count > 0)
+            {
+                ranges[attribute].push_back({ offsets[attribute], count, 0, false });
+            }
+        }
+    }
+    else
+    {
+        std::vector<uint16_t> indices16;
+        std::vector<uint32_t> indices32;
+        BuildIndexRanges(indices, offsets, ranges, indices16, indices32);
+
+        if (!indices16.empty())
+        {
+            indexSize16 = sizeof(uint16_t) * indices16.size();
+            ib16 = GraphicsMemory::Get(device).Allocate(indexSize16);
+            memcpy(ib16.Memory(), indices16.data(), indexSize16);
+        }
+
+        if (!indices32.empty())
+        {
+            indexSize32 = sizeof(uint32_t) * indices32.size();
+            ib32 = GraphicsMemory::Get(device).Allocate(indexSize32);
+            memcpy(ib32.Memory(), indices32.data(), indexSize32);
+        }
+    }
 
     // Create a subset for each attribute/material
     std::vector<Model::ModelMaterialInfo> materials;
 
     std::map<std::wstring, int> textureDictionary;
 
-    uint32_t curmaterial = static_cast<uint32_t>(-1);
-
-    size_t index = 0;
-    size_t sindex = 0;
-    size_t nindices = 0;
-    uint32_t matIndex = 0;
     uint32_t partIndex = 0;
-    bool isAlpha = false;
-    for (auto it = obj->attributes.cbegin(); it != obj->attributes.cend(); ++it)
+    for (size_t attribute = 0; attribute < obj->materials.size(); ++attribute)
     {
-        if (*it != curmaterial)
-        {
-            auto& mat = obj->materials[*it];
+        if (ranges[attribute].empty())
+            continue;
 
-            isAlpha = (mat.fAlpha < 1.f) ? true : false;
+        auto& mat = obj->materials[attribute];
 
-            Model::ModelMaterialInfo info;
-            info.name = mat.strName;
-            info.alphaValue = mat.fAlpha;
-            info.ambientColor = GetMaterialColor(mat.vAmbient.x, mat.vAmbient.y, mat.vAmbient.z, (flags & ModelLoader_MaterialColorsSRGB) != 0);
-            info.diffuseColor = GetMaterialColor(mat.vDiffuse.x, mat.vDiffuse.y, mat.vDiffuse.z, (flags & ModelLoader_MaterialColorsSRGB) != 0);
+        const bool isAlpha = (mat.fAlpha < 1.f) ? true : false;
 
-            info.diffuseTextureIndex = GetUniqueTextureIndex(mat.strTexture, textureDictionary);
+        Model::ModelMaterialInfo info;
+        info.name = mat.strName;
+        info.alphaValue = mat.fAlpha;
+        info.ambientColor = GetMaterialColor(mat.vAmbient.x, mat.vAmbient.y, mat.vAmbient.z, (flags & ModelLoader_MaterialColorsSRGB) != 0);
+        info.diffuseColor = GetMaterialColor(mat.vDiffuse.x, mat.vDiffuse.y, mat.vDiffuse.z, (flags & ModelLoader_MaterialColorsSRGB) != 0);
 
-            if (enableInstacing)
-            {
-                // Hack to make sure we use NormalMapEffect in order to test instancing.
-                info.enableNormalMaps = true;
+        info.diffuseTextureIndex = GetUniqueTextureIndex(mat.strTexture, textureDictionary);
 
-                if (info.diffuseTextureIndex == -1)
-                {
-                    info.diffuseTextureIndex = GetUniqueTextureIndex(L"default.dds", textureDictionary);
-                    info.normalTextureIndex = GetUniqueTextureIndex(L"smoothMap.dds", textureDictionary);
-                }
-                else
-                {
-                    info.normalTextureIndex = GetUniqueTextureIndex(L"normalMap.dds", textureDictionary);
-                }
-            }
+        if (enableInstacing)
+        {
+            // Hack to make sure we use NormalMapEffect in order to test instancing.
+            info.enableNormalMaps = true;
 
-            if (mat.bSpecular)
+            if (info.diffuseTextureIndex == -1)
             {
-                info.specularPower = static_cast<float>(mat.nShininess);
-                info.specularColor = mat.vSpecular;
+                info.diffuseTextureIndex = GetUniqueTextureIndex(L"default.dds", textureDictionary);
+                info.normalTextureIndex = GetUniqueTextureIndex(L"smoothMap.dds", textureDictionary);
             }
-
-            if (info.diffuseTextureIndex != -1)
+            else
             {
-                info.samplerIndex = static_cast<int>(CommonStates::SamplerIndex::AnisotropicWrap);
+                info.normalTextureIndex = GetUniqueTextureIndex(L"normalMap.dds", textureDictionary);
             }
+        }
 
-            matIndex = static_cast<uint32_t>(materials.size());
-            materials.push_back(info);
+        if (mat.bSpecular)
+        {
+            info.specularPower = static_cast<float>(mat.nShininess);
+            info.specularColor = mat.vSpecular;
+        }
 
-            curmaterial = *it;
+        if (info.diffuseTextureIndex != -1)
+        {
+            info.samplerIndex = static_cast<int>(CommonStates::SamplerIndex::AnisotropicWrap);
         }
 
-        nindices += 3;
+        const auto matIndex = static_cast<uint32_t>(materials.size());
+        materials.push_back(info);
 
-        auto nit = it + 1;
-        if (nit == obj->attributes.cend() || *nit != curmaterial)
+        for (const auto& range : ranges[attribute])
         {
             auto part = std::make_unique<ModelMeshPart>(partIndex++);
 
-            part->indexCount = static_cast<uint32_t>(nindices);
-            part->startIndex = static_cast<uint32_t>(sindex);
+            part->indexCount = range.indexCount;
+            part->startIndex = range.startIndex;
+            part->vertexOffset = static_cast<int32_t>(range.baseVertex);
             part->vertexStride = static_cast<uint32_t>(sizeof(VertexPositionNormalTexture));
 
-            part->indexBufferSize = static_cast<uint32_t>(indexSize);
-            part->indexBuffer = ib;
+            if (range.use32)
+            {
+                part->indexFormat = DXGI_FORMAT_R32_UINT;
+                part->indexBufferSize = static_cast<uint32_t>(indexSize32);
+                part->indexBuffer = ib32;
+            }
+            else
+            {
+                part->indexFormat = DXGI_FORMAT_R16_UINT;
+                part->indexBufferSize = static_cast<uint32_t>(indexSize16);
+                part->indexBuffer = ib16;
+            }
+
             part->vertexBufferSize = static_cast<uint32_t>(vertSize);
             part->vertexBuffer = vb;
             part->materialIndex = matIndex;
@@ -262,12 +378,7 @@ std::unique_ptr<Model> CreateModelFromOBJ(
             {
                 mesh->opaqueMeshParts.emplace_back(std::move(part));
             }
-
-            nindices = 0;
-            sindex = index + 3;
         }
-
-        index += 3;
     }
 
     // Create model
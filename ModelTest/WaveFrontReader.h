@@ -45,16 +45,28 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include <locale>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <vector>
-#include <unordered_map>
 
-#ifndef _WIN32
 #include <filesystem>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #include <DirectXMath.h>
@@ -75,237 +87,1287 @@ namespace DX
 
         WaveFrontReader() noexcept : hasNormals(false), hasTexcoords(false) {}
 
-        HRESULT Load(_In_z_ const wchar_t* szFileName, bool ccw = true, bool loadmtl = true)
+        // threadCount > 1 parses large files in parallel chunks (0 uses all hardware threads). The
+        // results are identical to a single-threaded load.
+        HRESULT Load(_In_z_ const wchar_t* szFileName, bool ccw = true, bool loadmtl = true, unsigned int threadCount = 1)
+        {
+            std::wstring materialPath;
+            return LoadOBJ(szFileName, ccw, loadmtl, threadCount, materialPath, nullptr);
+        }
+
+        // Loads from a binary cache next to the source file (same name with the .objcache extension) if
+        // it matches the size and timestamp of the OBJ and MTL files; the contents are only hashed when
+        // the timestamp differs. A cache which fails its checksum or range checks is treated as a miss.
+        // Otherwise the OBJ is parsed and the cache is rewritten; failing to write the cache is not an error.
+        HRESULT LoadCached(_In_z_ const wchar_t* szFileName, bool ccw = true, bool loadmtl = true, unsigned int threadCount = 1)
         {
             Clear();
 
             if (!szFileName)
                 return E_INVALIDARG;
 
-            constexpr size_t MAX_POLY = 64;
-
-            using namespace DirectX;
+            const std::wstring cacheFileName = GetCacheFileName(szFileName);
+            if (SUCCEEDED(LoadCache(cacheFileName.c_str(), szFileName, ccw, loadmtl)))
+                return S_OK;
 
-            std::wifstream InFile(szFileName);
-            if (!InFile)
-                return /* HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) */ static_cast<HRESULT>(0x80070002L);
+            std::wstring materialPath;
+            SourceStamp source = {};
+            HRESULT hr = LoadOBJ(szFileName, ccw, loadmtl, threadCount, materialPath, &source);
+            if (FAILED(hr))
+                return hr;
 
-            InFile.imbue(std::locale::classic());
+            (void)SaveCache(cacheFileName.c_str(), source, materialPath.c_str(), ccw, loadmtl);
+            return S_OK;
+        }
 
-    #ifdef _WIN32
-            wchar_t fname[_MAX_FNAME] = {};
-            _wsplitpath_s(szFileName, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, nullptr, 0);
-            name = fname;
-    #else
+        static std::wstring GetCacheFileName(_In_z_ const wchar_t* szFileName)
+        {
             auto path = std::filesystem::path(szFileName);
-            name = path.filename().c_str();
-    #endif
+            path.replace_extension(L".objcache");
+            return path.wstring();
+        }
 
-            std::vector<XMFLOAT3>   positions;
-            std::vector<XMFLOAT3>   normals;
-            std::vector<XMFLOAT2>   texCoords;
+        HRESULT LoadMTL(_In_z_ const wchar_t* szFileName)
+        {
+            if (!szFileName)
+                return E_INVALIDARG;
 
-            VertexCache  vertexCache;
+            using namespace DirectX;
 
-            Material defmat;
+            // Assumes MTL is in CWD along with OBJ
+    #ifdef _WIN32
+            std::wifstream InFile(szFileName);
+    #else
+            std::wifstream InFile{ std::filesystem::path(szFileName) };
+    #endif
+            if (!InFile)
+                return /* HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) */ static_cast<HRESULT>(0x80070002L);
 
-            wcscpy_s(defmat.strName, L"default");
-            materials.emplace_back(defmat);
+            InFile.imbue(std::locale::classic());
 
-            uint32_t curSubset = 0;
+            auto curMaterial = materials.end();
+            bool foundmat = false;
 
-            wchar_t strMaterialFilename[MAX_PATH] = {};
             for (;; )
             {
                 std::wstring strCommand;
-                InFile.width(MAX_PATH);
                 InFile >> strCommand;
                 if (!InFile)
                     break;
 
                 if (strCommand.empty() || *strCommand.c_str() == 0)
+                    continue;
+
+                if (*strCommand.c_str() == L'#')
                 {
+                    // Comment
+                    InFile.ignore(1000, L'\n');
                     continue;
                 }
-                else if (*strCommand.c_str() == L'#')
+                else if (0 == wcscmp(strCommand.c_str(), L"newmtl"))
                 {
-                    // Comment
+                    foundmat = true;
+
+                    // Switching active materials
+                    wchar_t strName[MAX_PATH] = {};
+                    InFile.width(MAX_PATH);
+                    InFile >> strName;
+
+                    curMaterial = materials.end();
+                    for (auto it = materials.begin(); it != materials.end(); ++it)
+                    {
+                        if (0 == wcscmp(it->strName, strName))
+                        {
+                            curMaterial = it;
+                            break;
+                        }
+                    }
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"o"))
+                else if (!std::isprint(*strCommand.c_str()))
                 {
-                    // Object name ignored
+                    // non-printable characters outside of comments mean this is not a text file
+                    return E_FAIL;
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"g"))
+
+                // The rest of the commands rely on an active material
+                if (curMaterial == materials.end())
+                    continue;
+
+                if (0 == wcscmp(strCommand.c_str(), L"Ka"))
                 {
-                    // Group name ignored
+                    // Ambient color
+                    float r, g, b;
+                    InFile >> r >> g >> b;
+                    curMaterial->vAmbient = XMFLOAT3(r, g, b);
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"s"))
+                else if (0 == wcscmp(strCommand.c_str(), L"Kd"))
                 {
-                    // Smoothing group ignored
+                    // Diffuse color
+                    float r, g, b;
+                    InFile >> r >> g >> b;
+                    curMaterial->vDiffuse = XMFLOAT3(r, g, b);
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"v"))
+                else if (0 == wcscmp(strCommand.c_str(), L"Ks"))
                 {
-                    // Vertex Position
-                    float x, y, z;
-                    InFile >> x >> y >> z;
-                    positions.emplace_back(XMFLOAT3(x, y, z));
+                    // Specular color
+                    float r, g, b;
+                    InFile >> r >> g >> b;
+                    curMaterial->vSpecular = XMFLOAT3(r, g, b);
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"vt"))
+                else if (0 == wcscmp(strCommand.c_str(), L"Ke"))
                 {
-                    // Vertex TexCoord
-                    float u, v;
-                    InFile >> u >> v;
-                    texCoords.emplace_back(XMFLOAT2(u, v));
-
-                    hasTexcoords = true;
+                    // Emissive color
+                    float r, g, b;
+                    InFile >> r >> g >> b;
+                    curMaterial->vEmissive = XMFLOAT3(r, g, b);
+                    if (r > 0.f || g > 0.f || b > 0.f)
+                    {
+                        curMaterial->bEmissive = true;
+                    }
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"vn"))
+                else if (0 == wcscmp(strCommand.c_str(), L"d"))
                 {
-                    // Vertex Normal
-                    float x, y, z;
-                    InFile >> x >> y >> z;
-                    normals.emplace_back(XMFLOAT3(x, y, z));
-
-                    hasNormals = true;
+                    // Alpha
+                    float alpha;
+                    InFile >> alpha;
+                    curMaterial->fAlpha = std::min(1.f, std::max(0.f, alpha));
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"f"))
+                else if (0 == wcscmp(strCommand.c_str(), L"Tr"))
                 {
-                    // Face
-                    INT iPosition, iTexCoord, iNormal;
-                    Vertex vertex;
-
-                    uint32_t faceIndex[MAX_POLY];
-                    size_t iFace = 0;
-                    for (;;)
-                    {
-                        if (iFace >= MAX_POLY)
-                        {
-                            // Too many polygon verts for the reader
-                            return E_FAIL;
-                        }
+                    // Transparency (inverse of alpha)
+                    float invAlpha;
+                    InFile >> invAlpha;
+                    curMaterial->fAlpha = std::min(1.f, std::max(0.f, 1.f - invAlpha));
+                }
+                else if (0 == wcscmp(strCommand.c_str(), L"Ns"))
+                {
+                    // Shininess
+                    int nShininess;
+                    InFile >> nShininess;
+                    curMaterial->nShininess = uint32_t(nShininess);
+                }
+                else if (0 == wcscmp(strCommand.c_str(), L"illum"))
+                {
+                    // Specular on/off
+                    int illumination;
+                    InFile >> illumination;
+                    curMaterial->bSpecular = (illumination == 2);
+                }
+                else if (0 == wcscmp(strCommand.c_str(), L"map_Kd"))
+                {
+                    // Diffuse texture
+                    LoadTexturePath(InFile, curMaterial->strTexture, MAX_PATH);
+                }
+                else if (0 == wcscmp(strCommand.c_str(), L"map_Ks"))
+                {
+                    // Specular texture
+                    LoadTexturePath(InFile, curMaterial->strSpecularTexture, MAX_PATH);
+                }
+                else if (0 == wcscmp(strCommand.c_str(), L"map_Kn")
+                        || 0 == wcscmp(strCommand.c_str(), L"norm"))
+                {
+                    // Normal texture
+                    LoadTexturePath(InFile, curMaterial->strNormalTexture, MAX_PATH);
+                }
+                else if (0 == wcscmp(strCommand.c_str(), L"map_Ke")
+                        || 0 == wcscmp(strCommand.c_str(), L"map_emissive"))
+                {
+                    // Emissive texture
+                    LoadTexturePath(InFile, curMaterial->strEmissiveTexture, MAX_PATH);
+                    curMaterial->bEmissive = true;
+                }
+                else if (0 == wcscmp(strCommand.c_str(), L"map_RMA")
+                    || 0 == wcscmp(strCommand.c_str(), L"map_ORM"))
+                {
+                    // RMA texture
+                    LoadTexturePath(InFile, curMaterial->strRMATexture, MAX_PATH);
+                }
+                else
+                {
+                    // Unimplemented or unrecognized command
+                }
 
-                        memset(&vertex, 0, sizeof(vertex));
+                InFile.ignore(1000, L'\n');
+            }
 
-                        InFile >> iPosition;
+            InFile.close();
 
-                        uint32_t vertexIndex = 0;
-                        if (!iPosition)
-                        {
-                            // 0 is not allowed for index
-                            return E_UNEXPECTED;
-                        }
-                        else if (iPosition < 0)
-                        {
-                            // Negative values are relative indices
-                            vertexIndex = uint32_t(ptrdiff_t(positions.size()) + iPosition);
-                        }
-                        else
-                        {
-                            // OBJ format uses 1-based arrays
-                            vertexIndex = uint32_t(iPosition - 1);
-                        }
+            return (foundmat) ? S_OK : E_FAIL;
+        }
 
-                        if (vertexIndex >= positions.size())
-                            return E_FAIL;
+        void Clear()
+        {
+            vertices.clear();
+            indices.clear();
+            attributes.clear();
+            materials.clear();
+            name.clear();
+            hasNormals = false;
+            hasTexcoords = false;
 
-                        vertex.position = positions[vertexIndex];
+            bounds.Center.x = bounds.Center.y = bounds.Center.z = 0.f;
+            bounds.Extents.x = bounds.Extents.y = bounds.Extents.z = 0.f;
+        }
 
-                        if ('/' == InFile.peek())
-                        {
-                            InFile.ignore();
+        HRESULT LoadVBO(_In_z_ const wchar_t* szFileName)
+        {
+            Clear();
 
-                            if ('/' != InFile.peek())
-                            {
-                                // Optional texture coordinate
-                                InFile >> iTexCoord;
+            if (!szFileName)
+                return E_INVALIDARG;
 
-                                uint32_t coordIndex = 0;
-                                if (!iTexCoord)
-                                {
-                                    // 0 is not allowed for index
-                                    return E_UNEXPECTED;
-                                }
-                                else if (iTexCoord < 0)
-                                {
-                                    // Negative values are relative indices
-                                    coordIndex = uint32_t(ptrdiff_t(texCoords.size()) + iTexCoord);
-                                }
-                                else
-                                {
-                                    // OBJ format uses 1-based arrays
-                                    coordIndex = uint32_t(iTexCoord - 1);
-                                }
+            using namespace DirectX;
 
-                                if (coordIndex >= texCoords.size())
-                                    return E_FAIL;
+    #ifdef _WIN32
+            wchar_t fname[_MAX_FNAME] = {};
+            _wsplitpath_s(szFileName, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, nullptr, 0);
+            name = fname;
+    #else
+            auto path = std::filesystem::path(szFileName);
+            name = path.filename().wstring();
+    #endif
 
-                                vertex.textureCoordinate = texCoords[coordIndex];
-                            }
+            Material defmat;
+            wcscpy_s(defmat.strName, L"default");
+            materials.emplace_back(defmat);
 
-                            if ('/' == InFile.peek())
-                            {
-                                InFile.ignore();
+            std::ifstream vboFile(szFileName, std::ifstream::in | std::ifstream::binary);
+            if (!vboFile.is_open())
+                return /* HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) */ static_cast<HRESULT>(0x80070002L);
 
-                                // Optional vertex normal
-                                InFile >> iNormal;
+            hasNormals = hasTexcoords = true;
 
-                                uint32_t normIndex = 0;
-                                if (!iNormal)
-                                {
-                                    // 0 is not allowed for index
-                                    return E_UNEXPECTED;
-                                }
-                                else if (iNormal < 0)
-                                {
-                                    // Negative values are relative indices
-                                    normIndex = uint32_t(ptrdiff_t(normals.size()) + iNormal);
-                                }
-                                else
-                                {
-                                    // OBJ format uses 1-based arrays
-                                    normIndex = uint32_t(iNormal - 1);
-                                }
+            uint32_t numVertices = 0;
+            uint32_t numIndices = 0;
 
-                                if (normIndex >= normals.size())
+            vboFile.read(reinterpret_cast<char*>(&numVertices), sizeof(uint32_t));
+            if (!numVertices)
+                return E_FAIL;
+
+            vboFile.read(reinterpret_cast<char*>(&numIndices), sizeof(uint32_t));
+            if (!numIndices)
+                return E_FAIL;
+
+            vertices.resize(numVertices);
+            vboFile.read(reinterpret_cast<char*>(vertices.data()), sizeof(Vertex) * numVertices);
+
+    #if (__cplusplus >= 201703L)
+            if constexpr (sizeof(index_t) == 2)
+    #else
+    #pragma warning( suppress : 4127 )
+            if (sizeof(index_t) == 2)
+    #endif
+            {
+                indices.resize(numIndices);
+                vboFile.read(reinterpret_cast<char*>(indices.data()), sizeof(uint16_t) * numIndices);
+            }
+            else
+            {
+                std::vector<uint16_t> tmp;
+                tmp.resize(numIndices);
+                vboFile.read(reinterpret_cast<char*>(tmp.data()), sizeof(uint16_t) * numIndices);
+
+                indices.reserve(numIndices);
+                for (const auto it : tmp)
+                {
+                    indices.emplace_back(it);
+                }
+            }
+
+            BoundingBox::CreateFromPoints(bounds, vertices.size(), reinterpret_cast<const XMFLOAT3*>(vertices.data()), sizeof(Vertex));
+
+            vboFile.close();
+
+            return S_OK;
+        }
+
+        // Groups the triangles by material with a counting sort over the attributes, keeping the original
+        // order within each material. 'destination' receives the reordered indices, and 'offsets' receives
+        // materials.size() + 1 entries so that material j uses indices [offsets[j], offsets[j + 1]).
+        // 'destination' may use a narrower index type if every vertex index fits in it.
+        template<class dest_t>
+        HRESULT SortByAttribute(_Out_writes_(indexCount) dest_t* destination, size_t indexCount, std::vector<uint32_t>& offsets) const
+        {
+            static_assert(std::is_unsigned<dest_t>::value && sizeof(dest_t) >= sizeof(uint16_t), "invalid destination index type");
+
+            offsets.clear();
+
+            if (!destination || indexCount != indices.size() || attributes.size() * 3 != indices.size())
+                return E_INVALIDARG;
+
+            if (indices.size() > UINT32_MAX)
+                return E_FAIL;
+
+            // The all-ones value is reserved as the strip-cut index
+    #if (__cplusplus >= 201703L)
+            if constexpr (sizeof(dest_t) < sizeof(index_t))
+    #else
+    #pragma warning( suppress : 4127 )
+            if (sizeof(dest_t) < sizeof(index_t))
+    #endif
+            {
+                if (vertices.size() > size_t(dest_t(-1)))
+                    return E_FAIL;
+            }
+
+            offsets.resize(materials.size() + 1, 0);
+
+            const size_t faceCount = attributes.size();
+            const uint32_t materialCount = static_cast<uint32_t>(materials.size());
+
+            bool sorted = true;
+            uint32_t prev = 0;
+            for (size_t j = 0; j < faceCount; ++j)
+            {
+                const uint32_t attribute = attributes[j];
+                if (attribute >= materialCount)
+                {
+                    offsets.clear();
+                    return E_FAIL;
+                }
+
+                sorted &= (attribute >= prev);
+                prev = attribute;
+                offsets[attribute + 1] += 3;
+            }
+
+            for (size_t j = 1; j < offsets.size(); ++j)
+            {
+                offsets[j] += offsets[j - 1];
+            }
+
+            if (sorted)
+            {
+    #if (__cplusplus >= 201703L)
+                if constexpr (sizeof(dest_t) == sizeof(index_t))
+    #else
+    #pragma warning( suppress : 4127 )
+                if (sizeof(dest_t) == sizeof(index_t))
+    #endif
+                {
+                    memcpy(destination, indices.data(), sizeof(index_t) * indices.size());
+                }
+                else
+                {
+                    std::transform(indices.cbegin(), indices.cend(), destination,
+                        [](index_t index) { return static_cast<dest_t>(index); });
+                }
+                return S_OK;
+            }
+
+            std::vector<uint32_t> cursors(offsets.cbegin(), offsets.cend() - 1);
+
+            const index_t* src = indices.data();
+            for (size_t j = 0; j < faceCount; ++j, src += 3)
+            {
+                dest_t* dest = destination + cursors[attributes[j]];
+                dest[0] = static_cast<dest_t>(src[0]);
+                dest[1] = static_cast<dest_t>(src[1]);
+                dest[2] = static_cast<dest_t>(src[2]);
+                cursors[attributes[j]] += 3;
+            }
+
+            return S_OK;
+        }
+
+        struct Material
+        {
+            DirectX::XMFLOAT3 vAmbient;
+            DirectX::XMFLOAT3 vDiffuse;
+            DirectX::XMFLOAT3 vSpecular;
+            DirectX::XMFLOAT3 vEmissive;
+            uint32_t nShininess;
+            float fAlpha;
+
+            bool bSpecular;
+            bool bEmissive;
+
+            wchar_t strName[MAX_PATH];
+            wchar_t strTexture[MAX_PATH];
+            wchar_t strNormalTexture[MAX_PATH];
+            wchar_t strSpecularTexture[MAX_PATH];
+            wchar_t strEmissiveTexture[MAX_PATH];
+            wchar_t strRMATexture[MAX_PATH];
+
+            Material() noexcept :
+            vAmbient(0.2f, 0.2f, 0.2f),
+                vDiffuse(0.8f, 0.8f, 0.8f),
+                vSpecular(1.0f, 1.0f, 1.0f),
+                vEmissive(0.f, 0.f, 0.f),
+                nShininess(0),
+                fAlpha(1.f),
+                bSpecular(false),
+                bEmissive(false),
+                strName{},
+                strTexture{},
+                strNormalTexture{},
+                strSpecularTexture{},
+                strEmissiveTexture{},
+                strRMATexture{}
+            {
+            }
+        };
+
+        std::vector<Vertex>     vertices;
+        std::vector<index_t>    indices;
+        std::vector<uint32_t>   attributes;
+        std::vector<Material>   materials;
+
+        std::wstring            name;
+        bool                    hasNormals;
+        bool                    hasTexcoords;
+
+        DirectX::BoundingBox    bounds;
+
+    private:
+        static constexpr uint32_t c_maxIndex = (sizeof(index_t) == 2) ? UINT16_MAX : UINT32_MAX;
+        static constexpr size_t c_minParallelChunk = 1024 * 1024;
+
+        // Open-addressing hash table of vertex indices keyed on (position index, normal, texcoord), which
+        // finds the first vertex in a pool with the same position index and identical contents. Slots are
+        // 4-byte indices into the pool and the table is sized up front from the face count, so inserts do
+        // not allocate unless the estimate was too small.
+        //
+        // The home slot follows the position index, so meshes which reference their positions roughly in
+        // order touch the table roughly in order. A collision first tries the adjacent slot and then steps
+        // by a hash of the whole vertex, so a position shared by many vertices does not build a long chain.
+        class VertexCache
+        {
+        public:
+            VertexCache() noexcept : m_mask(0), m_count(0) {}
+
+            void reserve(size_t count)
+            {
+                if (m_count > 0)
+                    return;
+
+                size_t capacity = 16;
+                while (capacity * 3 < count * 4)
+                    capacity <<= 1;
+
+                m_slots.assign(capacity, c_empty);
+                m_mask = capacity - 1;
+            }
+
+            // Returns the first entry in 'pool' which matches the vertex, or adds 'index' to the cache if it is new. The
+            // caller stores a new vertex and its position index at pool[index] and positionIndices[index].
+            uint32_t find_or_insert(
+                uint32_t position, const Vertex& vertex, uint32_t index,
+                const std::vector<uint32_t>& positionIndices, const std::vector<Vertex>& pool)
+            {
+                if ((m_count + 1) * 4 > m_slots.size() * 3)
+                    Rehash(std::max<size_t>(16, m_slots.size() * 2), positionIndices, pool);
+
+                size_t step = 0;
+                size_t j = Home(position);
+                for (size_t attempt = 0; ; j = Next(j, attempt++, step, position, vertex))
+                {
+                    const uint32_t slot = m_slots[j];
+                    if (slot == c_empty)
+                    {
+                        m_slots[j] = index;
+                        ++m_count;
+                        return index;
+                    }
+
+                    if (positionIndices[slot] == position && 0 == memcmp(&pool[slot], &vertex, sizeof(Vertex)))
+                        return slot;
+                }
+            }
+
+        private:
+            static constexpr uint32_t c_empty = UINT32_MAX;
+
+            size_t Home(uint32_t position) const noexcept { return (size_t(position) << 1) & m_mask; }
+
+            // The step is only hashed once the adjacent slot is also taken, which is rare for most meshes
+            size_t Next(size_t j, size_t attempt, size_t& step, uint32_t position, const Vertex& vertex) const noexcept
+            {
+                if (attempt == 0)
+                    return (j + 1) & m_mask;
+
+                if (!step)
+                    step = Step(position, vertex);
+
+                return (j + step) & m_mask;
+            }
+
+            static size_t Step(uint32_t position, const Vertex& vertex) noexcept
+            {
+                uint32_t bits[6] = { position };
+                memcpy(&bits[1], &vertex.normal, sizeof(DirectX::XMFLOAT3));
+                memcpy(&bits[4], &vertex.textureCoordinate, sizeof(DirectX::XMFLOAT2));
+
+                uint64_t h = 0;
+                for (const uint32_t value : bits)
+                {
+                    h = (h ^ value) * 0x9E3779B97F4A7C15ull;
+                    h ^= h >> 32;
+                }
+
+                // An odd step visits every slot of a power-of-two table
+                return static_cast<size_t>(h) | 1;
+            }
+
+            void Rehash(size_t capacity, const std::vector<uint32_t>& positionIndices, const std::vector<Vertex>& pool)
+            {
+                std::vector<uint32_t> slots(capacity, c_empty);
+                m_slots.swap(slots);
+                m_mask = capacity - 1;
+
+                for (const uint32_t index : slots)
+                {
+                    if (index == c_empty)
+                        continue;
+
+                    size_t step = 0;
+                    size_t j = Home(positionIndices[index]);
+                    for (size_t attempt = 0; m_slots[j] != c_empty; )
+                        j = Next(j, attempt++, step, positionIndices[index], pool[index]);
+                    m_slots[j] = index;
+                }
+            }
+
+            std::vector<uint32_t>   m_slots;
+            size_t                  m_mask;
+            size_t                  m_count;
+        };
+
+        // Counts face statements with a quick scan of line starts to size the vertex cache.
+        static size_t CountFaces(_In_reads_(end - ptr) const char* ptr, const char* end) noexcept
+        {
+            size_t count = 0;
+            while (ptr < end)
+            {
+                while (ptr < end && IsBlank(*ptr))
+                    ++ptr;
+
+                if (ptr + 1 < end && ptr[0] == 'f' && IsBlank(ptr[1]))
+                    ++count;
+
+                ptr = SkipLine(ptr, end);
+            }
+            return count;
+        }
+
+        // Binary cache of a parsed mesh. The data is a memory image for this build of the reader, so the
+        // header records the element sizes along with the state of the source files.
+        static constexpr uint32_t c_cacheMagic = 0x4A424F57; // "WOBJ"
+        static constexpr uint32_t c_cacheVersion = 2;
+
+        enum CacheFlags : uint32_t
+        {
+            CACHE_CCW = 0x1,
+            CACHE_LOADMTL = 0x2,
+            CACHE_NORMALS = 0x4,
+            CACHE_TEXCOORDS = 0x8,
+        };
+
+        static constexpr int64_t c_untrustedTime = INT64_MIN;
+
+        struct SourceStamp
+        {
+            uint64_t    size;
+            int64_t     time;
+            uint64_t    hash;
+        };
+
+        struct CacheHeader
+        {
+            uint32_t    magic;
+            uint32_t    version;
+            uint32_t    vertexSize;
+            uint32_t    indexSize;
+            uint32_t    materialSize;
+            uint32_t    flags;
+            SourceStamp source;
+            SourceStamp materialSource;
+            uint64_t    materialPathLength;
+            uint64_t    vertexCount;
+            uint64_t    indexCount;
+            uint64_t    attributeCount;
+            uint64_t    materialCount;
+            uint64_t    payloadHash;        // Of everything after the header
+            float       boundsCenter[3];
+            float       boundsExtents[3];
+        };
+
+        // Read-only view of a whole file, memory-mapped where the platform allows it.
+        class MappedFile
+        {
+        public:
+            MappedFile() noexcept : m_data(nullptr), m_size(0) {}
+
+            MappedFile(MappedFile&&) = delete;
+            MappedFile& operator= (MappedFile&&) = delete;
+
+            MappedFile(MappedFile const&) = delete;
+            MappedFile& operator= (MappedFile const&) = delete;
+
+            ~MappedFile()
+            {
+            #if defined(_WIN32) && (!defined(WINAPI_FAMILY) || (WINAPI_FAMILY == WINAPI_FAMILY_DESKTOP_APP))
+                if (m_data)
+                    UnmapViewOfFile(m_data);
+            #elif !defined(_WIN32)
+                if (m_data)
+                    munmap(const_cast<char*>(m_data), m_size);
+            #endif
+            }
+
+            HRESULT Open(_In_z_ const wchar_t* szFileName)
+            {
+            #if defined(_WIN32) && (!defined(WINAPI_FAMILY) || (WINAPI_FAMILY == WINAPI_FAMILY_DESKTOP_APP))
+                HANDLE hFile = CreateFileW(szFileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+                if (hFile == INVALID_HANDLE_VALUE)
+                    return HRESULT_FROM_WIN32(GetLastError());
+
+                LARGE_INTEGER fileSize = {};
+                if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart <= 0 || uint64_t(fileSize.QuadPart) > SIZE_MAX)
+                {
+                    CloseHandle(hFile);
+                    return E_FAIL;
+                }
+
+                HANDLE hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                CloseHandle(hFile);
+                if (!hMapping)
+                    return HRESULT_FROM_WIN32(GetLastError());
+
+                m_data = static_cast<const char*>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+                CloseHandle(hMapping);
+                if (!m_data)
+                    return HRESULT_FROM_WIN32(GetLastError());
+
+                m_size = static_cast<size_t>(fileSize.QuadPart);
+            #elif !defined(_WIN32)
+                const int fd = open(std::filesystem::path(szFileName).c_str(), O_RDONLY);
+                if (fd < 0)
+                    return /* HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) */ static_cast<HRESULT>(0x80070002L);
+
+                struct stat st = {};
+                if (fstat(fd, &st) != 0 || st.st_size <= 0)
+                {
+                    close(fd);
+                    return E_FAIL;
+                }
+
+                void* ptr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                close(fd);
+                if (ptr == MAP_FAILED)
+                    return E_FAIL;
+
+                m_data = static_cast<const char*>(ptr);
+                m_size = static_cast<size_t>(st.st_size);
+            #else
+                HRESULT hr = ReadFileData(szFileName, m_buffer);
+                if (FAILED(hr))
+                    return hr;
+
+                m_data = m_buffer.data();
+                m_size = m_buffer.size();
+            #endif
+                return S_OK;
+            }
+
+            const char* data() const noexcept { return m_data; }
+            size_t size() const noexcept { return m_size; }
+
+        private:
+            const char*         m_data;
+            size_t              m_size;
+        #if defined(_WIN32) && defined(WINAPI_FAMILY) && (WINAPI_FAMILY != WINAPI_FAMILY_DESKTOP_APP)
+            std::vector<char>   m_buffer;
+        #endif
+        };
+
+        // 64-bit hash of file contents used to detect a changed source file; this is not a cryptographic hash.
+        static uint64_t HashData(_In_reads_bytes_(size) const char* data, size_t size) noexcept
+        {
+            uint64_t h = 0xCBF29CE484222325ull ^ size;
+
+            size_t j = 0;
+            for (; j + sizeof(uint64_t) <= size; j += sizeof(uint64_t))
+            {
+                uint64_t value;
+                memcpy(&value, data + j, sizeof(value));
+                h = (h ^ value) * 0x9E3779B97F4A7C15ull;
+                h ^= h >> 32;
+            }
+
+            uint64_t tail = 0;
+            memcpy(&tail, data + j, size - j);
+            h = (h ^ tail) * 0x9E3779B97F4A7C15ull;
+            h ^= h >> 29;
+            return h;
+        }
+
+        // A matching size and timestamp is a match without reading the file. The contents are only read
+        // and hashed when the timestamp differs, such as for a file which was touched or copied, or was
+        // too new to trust when the cache was written.
+        static HRESULT CheckSourceStamp(_In_z_ const wchar_t* szFileName, const SourceStamp& expected)
+        {
+            const auto path = std::filesystem::path(szFileName);
+
+            std::error_code ec;
+            const auto size = std::filesystem::file_size(path, ec);
+            if (ec || size != expected.size)
+                return E_FAIL;
+
+            const auto time = std::filesystem::last_write_time(path, ec);
+            if (ec)
+                return E_FAIL;
+
+            if (expected.time != c_untrustedTime && static_cast<int64_t>(time.time_since_epoch().count()) == expected.time)
+                return S_OK;
+
+            std::vector<char> data;
+            HRESULT hr = ReadFileData(szFileName, data);
+            if (FAILED(hr))
+                return hr;
+
+            return (data.size() == expected.size && HashData(data.data(), data.size()) == expected.hash) ? S_OK : E_FAIL;
+        }
+
+        static HRESULT GetSourceStamp(_In_z_ const wchar_t* szFileName, SourceStamp& stamp)
+        {
+            stamp = {};
+
+            std::error_code ec;
+            const auto time = std::filesystem::last_write_time(std::filesystem::path(szFileName), ec);
+            if (ec)
+                return E_FAIL;
+
+            std::vector<char> data;
+            HRESULT hr = ReadFileData(szFileName, data);
+            if (FAILED(hr))
+                return hr;
+
+            StampSource(data, time, stamp);
+            return S_OK;
+        }
+
+        // Stamps the contents of a source file that were already read. The timestamp must be taken before the
+        // read, so that a write during the read leaves a newer timestamp and the contents are hashed again.
+        static void StampSource(const std::vector<char>& data, std::filesystem::file_time_type time, SourceStamp& stamp)
+        {
+            stamp.size = data.size();
+            stamp.time = static_cast<int64_t>(time.time_since_epoch().count());
+            stamp.hash = HashData(data.data(), data.size());
+
+            // A file written moments ago could be written again within the same timestamp tick, so its
+            // timestamp is not trusted and the contents are always hashed.
+            if (std::filesystem::file_time_type::clock::now() - time < std::chrono::seconds(2))
+            {
+                stamp.time = c_untrustedTime;
+            }
+        }
+
+        static uint32_t GetCacheFlags(bool ccw, bool loadmtl) noexcept
+        {
+            return (ccw ? uint32_t(CACHE_CCW) : 0u) | (loadmtl ? uint32_t(CACHE_LOADMTL) : 0u);
+        }
+
+        // Every string must be terminated, and the flags must be valid bools, before the materials are copied.
+        static bool ValidateCacheMaterials(_In_reads_bytes_(count * sizeof(Material)) const char* data, size_t count) noexcept
+        {
+            for (size_t j = 0; j < count; ++j)
+            {
+                const char* material = data + j * sizeof(Material);
+
+                for (const size_t offset : { offsetof(Material, bSpecular), offsetof(Material, bEmissive) })
+                {
+                    if (static_cast<uint8_t>(material[offset]) > 1)
+                        return false;
+                }
+
+                for (const size_t offset : {
+                    offsetof(Material, strName), offsetof(Material, strTexture), offsetof(Material, strNormalTexture),
+                    offsetof(Material, strSpecularTexture), offsetof(Material, strEmissiveTexture), offsetof(Material, strRMATexture) })
+                {
+                    wchar_t str[MAX_PATH];
+                    memcpy(str, material + offset, sizeof(str));
+                    if (std::find(std::cbegin(str), std::cend(str), L'\0') == std::cend(str))
+                        return false;
+                }
+            }
+
+            return true;
+        }
+
+        // Every index must name a vertex, and every face a material.
+        bool ValidateCacheIndices() const noexcept
+        {
+            if (indices.size() != attributes.size() * 3)
+                return false;
+
+            const size_t vertexCount = vertices.size();
+            for (const auto index : indices)
+            {
+                if (static_cast<size_t>(index) >= vertexCount)
+                    return false;
+            }
+
+            const size_t materialCount = materials.size();
+            for (const auto attribute : attributes)
+            {
+                if (attribute >= materialCount)
+                    return false;
+            }
+
+            return true;
+        }
+
+        HRESULT LoadCache(_In_z_ const wchar_t* szCacheFileName, _In_z_ const wchar_t* szFileName, bool ccw, bool loadmtl)
+        {
+            MappedFile cache;
+            HRESULT hr = cache.Open(szCacheFileName);
+            if (FAILED(hr))
+                return hr;
+
+            if (cache.size() < sizeof(CacheHeader))
+                return E_FAIL;
+
+            CacheHeader header;
+            memcpy(&header, cache.data(), sizeof(CacheHeader));
+
+            if (header.magic != c_cacheMagic
+                || header.version != c_cacheVersion
+                || header.vertexSize != sizeof(Vertex)
+                || header.indexSize != sizeof(index_t)
+                || header.materialSize != sizeof(Material)
+                || (header.flags & (CACHE_CCW | CACHE_LOADMTL)) != GetCacheFlags(ccw, loadmtl)
+                || !header.vertexCount
+                || header.materialPathLength >= MAX_PATH)
+                return E_FAIL;
+
+            // Validate each section against the file size before using the counts
+            const char* ptr = cache.data() + sizeof(CacheHeader);
+            const char* end = cache.data() + cache.size();
+
+            const uint64_t sections[] =
+            {
+                header.materialPathLength * sizeof(wchar_t),
+                header.vertexCount * sizeof(Vertex),
+                header.indexCount * sizeof(index_t),
+                header.attributeCount * sizeof(uint32_t),
+                header.materialCount * sizeof(Material),
+            };
+
+            uint64_t remaining = static_cast<uint64_t>(end - ptr);
+            for (const auto bytes : sections)
+            {
+                if (bytes > remaining)
+                    return E_FAIL;
+
+                remaining -= bytes;
+            }
+
+            if (remaining != 0)
+                return E_FAIL;
+
+            const std::wstring materialPath(reinterpret_cast<const wchar_t*>(ptr), static_cast<size_t>(header.materialPathLength));
+            ptr += sections[0];
+
+            hr = CheckSourceStamp(szFileName, header.source);
+            if (FAILED(hr))
+                return hr;
+
+            if (!materialPath.empty())
+            {
+                hr = CheckSourceStamp(materialPath.c_str(), header.materialSource);
+                if (FAILED(hr))
+                    return hr;
+            }
+
+            const char* payload = cache.data() + sizeof(CacheHeader);
+            if (HashData(payload, static_cast<size_t>(end - payload)) != header.payloadHash)
+                return E_FAIL;
+
+            vertices.resize(static_cast<size_t>(header.vertexCount));
+            memcpy(vertices.data(), ptr, static_cast<size_t>(sections[1]));
+            ptr += sections[1];
+
+            indices.resize(static_cast<size_t>(header.indexCount));
+            memcpy(indices.data(), ptr, static_cast<size_t>(sections[2]));
+            ptr += sections[2];
+
+            attributes.resize(static_cast<size_t>(header.attributeCount));
+            memcpy(attributes.data(), ptr, static_cast<size_t>(sections[3]));
+            ptr += sections[3];
+
+            if (!ValidateCacheMaterials(ptr, static_cast<size_t>(header.materialCount)))
+            {
+                Clear();
+                return E_FAIL;
+            }
+
+            materials.resize(static_cast<size_t>(header.materialCount));
+            memcpy(materials.data(), ptr, static_cast<size_t>(sections[4]));
+
+            if (!ValidateCacheIndices())
+            {
+                Clear();
+                return E_FAIL;
+            }
+
+    #ifdef _WIN32
+            wchar_t fname[_MAX_FNAME] = {};
+            _wsplitpath_s(szFileName, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, nullptr, 0);
+            name = fname;
+    #else
+            name = std::filesystem::path(szFileName).filename().wstring();
+    #endif
+
+            hasNormals = (header.flags & CACHE_NORMALS) != 0;
+            hasTexcoords = (header.flags & CACHE_TEXCOORDS) != 0;
+
+            bounds.Center = DirectX::XMFLOAT3(header.boundsCenter);
+            bounds.Extents = DirectX::XMFLOAT3(header.boundsExtents);
+
+            return S_OK;
+        }
+
+        HRESULT SaveCache(_In_z_ const wchar_t* szCacheFileName, const SourceStamp& source, _In_z_ const wchar_t* szMaterialPath, bool ccw, bool loadmtl) const
+        {
+            CacheHeader header = {};
+            header.magic = c_cacheMagic;
+            header.version = c_cacheVersion;
+            header.vertexSize = sizeof(Vertex);
+            header.indexSize = sizeof(index_t);
+            header.materialSize = sizeof(Material);
+            header.flags = GetCacheFlags(ccw, loadmtl)
+                | (hasNormals ? uint32_t(CACHE_NORMALS) : 0u)
+                | (hasTexcoords ? uint32_t(CACHE_TEXCOORDS) : 0u);
+            header.materialPathLength = wcslen(szMaterialPath);
+            header.vertexCount = vertices.size();
+            header.indexCount = indices.size();
+            header.attributeCount = attributes.size();
+            header.materialCount = materials.size();
+            memcpy(header.boundsCenter, &bounds.Center, sizeof(header.boundsCenter));
+            memcpy(header.boundsExtents, &bounds.Extents, sizeof(header.boundsExtents));
+
+            if (header.materialPathLength >= MAX_PATH)
+                return E_FAIL;
+
+            header.source = source;
+
+            // The MTL file is small, and LoadMTL parses it as a stream, so it is read again here
+            if (*szMaterialPath)
+            {
+                const HRESULT hr = GetSourceStamp(szMaterialPath, header.materialSource);
+                if (FAILED(hr))
+                    return hr;
+            }
+
+            std::vector<char> payload;
+            auto append = [&payload](const void* data, size_t bytes)
+                {
+                    auto ptr = static_cast<const char*>(data);
+                    payload.insert(payload.end(), ptr, ptr + bytes);
+                };
+
+            append(szMaterialPath, static_cast<size_t>(header.materialPathLength * sizeof(wchar_t)));
+            append(vertices.data(), vertices.size() * sizeof(Vertex));
+            append(indices.data(), indices.size() * sizeof(index_t));
+            append(attributes.data(), attributes.size() * sizeof(uint32_t));
+            append(materials.data(), materials.size() * sizeof(Material));
+
+            header.payloadHash = HashData(payload.data(), payload.size());
+
+            // Write to a temporary file and rename it so a partial cache is never picked up
+            const auto cachePath = std::filesystem::path(szCacheFileName);
+            auto tempPath = cachePath;
+            tempPath += L".tmp";
+
+            {
+                std::ofstream outFile(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+                if (!outFile)
+                    return E_FAIL;
+
+                outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                outFile.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+                if (!outFile)
+                {
+                    outFile.close();
+
+                    std::error_code ec;
+                    std::filesystem::remove(tempPath, ec);
+                    return E_FAIL;
+                }
+            }
+
+            std::error_code ec;
+            std::filesystem::rename(tempPath, cachePath, ec);
+            if (ec)
+            {
+                std::filesystem::remove(tempPath, ec);
+                return E_FAIL;
+            }
+
+            return S_OK;
+        }
+
+        // If 'source' is not null, it receives the stamp of the OBJ for the cache, taken from the same read.
+        HRESULT LoadOBJ(_In_z_ const wchar_t* szFileName, bool ccw, bool loadmtl, unsigned int threadCount, std::wstring& materialPath, _Out_opt_ SourceStamp* source)
+        {
+            Clear();
+
+            if (!szFileName)
+                return E_INVALIDARG;
+
+            std::filesystem::file_time_type time;
+            if (source)
+            {
+                std::error_code ec;
+                time = std::filesystem::last_write_time(std::filesystem::path(szFileName), ec);
+                if (ec)
+                    return /* HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) */ static_cast<HRESULT>(0x80070002L);
+            }
+
+            std::vector<char> data;
+            HRESULT hr = ReadFileData(szFileName, data);
+            if (FAILED(hr))
+                return hr;
+
+            if (source)
+            {
+                StampSource(data, time, *source);
+            }
+
+    #ifdef _WIN32
+            wchar_t fname[_MAX_FNAME] = {};
+            _wsplitpath_s(szFileName, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, nullptr, 0);
+            name = fname;
+    #else
+            auto path = std::filesystem::path(szFileName);
+            name = path.filename().wstring();
+    #endif
+
+            wchar_t strMaterialFilename[MAX_PATH] = {};
+            if (!threadCount)
+            {
+                threadCount = std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            const size_t chunks = std::min<size_t>(threadCount, data.size() / c_minParallelChunk);
+            if (chunks > 1)
+            {
+                hr = ParseOBJParallel(data.data(), data.size(), ccw, strMaterialFilename, chunks);
+            }
+            else
+            {
+                hr = ParseOBJ(data.data(), data.size(), ccw, strMaterialFilename);
+            }
+            if (FAILED(hr))
+                return hr;
+
+            // If an associated material file was found, read that in as well.
+            if (*strMaterialFilename && loadmtl)
+            {
+    #ifdef _WIN32
+                wchar_t ext[_MAX_EXT] = {};
+                _wsplitpath_s(strMaterialFilename, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, ext, _MAX_EXT);
+
+                wchar_t drive[_MAX_DRIVE] = {};
+                wchar_t dir[_MAX_DIR] = {};
+                _wsplitpath_s(szFileName, drive, _MAX_DRIVE, dir, _MAX_DIR, nullptr, 0, nullptr, 0);
+
+                wchar_t szPath[MAX_PATH] = {};
+                _wmakepath_s(szPath, MAX_PATH, drive, dir, fname, ext);
+                materialPath = szPath;
+                hr = LoadMTL(szPath);
+                if (FAILED(hr))
+                    return hr;
+    #else
+                auto mtlpath = std::filesystem::path(strMaterialFilename);
+                path.replace_filename(mtlpath.filename());
+                path.replace_extension(mtlpath.extension());
+
+                materialPath = path.wstring();
+                hr = LoadMTL(materialPath.c_str());
+                if (FAILED(hr))
+                    return hr;
+    #endif
+            }
+
+            return S_OK;
+        }
+
+        static HRESULT ReadFileData(_In_z_ const wchar_t* szFileName, std::vector<char>& data)
+        {
+    #ifdef _WIN32
+            std::ifstream inFile(szFileName, std::ios::in | std::ios::binary | std::ios::ate);
+    #else
+            std::ifstream inFile(std::filesystem::path(szFileName), std::ios::in | std::ios::binary | std::ios::ate);
+    #endif
+            if (!inFile)
+                return /* HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) */ static_cast<HRESULT>(0x80070002L);
+
+            const std::streampos len = inFile.tellg();
+            if (!inFile || len < 0)
+                return E_FAIL;
+
+            data.resize(static_cast<size_t>(len));
+            if (data.empty())
+                return S_OK;
+
+            inFile.seekg(0, std::ios::beg);
+            if (!inFile)
+                return E_FAIL;
+
+            inFile.read(data.data(), len);
+            if (!inFile)
+                return E_FAIL;
+
+            return S_OK;
+        }
+
+        // One corner of a face statement as written in the file; 0 means the element is not present.
+        struct FaceCorner
+        {
+            int position;
+            int texcoord;
+            int normal;
+        };
+
+        static constexpr size_t MAX_POLY = 64;
+
+        // Tokenizes the OBJ text held in memory. This is a single pass over the buffer which dispatches
+        // on the command token, and uses std::from_chars for numbers so it is locale-independent. Every
+        // statement is bounded by its line, so any range which starts on a line boundary can be parsed.
+        template<class Handler>
+        static HRESULT Tokenize(_In_reads_(end - ptr) const char* ptr, const char* end, Handler& handler)
+        {
+            using namespace DirectX;
+
+            for (;; )
+            {
+                ptr = SkipWhitespace(ptr, end);
+                if (ptr >= end)
+                    break;
+
+                const char* cmd = ptr;
+                while (ptr < end && !IsWhitespace(*ptr))
+                    ++ptr;
+                const size_t cmdLen = static_cast<size_t>(ptr - cmd);
+
+                HRESULT hr = S_OK;
+                if (*cmd == '#')
+                {
+                    // Comment
+                }
+                else if (IsCommand(cmd, cmdLen, "o"))
+                {
+                    // Object name ignored
+                }
+                else if (IsCommand(cmd, cmdLen, "g"))
+                {
+                    // Group name ignored
+                }
+                else if (IsCommand(cmd, cmdLen, "s"))
+                {
+                    // Smoothing group ignored
+                }
+                else if (IsCommand(cmd, cmdLen, "v"))
+                {
+                    // Vertex Position
+                    float x, y, z;
+                    if (!ParseFloat(ptr, end, x) || !ParseFloat(ptr, end, y) || !ParseFloat(ptr, end, z))
+                        return E_FAIL;
+                    hr = handler.OnPosition(XMFLOAT3(x, y, z));
+                }
+                else if (IsCommand(cmd, cmdLen, "vt"))
+                {
+                    // Vertex TexCoord
+                    float u, v;
+                    if (!ParseFloat(ptr, end, u) || !ParseFloat(ptr, end, v))
+                        return E_FAIL;
+                    hr = handler.OnTexCoord(XMFLOAT2(u, v));
+                }
+                else if (IsCommand(cmd, cmdLen, "vn"))
+                {
+                    // Vertex Normal
+                    float x, y, z;
+                    if (!ParseFloat(ptr, end, x) || !ParseFloat(ptr, end, y) || !ParseFloat(ptr, end, z))
+                        return E_FAIL;
+                    hr = handler.OnNormal(XMFLOAT3(x, y, z));
+                }
+                else if (IsCommand(cmd, cmdLen, "f"))
+                {
+                    // Face
+                    FaceCorner face[MAX_POLY];
+                    size_t iFace = 0;
+                    for (;;)
+                    {
+                        if (iFace >= MAX_POLY)
+                        {
+                            // Too many polygon verts for the reader
+                            return E_FAIL;
+                        }
+
+                        FaceCorner& corner = face[iFace];
+                        corner = {};
+
+                        if (!ParseInt(ptr, end, corner.position))
+                            return E_FAIL;
+
+                        if (ptr < end && *ptr == '/')
+                        {
+                            ++ptr;
+
+                            if (ptr < end && *ptr != '/')
+                            {
+                                // Optional texture coordinate
+                                if (!ParseInt(ptr, end, corner.texcoord))
                                     return E_FAIL;
 
-                                vertex.normal = normals[normIndex];
+                                if (!corner.texcoord)
+                                {
+                                    // 0 is not allowed for index
+                                    return E_UNEXPECTED;
+                                }
                             }
-                        }
 
-                        // If a duplicate vertex doesn't exist, add this vertex to the Vertices
-                        // list. Store the index in the Indices array. The Vertices and Indices
-                        // lists will eventually become the Vertex Buffer and Index Buffer for
-                        // the mesh.
-                        const uint32_t index = AddVertex(vertexIndex, &vertex, vertexCache);
-                        if (index == uint32_t(-1))
-                            return E_OUTOFMEMORY;
+                            if (ptr < end && *ptr == '/')
+                            {
+                                ++ptr;
+
+                                // Optional vertex normal
+                                if (!ParseInt(ptr, end, corner.normal))
+                                    return E_FAIL;
+
+                                if (!corner.normal)
+                                {
+                                    // 0 is not allowed for index
+                                    return E_UNEXPECTED;
+                                }
+                            }
+                        }
 
-                        constexpr uint32_t maxIndex = (sizeof(index_t) == 2) ? UINT16_MAX : UINT32_MAX;
-                        if (index >= maxIndex)
+                        if (!corner.position)
                         {
-                            // Too many indices for IB!
-                            return E_FAIL;
+                            // 0 is not allowed for index
+                            return E_UNEXPECTED;
                         }
 
-                        faceIndex[iFace] = index;
                         ++iFace;
 
                         // Check for more face data or end of the face statement
                         bool faceEnd = false;
                         for (;;)
                         {
-                            const wchar_t p = InFile.peek();
-
-                            if ('\n' == p || !InFile)
+                            if (ptr >= end || *ptr == '\n')
                             {
                                 faceEnd = true;
                                 break;
                             }
-                            else if (isdigit(p) || p == '-' || p == '+')
+
+                            const char p = *ptr;
+                            if ((p >= '0' && p <= '9') || p == '-' || p == '+')
                                 break;
 
-                            InFile.ignore();
+                            ++ptr;
                         }
 
                         if (faceEnd)
@@ -318,66 +1380,23 @@ namespace DX
                         return E_FAIL;
                     }
 
-                    // Convert polygons to triangles
-                    const uint32_t i0 = faceIndex[0];
-                    uint32_t i1 = faceIndex[1];
-
-                    for (size_t j = 2; j < iFace; ++j)
-                    {
-                        const uint32_t index = faceIndex[j];
-                        indices.emplace_back(static_cast<index_t>(i0));
-                        if (ccw)
-                        {
-                            indices.emplace_back(static_cast<index_t>(i1));
-                            indices.emplace_back(static_cast<index_t>(index));
-                        }
-                        else
-                        {
-                            indices.emplace_back(static_cast<index_t>(index));
-                            indices.emplace_back(static_cast<index_t>(i1));
-                        }
-
-                        attributes.emplace_back(curSubset);
-
-                        i1 = index;
-                    }
-
-                    assert(attributes.size() * 3 == indices.size());
+                    hr = handler.OnFace(face, iFace);
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"mtllib"))
+                else if (IsCommand(cmd, cmdLen, "mtllib"))
                 {
                     // Material library
-                    InFile.width(MAX_PATH);
-                    InFile >> strMaterialFilename;
+                    wchar_t strName[MAX_PATH] = {};
+                    ParseName(ptr, end, strName, MAX_PATH);
+                    hr = handler.OnMaterialLibrary(strName);
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"usemtl"))
+                else if (IsCommand(cmd, cmdLen, "usemtl"))
                 {
                     // Material
                     wchar_t strName[MAX_PATH] = {};
-                    InFile.width(MAX_PATH);
-                    InFile >> strName;
-
-                    bool bFound = false;
-                    uint32_t count = 0;
-                    for (auto it = materials.cbegin(); it != materials.cend(); ++it, ++count)
-                    {
-                        if (0 == wcscmp(it->strName, strName))
-                        {
-                            bFound = true;
-                            curSubset = count;
-                            break;
-                        }
-                    }
-
-                    if (!bFound)
-                    {
-                        Material mat;
-                        curSubset = static_cast<uint32_t>(materials.size());
-                        wcscpy_s(mat.strName, MAX_PATH - 1, strName);
-                        materials.emplace_back(mat);
-                    }
+                    ParseName(ptr, end, strName, MAX_PATH);
+                    hr = handler.OnUseMaterial(strName);
                 }
-                else if (!std::isprint(*strCommand.c_str()))
+                else if (!std::isprint(static_cast<unsigned char>(*cmd)))
                 {
                     // non-printable characters outside of comments mean this is not a text file
                     return E_FAIL;
@@ -386,374 +1405,631 @@ namespace DX
                 {
     #ifdef _DEBUG
                     // Unimplemented or unrecognized command
-                    OutputDebugStringW(strCommand.c_str());
+                    wchar_t strCommand[MAX_PATH] = {};
+                    const char* cmdPtr = cmd;
+                    ParseName(cmdPtr, ptr, strCommand, MAX_PATH);
+                    OutputDebugStringW(strCommand);
     #endif
                 }
 
-                InFile.ignore(1000, L'\n');
-            }
-
-            if (positions.empty())
-                return E_FAIL;
-
-            // Cleanup
-            InFile.close();
-
-            BoundingBox::CreateFromPoints(bounds, positions.size(), positions.data(), sizeof(XMFLOAT3));
-
-            // If an associated material file was found, read that in as well.
-            if (*strMaterialFilename && loadmtl)
-            {
-    #ifdef _WIN32
-                wchar_t ext[_MAX_EXT] = {};
-                _wsplitpath_s(strMaterialFilename, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, ext, _MAX_EXT);
-
-                wchar_t drive[_MAX_DRIVE] = {};
-                wchar_t dir[_MAX_DIR] = {};
-                _wsplitpath_s(szFileName, drive, _MAX_DRIVE, dir, _MAX_DIR, nullptr, 0, nullptr, 0);
-
-                wchar_t szPath[MAX_PATH] = {};
-                _wmakepath_s(szPath, MAX_PATH, drive, dir, fname, ext);
-                HRESULT hr = LoadMTL(szPath);
                 if (FAILED(hr))
                     return hr;
-    #else
-                auto path = std::filesystem::path(szFileName);
-                auto mtlpath = std::filesystem::path(strMaterialFilename);
-                path.replace_filename(mtlpath.filename());
-                path.replace_extension(mtlpath.extension());
 
-                HRESULT hr = LoadMTL(path.c_str());
-                if (FAILED(hr))
-                    return hr;
-    #endif
+                ptr = SkipLine(ptr, end);
             }
 
             return S_OK;
         }
 
-        HRESULT LoadMTL(_In_z_ const wchar_t* szFileName)
+        HRESULT ParseOBJ(
+            _In_reads_bytes_(size) const char* data, size_t size,
+            bool ccw,
+            _Out_writes_(MAX_PATH) wchar_t* strMaterialFilename)
         {
-            if (!szFileName)
-                return E_INVALIDARG;
-
             using namespace DirectX;
 
-            // Assumes MTL is in CWD along with OBJ
-            std::wifstream InFile(szFileName);
-            if (!InFile)
-                return /* HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) */ static_cast<HRESULT>(0x80070002L);
+            struct SerialHandler
+            {
+                WaveFrontReader&        reader;
+                bool                    ccw;
+                wchar_t*                strMaterialFilename;
+                uint32_t                curSubset;
+                std::vector<XMFLOAT3>   positions;
+                std::vector<XMFLOAT3>   normals;
+                std::vector<XMFLOAT2>   texCoords;
+                std::vector<uint32_t>   positionIndices;
+                VertexCache             vertexCache;
+
+                HRESULT OnPosition(const XMFLOAT3& value) { positions.emplace_back(value); return S_OK; }
+                HRESULT OnTexCoord(const XMFLOAT2& value) { texCoords.emplace_back(value); reader.hasTexcoords = true; return S_OK; }
+                HRESULT OnNormal(const XMFLOAT3& value) { normals.emplace_back(value); reader.hasNormals = true; return S_OK; }
+
+                HRESULT OnFace(const FaceCorner* face, size_t count)
+                {
+                    uint32_t faceIndex[MAX_POLY];
+                    for (size_t j = 0; j < count; ++j)
+                    {
+                        Vertex vertex;
+                        memset(&vertex, 0, sizeof(vertex));
 
-            InFile.imbue(std::locale::classic());
+                        uint32_t vertexIndex = 0;
+                        HRESULT hr = ResolveIndex(face[j].position, positions.size(), vertexIndex);
+                        if (FAILED(hr))
+                            return hr;
 
-            auto curMaterial = materials.end();
-            bool foundmat = false;
+                        vertex.position = positions[vertexIndex];
 
-            for (;; )
-            {
-                std::wstring strCommand;
-                InFile >> strCommand;
-                if (!InFile)
-                    break;
+                        if (face[j].texcoord)
+                        {
+                            uint32_t coordIndex = 0;
+                            hr = ResolveIndex(face[j].texcoord, texCoords.size(), coordIndex);
+                            if (FAILED(hr))
+                                return hr;
 
-                if (strCommand.empty() || *strCommand.c_str() == 0)
-                    continue;
+                            vertex.textureCoordinate = texCoords[coordIndex];
+                        }
 
-                if (*strCommand.c_str() == L'#')
-                {
-                    // Comment
-                    InFile.ignore(1000, L'\n');
-                    continue;
-                }
-                else if (0 == wcscmp(strCommand.c_str(), L"newmtl"))
-                {
-                    foundmat = true;
+                        if (face[j].normal)
+                        {
+                            uint32_t normIndex = 0;
+                            hr = ResolveIndex(face[j].normal, normals.size(), normIndex);
+                            if (FAILED(hr))
+                                return hr;
 
-                    // Switching active materials
-                    wchar_t strName[MAX_PATH] = {};
-                    InFile.width(MAX_PATH);
-                    InFile >> strName;
+                            vertex.normal = normals[normIndex];
+                        }
 
-                    curMaterial = materials.end();
-                    for (auto it = materials.begin(); it != materials.end(); ++it)
-                    {
-                        if (0 == wcscmp(it->strName, strName))
+                        // If a duplicate vertex doesn't exist, add this vertex to the Vertices
+                        // list. Store the index in the Indices array. The Vertices and Indices
+                        // lists will eventually become the Vertex Buffer and Index Buffer for
+                        // the mesh.
+                        const auto next = static_cast<uint32_t>(reader.vertices.size());
+                        const uint32_t index = vertexCache.find_or_insert(vertexIndex, vertex, next, positionIndices, reader.vertices);
+                        if (index == next)
                         {
-                            curMaterial = it;
-                            break;
+                            if (index >= c_maxIndex)
+                            {
+                                // Too many indices for IB!
+                                return E_FAIL;
+                            }
+
+                            reader.vertices.emplace_back(vertex);
+                            positionIndices.emplace_back(vertexIndex);
                         }
+
+                        faceIndex[j] = index;
                     }
-                }
-                else if (!std::isprint(*strCommand.c_str()))
-                {
-                    // non-printable characters outside of comments mean this is not a text file
-                    return E_FAIL;
-                }
 
-                // The rest of the commands rely on an active material
-                if (curMaterial == materials.end())
-                    continue;
+                    reader.AddFace(faceIndex, count, curSubset, ccw);
+                    return S_OK;
+                }
 
-                if (0 == wcscmp(strCommand.c_str(), L"Ka"))
+                HRESULT OnMaterialLibrary(const wchar_t* name)
                 {
-                    // Ambient color
-                    float r, g, b;
-                    InFile >> r >> g >> b;
-                    curMaterial->vAmbient = XMFLOAT3(r, g, b);
+                    wcscpy_s(strMaterialFilename, MAX_PATH, name);
+                    return S_OK;
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"Kd"))
+
+                HRESULT OnUseMaterial(const wchar_t* name)
                 {
-                    // Diffuse color
-                    float r, g, b;
-                    InFile >> r >> g >> b;
-                    curMaterial->vDiffuse = XMFLOAT3(r, g, b);
+                    curSubset = reader.GetMaterialIndex(name);
+                    return S_OK;
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"Ks"))
+            };
+
+            Material defmat;
+
+            wcscpy_s(defmat.strName, L"default");
+            materials.emplace_back(defmat);
+
+            SerialHandler handler = { *this, ccw, strMaterialFilename, 0, {}, {}, {}, {}, {} };
+
+            const size_t faceCount = CountFaces(data, data + size);
+            handler.vertexCache.reserve(faceCount);
+            handler.positionIndices.reserve(faceCount);
+            vertices.reserve(faceCount);
+
+            HRESULT hr = Tokenize(data, data + size, handler);
+            if (FAILED(hr))
+                return hr;
+
+            if (handler.positions.empty())
+                return E_FAIL;
+
+            BoundingBox::CreateFromPoints(bounds, handler.positions.size(), handler.positions.data(), sizeof(XMFLOAT3));
+
+            return S_OK;
+        }
+
+        // Splits the buffer at line boundaries and tokenizes the chunks concurrently. Relative indices are
+        // resolved using the element counts of all preceding chunks, and duplicate vertices are found per
+        // position-index partition, so the output is identical to ParseOBJ.
+        HRESULT ParseOBJParallel(
+            _In_reads_bytes_(size) const char* data, size_t size,
+            bool ccw,
+            _Out_writes_(MAX_PATH) wchar_t* strMaterialFilename,
+            size_t threadCount)
+        {
+            using namespace DirectX;
+
+            struct FaceRecord
+            {
+                uint32_t firstCorner;
+                uint32_t cornerCount;
+                uint32_t positionCount;
+                uint32_t texCoordCount;
+                uint32_t normalCount;
+            };
+
+            struct MaterialChange
+            {
+                size_t          face;
+                std::wstring    name;
+            };
+
+            struct ChunkHandler
+            {
+                const char*                 begin;
+                const char*                 end;
+                HRESULT                     hr;
+                std::vector<XMFLOAT3>       positions;
+                std::vector<XMFLOAT3>       normals;
+                std::vector<XMFLOAT2>       texCoords;
+                std::vector<FaceCorner>     corners;
+                std::vector<FaceRecord>     faces;
+                std::vector<MaterialChange> materialChanges;
+                std::wstring                materialLibrary;
+
+                size_t                      firstCorner;
+                size_t                      firstFace;
+
+                HRESULT OnPosition(const XMFLOAT3& value) { positions.emplace_back(value); return S_OK; }
+                HRESULT OnTexCoord(const XMFLOAT2& value) { texCoords.emplace_back(value); return S_OK; }
+                HRESULT OnNormal(const XMFLOAT3& value) { normals.emplace_back(value); return S_OK; }
+
+                HRESULT OnFace(const FaceCorner* face, size_t count)
                 {
-                    // Specular color
-                    float r, g, b;
-                    InFile >> r >> g >> b;
-                    curMaterial->vSpecular = XMFLOAT3(r, g, b);
+                    FaceRecord record = {};
+                    record.firstCorner = static_cast<uint32_t>(corners.size());
+                    record.cornerCount = static_cast<uint32_t>(count);
+                    record.positionCount = static_cast<uint32_t>(positions.size());
+                    record.texCoordCount = static_cast<uint32_t>(texCoords.size());
+                    record.normalCount = static_cast<uint32_t>(normals.size());
+                    faces.emplace_back(record);
+                    corners.insert(corners.end(), face, face + count);
+                    return S_OK;
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"Ke"))
+
+                HRESULT OnMaterialLibrary(const wchar_t* name)
                 {
-                    // Emissive color
-                    float r, g, b;
-                    InFile >> r >> g >> b;
-                    curMaterial->vEmissive = XMFLOAT3(r, g, b);
-                    if (r > 0.f || g > 0.f || b > 0.f)
-                    {
-                        curMaterial->bEmissive = true;
-                    }
+                    materialLibrary = name;
+                    return S_OK;
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"d"))
+
+                HRESULT OnUseMaterial(const wchar_t* name)
                 {
-                    // Alpha
-                    float alpha;
-                    InFile >> alpha;
-                    curMaterial->fAlpha = std::min(1.f, std::max(0.f, alpha));
+                    materialChanges.emplace_back(MaterialChange{ faces.size(), name });
+                    return S_OK;
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"Tr"))
+            };
+
+            // Split into chunks which start on a line boundary
+            std::vector<ChunkHandler> chunks;
+            {
+                const char* ptr = data;
+                const char* const end = data + size;
+                const size_t chunkSize = (size + threadCount - 1) / threadCount;
+                while (ptr < end)
                 {
-                    // Transparency (inverse of alpha)
-                    float invAlpha;
-                    InFile >> invAlpha;
-                    curMaterial->fAlpha = std::min(1.f, std::max(0.f, 1.f - invAlpha));
+                    const char* chunkEnd = (static_cast<size_t>(end - ptr) > chunkSize) ? SkipLine(ptr + chunkSize, end) : end;
+
+                    ChunkHandler chunk = {};
+                    chunk.begin = ptr;
+                    chunk.end = chunkEnd;
+                    chunks.emplace_back(std::move(chunk));
+
+                    ptr = chunkEnd;
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"Ns"))
+            }
+
+            ParallelFor(chunks.size(), chunks.size(), [&](size_t j)
                 {
-                    // Shininess
-                    int nShininess;
-                    InFile >> nShininess;
-                    curMaterial->nShininess = uint32_t(nShininess);
-                }
-                else if (0 == wcscmp(strCommand.c_str(), L"illum"))
+                    auto& chunk = chunks[j];
+                    chunk.hr = Tokenize(chunk.begin, chunk.end, chunk);
+                });
+
+            // Merge the per-chunk element streams in file order
+            Material defmat;
+
+            wcscpy_s(defmat.strName, L"default");
+            materials.emplace_back(defmat);
+
+            std::vector<XMFLOAT3>   positions;
+            std::vector<XMFLOAT3>   normals;
+            std::vector<XMFLOAT2>   texCoords;
+
+            std::vector<uint32_t>   firstPosition(chunks.size());
+            std::vector<uint32_t>   firstTexCoord(chunks.size());
+            std::vector<uint32_t>   firstNormal(chunks.size());
+
+            size_t totalCorners = 0;
+            size_t totalFaces = 0;
+            for (size_t j = 0; j < chunks.size(); ++j)
+            {
+                auto& chunk = chunks[j];
+                if (FAILED(chunk.hr))
+                    return chunk.hr;
+
+                firstPosition[j] = static_cast<uint32_t>(positions.size());
+                firstTexCoord[j] = static_cast<uint32_t>(texCoords.size());
+                firstNormal[j] = static_cast<uint32_t>(normals.size());
+                chunk.firstCorner = totalCorners;
+                chunk.firstFace = totalFaces;
+
+                positions.insert(positions.end(), chunk.positions.cbegin(), chunk.positions.cend());
+                texCoords.insert(texCoords.end(), chunk.texCoords.cbegin(), chunk.texCoords.cend());
+                normals.insert(normals.end(), chunk.normals.cbegin(), chunk.normals.cend());
+
+                totalCorners += chunk.corners.size();
+                totalFaces += chunk.faces.size();
+
+                if (!chunk.materialLibrary.empty())
                 {
-                    // Specular on/off
-                    int illumination;
-                    InFile >> illumination;
-                    curMaterial->bSpecular = (illumination == 2);
+                    wcscpy_s(strMaterialFilename, MAX_PATH, chunk.materialLibrary.c_str());
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"map_Kd"))
+
+                chunk.positions = {};
+                chunk.texCoords = {};
+                chunk.normals = {};
+            }
+
+            if (positions.empty())
+                return E_FAIL;
+
+            if (totalCorners >= UINT32_MAX)
+                return E_FAIL;
+
+            hasTexcoords = !texCoords.empty();
+            hasNormals = !normals.empty();
+
+            // Material names are assigned indices in order of first use
+            std::vector<uint32_t> faceSubsets(totalFaces);
+            {
+                uint32_t curSubset = 0;
+                for (const auto& chunk : chunks)
                 {
-                    // Diffuse texture
-                    LoadTexturePath(InFile, curMaterial->strTexture, MAX_PATH);
+                    auto change = chunk.materialChanges.cbegin();
+                    for (size_t face = 0; face < chunk.faces.size(); ++face)
+                    {
+                        while (change != chunk.materialChanges.cend() && change->face == face)
+                        {
+                            curSubset = GetMaterialIndex(change->name.c_str());
+                            ++change;
+                        }
+
+                        faceSubsets[chunk.firstFace + face] = curSubset;
+                    }
+
+                    for (; change != chunk.materialChanges.cend(); ++change)
+                    {
+                        curSubset = GetMaterialIndex(change->name.c_str());
+                    }
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"map_Ks"))
+            }
+
+            // Resolve face corners into vertices
+            std::vector<Vertex>     cornerVertices(totalCorners);
+            std::vector<uint32_t>   cornerKeys(totalCorners);
+
+            ParallelFor(chunks.size(), chunks.size(), [&](size_t j)
                 {
-                    // Specular texture
-                    LoadTexturePath(InFile, curMaterial->strSpecularTexture, MAX_PATH);
-                }
-                else if (0 == wcscmp(strCommand.c_str(), L"map_Kn")
-                        || 0 == wcscmp(strCommand.c_str(), L"norm"))
+                    auto& chunk = chunks[j];
+                    for (const auto& face : chunk.faces)
+                    {
+                        for (uint32_t k = 0; k < face.cornerCount; ++k)
+                        {
+                            const FaceCorner& corner = chunk.corners[face.firstCorner + k];
+                            const size_t dest = chunk.firstCorner + face.firstCorner + k;
+
+                            Vertex& vertex = cornerVertices[dest];
+                            memset(&vertex, 0, sizeof(vertex));
+
+                            uint32_t vertexIndex = 0;
+                            HRESULT hr = ResolveIndex(corner.position, firstPosition[j] + face.positionCount, vertexIndex);
+                            if (FAILED(hr))
+                            {
+                                chunk.hr = hr;
+                                return;
+                            }
+
+                            vertex.position = positions[vertexIndex];
+                            cornerKeys[dest] = vertexIndex;
+
+                            if (corner.texcoord)
+                            {
+                                uint32_t coordIndex = 0;
+                                hr = ResolveIndex(corner.texcoord, firstTexCoord[j] + face.texCoordCount, coordIndex);
+                                if (FAILED(hr))
+                                {
+                                    chunk.hr = hr;
+                                    return;
+                                }
+
+                                vertex.textureCoordinate = texCoords[coordIndex];
+                            }
+
+                            if (corner.normal)
+                            {
+                                uint32_t normIndex = 0;
+                                hr = ResolveIndex(corner.normal, firstNormal[j] + face.normalCount, normIndex);
+                                if (FAILED(hr))
+                                {
+                                    chunk.hr = hr;
+                                    return;
+                                }
+
+                                vertex.normal = normals[normIndex];
+                            }
+                        }
+                    }
+                });
+
+            for (const auto& chunk : chunks)
+            {
+                if (FAILED(chunk.hr))
+                    return chunk.hr;
+            }
+
+            // Each contiguous range of position indices finds the first corner with an identical vertex.
+            // The corners are bucketed by range first, in file order, so each thread walks only its own.
+            std::vector<uint32_t> firstCorner(totalCorners);
+
+            const size_t partitions = threadCount;
+            const size_t positionsPerPartition = (positions.size() + partitions - 1) / partitions;
+
+            std::vector<uint32_t> bucketStart(partitions + 1);
+            for (size_t k = 0; k < totalCorners; ++k)
+            {
+                ++bucketStart[cornerKeys[k] / positionsPerPartition + 1];
+            }
+
+            for (size_t j = 0; j < partitions; ++j)
+            {
+                bucketStart[j + 1] += bucketStart[j];
+            }
+
+            std::vector<uint32_t> buckets(totalCorners);
+            {
+                std::vector<uint32_t> next(bucketStart.cbegin(), bucketStart.cend() - 1);
+                for (size_t k = 0; k < totalCorners; ++k)
                 {
-                    // Normal texture
-                    LoadTexturePath(InFile, curMaterial->strNormalTexture, MAX_PATH);
+                    buckets[next[cornerKeys[k] / positionsPerPartition]++] = static_cast<uint32_t>(k);
                 }
-                else if (0 == wcscmp(strCommand.c_str(), L"map_Ke")
-                        || 0 == wcscmp(strCommand.c_str(), L"map_emissive"))
+            }
+
+            ParallelFor(partitions, partitions, [&](size_t j)
                 {
-                    // Emissive texture
-                    LoadTexturePath(InFile, curMaterial->strEmissiveTexture, MAX_PATH);
-                    curMaterial->bEmissive = true;
-                }
-                else if (0 == wcscmp(strCommand.c_str(), L"map_RMA")
-                    || 0 == wcscmp(strCommand.c_str(), L"map_ORM"))
+                    VertexCache cache;
+                    cache.reserve(bucketStart[j + 1] - bucketStart[j]);
+                    for (uint32_t b = bucketStart[j]; b < bucketStart[j + 1]; ++b)
+                    {
+                        const uint32_t k = buckets[b];
+                        firstCorner[k] = cache.find_or_insert(cornerKeys[k], cornerVertices[k], k, cornerKeys, cornerVertices);
+                    }
+                });
+
+            // Number the unique vertices in order of first use
+            for (size_t k = 0; k < totalCorners; ++k)
+            {
+                const uint32_t first = firstCorner[k];
+                if (first == k)
                 {
-                    // RMA texture
-                    LoadTexturePath(InFile, curMaterial->strRMATexture, MAX_PATH);
+                    const auto index = static_cast<uint32_t>(vertices.size());
+                    if (index >= c_maxIndex)
+                    {
+                        // Too many indices for IB!
+                        return E_FAIL;
+                    }
+
+                    vertices.emplace_back(cornerVertices[k]);
+                    firstCorner[k] = index;
                 }
                 else
                 {
-                    // Unimplemented or unrecognized command
+                    firstCorner[k] = firstCorner[first];
                 }
+            }
 
-                InFile.ignore(1000, L'\n');
+            // Convert polygons to triangles
+            for (const auto& chunk : chunks)
+            {
+                for (size_t face = 0; face < chunk.faces.size(); ++face)
+                {
+                    const auto& record = chunk.faces[face];
+                    AddFace(&firstCorner[chunk.firstCorner + record.firstCorner], record.cornerCount, faceSubsets[chunk.firstFace + face], ccw);
+                }
             }
 
-            InFile.close();
+            BoundingBox::CreateFromPoints(bounds, positions.size(), positions.data(), sizeof(XMFLOAT3));
 
-            return (foundmat) ? S_OK : E_FAIL;
+            return S_OK;
         }
 
-        void Clear()
+        template<class Func>
+        static void ParallelFor(size_t count, size_t threadCount, Func&& func)
         {
-            vertices.clear();
-            indices.clear();
-            attributes.clear();
-            materials.clear();
-            name.clear();
-            hasNormals = false;
-            hasTexcoords = false;
-
-            bounds.Center.x = bounds.Center.y = bounds.Center.z = 0.f;
-            bounds.Extents.x = bounds.Extents.y = bounds.Extents.z = 0.f;
-        }
+            threadCount = std::min(count, threadCount);
+            if (threadCount <= 1)
+            {
+                for (size_t j = 0; j < count; ++j)
+                    func(j);
+                return;
+            }
 
-        HRESULT LoadVBO(_In_z_ const wchar_t* szFileName)
-        {
-            Clear();
+            std::atomic<size_t> next(0);
+            auto worker = [&]()
+                {
+                    for (size_t j = next++; j < count; j = next++)
+                        func(j);
+                };
 
-            if (!szFileName)
-                return E_INVALIDARG;
+            std::vector<std::thread> threads;
+            threads.reserve(threadCount - 1);
+            for (size_t j = 1; j < threadCount; ++j)
+                threads.emplace_back(worker);
 
-            using namespace DirectX;
+            worker();
 
-    #ifdef _WIN32
-            wchar_t fname[_MAX_FNAME] = {};
-            _wsplitpath_s(szFileName, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, nullptr, 0);
-            name = fname;
-    #else
-            auto path = std::filesystem::path(szFileName);
-            name = path.filename().c_str();
-    #endif
+            for (auto& it : threads)
+                it.join();
+        }
 
-            Material defmat;
-            wcscpy_s(defmat.strName, L"default");
-            materials.emplace_back(defmat);
+        void AddFace(_In_reads_(count) const uint32_t* faceIndex, size_t count, uint32_t subset, bool ccw)
+        {
+            const uint32_t i0 = faceIndex[0];
+            uint32_t i1 = faceIndex[1];
 
-            std::ifstream vboFile(szFileName, std::ifstream::in | std::ifstream::binary);
-            if (!vboFile.is_open())
-                return /* HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) */ static_cast<HRESULT>(0x80070002L);
+            for (size_t j = 2; j < count; ++j)
+            {
+                const uint32_t index = faceIndex[j];
+                indices.emplace_back(static_cast<index_t>(i0));
+                if (ccw)
+                {
+                    indices.emplace_back(static_cast<index_t>(i1));
+                    indices.emplace_back(static_cast<index_t>(index));
+                }
+                else
+                {
+                    indices.emplace_back(static_cast<index_t>(index));
+                    indices.emplace_back(static_cast<index_t>(i1));
+                }
 
-            hasNormals = hasTexcoords = true;
+                attributes.emplace_back(subset);
 
-            uint32_t numVertices = 0;
-            uint32_t numIndices = 0;
+                i1 = index;
+            }
 
-            vboFile.read(reinterpret_cast<char*>(&numVertices), sizeof(uint32_t));
-            if (!numVertices)
-                return E_FAIL;
+            assert(attributes.size() * 3 == indices.size());
+        }
 
-            vboFile.read(reinterpret_cast<char*>(&numIndices), sizeof(uint32_t));
-            if (!numIndices)
-                return E_FAIL;
+        uint32_t GetMaterialIndex(_In_z_ const wchar_t* strName)
+        {
+            uint32_t count = 0;
+            for (auto it = materials.cbegin(); it != materials.cend(); ++it, ++count)
+            {
+                if (0 == wcscmp(it->strName, strName))
+                {
+                    return count;
+                }
+            }
 
-            vertices.resize(numVertices);
-            vboFile.read(reinterpret_cast<char*>(vertices.data()), sizeof(Vertex) * numVertices);
+            Material mat;
+            wcscpy_s(mat.strName, MAX_PATH - 1, strName);
+            materials.emplace_back(mat);
+            return count;
+        }
 
-    #if (__cplusplus >= 201703L)
-            if constexpr (sizeof(index_t) == 2)
-    #else
-    #pragma warning( suppress : 4127 )
-            if (sizeof(index_t) == 2)
-    #endif
+        // Relative (negative) indices refer back from 'count', the number of elements defined before
+        // the face statement.
+        static HRESULT ResolveIndex(int value, size_t count, uint32_t& result) noexcept
+        {
+            if (!value)
             {
-                indices.resize(numIndices);
-                vboFile.read(reinterpret_cast<char*>(indices.data()), sizeof(uint16_t) * numIndices);
+                // 0 is not allowed for index
+                return E_UNEXPECTED;
+            }
+            else if (value < 0)
+            {
+                // Negative values are relative indices
+                result = uint32_t(ptrdiff_t(count) + value);
             }
             else
             {
-                std::vector<uint16_t> tmp;
-                tmp.resize(numIndices);
-                vboFile.read(reinterpret_cast<char*>(tmp.data()), sizeof(uint16_t) * numIndices);
-
-                indices.reserve(numIndices);
-                for (const auto it : tmp)
-                {
-                    indices.emplace_back(it);
-                }
+                // OBJ format uses 1-based arrays
+                result = uint32_t(value - 1);
             }
 
-            BoundingBox::CreateFromPoints(bounds, vertices.size(), reinterpret_cast<const XMFLOAT3*>(vertices.data()), sizeof(Vertex));
+            return (result >= count) ? E_FAIL : S_OK;
+        }
 
-            vboFile.close();
+        static constexpr bool IsWhitespace(char c) noexcept
+        {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+        }
 
-            return S_OK;
+        static constexpr bool IsBlank(char c) noexcept
+        {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
         }
 
-        struct Material
+        static bool IsCommand(const char* cmd, size_t cmdLen, const char* str) noexcept
         {
-            DirectX::XMFLOAT3 vAmbient;
-            DirectX::XMFLOAT3 vDiffuse;
-            DirectX::XMFLOAT3 vSpecular;
-            DirectX::XMFLOAT3 vEmissive;
-            uint32_t nShininess;
-            float fAlpha;
+            const size_t len = strlen(str);
+            return (cmdLen == len) && (0 == memcmp(cmd, str, len));
+        }
 
-            bool bSpecular;
-            bool bEmissive;
+        static const char* SkipWhitespace(const char* ptr, const char* end) noexcept
+        {
+            while (ptr < end && IsWhitespace(*ptr))
+                ++ptr;
+            return ptr;
+        }
 
-            wchar_t strName[MAX_PATH];
-            wchar_t strTexture[MAX_PATH];
-            wchar_t strNormalTexture[MAX_PATH];
-            wchar_t strSpecularTexture[MAX_PATH];
-            wchar_t strEmissiveTexture[MAX_PATH];
-            wchar_t strRMATexture[MAX_PATH];
+        static const char* SkipLine(const char* ptr, const char* end) noexcept
+        {
+            auto eol = static_cast<const char*>(memchr(ptr, '\n', static_cast<size_t>(end - ptr)));
+            return (eol) ? (eol + 1) : end;
+        }
 
-            Material() noexcept :
-            vAmbient(0.2f, 0.2f, 0.2f),
-                vDiffuse(0.8f, 0.8f, 0.8f),
-                vSpecular(1.0f, 1.0f, 1.0f),
-                vEmissive(0.f, 0.f, 0.f),
-                nShininess(0),
-                fAlpha(1.f),
-                bSpecular(false),
-                bEmissive(false),
-                strName{},
-                strTexture{},
-                strNormalTexture{},
-                strSpecularTexture{},
-                strEmissiveTexture{},
-                strRMATexture{}
-            {
-            }
-        };
+        static bool ParseFloat(const char*& ptr, const char* end, float& value) noexcept
+        {
+            while (ptr < end && IsBlank(*ptr))
+                ++ptr;
 
-        std::vector<Vertex>     vertices;
-        std::vector<index_t>    indices;
-        std::vector<uint32_t>   attributes;
-        std::vector<Material>   materials;
+            if (ptr < end && *ptr == '+')
+                ++ptr;
 
-        std::wstring            name;
-        bool                    hasNormals;
-        bool                    hasTexcoords;
+            auto result = std::from_chars(ptr, end, value);
+            if (result.ec != std::errc())
+                return false;
 
-        DirectX::BoundingBox    bounds;
+            ptr = result.ptr;
+            return true;
+        }
 
-    private:
-        using VertexCache = std::unordered_multimap<uint32_t, uint32_t>;
+        static bool ParseInt(const char*& ptr, const char* end, int& value) noexcept
+        {
+            while (ptr < end && IsBlank(*ptr))
+                ++ptr;
+
+            if (ptr < end && *ptr == '+')
+                ++ptr;
+
+            auto result = std::from_chars(ptr, end, value);
+            if (result.ec != std::errc())
+                return false;
 
-        uint32_t AddVertex(uint32_t hash, const Vertex* pVertex, VertexCache& cache)
+            ptr = result.ptr;
+            return true;
+        }
+
+        // Names are read as a single whitespace-delimited token, widening each byte.
+        static void ParseName(const char*& ptr, const char* end, _Out_writes_(maxChar) wchar_t* str, size_t maxChar) noexcept
         {
-            auto f = cache.equal_range(hash);
+            while (ptr < end && IsBlank(*ptr))
+                ++ptr;
 
-            for (auto it = f.first; it != f.second; ++it)
+            size_t count = 0;
+            while (ptr < end && !IsWhitespace(*ptr))
             {
-                auto& tv = vertices[it->second];
-
-                if (0 == memcmp(pVertex, &tv, sizeof(Vertex)))
+                if (count + 1 < maxChar)
                 {
-                    return it->second;
+                    str[count++] = static_cast<wchar_t>(static_cast<unsigned char>(*ptr));
                 }
+                ++ptr;
             }
 
-            auto index = static_cast<uint32_t>(vertices.size());
-            vertices.emplace_back(*pVertex);
-
-            VertexCache::value_type entry(hash, index);
-            cache.insert(entry);
-            return index;
+            str[count] = 0;
         }
 
         void LoadTexturePath(std::wifstream& InFile, _Out_writes_(maxChar) wchar_t* texture, size_t maxChar)
@@ -13,6 +13,7 @@
 #include "Game.h"
 
 #include "FindMedia.h"
+#include "InstanceTransforms.h"
 
 #define GAMMA_CORRECT_RENDERING
 #define USE_COPY_QUEUE
@@ -566,8 +567,7 @@ void Game::Render()
         size_t j = 0;
         for (float x = -8.f; x <= 8.f; x += 3.f)
         {
-            XMMATRIX m = world * XMMatrixTranslation(x, 0.f, cos(time + float(j) * XM_PIDIV4));
-            XMStoreFloat3x4(&m_instanceTransforms[j], m);
+            m_instancePositions[j] = XMFLOAT3(x, 0.f, cos(time + float(j) * XM_PIDIV4));
             ++j;
         }
 
@@ -575,8 +575,9 @@ void Game::Render()
 
         const size_t instBytes = j * sizeof(XMFLOAT3X4);
 
-        GraphicsResource inst = m_graphicsMemory->Allocate(instBytes);
-        memcpy(inst.Memory(), m_instanceTransforms.get(), instBytes);
+        GraphicsResource inst = DX::AllocateInstanceTransforms(*m_graphicsMemory,
+            m_instancePositions.get(), sizeof(XMFLOAT3), world,
+            j, XMMatrixIdentity());
 
         D3D12_VERTEX_BUFFER_VIEW vertexBufferInst = {};
         vertexBufferInst.BufferLocation = inst.GpuAddress();
@@ -872,15 +873,12 @@ void Game::CreateDeviceDependentResources()
         }
         m_instanceCount = static_cast<UINT>(j);
 
-        m_instanceTransforms = std::make_unique<XMFLOAT3X4[]>(j);
-
-        constexpr XMFLOAT3X4 s_identity = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f };
+        m_instancePositions = std::make_unique<XMFLOAT3[]>(j);
 
         j = 0;
         for (float x = -8.f; x <= 8.f; x += 3.f)
         {
-            m_instanceTransforms[j] = s_identity;
-            m_instanceTransforms[j]._14 = x;
+            m_instancePositions[j] = XMFLOAT3(x, 0.f, 0.f);
             ++j;
         }
     }
@@ -134,7 +134,7 @@ private:
     Microsoft::WRL::ComPtr<ID3D12Resource>          m_normalMap;
 
     UINT                                            m_instanceCount;
-    std::unique_ptr<DirectX::XMFLOAT3X4[]>          m_instanceTransforms;
+    std::unique_ptr<DirectX::XMFLOAT3[]>            m_instancePositions;
 
     bool        m_spinning;
     bool        m_firstFrame;
@@ -13,9 +13,22 @@
 #include "Game.h"
 
 #include "FindMedia.h"
+#include "PipelineStateCache.h"
+
+#include <chrono>
 
 #define GAMMA_CORRECT_RENDERING
 
+// Shares identical effect pipeline states through DX::PipelineStateCache
+#if !defined(_GAMING_XBOX) && !defined(_XBOX_ONE)
+#define PIPELINE_STATE_CACHE
+#endif
+
+// Keeps the effect pipeline states from run to run in a DX::PipelineLibrary file
+#if defined(PIPELINE_STATE_CACHE) && (!defined(WINAPI_FAMILY) || (WINAPI_FAMILY == WINAPI_FAMILY_DESKTOP_APP))
+#define PIPELINE_LIBRARY
+#endif
+
 extern void ExitGame() noexcept;
 
 using namespace DirectX;
@@ -26,6 +39,29 @@ using Microsoft::WRL::ComPtr;
 
 namespace
 {
+#ifdef PIPELINE_LIBRARY
+    constexpr const wchar_t* c_pipelineLibraryFile = L"ShaderTest.pipelines";
+
+    // Stores the pipeline states created this run for the next one.
+    void ClosePipelineLibrary(std::unique_ptr<DX::PipelineLibrary>& library)
+    {
+        if (!library)
+            return;
+
+        DX::PipelineStateCache::Get().SetLibrary(nullptr);
+
+        const HRESULT hr = library->Save();
+        if (FAILED(hr))
+        {
+            char buff[128] = {};
+            sprintf_s(buff, "ERROR: Failed to save pipeline library (%08X)\n", static_cast<unsigned int>(hr));
+            OutputDebugStringA(buff);
+        }
+
+        library.reset();
+    }
+#endif
+
     constexpr float SWAP_TIME = 1.f;
     constexpr float INTERACTIVE_TIME = 10.f;
 
@@ -208,6 +244,7 @@ Game::Game() noexcept(false) :
     m_vertexBufferViewBn{},
     m_indexBufferView{},
     m_renderMode(Render_Normal),
+    m_parallelRecord(true),
     m_delay(0),
     m_frame(0)
 {
@@ -252,6 +289,14 @@ Game::~Game()
     {
         m_deviceResources->WaitForGpu();
     }
+
+#ifdef PIPELINE_LIBRARY
+    ClosePipelineLibrary(m_pipelineLibrary);
+#endif
+
+#ifdef PIPELINE_STATE_CACHE
+    DX::PipelineStateCache::Get().Clear();
+#endif
 }
 
 // Initialize the Direct3D resources required to run.
@@ -335,6 +380,12 @@ void Game::Update(DX::StepTimer const& timer)
 
     m_keyboardButtons.Update(kb);
 
+    if (m_keyboardButtons.IsKeyPressed(Keyboard::Enter) || (m_gamePadButtons.x == GamePad::ButtonStateTracker::PRESSED))
+    {
+        // Toggle between recording on worker threads and on the main thread
+        m_parallelRecord = !m_parallelRecord;
+    }
+
     if (m_keyboardButtons.IsKeyPressed(Keyboard::Space) || (m_gamePadButtons.y == GamePad::ButtonStateTracker::PRESSED))
     {
         CycleRenderMode();
@@ -382,15 +433,17 @@ void Game::Render()
     auto commandList = m_deviceResources->GetCommandList();
     PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Render");
 
-    // Set the descriptor heaps
-    ID3D12DescriptorHeap* heaps[] = { m_resourceDescriptors->Heap(), m_states->Heap() };
-    commandList->SetDescriptorHeaps(static_cast<UINT>(std::size(heaps)), heaps);
+    // Setup for cube drawing. The draws are gathered first, then recorded by RecordDraws.
+    m_drawItems.clear();
+
+    D3D12_VERTEX_BUFFER_VIEW instancedBuffers[2] = {};
+    const D3D12_VERTEX_BUFFER_VIEW* vertexBuffers = &m_vertexBufferView;
+    UINT vertexBufferCount = 1;
 
-    // Setup for cube drawing.
     switch (m_renderMode)
     {
     case Render_Compressed:
-        commandList->IASetVertexBuffers(0, 1, &m_vertexBufferViewBn);
+        vertexBuffers = &m_vertexBufferViewBn;
         break;
 
     case Render_Instanced:
@@ -411,23 +464,19 @@ void Game::Render()
         GraphicsResource inst = m_graphicsMemory->Allocate(instBytes);
         memcpy(inst.Memory(), m_instanceTransforms.get(), instBytes);
 
-        D3D12_VERTEX_BUFFER_VIEW vertexBuffers[2] = { (m_renderMode == Render_CompressedInstanced) ? m_vertexBufferViewBn : m_vertexBufferView };
-        vertexBuffers[1].BufferLocation = inst.GpuAddress();
-        vertexBuffers[1].SizeInBytes = static_cast<UINT>(instBytes);
-        vertexBuffers[1].StrideInBytes = sizeof(XMFLOAT3X4);
-        commandList->IASetVertexBuffers(0, 2, vertexBuffers);
+        instancedBuffers[0] = (m_renderMode == Render_CompressedInstanced) ? m_vertexBufferViewBn : m_vertexBufferView;
+        instancedBuffers[1].BufferLocation = inst.GpuAddress();
+        instancedBuffers[1].SizeInBytes = static_cast<UINT>(instBytes);
+        instancedBuffers[1].StrideInBytes = sizeof(XMFLOAT3X4);
+        vertexBuffers = instancedBuffers;
+        vertexBufferCount = 2;
     }
     break;
 
     default:
-        commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
         break;
     }
 
-    commandList->IASetIndexBuffer(&m_indexBufferView);
-
-    commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
     float y = ortho_height - 0.5f;
     if (m_renderMode == Render_Instanced || m_renderMode == Render_CompressedInstanced)
     {
@@ -442,8 +491,7 @@ void Game::Render()
             for (; y > -ortho_height; y -= 1.f)
             {
                 (*it)->SetWorld(XMMatrixTranslation(0, y, -1.f));
-                (*it)->Apply(commandList);
-                commandList->DrawIndexedInstanced(m_indexCount, m_instanceCount, 0, 0, 0);
+                m_drawItems.push_back({ it->get(), vertexBuffers, vertexBufferCount, m_instanceCount });
 
                 ++it;
                 if (it == eit)
@@ -465,8 +513,7 @@ void Game::Render()
             for (; y > -ortho_height; y -= 1.f)
             {
                 (*it)->SetWorld(XMMatrixTranslation(0, y, -1.f));
-                (*it)->Apply(commandList);
-                commandList->DrawIndexedInstanced(m_indexCount, m_instanceCount, 0, 0, 0);
+                m_drawItems.push_back({ it->get(), vertexBuffers, vertexBufferCount, m_instanceCount });
 
                 ++it;
                 if (it == eit)
@@ -488,8 +535,7 @@ void Game::Render()
             for (; y > -ortho_height; y -= 1.f)
             {
                 (*it)->SetWorld(XMMatrixTranslation(0, y, -1.f));
-                (*it)->Apply(commandList);
-                commandList->DrawIndexedInstanced(m_indexCount, m_instanceCount, 0, 0, 0);
+                m_drawItems.push_back({ it->get(), vertexBuffers, vertexBufferCount, m_instanceCount });
 
                 ++it;
                 if (it == eit)
@@ -511,8 +557,7 @@ void Game::Render()
             for (; y > -ortho_height; y -= 1.f)
             {
                 (*it)->SetWorld(XMMatrixTranslation(0, y, -1.f));
-                (*it)->Apply(commandList);
-                commandList->DrawIndexedInstanced(m_indexCount, m_instanceCount, 0, 0, 0);
+                m_drawItems.push_back({ it->get(), vertexBuffers, vertexBufferCount, m_instanceCount });
 
                 ++it;
                 if (it == eit)
@@ -540,8 +585,7 @@ void Game::Render()
                 for (float x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
                 {
                     (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+                    m_drawItems.push_back({ it->get(), vertexBuffers, vertexBufferCount, 1 });
 
                     ++it;
                     if (it == eit)
@@ -578,8 +622,7 @@ void Game::Render()
                 {
                     (*it)->SetBoneTransforms(bones, 4);
                     (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+                    m_drawItems.push_back({ it->get(), vertexBuffers, vertexBufferCount, 1 });
 
                     ++it;
                     if (it == eit)
@@ -607,8 +650,7 @@ void Game::Render()
                 for (float x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
                 {
                     (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+                    m_drawItems.push_back({ it->get(), vertexBuffers, vertexBufferCount, 1 });
 
                     ++it;
                     if (it == eit)
@@ -625,7 +667,7 @@ void Game::Render()
             y -= 1.f;
         }
 
-        commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
+        vertexBuffers = &m_vertexBufferView;
 
         // DualTextureEffect
         {
@@ -637,8 +679,7 @@ void Game::Render()
                 for (float x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
                 {
                     (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+                    m_drawItems.push_back({ it->get(), vertexBuffers, vertexBufferCount, 1 });
 
                     ++it;
                     if (it == m_dual.cend())
@@ -665,8 +706,7 @@ void Game::Render()
                 for (float x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
                 {
                     (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+                    m_drawItems.push_back({ it->get(), vertexBuffers, vertexBufferCount, 1 });
 
                     ++it;
                     if (it == m_alphTest.cend())
@@ -683,7 +723,7 @@ void Game::Render()
             y -= 1.f;
         }
 
-        commandList->IASetVertexBuffers(0, 1, (showCompressed) ? &m_vertexBufferViewBn : &m_vertexBufferView);
+        vertexBuffers = (showCompressed) ? &m_vertexBufferViewBn : &m_vertexBufferView;
 
         // NormalMapEffect
         float lastx = 0.f;
@@ -698,8 +738,7 @@ void Game::Render()
                 for (x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
                 {
                     (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+                    m_drawItems.push_back({ it->get(), vertexBuffers, vertexBufferCount, 1 });
 
                     ++it;
                     if (it == eit)
@@ -728,8 +767,7 @@ void Game::Render()
                 for (float x = lastx + 1.f; x < ortho_width; x += 1.f)
                 {
                     (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+                    m_drawItems.push_back({ it->get(), vertexBuffers, vertexBufferCount, 1 });
 
                     ++it;
                     if (it == eit)
@@ -759,8 +797,7 @@ void Game::Render()
                 for (x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
                 {
                     (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+                    m_drawItems.push_back({ it->get(), vertexBuffers, vertexBufferCount, 1 });
 
                     ++it;
                     if (it == eit)
@@ -789,8 +826,7 @@ void Game::Render()
                 for (float x = lastx + 1.f; x < ortho_width; x += 1.f)
                 {
                     (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+                    m_drawItems.push_back({ it->get(), vertexBuffers, vertexBufferCount, 1 });
 
                     ++it;
                     if (it == eit)
@@ -818,8 +854,7 @@ void Game::Render()
                 for (float x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
                 {
                     (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+                    m_drawItems.push_back({ it->get(), vertexBuffers, vertexBufferCount, 1 });
 
                     ++it;
                     if (it == eit)
@@ -849,8 +884,7 @@ void Game::Render()
                 for (x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
                 {
                     (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+                    m_drawItems.push_back({ it->get(), vertexBuffers, vertexBufferCount, 1 });
 
                     ++it;
                     if (it == eit)
@@ -879,8 +913,7 @@ void Game::Render()
                 for (float x = lastx + 1.f; x < ortho_width; x += 1.f)
                 {
                     (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+                    m_drawItems.push_back({ it->get(), vertexBuffers, vertexBufferCount, 1 });
 
                     ++it;
                     if (it == eit)
@@ -898,7 +931,35 @@ void Game::Render()
         }
     }
 
-    PIXEndEvent(commandList);
+    if (m_parallelRecord)
+    {
+        PIXEndEvent(commandList);
+
+        // Each worker records its share of the draws into its own command list, submitted in order.
+        m_deviceResources->RecordParallel(m_drawItems.size(), [this](auto workerList, size_t begin, size_t end)
+            {
+                PIXBeginEvent(workerList, PIX_COLOR_DEFAULT, L"Render %zu-%zu", begin, end);
+                RecordDraws(workerList, begin, end);
+                PIXEndEvent(workerList);
+            });
+
+        commandList = m_deviceResources->GetCommandList();
+
+        const auto& times = m_deviceResources->GetWorkerRecordTimes();
+        for (size_t j = 0; j < times.size(); ++j)
+        {
+            PIXSetMarker(commandList, PIX_COLOR_DEFAULT, L"Worker %zu of %zu: %.3f ms", j, times.size(), times[j]);
+        }
+    }
+    else
+    {
+        auto start = std::chrono::steady_clock::now();
+        RecordDraws(commandList, 0, m_drawItems.size());
+        const double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        PIXSetMarker(commandList, PIX_COLOR_DEFAULT, L"Single thread: %.3f ms", time);
+        PIXEndEvent(commandList);
+    }
 
     // Show the new frame.
     PIXBeginEvent(m_deviceResources->GetCommandQueue(), PIX_COLOR_DEFAULT, L"Present");
@@ -911,28 +972,66 @@ void Game::Render()
     PIXEndEvent(m_deviceResources->GetCommandQueue());
 }
 
+// Records draws [begin, end) gathered by Render, setting all of the state they need.
+void Game::RecordDraws(ID3D12GraphicsCommandList* commandList, size_t begin, size_t end)
+{
+    // Set the descriptor heaps
+    ID3D12DescriptorHeap* heaps[] = { m_resourceDescriptors->Heap(), m_states->Heap() };
+    commandList->SetDescriptorHeaps(static_cast<UINT>(std::size(heaps)), heaps);
+
+    SetRenderTargets(commandList);
+
+    commandList->IASetIndexBuffer(&m_indexBufferView);
+
+    commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    const D3D12_VERTEX_BUFFER_VIEW* vertexBuffers = nullptr;
+    for (size_t j = begin; j < end; ++j)
+    {
+        const auto& item = m_drawItems[j];
+        if (item.vertexBuffers != vertexBuffers)
+        {
+            vertexBuffers = item.vertexBuffers;
+            commandList->IASetVertexBuffers(0, item.vertexBufferCount, vertexBuffers);
+        }
+
+        item.effect->Apply(commandList);
+        commandList->DrawIndexedInstanced(m_indexCount, item.instanceCount, 0, 0, 0);
+    }
+}
+
 // Helper method to clear the back buffers.
 void Game::Clear()
 {
     auto commandList = m_deviceResources->GetCommandList();
     PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Clear");
 
+    SetRenderTargets(commandList);
+
     // Clear the views.
     const auto rtvDescriptor = m_deviceResources->GetRenderTargetView();
     const auto dsvDescriptor = m_deviceResources->GetDepthStencilView();
 
-    D3D12_CPU_DESCRIPTOR_HANDLE rtvDescriptors[2] = { rtvDescriptor, m_renderDescriptors->GetCpuHandle(RTDescriptors::RTVelocityBuffer) };
-    commandList->OMSetRenderTargets(2, rtvDescriptors, FALSE, &dsvDescriptor);
     commandList->ClearRenderTargetView(rtvDescriptor, c_clearColor, 0, nullptr);
     commandList->ClearDepthStencilView(dsvDescriptor, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
 
+    PIXEndEvent(commandList);
+}
+
+// Sets the render targets, viewport, and scissor rect, which each command list needs.
+void Game::SetRenderTargets(ID3D12GraphicsCommandList* commandList)
+{
+    const auto rtvDescriptor = m_deviceResources->GetRenderTargetView();
+    const auto dsvDescriptor = m_deviceResources->GetDepthStencilView();
+
+    D3D12_CPU_DESCRIPTOR_HANDLE rtvDescriptors[2] = { rtvDescriptor, m_renderDescriptors->GetCpuHandle(RTDescriptors::RTVelocityBuffer) };
+    commandList->OMSetRenderTargets(2, rtvDescriptors, FALSE, &dsvDescriptor);
+
     // Set the viewport and scissor rect.
     const auto viewport = m_deviceResources->GetScreenViewport();
     const auto scissorRect = m_deviceResources->GetScissorRect();
     commandList->RSSetViewports(1, &viewport);
     commandList->RSSetScissorRects(1, &scissorRect);
-
-    PIXEndEvent(commandList);
 }
 #pragma endregion
 
@@ -1010,7 +1109,25 @@ void Game::CreateDeviceDependentResources()
 {
     auto device = m_deviceResources->GetD3DDevice();
 
-    m_graphicsMemory = std::make_unique<GraphicsMemory>(device);
+#ifdef PIPELINE_STATE_CACHE
+    // The effects create their pipeline states through this device, and GraphicsMemory::Get finds
+    // their constant buffer memory by it too.
+    {
+        ComPtr<DX::PipelineCachingDevice> pipelineDevice;
+        DX::ThrowIfFailed(DX::PipelineCachingDevice::Create(device, pipelineDevice.GetAddressOf()));
+        m_pipelineDevice = pipelineDevice;
+    }
+    auto effectDevice = m_pipelineDevice.Get();
+
+#ifdef PIPELINE_LIBRARY
+    m_pipelineLibrary = std::make_unique<DX::PipelineLibrary>(device, c_pipelineLibraryFile);
+    DX::PipelineStateCache::Get().SetLibrary(m_pipelineLibrary.get());
+#endif
+#else
+    auto effectDevice = device;
+#endif
+
+    m_graphicsMemory = std::make_unique<GraphicsMemory>(effectDevice);
 
     m_states = std::make_unique<CommonStates>(device);
 
@@ -1183,6 +1300,11 @@ void Game::CreateDeviceDependentResources()
     }
 
     // Create test effects
+    auto effectsBegin = std::chrono::steady_clock::now();
+#ifdef PIPELINE_STATE_CACHE
+    const auto cacheBefore = DX::PipelineStateCache::Get().GetStatistics();
+#endif
+
     RenderTargetState rtState(m_deviceResources->GetBackBufferFormat(), m_deviceResources->GetDepthBufferFormat());
     rtState.numRenderTargets = 2;
     rtState.rtvFormats[1] = m_velocityBuffer->GetFormat();
@@ -1224,37 +1346,37 @@ void Game::CreateDeviceDependentResources()
 
             // BasicEffect (no texture)
             {
-                auto effect = std::make_unique<BasicEffect>(device, eflags, pd);
+                auto effect = std::make_unique<BasicEffect>(effectDevice, eflags, pd);
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::Fog, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::Fog, pd);
                 effect->SetFogColor(Colors::Black);
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::VertexColor, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::VertexColor, pd);
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::Fog | EffectFlags::VertexColor, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::Fog | EffectFlags::VertexColor, pd);
                 effect->SetFogColor(Colors::Black);
                 basic.emplace_back(std::move(effect));
             }
 
             // BasicEffect (textured)
             {
-                auto effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::Texture, pd);
+                auto effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::Texture, pd);
                 effect->SetTexture(defaultTex, sampler);
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::Texture | EffectFlags::Fog, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::Texture | EffectFlags::Fog, pd);
                 effect->SetTexture(defaultTex, sampler);
                 effect->SetFogColor(Colors::Black);
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::Texture | EffectFlags::VertexColor, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::Texture | EffectFlags::VertexColor, pd);
                 effect->SetTexture(defaultTex, sampler);
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::Texture | EffectFlags::Fog | EffectFlags::VertexColor, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::Texture | EffectFlags::Fog | EffectFlags::VertexColor, pd);
                 effect->SetFogColor(Colors::Black);
                 effect->SetTexture(defaultTex, sampler);
                 basic.emplace_back(std::move(effect));
@@ -1262,41 +1384,41 @@ void Game::CreateDeviceDependentResources()
 
             // BasicEffect (vertex lighting)
             {
-                auto effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::Lighting, pd);
+                auto effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::Lighting, pd);
                 effect->EnableDefaultLighting();
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::Lighting | EffectFlags::Fog, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::Lighting | EffectFlags::Fog, pd);
                 effect->EnableDefaultLighting();
                 effect->SetFogColor(Colors::Black);
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::Lighting | EffectFlags::VertexColor, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::Lighting | EffectFlags::VertexColor, pd);
                 effect->EnableDefaultLighting();
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::Lighting | EffectFlags::Fog | EffectFlags::VertexColor, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::Lighting | EffectFlags::Fog | EffectFlags::VertexColor, pd);
                 effect->SetFogColor(Colors::Black);
                 effect->EnableDefaultLighting();
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::Lighting | EffectFlags::Texture, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::Lighting | EffectFlags::Texture, pd);
                 effect->EnableDefaultLighting();
                 effect->SetTexture(defaultTex, sampler);
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::Lighting | EffectFlags::Texture | EffectFlags::Fog, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::Lighting | EffectFlags::Texture | EffectFlags::Fog, pd);
                 effect->EnableDefaultLighting();
                 effect->SetTexture(defaultTex, sampler);
                 effect->SetFogColor(Colors::Black);
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::Lighting | EffectFlags::Texture | EffectFlags::VertexColor, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::Lighting | EffectFlags::Texture | EffectFlags::VertexColor, pd);
                 effect->EnableDefaultLighting();
                 effect->SetTexture(defaultTex, sampler);
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::Lighting | EffectFlags::Texture | EffectFlags::Fog | EffectFlags::VertexColor, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::Lighting | EffectFlags::Texture | EffectFlags::Fog | EffectFlags::VertexColor, pd);
                 effect->EnableDefaultLighting();
                 effect->SetFogColor(Colors::Black);
                 effect->SetTexture(defaultTex, sampler);
@@ -1305,41 +1427,41 @@ void Game::CreateDeviceDependentResources()
 
             // BasicEffect (per pixel light)
             {
-                auto effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::PerPixelLighting, pd);
+                auto effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting, pd);
                 effect->EnableDefaultLighting();
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fog, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fog, pd);
                 effect->EnableDefaultLighting();
                 effect->SetFogColor(Colors::Black);
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::PerPixelLighting | EffectFlags::VertexColor, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting | EffectFlags::VertexColor, pd);
                 effect->EnableDefaultLighting();
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fog | EffectFlags::VertexColor, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fog | EffectFlags::VertexColor, pd);
                 effect->EnableDefaultLighting();
                 effect->SetFogColor(Colors::Black);
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::PerPixelLighting | EffectFlags::Texture, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting | EffectFlags::Texture, pd);
                 effect->EnableDefaultLighting();
                 effect->SetTexture(defaultTex, sampler);
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::PerPixelLighting | EffectFlags::Texture | EffectFlags::Fog, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting | EffectFlags::Texture | EffectFlags::Fog, pd);
                 effect->EnableDefaultLighting();
                 effect->SetTexture(defaultTex, sampler);
                 effect->SetFogColor(Colors::Black);
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::PerPixelLighting | EffectFlags::Texture | EffectFlags::VertexColor, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting | EffectFlags::Texture | EffectFlags::VertexColor, pd);
                 effect->EnableDefaultLighting();
                 effect->SetTexture(defaultTex, sampler);
                 basic.emplace_back(std::move(effect));
 
-                effect = std::make_unique<BasicEffect>(device, eflags | EffectFlags::PerPixelLighting | EffectFlags::Texture | EffectFlags::Fog | EffectFlags::VertexColor, pd);
+                effect = std::make_unique<BasicEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting | EffectFlags::Texture | EffectFlags::Fog | EffectFlags::VertexColor, pd);
                 effect->EnableDefaultLighting();
                 effect->SetFogColor(Colors::Black);
                 effect->SetTexture(defaultTex, sampler);
@@ -1363,12 +1485,12 @@ void Game::CreateDeviceDependentResources()
 
             // SkinnedEFfect (vertex lighting)
             {
-                auto effect = std::make_unique<SkinnedEffect>(device, eflags, pd);
+                auto effect = std::make_unique<SkinnedEffect>(effectDevice, eflags, pd);
                 effect->EnableDefaultLighting();
                 effect->SetTexture(defaultTex, sampler);
                 skinning.emplace_back(std::move(effect));
 
-                effect = std::make_unique<SkinnedEffect>(device, eflags | EffectFlags::Fog, pd);
+                effect = std::make_unique<SkinnedEffect>(effectDevice, eflags | EffectFlags::Fog, pd);
                 effect->EnableDefaultLighting();
                 effect->SetTexture(defaultTex, sampler);
                 effect->SetFogColor(Colors::Black);
@@ -1377,12 +1499,12 @@ void Game::CreateDeviceDependentResources()
 
             // SkinnedEFfect (per pixel lighting)
             {
-                auto effect = std::make_unique<SkinnedEffect>(device, eflags | EffectFlags::PerPixelLighting, pd);
+                auto effect = std::make_unique<SkinnedEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting, pd);
                 effect->EnableDefaultLighting();
                 effect->SetTexture(defaultTex, sampler);
                 skinning.emplace_back(std::move(effect));
 
-                effect = std::make_unique<SkinnedEffect>(device, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fog, pd);
+                effect = std::make_unique<SkinnedEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fog, pd);
                 effect->EnableDefaultLighting();
                 effect->SetTexture(defaultTex, sampler);
                 effect->SetFogColor(Colors::Black);
@@ -1407,13 +1529,13 @@ void Game::CreateDeviceDependentResources()
             std::vector<std::unique_ptr<DirectX::EnvironmentMapEffect>> envmaps;
 
             // EnvironmentMapEffect (fresnel)
-            auto effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::Fresnel, pd);
+            auto effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::Fresnel, pd);
             effect->EnableDefaultLighting();
             effect->SetTexture(defaultTex, sampler);
             effect->SetEnvironmentMap(envmap, sampler);
             envmaps.emplace_back(std::move(effect));
 
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::Fog | EffectFlags::Fresnel, pd);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::Fog | EffectFlags::Fresnel, pd);
             effect->EnableDefaultLighting();
             effect->SetTexture(defaultTex, sampler);
             effect->SetEnvironmentMap(envmap, sampler);
@@ -1421,13 +1543,13 @@ void Game::CreateDeviceDependentResources()
             envmaps.emplace_back(std::move(effect));
 
             // EnvironmentMapEffect (no fresnel)
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags, pd);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags, pd);
             effect->EnableDefaultLighting();
             effect->SetTexture(defaultTex, sampler);
             effect->SetEnvironmentMap(envmap, sampler);
             envmaps.emplace_back(std::move(effect));
 
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::Fog, pd);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::Fog, pd);
             effect->EnableDefaultLighting();
             effect->SetTexture(defaultTex, sampler);
             effect->SetEnvironmentMap(envmap, sampler);
@@ -1435,14 +1557,14 @@ void Game::CreateDeviceDependentResources()
             envmaps.emplace_back(std::move(effect));
 
             // EnvironmentMapEffect (specular)
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::Specular, pd);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::Specular, pd);
             effect->EnableDefaultLighting();
             effect->SetEnvironmentMapSpecular(Colors::Blue);
             effect->SetTexture(defaultTex, sampler);
             effect->SetEnvironmentMap(envmap, sampler);
             envmaps.emplace_back(std::move(effect));
 
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::Specular | EffectFlags::Fog, pd);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::Specular | EffectFlags::Fog, pd);
             effect->EnableDefaultLighting();
             effect->SetEnvironmentMapSpecular(Colors::Blue);
             effect->SetTexture(defaultTex, sampler);
@@ -1451,14 +1573,14 @@ void Game::CreateDeviceDependentResources()
             envmaps.emplace_back(std::move(effect));
 
             // EnvironmentMapEffect (fresnel + specular)
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::Fresnel | EffectFlags::Specular, pd);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::Fresnel | EffectFlags::Specular, pd);
             effect->EnableDefaultLighting();
             effect->SetEnvironmentMapSpecular(Colors::Blue);
             effect->SetTexture(defaultTex, sampler);
             effect->SetEnvironmentMap(envmap, sampler);
             envmaps.emplace_back(std::move(effect));
 
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::Fresnel | EffectFlags::Specular | EffectFlags::Fog, pd);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::Fresnel | EffectFlags::Specular | EffectFlags::Fog, pd);
             effect->EnableDefaultLighting();
             effect->SetEnvironmentMapSpecular(Colors::Blue);
             effect->SetTexture(defaultTex, sampler);
@@ -1467,14 +1589,14 @@ void Game::CreateDeviceDependentResources()
             envmaps.emplace_back(std::move(effect));
 
             // EnvironmentMapEffect (per pixel lighting)
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fresnel, pd, EnvironmentMapEffect::Mapping_Cube);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fresnel, pd, EnvironmentMapEffect::Mapping_Cube);
             effect->EnableDefaultLighting();
             effect->SetEnvironmentMapSpecular(Colors::Blue);
             effect->SetTexture(defaultTex, sampler);
             effect->SetEnvironmentMap(envmap, sampler);
             envmaps.emplace_back(std::move(effect));
 
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fresnel | EffectFlags::Fog, pd, EnvironmentMapEffect::Mapping_Cube);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fresnel | EffectFlags::Fog, pd, EnvironmentMapEffect::Mapping_Cube);
             effect->EnableDefaultLighting();
             effect->SetEnvironmentMapSpecular(Colors::Blue);
             effect->SetTexture(defaultTex, sampler);
@@ -1482,14 +1604,14 @@ void Game::CreateDeviceDependentResources()
             effect->SetFogColor(Colors::Black);
             envmaps.emplace_back(std::move(effect));
 
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::PerPixelLighting, pd, EnvironmentMapEffect::Mapping_Cube);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting, pd, EnvironmentMapEffect::Mapping_Cube);
             effect->EnableDefaultLighting();
             effect->SetEnvironmentMapSpecular(Colors::Blue);
             effect->SetTexture(defaultTex, sampler);
             effect->SetEnvironmentMap(envmap, sampler);
             envmaps.emplace_back(std::move(effect));
 
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fog, pd, EnvironmentMapEffect::Mapping_Cube);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fog, pd, EnvironmentMapEffect::Mapping_Cube);
             effect->EnableDefaultLighting();
             effect->SetEnvironmentMapSpecular(Colors::Blue);
             effect->SetTexture(defaultTex, sampler);
@@ -1500,14 +1622,14 @@ void Game::CreateDeviceDependentResources()
             // EnvironmentMapEffect sphere mapping (per pixel lighting only)
             auto spheremap = m_resourceDescriptors->GetGpuHandle(Descriptors::SphereMap);
 
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fresnel, pd, EnvironmentMapEffect::Mapping_Sphere);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fresnel, pd, EnvironmentMapEffect::Mapping_Sphere);
             effect->EnableDefaultLighting();
             effect->SetEnvironmentMapSpecular(Colors::Green);
             effect->SetTexture(defaultTex, sampler);
             effect->SetEnvironmentMap(spheremap, sampler);
             envmaps.emplace_back(std::move(effect));
 
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fresnel | EffectFlags::Fog, pd, EnvironmentMapEffect::Mapping_Sphere);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fresnel | EffectFlags::Fog, pd, EnvironmentMapEffect::Mapping_Sphere);
             effect->EnableDefaultLighting();
             effect->SetEnvironmentMapSpecular(Colors::Green);
             effect->SetTexture(defaultTex, sampler);
@@ -1515,14 +1637,14 @@ void Game::CreateDeviceDependentResources()
             effect->SetFogColor(Colors::Black);
             envmaps.emplace_back(std::move(effect));
 
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::PerPixelLighting, pd, EnvironmentMapEffect::Mapping_Sphere);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting, pd, EnvironmentMapEffect::Mapping_Sphere);
             effect->EnableDefaultLighting();
             effect->SetEnvironmentMapSpecular(Colors::Green);
             effect->SetTexture(defaultTex, sampler);
             effect->SetEnvironmentMap(spheremap, sampler);
             envmaps.emplace_back(std::move(effect));
 
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fog, pd, EnvironmentMapEffect::Mapping_Sphere);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fog, pd, EnvironmentMapEffect::Mapping_Sphere);
             effect->EnableDefaultLighting();
             effect->SetEnvironmentMapSpecular(Colors::Green);
             effect->SetTexture(defaultTex, sampler);
@@ -1533,14 +1655,14 @@ void Game::CreateDeviceDependentResources()
             // EnvironmentMapEffect dual parabolic mapping (per pixel lighting only)
             auto dualmap = m_resourceDescriptors->GetGpuHandle(Descriptors::DualParabolaMap);
 
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fresnel, pd, EnvironmentMapEffect::Mapping_DualParabola);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fresnel, pd, EnvironmentMapEffect::Mapping_DualParabola);
             effect->EnableDefaultLighting();
             effect->SetEnvironmentMapSpecular(Colors::Red);
             effect->SetTexture(defaultTex, sampler);
             effect->SetEnvironmentMap(dualmap, sampler);
             envmaps.emplace_back(std::move(effect));
 
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fresnel | EffectFlags::Fog, pd, EnvironmentMapEffect::Mapping_DualParabola);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fresnel | EffectFlags::Fog, pd, EnvironmentMapEffect::Mapping_DualParabola);
             effect->EnableDefaultLighting();
             effect->SetEnvironmentMapSpecular(Colors::Red);
             effect->SetTexture(defaultTex, sampler);
@@ -1548,14 +1670,14 @@ void Game::CreateDeviceDependentResources()
             effect->SetFogColor(Colors::Black);
             envmaps.emplace_back(std::move(effect));
 
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::PerPixelLighting, pd, EnvironmentMapEffect::Mapping_DualParabola);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting, pd, EnvironmentMapEffect::Mapping_DualParabola);
             effect->EnableDefaultLighting();
             effect->SetEnvironmentMapSpecular(Colors::Red);
             effect->SetTexture(defaultTex, sampler);
             effect->SetEnvironmentMap(dualmap, sampler);
             envmaps.emplace_back(std::move(effect));
 
-            effect = std::make_unique<EnvironmentMapEffect>(device, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fog, pd, EnvironmentMapEffect::Mapping_DualParabola);
+            effect = std::make_unique<EnvironmentMapEffect>(effectDevice, eflags | EffectFlags::PerPixelLighting | EffectFlags::Fog, pd, EnvironmentMapEffect::Mapping_DualParabola);
             effect->EnableDefaultLighting();
             effect->SetEnvironmentMapSpecular(Colors::Red);
             effect->SetTexture(defaultTex, sampler);
@@ -1584,34 +1706,34 @@ void Game::CreateDeviceDependentResources()
             std::vector<std::unique_ptr<DirectX::NormalMapEffect>> normalMapInst;
 
             // NormalMapEffect (no specular)
-            auto effect = std::make_unique<NormalMapEffect>(device, eflags, pd);
+            auto effect = std::make_unique<NormalMapEffect>(effectDevice, eflags, pd);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             effect->SetNormalTexture(normal);
             normalMap.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NormalMapEffect>(device, eflags | EffectFlags::Fog, pd);
+            effect = std::make_unique<NormalMapEffect>(effectDevice, eflags | EffectFlags::Fog, pd);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             effect->SetNormalTexture(normal);
             effect->SetFogColor(Colors::Black);
             normalMap.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NormalMapEffect>(device, eflags | EffectFlags::Instancing, pdInst);
+            effect = std::make_unique<NormalMapEffect>(effectDevice, eflags | EffectFlags::Instancing, pdInst);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             effect->SetNormalTexture(normal);
             normalMapInst.emplace_back(std::move(effect));
 
             // NormalMapEffect (specular)
-            effect = std::make_unique<NormalMapEffect>(device, eflags | EffectFlags::Specular, pd);
+            effect = std::make_unique<NormalMapEffect>(effectDevice, eflags | EffectFlags::Specular, pd);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             effect->SetNormalTexture(normal);
             effect->SetSpecularTexture(specular);
             normalMap.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NormalMapEffect>(device, eflags | EffectFlags::Specular | EffectFlags::Fog, pd);
+            effect = std::make_unique<NormalMapEffect>(effectDevice, eflags | EffectFlags::Specular | EffectFlags::Fog, pd);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             effect->SetNormalTexture(normal);
@@ -1619,7 +1741,7 @@ void Game::CreateDeviceDependentResources()
             effect->SetFogColor(Colors::Black);
             normalMap.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NormalMapEffect>(device, eflags | EffectFlags::Instancing | EffectFlags::Specular, pdInst);
+            effect = std::make_unique<NormalMapEffect>(effectDevice, eflags | EffectFlags::Instancing | EffectFlags::Specular, pdInst);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             effect->SetNormalTexture(normal);
@@ -1627,40 +1749,40 @@ void Game::CreateDeviceDependentResources()
             normalMapInst.emplace_back(std::move(effect));
 
             // NormalMapEffect (vertex color)
-            effect = std::make_unique<NormalMapEffect>(device, eflags | EffectFlags::VertexColor, pd);
+            effect = std::make_unique<NormalMapEffect>(effectDevice, eflags | EffectFlags::VertexColor, pd);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             effect->SetNormalTexture(normal);
             normalMap.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NormalMapEffect>(device, eflags | EffectFlags::Instancing | EffectFlags::VertexColor, pdInst);
+            effect = std::make_unique<NormalMapEffect>(effectDevice, eflags | EffectFlags::Instancing | EffectFlags::VertexColor, pdInst);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             effect->SetNormalTexture(normal);
             normalMapInst.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NormalMapEffect>(device, eflags | EffectFlags::VertexColor | EffectFlags::Fog, pd);
+            effect = std::make_unique<NormalMapEffect>(effectDevice, eflags | EffectFlags::VertexColor | EffectFlags::Fog, pd);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             effect->SetNormalTexture(normal);
             effect->SetFogColor(Colors::Black);
             normalMap.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NormalMapEffect>(device, eflags | EffectFlags::VertexColor | EffectFlags::Specular, pd);
+            effect = std::make_unique<NormalMapEffect>(effectDevice, eflags | EffectFlags::VertexColor | EffectFlags::Specular, pd);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             effect->SetNormalTexture(normal);
             effect->SetSpecularTexture(specular);
             normalMap.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NormalMapEffect>(device, eflags | EffectFlags::Instancing | EffectFlags::VertexColor | EffectFlags::Specular, pdInst);
+            effect = std::make_unique<NormalMapEffect>(effectDevice, eflags | EffectFlags::Instancing | EffectFlags::VertexColor | EffectFlags::Specular, pdInst);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             effect->SetNormalTexture(normal);
             effect->SetSpecularTexture(specular);
             normalMapInst.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NormalMapEffect>(device, eflags | EffectFlags::VertexColor | EffectFlags::Specular | EffectFlags::Fog, pd);
+            effect = std::make_unique<NormalMapEffect>(effectDevice, eflags | EffectFlags::VertexColor | EffectFlags::Specular | EffectFlags::Fog, pd);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             effect->SetNormalTexture(normal);
@@ -1690,13 +1812,13 @@ void Game::CreateDeviceDependentResources()
             std::vector<std::unique_ptr<DirectX::SkinnedNormalMapEffect>> normalMap;
 
             // SkinnedNormalMapEffect (no specular)
-            auto effect = std::make_unique<SkinnedNormalMapEffect>(device, eflags, pd);
+            auto effect = std::make_unique<SkinnedNormalMapEffect>(effectDevice, eflags, pd);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             effect->SetNormalTexture(normal);
             normalMap.emplace_back(std::move(effect));
 
-            effect = std::make_unique<SkinnedNormalMapEffect>(device, eflags | EffectFlags::Fog, pd);
+            effect = std::make_unique<SkinnedNormalMapEffect>(effectDevice, eflags | EffectFlags::Fog, pd);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             effect->SetNormalTexture(normal);
@@ -1704,14 +1826,14 @@ void Game::CreateDeviceDependentResources()
             normalMap.emplace_back(std::move(effect));
 
             // SkinnedNormalMapEffect (specular)
-            effect = std::make_unique<SkinnedNormalMapEffect>(device, eflags | EffectFlags::Specular, pd);
+            effect = std::make_unique<SkinnedNormalMapEffect>(effectDevice, eflags | EffectFlags::Specular, pd);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             effect->SetNormalTexture(normal);
             effect->SetSpecularTexture(specular);
             normalMap.emplace_back(std::move(effect));
 
-            effect = std::make_unique<SkinnedNormalMapEffect>(device, eflags | EffectFlags::Specular | EffectFlags::Fog, pd);
+            effect = std::make_unique<SkinnedNormalMapEffect>(effectDevice, eflags | EffectFlags::Specular | EffectFlags::Fog, pd);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             effect->SetNormalTexture(normal);
@@ -1745,7 +1867,7 @@ void Game::CreateDeviceDependentResources()
             std::vector<std::unique_ptr<DirectX::PBREffect>> pbrInst;
 
             // PBREffect
-            auto effect = std::make_unique<PBREffect>(device, eflags, pd);
+            auto effect = std::make_unique<PBREffect>(effectDevice, eflags, pd);
             effect->EnableDefaultLighting();
             effect->SetConstantAlbedo(Colors::Cyan);
             effect->SetConstantMetallic(0.5f);
@@ -1753,7 +1875,7 @@ void Game::CreateDeviceDependentResources()
             effect->SetIBLTextures(radiance, diffuseDesc.MipLevels, irradiance, m_states->LinearWrap());
             pbr.emplace_back(std::move(effect));
 
-            effect = std::make_unique<PBREffect>(device, eflags | EffectFlags::Instancing, pdInst);
+            effect = std::make_unique<PBREffect>(effectDevice, eflags | EffectFlags::Instancing, pdInst);
             effect->EnableDefaultLighting();
             effect->SetConstantAlbedo(Colors::Cyan);
             effect->SetConstantMetallic(0.5f);
@@ -1766,13 +1888,13 @@ void Game::CreateDeviceDependentResources()
             auto normal = m_resourceDescriptors->GetGpuHandle(Descriptors::PBRNormal);
             auto rma = m_resourceDescriptors->GetGpuHandle(Descriptors::PBR_RMA);
 
-            effect = std::make_unique<PBREffect>(device, eflags | EffectFlags::Texture, pd);
+            effect = std::make_unique<PBREffect>(effectDevice, eflags | EffectFlags::Texture, pd);
             effect->EnableDefaultLighting();
             effect->SetIBLTextures(radiance, diffuseDesc.MipLevels, irradiance, m_states->LinearWrap());
             effect->SetSurfaceTextures(albedo, normal, rma, m_states->AnisotropicClamp());
             pbr.emplace_back(std::move(effect));
 
-            effect = std::make_unique<PBREffect>(device, eflags | EffectFlags::Instancing | EffectFlags::Texture, pdInst);
+            effect = std::make_unique<PBREffect>(effectDevice, eflags | EffectFlags::Instancing | EffectFlags::Texture, pdInst);
             effect->EnableDefaultLighting();
             effect->SetIBLTextures(radiance, diffuseDesc.MipLevels, irradiance, m_states->LinearWrap());
             effect->SetSurfaceTextures(albedo, normal, rma, m_states->AnisotropicClamp());
@@ -1781,14 +1903,14 @@ void Game::CreateDeviceDependentResources()
             // PBREffect (emissive)
             auto emissive = m_resourceDescriptors->GetGpuHandle(Descriptors::PBREmissive);
 
-            effect = std::make_unique<PBREffect>(device, eflags | EffectFlags::Texture | EffectFlags::Emissive, pd);
+            effect = std::make_unique<PBREffect>(effectDevice, eflags | EffectFlags::Texture | EffectFlags::Emissive, pd);
             effect->EnableDefaultLighting();
             effect->SetIBLTextures(radiance, diffuseDesc.MipLevels, irradiance, m_states->LinearWrap());
             effect->SetSurfaceTextures(albedo, normal, rma, m_states->AnisotropicClamp());
             effect->SetEmissiveTexture(emissive);
             pbr.emplace_back(std::move(effect));
 
-            effect = std::make_unique<PBREffect>(device, eflags | EffectFlags::Instancing | EffectFlags::Texture | EffectFlags::Emissive, pdInst);
+            effect = std::make_unique<PBREffect>(effectDevice, eflags | EffectFlags::Instancing | EffectFlags::Texture | EffectFlags::Emissive, pdInst);
             effect->EnableDefaultLighting();
             effect->SetIBLTextures(radiance, diffuseDesc.MipLevels, irradiance, m_states->LinearWrap());
             effect->SetSurfaceTextures(albedo, normal, rma, m_states->AnisotropicClamp());
@@ -1796,7 +1918,7 @@ void Game::CreateDeviceDependentResources()
             pbrInst.emplace_back(std::move(effect));
 
             // PBREffect (velocity)
-            effect = std::make_unique<PBREffect>(device, eflags | EffectFlags::Texture | EffectFlags::Velocity, opaquePd);
+            effect = std::make_unique<PBREffect>(effectDevice, eflags | EffectFlags::Texture | EffectFlags::Velocity, opaquePd);
             effect->EnableDefaultLighting();
             effect->SetIBLTextures(radiance, diffuseDesc.MipLevels, irradiance, m_states->LinearWrap());
             effect->SetSurfaceTextures(albedo, normal, rma, m_states->AnisotropicClamp());
@@ -1804,7 +1926,7 @@ void Game::CreateDeviceDependentResources()
             pbr.emplace_back(std::move(effect));
 
             // PBREffect (velocity + emissive)
-            effect = std::make_unique<PBREffect>(device, eflags | EffectFlags::Texture | EffectFlags::Emissive | EffectFlags::Velocity, opaquePd);
+            effect = std::make_unique<PBREffect>(effectDevice, eflags | EffectFlags::Texture | EffectFlags::Emissive | EffectFlags::Velocity, opaquePd);
             effect->EnableDefaultLighting();
             effect->SetIBLTextures(radiance, diffuseDesc.MipLevels, irradiance, m_states->LinearWrap());
             effect->SetSurfaceTextures(albedo, normal, rma, m_states->AnisotropicClamp());
@@ -1839,7 +1961,7 @@ void Game::CreateDeviceDependentResources()
             std::vector<std::unique_ptr<DirectX::SkinnedPBREffect>> pbr;
 
             // SkinnedPBREffect
-            auto effect = std::make_unique<SkinnedPBREffect>(device, eflags, pd);
+            auto effect = std::make_unique<SkinnedPBREffect>(effectDevice, eflags, pd);
             effect->EnableDefaultLighting();
             effect->SetConstantAlbedo(Colors::Cyan);
             effect->SetConstantMetallic(0.5f);
@@ -1852,7 +1974,7 @@ void Game::CreateDeviceDependentResources()
             auto normal = m_resourceDescriptors->GetGpuHandle(Descriptors::PBRNormal);
             auto rma = m_resourceDescriptors->GetGpuHandle(Descriptors::PBR_RMA);
 
-            effect = std::make_unique<SkinnedPBREffect>(device, eflags | EffectFlags::Texture, pd);
+            effect = std::make_unique<SkinnedPBREffect>(effectDevice, eflags | EffectFlags::Texture, pd);
             effect->EnableDefaultLighting();
             effect->SetIBLTextures(radiance, diffuseDesc.MipLevels, irradiance, m_states->LinearWrap());
             effect->SetSurfaceTextures(albedo, normal, rma, m_states->AnisotropicClamp());
@@ -1861,7 +1983,7 @@ void Game::CreateDeviceDependentResources()
             // SkinnedPBREffect (emissive)
             auto emissive = m_resourceDescriptors->GetGpuHandle(Descriptors::PBREmissive);
 
-            effect = std::make_unique<SkinnedPBREffect>(device, eflags | EffectFlags::Texture | EffectFlags::Emissive, pd);
+            effect = std::make_unique<SkinnedPBREffect>(effectDevice, eflags | EffectFlags::Texture | EffectFlags::Emissive, pd);
             effect->EnableDefaultLighting();
             effect->SetIBLTextures(radiance, diffuseDesc.MipLevels, irradiance, m_states->LinearWrap());
             effect->SetSurfaceTextures(albedo, normal, rma, m_states->AnisotropicClamp());
@@ -1885,35 +2007,35 @@ void Game::CreateDeviceDependentResources()
             std::vector<std::unique_ptr<DirectX::DebugEffect>> debugInst;
 
             // DebugEffect
-            auto effect = std::make_unique<DebugEffect>(device, eflags, pd, DebugEffect::Mode_Default);
+            auto effect = std::make_unique<DebugEffect>(effectDevice, eflags, pd, DebugEffect::Mode_Default);
             debug.emplace_back(std::move(effect));
 
-            effect = std::make_unique<DebugEffect>(device, eflags | EffectFlags::Instancing, pdInst, DebugEffect::Mode_Default);
+            effect = std::make_unique<DebugEffect>(effectDevice, eflags | EffectFlags::Instancing, pdInst, DebugEffect::Mode_Default);
             debugInst.emplace_back(std::move(effect));
 
-            effect = std::make_unique<DebugEffect>(device, eflags, pd, DebugEffect::Mode_Normals);
+            effect = std::make_unique<DebugEffect>(effectDevice, eflags, pd, DebugEffect::Mode_Normals);
             debug.emplace_back(std::move(effect));
 
-            effect = std::make_unique<DebugEffect>(device, eflags, pd, DebugEffect::Mode_Tangents);
+            effect = std::make_unique<DebugEffect>(effectDevice, eflags, pd, DebugEffect::Mode_Tangents);
             debug.emplace_back(std::move(effect));
 
-            effect = std::make_unique<DebugEffect>(device, eflags, pd, DebugEffect::Mode_BiTangents);
+            effect = std::make_unique<DebugEffect>(effectDevice, eflags, pd, DebugEffect::Mode_BiTangents);
             debug.emplace_back(std::move(effect));
 
             // DebugEffect (vertex color)
-            effect = std::make_unique<DebugEffect>(device, eflags | EffectFlags::VertexColor, pd, DebugEffect::Mode_Default);
+            effect = std::make_unique<DebugEffect>(effectDevice, eflags | EffectFlags::VertexColor, pd, DebugEffect::Mode_Default);
             debug.emplace_back(std::move(effect));
 
-            effect = std::make_unique<DebugEffect>(device, eflags | EffectFlags::Instancing | EffectFlags::VertexColor, pdInst, DebugEffect::Mode_Default);
+            effect = std::make_unique<DebugEffect>(effectDevice, eflags | EffectFlags::Instancing | EffectFlags::VertexColor, pdInst, DebugEffect::Mode_Default);
             debugInst.emplace_back(std::move(effect));
 
-            effect = std::make_unique<DebugEffect>(device, eflags | EffectFlags::VertexColor, pd, DebugEffect::Mode_Normals);
+            effect = std::make_unique<DebugEffect>(effectDevice, eflags | EffectFlags::VertexColor, pd, DebugEffect::Mode_Normals);
             debug.emplace_back(std::move(effect));
 
-            effect = std::make_unique<DebugEffect>(device, eflags | EffectFlags::VertexColor, pd, DebugEffect::Mode_Tangents);
+            effect = std::make_unique<DebugEffect>(effectDevice, eflags | EffectFlags::VertexColor, pd, DebugEffect::Mode_Tangents);
             debug.emplace_back(std::move(effect));
 
-            effect = std::make_unique<DebugEffect>(device, eflags | EffectFlags::VertexColor, pd, DebugEffect::Mode_BiTangents);
+            effect = std::make_unique<DebugEffect>(effectDevice, eflags | EffectFlags::VertexColor, pd, DebugEffect::Mode_BiTangents);
             debug.emplace_back(std::move(effect));
 
             if (!j)
@@ -1935,94 +2057,94 @@ void Game::CreateDeviceDependentResources()
             std::vector<std::unique_ptr<DirectX::NPREffect>> nprInst;
 
             // NPREffect
-            auto effect = std::make_unique<NPREffect>(device, eflags, pd, NPREffect::Mode_Cel);
+            auto effect = std::make_unique<NPREffect>(effectDevice, eflags, pd, NPREffect::Mode_Cel);
             npr.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags, pd, NPREffect::Mode_Gooch);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags, pd, NPREffect::Mode_Gooch);
             npr.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::VertexColor, pd, NPREffect::Mode_Cel);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::VertexColor, pd, NPREffect::Mode_Cel);
             npr.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::VertexColor, pd, NPREffect::Mode_Gooch);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::VertexColor, pd, NPREffect::Mode_Gooch);
             npr.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Texture, pd, NPREffect::Mode_Cel);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Texture, pd, NPREffect::Mode_Cel);
             effect->SetTexture(defaultTex, sampler);
             npr.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Texture, pd, NPREffect::Mode_Gooch);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Texture, pd, NPREffect::Mode_Gooch);
             effect->SetTexture(defaultTex, sampler);
             npr.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Texture | EffectFlags::VertexColor, pd, NPREffect::Mode_Cel);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Texture | EffectFlags::VertexColor, pd, NPREffect::Mode_Cel);
             effect->SetTexture(defaultTex, sampler);
             npr.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Texture | EffectFlags::VertexColor, pd, NPREffect::Mode_Gooch);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Texture | EffectFlags::VertexColor, pd, NPREffect::Mode_Gooch);
             effect->SetTexture(defaultTex, sampler);
             npr.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags, pd, NPREffect::Mode_MatCap);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags, pd, NPREffect::Mode_MatCap);
             effect->SetMatCap(defaultTex, sampler);
             npr.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::VertexColor, pd, NPREffect::Mode_MatCap);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::VertexColor, pd, NPREffect::Mode_MatCap);
             effect->SetMatCap(defaultTex, sampler);
             npr.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Texture, pd, NPREffect::Mode_MatCap);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Texture, pd, NPREffect::Mode_MatCap);
             effect->SetTexture(defaultTex, sampler);
             effect->SetMatCap(defaultTex);
             npr.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Texture | EffectFlags::VertexColor, pd, NPREffect::Mode_MatCap);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Texture | EffectFlags::VertexColor, pd, NPREffect::Mode_MatCap);
             effect->SetTexture(defaultTex, sampler);
             effect->SetMatCap(defaultTex);
             npr.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Instancing, pdInst, NPREffect::Mode_Cel);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Instancing, pdInst, NPREffect::Mode_Cel);
             nprInst.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Instancing | EffectFlags::VertexColor, pdInst, NPREffect::Mode_Cel);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Instancing | EffectFlags::VertexColor, pdInst, NPREffect::Mode_Cel);
             nprInst.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Instancing, pdInst, NPREffect::Mode_Gooch);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Instancing, pdInst, NPREffect::Mode_Gooch);
             nprInst.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Instancing | EffectFlags::VertexColor, pdInst, NPREffect::Mode_Gooch);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Instancing | EffectFlags::VertexColor, pdInst, NPREffect::Mode_Gooch);
             nprInst.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Texture | EffectFlags::Instancing, pdInst, NPREffect::Mode_Cel);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Texture | EffectFlags::Instancing, pdInst, NPREffect::Mode_Cel);
             effect->SetTexture(defaultTex, sampler);
             nprInst.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Texture | EffectFlags::Instancing | EffectFlags::VertexColor, pdInst, NPREffect::Mode_Cel);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Texture | EffectFlags::Instancing | EffectFlags::VertexColor, pdInst, NPREffect::Mode_Cel);
             effect->SetTexture(defaultTex, sampler);
             nprInst.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Texture | EffectFlags::Instancing, pdInst, NPREffect::Mode_Gooch);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Texture | EffectFlags::Instancing, pdInst, NPREffect::Mode_Gooch);
             effect->SetTexture(defaultTex, sampler);
             nprInst.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Texture | EffectFlags::Instancing | EffectFlags::VertexColor, pdInst, NPREffect::Mode_Gooch);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Texture | EffectFlags::Instancing | EffectFlags::VertexColor, pdInst, NPREffect::Mode_Gooch);
             effect->SetTexture(defaultTex, sampler);
             nprInst.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Instancing, pdInst, NPREffect::Mode_MatCap);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Instancing, pdInst, NPREffect::Mode_MatCap);
             effect->SetMatCap(defaultTex, sampler);
             nprInst.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Instancing | EffectFlags::VertexColor, pdInst, NPREffect::Mode_MatCap);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Instancing | EffectFlags::VertexColor, pdInst, NPREffect::Mode_MatCap);
             effect->SetMatCap(defaultTex, sampler);
             nprInst.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Instancing | EffectFlags::Texture, pdInst, NPREffect::Mode_MatCap);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Instancing | EffectFlags::Texture, pdInst, NPREffect::Mode_MatCap);
             effect->SetTexture(defaultTex, sampler);
             effect->SetMatCap(defaultTex);
             nprInst.emplace_back(std::move(effect));
 
-            effect = std::make_unique<NPREffect>(device, eflags | EffectFlags::Instancing | EffectFlags::Texture | EffectFlags::VertexColor, pdInst, NPREffect::Mode_MatCap);
+            effect = std::make_unique<NPREffect>(effectDevice, eflags | EffectFlags::Instancing | EffectFlags::Texture | EffectFlags::VertexColor, pdInst, NPREffect::Mode_MatCap);
             effect->SetTexture(defaultTex, sampler);
             effect->SetMatCap(defaultTex);
             nprInst.emplace_back(std::move(effect));
@@ -2047,19 +2169,19 @@ void Game::CreateDeviceDependentResources()
             std::vector<std::unique_ptr<DirectX::SkinnedNPREffect>> npr;
 
             // SkinnedNPREffect (cel shading)
-            auto effect = std::make_unique<SkinnedNPREffect>(device, eflags, pd, SkinnedNPREffect::Mode_Cel);
+            auto effect = std::make_unique<SkinnedNPREffect>(effectDevice, eflags, pd, SkinnedNPREffect::Mode_Cel);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             npr.emplace_back(std::move(effect));
 
             // SkinnedNPREffect (gooch shading)
-            effect = std::make_unique<SkinnedNPREffect>(device, eflags, pd, SkinnedNPREffect::Mode_Gooch);
+            effect = std::make_unique<SkinnedNPREffect>(effectDevice, eflags, pd, SkinnedNPREffect::Mode_Gooch);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             npr.emplace_back(std::move(effect));
 
             // SkinnedNPREffect (matcap shading)
-            effect = std::make_unique<SkinnedNPREffect>(device, eflags, pd, SkinnedNPREffect::Mode_MatCap);
+            effect = std::make_unique<SkinnedNPREffect>(effectDevice, eflags, pd, SkinnedNPREffect::Mode_MatCap);
             effect->EnableDefaultLighting();
             effect->SetTexture(diffuse, sampler);
             effect->SetMatCap(diffuse);
@@ -2088,23 +2210,23 @@ void Game::CreateDeviceDependentResources()
     {
         auto overlay = m_resourceDescriptors->GetGpuHandle(Descriptors::Overlay);
 
-        auto effect = std::make_unique<DualTextureEffect>(device, EffectFlags::None, pd);
+        auto effect = std::make_unique<DualTextureEffect>(effectDevice, EffectFlags::None, pd);
         effect->SetTexture(defaultTex, sampler);
         effect->SetTexture2(overlay, sampler);
         m_dual.emplace_back(std::move(effect));
 
-        effect = std::make_unique<DualTextureEffect>(device, EffectFlags::Fog, pd);
+        effect = std::make_unique<DualTextureEffect>(effectDevice, EffectFlags::Fog, pd);
         effect->SetTexture(defaultTex, sampler);
         effect->SetTexture2(overlay, sampler);
         effect->SetFogColor(Colors::Black);
         m_dual.emplace_back(std::move(effect));
 
-        effect = std::make_unique<DualTextureEffect>(device, EffectFlags::VertexColor, pd);
+        effect = std::make_unique<DualTextureEffect>(effectDevice, EffectFlags::VertexColor, pd);
         effect->SetTexture(defaultTex, sampler);
         effect->SetTexture2(overlay, sampler);
         m_dual.emplace_back(std::move(effect));
 
-        effect = std::make_unique<DualTextureEffect>(device, EffectFlags::VertexColor | EffectFlags::Fog, pd);
+        effect = std::make_unique<DualTextureEffect>(effectDevice, EffectFlags::VertexColor | EffectFlags::Fog, pd);
         effect->SetTexture(defaultTex, sampler);
         effect->SetTexture2(overlay, sampler);
         effect->SetFogColor(Colors::Black);
@@ -2117,43 +2239,68 @@ void Game::CreateDeviceDependentResources()
         auto cat = m_resourceDescriptors->GetGpuHandle(Descriptors::Cat);
 
         // AlphaTestEffect (lt/gt)
-        auto effect = std::make_unique<AlphaTestEffect>(device, EffectFlags::None, pd);
+        auto effect = std::make_unique<AlphaTestEffect>(effectDevice, EffectFlags::None, pd);
         effect->SetTexture(cat, sampler);
         m_alphTest.emplace_back(std::move(effect));
 
-        effect = std::make_unique<AlphaTestEffect>(device, EffectFlags::Fog, pd);
+        effect = std::make_unique<AlphaTestEffect>(effectDevice, EffectFlags::Fog, pd);
         effect->SetTexture(cat, sampler);
         effect->SetFogColor(Colors::Black);
         m_alphTest.emplace_back(std::move(effect));
 
-        effect = std::make_unique<AlphaTestEffect>(device, EffectFlags::VertexColor, pd);
+        effect = std::make_unique<AlphaTestEffect>(effectDevice, EffectFlags::VertexColor, pd);
         effect->SetTexture(cat, sampler);
         m_alphTest.emplace_back(std::move(effect));
 
-        effect = std::make_unique<AlphaTestEffect>(device, EffectFlags::VertexColor | EffectFlags::Fog, pd);
+        effect = std::make_unique<AlphaTestEffect>(effectDevice, EffectFlags::VertexColor | EffectFlags::Fog, pd);
         effect->SetTexture(cat, sampler);
         effect->SetFogColor(Colors::Black);
         m_alphTest.emplace_back(std::move(effect));
 
         // AlphaTestEffect (eg/ne)
-        effect = std::make_unique<AlphaTestEffect>(device, EffectFlags::None, pd, D3D12_COMPARISON_FUNC_NOT_EQUAL);
+        effect = std::make_unique<AlphaTestEffect>(effectDevice, EffectFlags::None, pd, D3D12_COMPARISON_FUNC_NOT_EQUAL);
         effect->SetTexture(cat, sampler);
         m_alphTest.emplace_back(std::move(effect));
 
-        effect = std::make_unique<AlphaTestEffect>(device, EffectFlags::Fog, pd, D3D12_COMPARISON_FUNC_NOT_EQUAL);
+        effect = std::make_unique<AlphaTestEffect>(effectDevice, EffectFlags::Fog, pd, D3D12_COMPARISON_FUNC_NOT_EQUAL);
         effect->SetTexture(cat, sampler);
         effect->SetFogColor(Colors::Black);
         m_alphTest.emplace_back(std::move(effect));
 
-        effect = std::make_unique<AlphaTestEffect>(device, EffectFlags::VertexColor, pd, D3D12_COMPARISON_FUNC_NOT_EQUAL);
+        effect = std::make_unique<AlphaTestEffect>(effectDevice, EffectFlags::VertexColor, pd, D3D12_COMPARISON_FUNC_NOT_EQUAL);
         effect->SetTexture(cat, sampler);
         m_alphTest.emplace_back(std::move(effect));
 
-        effect = std::make_unique<AlphaTestEffect>(device, EffectFlags::VertexColor | EffectFlags::Fog, pd, D3D12_COMPARISON_FUNC_NOT_EQUAL);
+        effect = std::make_unique<AlphaTestEffect>(effectDevice, EffectFlags::VertexColor | EffectFlags::Fog, pd, D3D12_COMPARISON_FUNC_NOT_EQUAL);
         effect->SetTexture(cat, sampler);
         effect->SetFogColor(Colors::Black);
         m_alphTest.emplace_back(std::move(effect));
     }
+
+    // Effect creation report
+    {
+        const double effectsTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - effectsBegin).count();
+
+        char buff[256] = {};
+#ifdef PIPELINE_STATE_CACHE
+        const auto cache = DX::PipelineStateCache::Get().GetStatistics();
+        sprintf_s(buff, "INFO: Effects %.1f ms (cached: %llu hits, %llu misses, %.1f ms creating pipeline states)\n",
+            effectsTime, cache.hits - cacheBefore.hits, cache.misses - cacheBefore.misses, cache.createTime - cacheBefore.createTime);
+#else
+        sprintf_s(buff, "INFO: Effects %.1f ms (uncached)\n", effectsTime);
+#endif
+        OutputDebugStringA(buff);
+
+#ifdef PIPELINE_LIBRARY
+        const auto state = m_pipelineLibrary->GetState();
+        const auto library = m_pipelineLibrary->GetStatistics();
+        sprintf_s(buff, "INFO: %s start from pipeline library (%s, %zu bytes, %.1f ms opening): %llu loaded in %.1f ms, %llu created in %.1f ms\n",
+            (state == DX::PipelineLibrary::State::Loaded) ? "Warm" : "Cold",
+            DX::PipelineLibrary::GetStateName(state), library.fileSize, library.openTime,
+            library.loaded, library.loadTime, library.created, library.createTime);
+        OutputDebugStringA(buff);
+#endif
+    }
 }
 
 // Allocate all memory resources that change on a window SizeChanged event.
@@ -2384,6 +2531,15 @@ void Game::OnDeviceLost()
     m_renderDescriptors.reset();
     m_states.reset();
     m_graphicsMemory.reset();
+
+#ifdef PIPELINE_LIBRARY
+    ClosePipelineLibrary(m_pipelineLibrary);
+#endif
+
+#ifdef PIPELINE_STATE_CACHE
+    DX::PipelineStateCache::Get().Clear(m_deviceResources->GetD3DDevice());
+    m_pipelineDevice.Reset();
+#endif
 }
 
 void Game::OnDeviceRestored()
@@ -13,6 +13,7 @@
 #include "DirectXTKTest.h"
 #include "StepTimer.h"
 
+#include "PipelineLibrary.h"
 #include "RenderTexture.h"
 
 constexpr uint32_t c_testTimeout = 10000;
@@ -84,6 +85,8 @@ private:
     void Render();
 
     void Clear();
+    void SetRenderTargets(ID3D12GraphicsCommandList* commandList);
+    void RecordDraws(ID3D12GraphicsCommandList* commandList, size_t begin, size_t end);
 
     void CreateDeviceDependentResources();
     void CreateWindowSizeDependentResources();
@@ -107,6 +110,8 @@ private:
 
     // DirectXTK Test Objects
     std::unique_ptr<DirectX::GraphicsMemory>    m_graphicsMemory;
+    Microsoft::WRL::ComPtr<ID3D12Device>        m_pipelineDevice;
+    std::unique_ptr<DX::PipelineLibrary>        m_pipelineLibrary;
 
     std::unique_ptr<DirectX::CommonStates>      m_states;
     std::unique_ptr<DirectX::DescriptorHeap>    m_resourceDescriptors;
@@ -174,6 +179,17 @@ private:
 
     std::unique_ptr<DirectX::XMFLOAT3X4[]>          m_instanceTransforms;
 
+    // Draws gathered each frame, so they can be split across command lists
+    struct DrawItem
+    {
+        DirectX::IEffect*                   effect;
+        const D3D12_VERTEX_BUFFER_VIEW*     vertexBuffers;
+        UINT                                vertexBufferCount;
+        UINT                                instanceCount;
+    };
+
+    std::vector<DrawItem>                           m_drawItems;
+
     enum RenderMode
     {
         Render_Normal,
@@ -184,6 +200,7 @@ private:
     };
 
     unsigned int                                    m_renderMode;
+    bool                                            m_parallelRecord;
     float                                           m_delay;
     uint64_t                                        m_frame;
 